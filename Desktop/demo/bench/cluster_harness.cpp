@@ -0,0 +1,339 @@
+#include "common.h"
+#include "../crypto/crypto_utils.h"
+#include "../crypto/replication.h"
+#include "../client/secure_client.h"
+#include "logger.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+    #include <sys/socket.h>
+    #include <sys/wait.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <fcntl.h>
+    #include <signal.h>
+    #include <unistd.h>
+#endif
+
+// Local multi-process cluster harness: starts N server processes on
+// localhost with full-mesh session replication, opens sessions on node 0,
+// measures how long each session takes to reach the other nodes (the
+// harness itself joins the mesh as a receive-only peer), then kills node 0
+// and measures how long clients take to resume their sessions on node 1.
+// Finally one resumed client keeps sending on node 1 past the idle timeout,
+// while the other nodes' copies of its session go idle, and must not lose
+// its session.
+
+#ifdef _WIN32
+
+int main() {
+    std::cerr << "cluster_harness requires a POSIX system" << std::endl;
+    return 1;
+}
+
+#else
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsed_ms(Clock::time_point begin, Clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+void print_latency(const std::string& label, std::vector<double> samples) {
+    if (samples.empty()) {
+        std::cout << std::left << std::setw(24) << label << "no samples" << std::endl;
+        return;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto pct = [&samples](double p) {
+        return samples[std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()))];
+    };
+    std::cout << std::left << std::setw(24) << label << std::right
+              << "p50 " << std::setw(8) << pct(0.50) << " ms   "
+              << "p99 " << std::setw(8) << pct(0.99) << " ms   "
+              << "max " << std::setw(8) << samples.back() << " ms" << std::endl;
+}
+
+bool port_open(uint16_t port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    bool ok = connect(sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0;
+    close(sock);
+    return ok;
+}
+
+pid_t spawn_node(const std::string& binary, const std::vector<std::string>& args, const std::string& log_path) {
+    pid_t pid = fork();
+    if (pid != 0) {
+        return pid;
+    }
+
+    int log_fd = open(log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (log_fd >= 0) {
+        dup2(log_fd, STDOUT_FILENO);
+        dup2(log_fd, STDERR_FILENO);
+        close(log_fd);
+    }
+
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(binary.c_str()));
+    for (const std::string& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    execv(binary.c_str(), argv.data());
+    _exit(127);
+}
+
+// Receive-only mesh member that timestamps each session's first arrival
+class ArrivalRecorder {
+public:
+    void record(const SecureComm::SessionChange& change) {
+        if (change.op != SecureComm::SessionChange::Op::PUT) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            removals_[change.session.session_id]++;
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        arrivals_.emplace(change.session.session_id, Clock::now());
+        cv_.notify_all();
+    }
+
+    bool wait_for(const std::vector<uint32_t>& session_ids, std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, timeout, [&]() {
+            for (uint32_t id : session_ids) {
+                if (arrivals_.find(id) == arrivals_.end()) {
+                    return false;
+                }
+            }
+            return true;
+        });
+    }
+
+    Clock::time_point arrival(uint32_t session_id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return arrivals_.at(session_id);
+    }
+
+    size_t removals(uint32_t session_id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = removals_.find(session_id);
+        return it == removals_.end() ? 0 : it->second;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::unordered_map<uint32_t, Clock::time_point> arrivals_;
+    std::unordered_map<uint32_t, size_t> removals_;
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t node_count = 3;
+    size_t session_count = 50;
+    std::string server_binary = "./server";
+    uint16_t base_port = 9400;
+    // Must outlast opening every session and the failover, or replicas drop
+    // their idle copies before the clients move
+    std::chrono::seconds idle_timeout(30);
+    if (argc > 1) node_count = std::max<size_t>(2, std::stoul(argv[1]));
+    if (argc > 2) session_count = std::stoul(argv[2]);
+    if (argc > 3) server_binary = argv[3];
+    if (argc > 4) base_port = static_cast<uint16_t>(std::stoi(argv[4]));
+    if (argc > 5) idle_timeout = std::chrono::seconds(std::max(1l, std::stol(argv[5])));
+
+    signal(SIGPIPE, SIG_IGN);
+
+    const std::string key_path = "cluster_harness.key";
+    std::remove(key_path.c_str());
+    SecureComm::SecureBytes cluster_key = SecureComm::PersistentSessionStore::load_or_create_key(key_path);
+
+    auto client_port = [base_port](size_t node) { return static_cast<uint16_t>(base_port + node); };
+    auto replication_port = [base_port](size_t node) { return static_cast<uint16_t>(base_port + 100 + node); };
+    const uint16_t harness_port = static_cast<uint16_t>(base_port + 199);
+
+    // The harness joins the mesh first so no node has to retry it
+    ArrivalRecorder recorder;
+    SecureComm::ReplicationConfig observer_config;
+    observer_config.node_id = 0xFFFFFFFFu;
+    observer_config.listen_port = harness_port;
+    observer_config.cluster_key = cluster_key;
+    // The observer's replication log is noise next to the results
+    SecureComm::Logger::instance().set_level(SecureComm::LogLevel::OFF);
+    SecureComm::SessionReplicator observer(observer_config);
+    observer.set_apply_callback([&recorder](const SecureComm::SessionChange& change) { recorder.record(change); });
+    observer.start();
+
+    std::vector<pid_t> nodes;
+    for (size_t i = 0; i < node_count; ++i) {
+        std::vector<std::string> args = {
+            std::to_string(client_port(i)),
+            "--node-id", std::to_string(i + 1),
+            "--replication-port", std::to_string(replication_port(i)),
+            "--cluster-key", key_path,
+            "--idle-timeout", std::to_string(idle_timeout.count())
+        };
+        for (size_t j = 0; j < node_count; ++j) {
+            if (j != i) {
+                args.push_back("--peer");
+                args.push_back("127.0.0.1:" + std::to_string(replication_port(j)));
+            }
+        }
+        // Batches go to peers in order, so a session seen by the harness has
+        // already been handed to every real node
+        args.push_back("--peer");
+        args.push_back("127.0.0.1:" + std::to_string(harness_port));
+        nodes.push_back(spawn_node(server_binary, args, "cluster_harness_node" + std::to_string(i) + ".log"));
+    }
+
+    auto shutdown_nodes = [&nodes]() {
+        for (pid_t pid : nodes) {
+            if (pid > 0) {
+                kill(pid, SIGKILL);
+                waitpid(pid, nullptr, 0);
+            }
+        }
+    };
+
+    auto ready_deadline = Clock::now() + std::chrono::seconds(20);
+    for (size_t i = 0; i < node_count; ++i) {
+        while (!port_open(client_port(i))) {
+            if (Clock::now() > ready_deadline) {
+                std::cerr << "Node " << i << " did not start (see cluster_harness_node" << i << ".log)" << std::endl;
+                shutdown_nodes();
+                return 1;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    }
+    // Let the nodes open their replication links
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    std::cout << "Cluster harness: " << node_count << " nodes, " << session_count << " sessions" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+
+    // Client output is noise here; results are printed with the streams restored
+    std::ofstream null_stream("/dev/null");
+    std::streambuf* saved_cout = std::cout.rdbuf(null_stream.rdbuf());
+    std::streambuf* saved_cerr = std::cerr.rdbuf(null_stream.rdbuf());
+
+    std::vector<std::unique_ptr<SecureClient>> clients;
+    std::vector<uint32_t> session_ids;
+    std::vector<Clock::time_point> established;
+    std::vector<double> handshake_ms;
+    for (size_t i = 0; i < session_count; ++i) {
+        auto client = std::make_unique<SecureClient>();
+        auto begin = Clock::now();
+        if (!client->connect("127.0.0.1", client_port(0))) {
+            continue;
+        }
+        auto end = Clock::now();
+        handshake_ms.push_back(elapsed_ms(begin, end));
+        session_ids.push_back(client->session_id());
+        established.push_back(end);
+        clients.push_back(std::move(client));
+    }
+
+    bool replicated = recorder.wait_for(session_ids, std::chrono::seconds(10));
+    std::vector<double> lag_ms;
+    for (size_t i = 0; i < session_ids.size(); ++i) {
+        if (replicated) {
+            lag_ms.push_back(elapsed_ms(established[i], recorder.arrival(session_ids[i])));
+        }
+    }
+
+    // Fail node 0 and move every client to node 1
+    auto kill_time = Clock::now();
+    kill(nodes[0], SIGKILL);
+    waitpid(nodes[0], nullptr, 0);
+    nodes[0] = -1;
+
+    std::vector<double> resume_ms;
+    size_t resumed = 0;
+    size_t fell_back = 0;
+    for (auto& client : clients) {
+        client->disconnect();
+        auto begin = Clock::now();
+        if (client->resume("127.0.0.1", client_port(1))) {
+            resume_ms.push_back(elapsed_ms(begin, Clock::now()));
+            resumed++;
+        } else if (client->connect("127.0.0.1", client_port(1))) {
+            fell_back++;
+        }
+    }
+    double failover_total_ms = elapsed_ms(kill_time, Clock::now());
+
+    // Keep one session busy on node 1 until every other copy of it has gone idle
+    SecureClient* busy = nullptr;
+    for (auto& client : clients) {
+        if (client->has_session()) {
+            busy = client.get();
+            break;
+        }
+    }
+    size_t busy_sent = 0;
+    size_t busy_failed = 0;
+    auto busy_until = Clock::now() + idle_timeout + std::chrono::seconds(3);
+    while (busy && Clock::now() < busy_until) {
+        std::string response;
+        if (busy->send_encrypted_message("ping", &response) && !response.empty()) {
+            busy_sent++;
+        } else {
+            busy_failed++;
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    }
+    // Give a stray remove time to reach the observer
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    size_t busy_removals = busy ? recorder.removals(busy->session_id()) : 0;
+    bool busy_survived = busy && busy_failed == 0 && busy_removals == 0;
+
+    std::cout.rdbuf(saved_cout);
+    std::cerr.rdbuf(saved_cerr);
+
+    SecureComm::ReplicationStats stats = observer.stats();
+    std::cout << "Sessions established:   " << session_ids.size() << "/" << session_count << std::endl;
+    print_latency("Full handshake:", handshake_ms);
+    if (replicated) {
+        print_latency("Replication lag:", lag_ms);
+    } else {
+        std::cout << "Replication lag:        timed out waiting for sessions to replicate" << std::endl;
+    }
+    std::cout << "Batches received:       " << stats.batches_received
+              << " (" << stats.changes_applied << " changes)" << std::endl;
+    std::cout << "Failover to node 1:     " << resumed << " resumed, " << fell_back
+              << " full handshakes" << std::endl;
+    print_latency("Resume on node 1:", resume_ms);
+    std::cout << "All clients moved in:   " << failover_total_ms << " ms" << std::endl;
+    std::cout << "Busy past idle timeout: " << (busy_survived ? "survived" : "LOST") << " ("
+              << busy_sent << " messages over " << (idle_timeout + std::chrono::seconds(3)).count()
+              << " s, " << busy_removals << " removes replicated)" << std::endl;
+
+    observer.stop();
+    shutdown_nodes();
+    std::remove(key_path.c_str());
+    return (replicated && resumed == clients.size() && busy_survived) ? 0 : 1;
+}
+
+#endif
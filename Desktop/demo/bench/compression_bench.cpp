@@ -0,0 +1,220 @@
+#include "common.h"
+#include "../crypto/crypto_utils.h"
+#include "../crypto/compression.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Compression benchmark: bytes on the wire and CPU per message for a
+// generated corpus of typical payloads (JSON API requests and responses,
+// log lines, short chat messages), sent uncompressed, deflated one message
+// at a time, and through the per-connection streaming MessageCompressor.
+// The AES-256-GCM seal of the same messages is timed for scale.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* const USERS[] = {"alice", "bob", "carol", "dave", "erin", "frank", "grace", "heidi"};
+const char* const ACTIONS[] = {"login", "logout", "upload", "download", "share", "delete", "rename"};
+const char* const PATHS[] = {"/api/v1/files", "/api/v1/users", "/api/v1/sessions", "/api/v1/messages"};
+const char* const LEVELS[] = {"INFO", "INFO", "INFO", "WARN", "DEBUG", "ERROR"};
+const char* const WORDS[] = {"ok", "thanks", "see", "you", "at", "the", "meeting", "tomorrow", "sounds",
+                             "good", "can", "send", "file", "again", "please", "done", "later", "call"};
+
+template <size_t N>
+const char* pick(std::mt19937& rng, const char* const (&values)[N]) {
+    return values[rng() % N];
+}
+
+std::vector<std::string> make_json_corpus(size_t count, std::mt19937& rng) {
+    std::vector<std::string> corpus;
+    corpus.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string message = "{\"id\":" + std::to_string(100000 + i) + ",\"user\":\"" + pick(rng, USERS) +
+                              "\",\"action\":\"" + pick(rng, ACTIONS) + "\",\"path\":\"" + pick(rng, PATHS) +
+                              "/" + std::to_string(rng() % 5000) + "\",\"timestamp\":" +
+                              std::to_string(1700000000 + i * 3 + rng() % 3) + ",\"status\":" +
+                              (rng() % 10 ? "200" : "404") + ",\"size\":" + std::to_string(rng() % 1000000);
+        if (rng() % 4 == 0) {
+            message += ",\"tags\":[\"shared\",\"" + std::string(pick(rng, USERS)) + "\"],\"client\":\"desktop-2.4.1\"";
+        }
+        corpus.push_back(message + "}");
+    }
+    return corpus;
+}
+
+std::vector<std::string> make_log_corpus(size_t count, std::mt19937& rng) {
+    std::vector<std::string> corpus;
+    corpus.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        corpus.push_back("2024-05-17T10:" + std::to_string(10 + (i / 60) % 50) + ":" + std::to_string(10 + i % 50) +
+                         "Z " + pick(rng, LEVELS) + " session=" + std::to_string(4000 + rng() % 64) + " user=" +
+                         pick(rng, USERS) + " " + pick(rng, ACTIONS) + " " + pick(rng, PATHS) + " took " +
+                         std::to_string(rng() % 900) + "ms");
+    }
+    return corpus;
+}
+
+std::vector<std::string> make_chat_corpus(size_t count, std::mt19937& rng) {
+    std::vector<std::string> corpus;
+    corpus.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string message = pick(rng, WORDS);
+        size_t words = 2 + rng() % 12;
+        for (size_t w = 0; w < words; ++w) {
+            message += " ";
+            message += pick(rng, WORDS);
+        }
+        corpus.push_back(message);
+    }
+    return corpus;
+}
+
+struct Result {
+    size_t wire_bytes = 0;
+    double compress_ns = 0;
+    double decompress_ns = 0;
+};
+
+double per_message_ns(Clock::time_point begin, size_t count) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / static_cast<double>(count);
+}
+
+// Independent zlib stream per message, same threshold
+Result run_per_message(const std::vector<std::string>& corpus, int level) {
+    Result result;
+    std::vector<std::vector<uint8_t>> compressed(corpus.size());
+    auto begin = Clock::now();
+    for (size_t i = 0; i < corpus.size(); ++i) {
+        const std::string& message = corpus[i];
+        if (message.size() < SecureComm::COMPRESSION_THRESHOLD) {
+            continue;
+        }
+        uLongf size = compressBound(static_cast<uLong>(message.size()));
+        compressed[i].resize(size);
+        compress2(compressed[i].data(), &size, reinterpret_cast<const Bytef*>(message.data()),
+                  static_cast<uLong>(message.size()), level);
+        compressed[i].resize(size);
+    }
+    result.compress_ns = per_message_ns(begin, corpus.size());
+
+    std::vector<uint8_t> output(SecureComm::MAX_MESSAGE_SIZE);
+    begin = Clock::now();
+    for (size_t i = 0; i < corpus.size(); ++i) {
+        if (compressed[i].empty()) {
+            result.wire_bytes += corpus[i].size();
+            continue;
+        }
+        uLongf size = static_cast<uLongf>(output.size());
+        if (uncompress(output.data(), &size, compressed[i].data(), static_cast<uLong>(compressed[i].size())) != Z_OK ||
+            size != corpus[i].size()) {
+            throw std::runtime_error("per-message round trip failed");
+        }
+        result.wire_bytes += compressed[i].size();
+    }
+    result.decompress_ns = per_message_ns(begin, corpus.size());
+    return result;
+}
+
+// One MessageCompressor / MessageDecompressor pair for the whole corpus, as on a connection
+Result run_streaming(const std::vector<std::string>& corpus, int level, SecureComm::BufferPool& pool) {
+    Result result;
+    SecureComm::MessageCompressor compressor(level);
+    SecureComm::MessageDecompressor decompressor(pool);
+    std::vector<std::vector<uint8_t>> compressed(corpus.size());
+    auto begin = Clock::now();
+    for (size_t i = 0; i < corpus.size(); ++i) {
+        const std::string& message = corpus[i];
+        if (message.size() >= SecureComm::COMPRESSION_THRESHOLD) {
+            compressed[i] = compressor.compress(SecureComm::ByteView(
+                reinterpret_cast<const uint8_t*>(message.data()), message.size()));
+        }
+    }
+    result.compress_ns = per_message_ns(begin, corpus.size());
+
+    begin = Clock::now();
+    for (size_t i = 0; i < corpus.size(); ++i) {
+        if (corpus[i].size() < SecureComm::COMPRESSION_THRESHOLD) {
+            result.wire_bytes += corpus[i].size();
+            continue;
+        }
+        SecureComm::BufferPool::Buffer plaintext;
+        if (!decompressor.decompress(compressed[i], SecureComm::MAX_MESSAGE_SIZE, plaintext) ||
+            plaintext.size() != corpus[i].size() ||
+            !std::equal(corpus[i].begin(), corpus[i].end(), plaintext.data())) {
+            throw std::runtime_error("streaming round trip failed");
+        }
+        result.wire_bytes += compressed[i].size();
+    }
+    result.decompress_ns = per_message_ns(begin, corpus.size());
+    return result;
+}
+
+double time_seal(const std::vector<std::string>& corpus) {
+    SecureComm::CryptoManager crypto;
+    std::vector<uint8_t> key = crypto.generate_random_bytes(SecureComm::KEY_SIZE);
+    std::vector<uint8_t> iv = crypto.generate_random_bytes(SecureComm::IV_SIZE);
+    size_t sink = 0;
+    auto begin = Clock::now();
+    for (const std::string& message : corpus) {
+        std::vector<uint8_t> plaintext(message.begin(), message.end());
+        sink += crypto.seal_aead(EVP_aes_256_gcm(), plaintext, key, iv).size();
+    }
+    double ns = per_message_ns(begin, corpus.size());
+    return sink > 0 ? ns : 0;
+}
+
+void report(const char* label, size_t raw_bytes, size_t count, const Result& result) {
+    double saved = 100.0 * (1.0 - static_cast<double>(result.wire_bytes) / static_cast<double>(raw_bytes));
+    std::cout << "  " << std::left << std::setw(12) << label << std::right
+              << std::setw(10) << static_cast<double>(result.wire_bytes) / static_cast<double>(count)
+              << std::setw(9) << saved << "%"
+              << std::setw(12) << result.compress_ns << std::setw(12) << result.decompress_ns << std::endl;
+}
+
+void run_corpus(const char* name, const std::vector<std::string>& corpus, int level, SecureComm::BufferPool& pool) {
+    size_t raw_bytes = 0;
+    size_t compressible = 0;
+    for (const std::string& message : corpus) {
+        raw_bytes += message.size();
+        compressible += message.size() >= SecureComm::COMPRESSION_THRESHOLD ? 1 : 0;
+    }
+    std::cout << name << ": " << corpus.size() << " messages, "
+              << static_cast<double>(raw_bytes) / static_cast<double>(corpus.size()) << " B average, "
+              << 100.0 * static_cast<double>(compressible) / static_cast<double>(corpus.size())
+              << "% at or over the " << SecureComm::COMPRESSION_THRESHOLD << " B threshold, AES-GCM seal "
+              << time_seal(corpus) << " ns/msg" << std::endl;
+    std::cout << "  " << std::left << std::setw(12) << "mode" << std::right << std::setw(10) << "B/msg"
+              << std::setw(10) << "saved" << std::setw(12) << "comp ns" << std::setw(12) << "decomp ns" << std::endl;
+
+    Result none;
+    none.wire_bytes = raw_bytes;
+    report("none", raw_bytes, corpus.size(), none);
+    report("per-message", raw_bytes, corpus.size(), run_per_message(corpus, level));
+    report("streaming", raw_bytes, corpus.size(), run_streaming(corpus, level, pool));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = 20000;
+    int level = 6;
+    if (argc > 1) count = std::max<size_t>(1, std::stoul(argv[1]));
+    if (argc > 2) level = std::min(9, std::max(1, std::stoi(argv[2])));
+
+    std::mt19937 rng(1234);
+    SecureComm::BufferPool pool;
+    std::cout << "Compression benchmark: zlib level " << level << ", ns per message" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    run_corpus("json", make_json_corpus(count, rng), level, pool);
+    run_corpus("logs", make_log_corpus(count, rng), level, pool);
+    run_corpus("chat", make_chat_corpus(count, rng), level, pool);
+    std::cout << "pooled buffers idle: " << pool.idle_count() << std::endl;
+    return 0;
+}
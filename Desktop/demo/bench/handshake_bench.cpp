@@ -0,0 +1,437 @@
+#include "common.h"
+#include "../crypto/crypto_utils.h"
+#include "../client/secure_client.h"
+#include "../server/secure_server.h"
+#include "logger.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+    #include <sys/select.h>
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+#endif
+
+// Full vs. resumed handshake benchmark: runs a SecureServer in-process on
+// loopback and times N connections for each handshake kind (full X25519
+// key exchange, session-id resumption, ticket resumption). Latency is wall
+// time per connection; CPU is process CPU time per connection, so it covers
+// both the client and the server side of each handshake. Time to first
+// reply compares sending a request after a ticket resumption with sending
+// it as 0-RTT early data in the first flight. An optional emulated round
+// trip time (POSIX only) routes the clients through a delaying proxy so the
+// saved round trips are visible over loopback. Before timing, it checks
+// that a client which drops the connection before HANDSHAKE_COMPLETE gets
+// no ticket it could use to recreate the abandoned session.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    std::vector<double> latency_ms;
+    double cpu_ms_per_handshake = 0;
+    size_t failures = 0;
+};
+
+Result run(size_t iterations, const std::function<bool()>& handshake, const std::function<void()>& teardown) {
+    Result result;
+    std::clock_t cpu_begin = std::clock();
+    for (size_t i = 0; i < iterations; ++i) {
+        auto begin = Clock::now();
+        bool ok = handshake();
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+        if (ok) {
+            result.latency_ms.push_back(ms);
+        } else {
+            result.failures++;
+        }
+        teardown();
+    }
+    std::clock_t cpu_end = std::clock();
+    double cpu_ms = 1000.0 * static_cast<double>(cpu_end - cpu_begin) / CLOCKS_PER_SEC;
+    result.cpu_ms_per_handshake = cpu_ms / static_cast<double>(iterations);
+    return result;
+}
+
+void print_result(const std::string& label, Result result) {
+    std::sort(result.latency_ms.begin(), result.latency_ms.end());
+    auto pct = [&result](double p) {
+        if (result.latency_ms.empty()) {
+            return 0.0;
+        }
+        return result.latency_ms[std::min(result.latency_ms.size() - 1,
+                                          static_cast<size_t>(p * result.latency_ms.size()))];
+    };
+    std::cout << std::left << std::setw(18) << label << std::right
+              << "p50 " << std::setw(8) << pct(0.50) << " ms   "
+              << "p99 " << std::setw(8) << pct(0.99) << " ms   "
+              << "cpu " << std::setw(8) << result.cpu_ms_per_handshake << " ms/handshake";
+    if (result.failures > 0) {
+        std::cout << "   (" << result.failures << " failed)";
+    }
+    std::cout << std::endl;
+}
+
+#ifndef _WIN32
+
+// Loopback TCP proxy that holds every chunk for half the round trip in each direction
+class DelayProxy {
+public:
+    DelayProxy(uint16_t target_port, std::chrono::microseconds one_way)
+        : target_port_(target_port), one_way_(one_way), listen_socket_(-1) {}
+
+    ~DelayProxy() { stop(); }
+
+    bool start(uint16_t port) {
+        listen_socket_ = socket(AF_INET, SOCK_STREAM, 0);
+        int opt = 1;
+        setsockopt(listen_socket_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        struct sockaddr_in addr = loopback(port);
+        if (bind(listen_socket_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            listen(listen_socket_, 16) < 0) {
+            close(listen_socket_);
+            listen_socket_ = -1;
+            return false;
+        }
+        accept_thread_ = std::thread(&DelayProxy::accept_loop, this, listen_socket_);
+        return true;
+    }
+
+    void stop() {
+        if (listen_socket_ >= 0) {
+            shutdown(listen_socket_, SHUT_RDWR);
+            close(listen_socket_);
+            listen_socket_ = -1;
+        }
+        if (accept_thread_.joinable()) {
+            accept_thread_.join();
+        }
+        for (std::thread& connection : connections_) {
+            connection.join();
+        }
+        connections_.clear();
+    }
+
+private:
+    static struct sockaddr_in loopback(uint16_t port) {
+        struct sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        return addr;
+    }
+
+    void accept_loop(int listen_socket) {
+        while (true) {
+            int client = accept(listen_socket, nullptr, nullptr);
+            if (client < 0) {
+                return;
+            }
+            int server = socket(AF_INET, SOCK_STREAM, 0);
+            struct sockaddr_in addr = loopback(target_port_);
+            if (connect(server, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+                close(server);
+                close(client);
+                continue;
+            }
+            int nodelay = 1;
+            setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+            setsockopt(server, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+            connections_.emplace_back([this, client, server]() {
+                std::thread upstream(&DelayProxy::relay, this, client, server);
+                relay(server, client);
+                upstream.join();
+                close(client);
+                close(server);
+            });
+        }
+    }
+
+    // Timestamp chunks as they arrive and forward each once its delay is up
+    void relay(int from, int to) {
+        std::deque<std::pair<Clock::time_point, std::vector<uint8_t>>> pending;
+        bool open = true;
+        std::vector<uint8_t> buffer(16384);
+        while (open || !pending.empty()) {
+            auto now = Clock::now();
+            while (!pending.empty() && pending.front().first <= now) {
+                const std::vector<uint8_t>& chunk = pending.front().second;
+                size_t sent = 0;
+                while (sent < chunk.size()) {
+                    ssize_t n = send(to, chunk.data() + sent, chunk.size() - sent, MSG_NOSIGNAL);
+                    if (n <= 0) {
+                        return;
+                    }
+                    sent += static_cast<size_t>(n);
+                }
+                pending.pop_front();
+            }
+
+            auto wait = std::chrono::microseconds(100000);
+            if (!pending.empty()) {
+                wait = std::max(std::chrono::microseconds(0),
+                                std::chrono::duration_cast<std::chrono::microseconds>(pending.front().first - now));
+            }
+            if (!open) {
+                std::this_thread::sleep_for(wait);
+                continue;
+            }
+
+            fd_set readable;
+            FD_ZERO(&readable);
+            FD_SET(from, &readable);
+            struct timeval timeout;
+            timeout.tv_sec = static_cast<long>(wait.count() / 1000000);
+            timeout.tv_usec = static_cast<long>(wait.count() % 1000000);
+            if (select(from + 1, &readable, nullptr, nullptr, &timeout) > 0) {
+                ssize_t n = recv(from, buffer.data(), buffer.size(), 0);
+                if (n <= 0) {
+                    open = false;
+                } else {
+                    pending.emplace_back(Clock::now() + one_way_,
+                                         std::vector<uint8_t>(buffer.begin(), buffer.begin() + n));
+                }
+            }
+        }
+        shutdown(to, SHUT_WR);
+    }
+
+    const uint16_t target_port_;
+    const std::chrono::microseconds one_way_;
+    int listen_socket_;
+    std::thread accept_thread_;
+    std::vector<std::thread> connections_;
+};
+
+int connect_loopback(uint16_t port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (sock >= 0 && connect(sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+    // Waits for a reply are bounded, so a server that sends nothing reads as empty
+    struct timeval timeout;
+    timeout.tv_sec = 1;
+    timeout.tv_usec = 0;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return sock;
+}
+
+bool send_init(int sock, const SecureComm::HandshakeMessage& init, uint16_t flags, const std::vector<uint8_t>& trailer) {
+    SecureComm::MessageHeader header;
+    header.version = SecureComm::ProtocolVersion::V1_0;
+    header.type = SecureComm::MessageType::HANDSHAKE_INIT;
+    header.sequence_number = 0;
+    header.timestamp = SecureComm::get_current_timestamp_seconds();
+    header.payload_size = static_cast<uint16_t>(SecureComm::HANDSHAKE_WIRE_SIZE + trailer.size());
+    header.flags = flags;
+
+    std::vector<uint8_t> request = SecureComm::serialize_header(header);
+    std::vector<uint8_t> body = SecureComm::serialize_handshake(init);
+    request.insert(request.end(), body.begin(), body.end());
+    request.insert(request.end(), trailer.begin(), trailer.end());
+    return send(sock, request.data(), request.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(request.size());
+}
+
+// One whole message, or empty on disconnect or timeout
+std::vector<uint8_t> read_message(int sock) {
+    std::vector<uint8_t> message(SecureComm::HEADER_WIRE_SIZE);
+    if (recv(sock, message.data(), message.size(), MSG_WAITALL) != static_cast<ssize_t>(message.size())) {
+        return {};
+    }
+    size_t body_size = SecureComm::message_body_size(SecureComm::MessageView(message).header());
+    message.resize(SecureComm::HEADER_WIRE_SIZE + body_size);
+    if (body_size > 0 && recv(sock, message.data() + SecureComm::HEADER_WIRE_SIZE, body_size, MSG_WAITALL) !=
+                             static_cast<ssize_t>(body_size)) {
+        return {};
+    }
+    return message;
+}
+
+// Runs a full handshake up to the server's response, waits for a ticket
+// and drops the connection without sending HANDSHAKE_COMPLETE. The server
+// must not have issued one; if it did, the ticket is presented on a new
+// connection, and the check fails if the server resumes the session from it.
+bool abandoned_handshake_refused(uint16_t port) {
+    SecureComm::CryptoManager crypto;
+    SecureComm::KeyPair ephemeral = crypto.generate_x25519_keypair();
+    SecureComm::HandshakeMessage init;
+    init.client_id = crypto.generate_random_uint32();
+    init.session_id = 0;
+    init.fs_type = SecureComm::ForwardSecrecyType::ECDH;
+    std::copy(ephemeral.public_key.begin(), ephemeral.public_key.end(), init.public_key);
+    std::vector<uint8_t> nonce = SecureComm::generate_nonce(SecureComm::IV_SIZE);
+    std::copy(nonce.begin(), nonce.end(), init.nonce);
+
+    int sock = connect_loopback(port);
+    if (sock < 0 || !send_init(sock, init, 0, {})) {
+        if (sock >= 0) {
+            close(sock);
+        }
+        return false;
+    }
+    std::vector<uint8_t> response = read_message(sock);
+    if (response.empty() || SecureComm::MessageView(response).type() != SecureComm::MessageType::HANDSHAKE_RESPONSE) {
+        close(sock);
+        return false;
+    }
+    SecureComm::HandshakeView server_handshake(SecureComm::MessageView(response).body());
+    std::vector<uint8_t> ticket_message = read_message(sock);
+    close(sock);
+    if (ticket_message.empty()) {
+        return true;
+    }
+    if (SecureComm::MessageView(ticket_message).type() != SecureComm::MessageType::SESSION_TICKET ||
+        ticket_message.size() < SecureComm::HEADER_WIRE_SIZE + 4 + SecureComm::SessionTicketManager::TICKET_SIZE) {
+        return false;
+    }
+
+    std::vector<uint8_t> shared_secret = crypto.perform_x25519_key_exchange(ephemeral.private_key,
+                                                                            server_handshake.public_key());
+    std::vector<uint8_t> session_key = crypto.derive_shared_secret(shared_secret, server_handshake.nonce());
+    std::vector<uint8_t> secret = crypto.derive_resumption_secret(session_key);
+    const uint8_t* ticket = ticket_message.data() + SecureComm::HEADER_WIRE_SIZE + 4;
+
+    SecureComm::HandshakeMessage resume;
+    resume.client_id = server_handshake.client_id();
+    resume.session_id = server_handshake.session_id();
+    resume.fs_type = SecureComm::ForwardSecrecyType::ECDH;
+    nonce = SecureComm::generate_nonce(SecureComm::IV_SIZE);
+    std::copy(nonce.begin(), nonce.end(), resume.nonce);
+    std::vector<uint8_t> binder = crypto.resume_binder(secret, resume.session_id, nonce);
+    std::copy(binder.begin(), binder.end(), resume.public_key);
+
+    sock = connect_loopback(port);
+    bool resumed = sock >= 0 &&
+                   send_init(sock, resume, SecureComm::FLAG_TICKET,
+                             std::vector<uint8_t>(ticket, ticket + SecureComm::SessionTicketManager::TICKET_SIZE));
+    if (resumed) {
+        std::vector<uint8_t> reply = read_message(sock);
+        resumed = !reply.empty() &&
+                  SecureComm::MessageView(reply).type() == SecureComm::MessageType::HANDSHAKE_RESPONSE;
+    }
+    if (sock >= 0) {
+        close(sock);
+    }
+    return !resumed;
+}
+
+#endif
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t iterations = 200;
+    uint16_t port = 9500;
+    double rtt_ms = 0;
+    if (argc > 1) iterations = std::max<size_t>(1, std::stoul(argv[1]));
+    if (argc > 2) port = static_cast<uint16_t>(std::stoi(argv[2]));
+    if (argc > 3) rtt_ms = std::stod(argv[3]);
+
+    // Server and client logging would dominate the timings
+    std::ofstream null_stream("/dev/null");
+    std::streambuf* saved_cout = std::cout.rdbuf(null_stream.rdbuf());
+    std::streambuf* saved_cerr = std::cerr.rdbuf(null_stream.rdbuf());
+    SecureComm::Logger::instance().set_level(SecureComm::LogLevel::OFF);
+
+    SecureServer server;
+    if (!server.start(port)) {
+        std::cerr.rdbuf(saved_cerr);
+        std::cout.rdbuf(saved_cout);
+        std::cerr << "Failed to start server on port " << port << std::endl;
+        return 1;
+    }
+    std::thread server_thread([&server]() { server.run(); });
+
+#ifndef _WIN32
+    bool abandoned_refused = abandoned_handshake_refused(port);
+#else
+    bool abandoned_refused = true;
+#endif
+
+    // Clients connect through the delaying proxy on the next port
+    uint16_t client_port = port;
+#ifndef _WIN32
+    DelayProxy proxy(port, std::chrono::microseconds(static_cast<int64_t>(rtt_ms * 500.0)));
+    if (rtt_ms > 0) {
+        client_port = static_cast<uint16_t>(port + 1);
+        if (!proxy.start(client_port)) {
+            server.stop();
+            server_thread.join();
+            std::cerr.rdbuf(saved_cerr);
+            std::cerr << "Failed to start delay proxy on port " << client_port << std::endl;
+            return 1;
+        }
+    }
+#endif
+
+    SecureClient client;
+    const std::string host = "127.0.0.1";
+    auto teardown = [&client]() { client.disconnect(); };
+
+    Result full = run(iterations, [&]() { return client.connect(host, client_port); }, teardown);
+    Result resumed = run(iterations, [&]() { return client.resume(host, client_port); }, teardown);
+    Result ticket = run(iterations, [&]() { return client.resume_with_ticket(host, client_port); }, teardown);
+
+    const std::string request = "GET /status";
+    std::string reply;
+    Result one_rtt = run(iterations, [&]() {
+        return client.resume_with_ticket(host, client_port) && client.send_encrypted_message(request, &reply);
+    }, teardown);
+    Result zero_rtt = run(iterations, [&]() {
+        return client.resume_with_early_data(host, client_port, request, reply);
+    }, teardown);
+
+#ifndef _WIN32
+    proxy.stop();
+#endif
+    server.stop();
+    server_thread.join();
+
+    std::cout.rdbuf(saved_cout);
+    std::cerr.rdbuf(saved_cerr);
+
+    std::cout << "Handshake benchmark: " << iterations << " connections per kind (loopback";
+    if (rtt_ms > 0) {
+        std::cout << ", " << rtt_ms << " ms emulated RTT";
+    }
+    std::cout << ")" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    print_result("full (X25519):", full);
+    print_result("session resume:", resumed);
+    print_result("ticket resume:", ticket);
+    std::cout << "Time to first reply:" << std::endl;
+    print_result("resume + request:", one_rtt);
+    print_result("0-RTT early data:", zero_rtt);
+    if (ticket.cpu_ms_per_handshake > 0) {
+        std::cout << std::setprecision(1) << "ticket resume uses "
+                  << full.cpu_ms_per_handshake / ticket.cpu_ms_per_handshake
+                  << "x less CPU than a full handshake" << std::endl;
+    }
+
+    std::cout << "abandoned handshake: "
+              << (abandoned_refused ? "no usable ticket issued" : "ticket resumed a rejected session") << std::endl;
+
+    size_t failures = (abandoned_refused ? 0 : 1) + full.failures + resumed.failures + ticket.failures + one_rtt.failures + zero_rtt.failures;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,716 @@
+#include "common.h"
+#include "histogram.h"
+#include "logger.h"
+#include "metrics.h"
+#include "../crypto/crypto_utils.h"
+#include "../crypto/session_ticket.h"
+#include "../client/secure_client.h"
+#include "../server/secure_server.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+// Handshake throughput under a reconnect storm: many clients doing full
+// handshakes at once, as after a deploy.
+//
+// The loopback mode starts a SecureServer in-process and has --clients
+// threads connect and disconnect back to back for --duration seconds, so
+// every handshake runs through the real perform_handshake code; the
+// per-step breakdown comes from the server's own stage histograms
+// (metrics.h), whose response and complete steps include waiting for the
+// client. The in-process mode runs the same crypto for both sides of a
+// handshake on --clients threads with no sockets at all, timing each step
+// itself, which gives the ceiling the protocol code and the kernel are
+// measured against. Throughput per core is handshakes per second of process
+// CPU time; in loopback mode that CPU covers the clients as well as the
+// server. --client-keygen gives every handshake a new client RSA identity,
+// as a storm of freshly started clients would.
+//
+// In loopback mode --probe-sessions keeps that many established sessions
+// sending messages at --probe-rate, first alone and then through the
+// storm, to show what the storm does to message latency;
+// --handshake-workers runs the server's key exchange on a bounded
+// handshake pool (with --handshake-queue as its admission limit) to compare.
+//
+// --flood sends that many bogus HANDSHAKE_INITs per second through the
+// storm, each on a fresh connection that is dropped without reading the
+// reply, as peers that never finish a handshake would. --cookie-threshold
+// turns on the server's cookie challenge, so a flood init costs an HMAC
+// instead of a key exchange; compare the legitimate clients' throughput
+// with and without it. --flood-echo makes the flood read its challenge and
+// send the cookie back on every following connection, as an attacker
+// that does receive at its address would, to check that a cookie admits
+// one key exchange and its replays are refused.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Config {
+    std::string mode = "both";
+    size_t clients = 8;
+    double duration_s = 5;
+    uint16_t port = 9600;
+    bool client_keygen = false;
+    std::string json_path;
+    // Established sessions measured through the storm (loopback mode)
+    size_t probe_sessions = 0;
+    double probe_rate = 200;
+    bool handshake_pool = false;
+    SecureComm::HandshakePoolConfig pool_config;
+    // Bogus inits per second sent through the storm (loopback mode)
+    double flood_rate = 0;
+    bool flood_echo = false;
+    bool handshake_cookies = false;
+    size_t cookie_threshold = 0;
+};
+
+struct Step {
+    std::string name;
+    SecureComm::LatencyHistogram histogram;
+};
+
+struct ModeResult {
+    std::string mode;
+    uint64_t handshakes = 0;
+    uint64_t failures = 0;
+    double wall_s = 0;
+    double cpu_s = 0;
+    SecureComm::LatencyHistogram latency;
+    std::vector<Step> steps;
+    // Refused by the handshake pool's admission limit
+    uint64_t rejected = 0;
+    // Probe message latency without and with the storm
+    SecureComm::LatencyHistogram probe_idle;
+    SecureComm::LatencyHistogram probe_storm;
+    // Bogus inits sent by the flood, inits the server challenged, and with
+    // --flood-echo the cookies the flood received, the inits that echoed
+    // one and how many of those the server let in
+    uint64_t flood_inits = 0;
+    uint64_t cookies_sent = 0;
+    uint64_t cookies_fetched = 0;
+    uint64_t cookies_echoed = 0;
+    uint64_t cookies_admitted = 0;
+};
+
+double process_cpu_s() {
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+uint64_t elapsed_ns(Clock::time_point begin, Clock::time_point end) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+}
+
+Clock::time_point after_seconds(Clock::time_point start, double seconds) {
+    return start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+// Sends on the probe sessions in turn at a fixed rate until end; latency
+// counts from the scheduled send, so a stalled server shows up in it
+void probe(std::vector<std::unique_ptr<SecureClient>>& sessions, double rate, Clock::time_point end,
+           SecureComm::LatencyHistogram& latency, std::atomic<uint64_t>& errors) {
+    const Clock::duration interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / rate));
+    Clock::time_point next = Clock::now();
+    std::string reply;
+    for (size_t i = 0; next < end; ++i, next += interval) {
+        std::this_thread::sleep_until(next);
+        if (sessions[i % sessions.size()]->send_encrypted_message("probe", &reply)) {
+            latency.record(elapsed_ns(next, Clock::now()));
+        } else {
+            errors.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+struct FloodCounters {
+    std::atomic<uint64_t> sent{0};
+    // Cookies the flood received, inits it sent echoing one, and echoes
+    // the server answered with a key exchange
+    std::atomic<uint64_t> fetched{0};
+    std::atomic<uint64_t> echoed{0};
+    std::atomic<uint64_t> admitted{0};
+};
+
+// Waits up to a second for the header of the server's reply; false if none came
+bool read_reply_header(int sock, std::vector<uint8_t>& reply) {
+    struct timeval timeout;
+    timeout.tv_sec = 1;
+    timeout.tv_usec = 0;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    reply.resize(SecureComm::HEADER_WIRE_SIZE);
+    return recv(sock, reply.data(), SecureComm::HEADER_WIRE_SIZE, MSG_WAITALL) ==
+           static_cast<ssize_t>(SecureComm::HEADER_WIRE_SIZE);
+}
+
+// Reads one HANDSHAKE_COOKIE reply; empty if the server answered otherwise
+// or not within the timeout
+std::vector<uint8_t> read_cookie(int sock) {
+    std::vector<uint8_t> reply;
+    if (!read_reply_header(sock, reply)) {
+        return {};
+    }
+    SecureComm::MessageHeader header = SecureComm::deserialize_header(reply);
+    reply.resize(SecureComm::HEADER_WIRE_SIZE + SecureComm::HANDSHAKE_COOKIE_SIZE);
+    if (header.type != SecureComm::MessageType::HANDSHAKE_COOKIE ||
+        header.payload_size != SecureComm::HANDSHAKE_COOKIE_SIZE ||
+        recv(sock, reply.data() + SecureComm::HEADER_WIRE_SIZE, SecureComm::HANDSHAKE_COOKIE_SIZE, MSG_WAITALL) !=
+            static_cast<ssize_t>(SecureComm::HANDSHAKE_COOKIE_SIZE)) {
+        return {};
+    }
+    return std::vector<uint8_t>(reply.begin() + SecureComm::HEADER_WIRE_SIZE, reply.end());
+}
+
+// One bogus HANDSHAKE_INIT per connection at a fixed rate until end: a
+// random public key and no cookie, and the connection is dropped without
+// reading the reply. With echo, the flood instead reads the challenge
+// whenever it holds no live cookie, then resends the same init with that
+// cookie on every connection until it expires, reading only whether the
+// server let it in
+void flood(uint16_t port, double rate, bool echo, Clock::time_point end, FloodCounters& counters) {
+    SecureComm::CryptoManager crypto;
+    SecureComm::HandshakeMessage init;
+    init.client_id = crypto.generate_random_uint32();
+    init.session_id = crypto.generate_random_uint32();
+    init.fs_type = SecureComm::ForwardSecrecyType::ECDH;
+    std::vector<uint8_t> key = crypto.generate_random_bytes(SecureComm::KEY_SIZE);
+    std::vector<uint8_t> nonce = crypto.generate_random_bytes(SecureComm::IV_SIZE);
+    std::copy(key.begin(), key.end(), init.public_key);
+    std::copy(nonce.begin(), nonce.end(), init.nonce);
+
+    SecureComm::MessageHeader header;
+    header.version = SecureComm::ProtocolVersion::V1_0;
+    header.type = SecureComm::MessageType::HANDSHAKE_INIT;
+    header.sequence_number = 0;
+    header.timestamp = SecureComm::get_current_timestamp_seconds();
+    header.payload_size = SecureComm::HANDSHAKE_WIRE_SIZE;
+    header.flags = 0;
+    std::vector<uint8_t> request = SecureComm::serialize_header(header);
+    std::vector<uint8_t> body = SecureComm::serialize_handshake(init);
+    request.insert(request.end(), body.begin(), body.end());
+
+    // Same init with FLAG_COOKIE, the cookie going where the capabilities
+    // would (the flood offers none)
+    header.flags = SecureComm::FLAG_COOKIE;
+    header.payload_size = static_cast<uint16_t>(SecureComm::HANDSHAKE_WIRE_SIZE + SecureComm::HANDSHAKE_COOKIE_SIZE);
+    std::vector<uint8_t> echo_request = SecureComm::serialize_header(header);
+    echo_request.insert(echo_request.end(), body.begin(), body.end());
+    std::vector<uint8_t> cookie;
+    Clock::time_point cookie_expiry;
+
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    const Clock::duration interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / rate));
+    for (Clock::time_point next = Clock::now(); next < end; next += interval) {
+        std::this_thread::sleep_until(next);
+        int sock = socket(AF_INET, SOCK_STREAM, 0);
+        if (sock < 0) {
+            continue;
+        }
+        if (echo && !cookie.empty() && Clock::now() >= cookie_expiry) {
+            cookie.clear();
+        }
+        const bool echoing = !cookie.empty();
+        if (echoing) {
+            echo_request.resize(SecureComm::HEADER_WIRE_SIZE + SecureComm::HANDSHAKE_WIRE_SIZE);
+            echo_request.insert(echo_request.end(), cookie.begin(), cookie.end());
+        }
+        const std::vector<uint8_t>& message = echoing ? echo_request : request;
+        if (connect(sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0 &&
+            send(sock, message.data(), message.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(message.size())) {
+            counters.sent.fetch_add(1, std::memory_order_relaxed);
+            std::vector<uint8_t> reply;
+            if (echoing) {
+                counters.echoed.fetch_add(1, std::memory_order_relaxed);
+                if (read_reply_header(sock, reply) &&
+                    SecureComm::MessageView(reply).type() == SecureComm::MessageType::HANDSHAKE_RESPONSE) {
+                    counters.admitted.fetch_add(1, std::memory_order_relaxed);
+                }
+            } else if (echo) {
+                cookie = read_cookie(sock);
+                cookie_expiry = Clock::now() + SecureComm::HANDSHAKE_COOKIE_LIFETIME;
+                if (!cookie.empty()) {
+                    counters.fetched.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+        close(sock);
+    }
+}
+
+ModeResult run_loopback(const Config& config) {
+    ModeResult result;
+    result.mode = "loopback";
+
+    SecureServer server;
+    if (config.handshake_pool && !server.enable_handshake_pool(config.pool_config)) {
+        throw std::runtime_error("Failed to start the handshake pool");
+    }
+    if (config.handshake_cookies && !server.enable_handshake_cookies(config.cookie_threshold)) {
+        throw std::runtime_error("Failed to set up handshake cookies");
+    }
+    if (!server.start(config.port)) {
+        throw std::runtime_error("Failed to start server on port " + std::to_string(config.port));
+    }
+    std::thread server_thread([&server]() { server.run(); });
+
+    // One shared identity unless every handshake is a new client
+    SecureComm::CryptoManager crypto;
+    SecureComm::KeyPair identity = crypto.generate_rsa_keypair(2048);
+
+    std::vector<std::unique_ptr<SecureClient>> probes;
+    std::atomic<uint64_t> probe_errors(0);
+    for (size_t i = 0; i < config.probe_sessions; ++i) {
+        probes.push_back(std::make_unique<SecureClient>(identity));
+        if (!probes.back()->connect("127.0.0.1", config.port)) {
+            throw std::runtime_error("Probe session failed to connect");
+        }
+    }
+    if (!probes.empty()) {
+        // Baseline without the storm
+        probe(probes, config.probe_rate, after_seconds(Clock::now(), std::min(2.0, config.duration_s)),
+              result.probe_idle, probe_errors);
+    }
+
+    std::vector<SecureComm::LatencyHistogram> latencies(config.clients);
+    std::atomic<uint64_t> handshakes(0);
+    std::atomic<uint64_t> failures(0);
+    Clock::time_point start = Clock::now();
+    Clock::time_point end = after_seconds(start, config.duration_s);
+    double cpu_begin = process_cpu_s();
+
+    std::thread probe_thread;
+    if (!probes.empty()) {
+        probe_thread = std::thread([&]() { probe(probes, config.probe_rate, end, result.probe_storm, probe_errors); });
+    }
+    FloodCounters flood_counters;
+    std::vector<std::thread> threads;
+    if (config.flood_rate > 0) {
+        threads.emplace_back([&]() { flood(config.port, config.flood_rate, config.flood_echo, end, flood_counters); });
+    }
+    for (size_t t = 0; t < config.clients; ++t) {
+        threads.emplace_back([&, t]() {
+            std::unique_ptr<SecureClient> client;
+            while (Clock::now() < end) {
+                Clock::time_point begin = Clock::now();
+                if (!client || config.client_keygen) {
+                    client = config.client_keygen ? std::make_unique<SecureClient>()
+                                                  : std::make_unique<SecureClient>(identity);
+                }
+                if (client->connect("127.0.0.1", config.port)) {
+                    latencies[t].record(elapsed_ns(begin, Clock::now()));
+                    handshakes.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    // Back off like a real client instead of retrying in a tight loop
+                    failures.fetch_add(1, std::memory_order_relaxed);
+                    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                }
+                client->disconnect();
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    result.wall_s = std::chrono::duration<double>(Clock::now() - start).count();
+    result.cpu_s = process_cpu_s() - cpu_begin;
+    if (probe_thread.joinable()) {
+        probe_thread.join();
+    }
+    for (auto& session : probes) {
+        session->disconnect();
+    }
+
+    server.stop();
+    server_thread.join();
+
+    result.handshakes = handshakes.load();
+    result.flood_inits = flood_counters.sent.load();
+    result.cookies_fetched = flood_counters.fetched.load();
+    result.cookies_echoed = flood_counters.echoed.load();
+    result.cookies_admitted = flood_counters.admitted.load();
+    result.failures = failures.load() + probe_errors.load();
+    for (const SecureComm::LatencyHistogram& latency : latencies) {
+        result.latency.merge(latency);
+    }
+
+    // Server-side steps as the server recorded them
+    SecureComm::MetricsSnapshot snapshot = SecureComm::Metrics::instance().collect();
+    result.rejected = snapshot.counters[static_cast<size_t>(SecureComm::MetricCounter::HANDSHAKES_REJECTED)];
+    result.cookies_sent = snapshot.counters[static_cast<size_t>(SecureComm::MetricCounter::HANDSHAKE_COOKIES_SENT)];
+    const SecureComm::TraceStage stages[] = {
+        SecureComm::TraceStage::ACCEPT, SecureComm::TraceStage::HANDSHAKE_INIT,
+        SecureComm::TraceStage::HANDSHAKE_QUEUE, SecureComm::TraceStage::HANDSHAKE_KEYGEN, SecureComm::TraceStage::HANDSHAKE_EXCHANGE,
+        SecureComm::TraceStage::HANDSHAKE_DERIVE, SecureComm::TraceStage::HANDSHAKE_RESPONSE,
+        SecureComm::TraceStage::HANDSHAKE_COMPLETE};
+    for (SecureComm::TraceStage stage : stages) {
+        if (stage == SecureComm::TraceStage::HANDSHAKE_QUEUE && !config.handshake_pool) {
+            continue;
+        }
+        result.steps.push_back({std::string("server ") + SecureComm::trace_stage_name(stage),
+                                snapshot.stages[static_cast<size_t>(stage)]});
+    }
+    return result;
+}
+
+// Both sides of a full handshake, step by step, as the client and the
+// server code run them
+class InProcessHandshake {
+public:
+    enum StepIndex {
+        CLIENT_RSA_KEYGEN,
+        CLIENT_KEYGEN,
+        SERVER_KEYGEN,
+        SERVER_EXCHANGE,
+        SERVER_DERIVE,
+        SERVER_TICKET,
+        CLIENT_EXCHANGE,
+        CLIENT_DERIVE,
+        CLIENT_RESUMPTION_SECRET,
+        STEP_COUNT
+    };
+
+    static const char* step_name(size_t step) {
+        static const char* const names[] = {"client rsa_keygen", "client x25519_keygen", "server x25519_keygen",
+                                            "server x25519_exchange", "server derive_shared_secret",
+                                            "server session_ticket", "client x25519_exchange",
+                                            "client derive_shared_secret", "client resumption_secret"};
+        return names[step];
+    }
+
+    InProcessHandshake(SecureComm::SessionTicketManager& tickets, bool client_keygen)
+        : tickets_(tickets), client_keygen_(client_keygen), steps_(STEP_COUNT) {}
+
+    void run() {
+        Clock::time_point mark = Clock::now();
+        auto end_step = [this, &mark](StepIndex step) {
+            Clock::time_point now = Clock::now();
+            steps_[step].record(elapsed_ns(mark, now));
+            mark = now;
+        };
+
+        if (client_keygen_) {
+            SecureComm::KeyPair identity = crypto_.generate_rsa_keypair(2048);
+            end_step(CLIENT_RSA_KEYGEN);
+        }
+        SecureComm::KeyPair client_ecdh = crypto_.generate_x25519_keypair();
+        std::vector<uint8_t> client_nonce = crypto_.generate_random_bytes(SecureComm::IV_SIZE);
+        end_step(CLIENT_KEYGEN);
+
+        SecureComm::KeyPair server_ecdh = crypto_.generate_x25519_keypair();
+        end_step(SERVER_KEYGEN);
+        std::vector<uint8_t> server_secret =
+            crypto_.perform_x25519_key_exchange(server_ecdh.private_key, client_ecdh.public_key);
+        end_step(SERVER_EXCHANGE);
+        std::vector<uint8_t> server_key = crypto_.derive_shared_secret(server_secret, client_nonce);
+        end_step(SERVER_DERIVE);
+        SecureComm::SessionTicket ticket;
+        ticket.session_id = 1;
+        ticket.client_id = 1;
+        ticket.created_at = std::chrono::system_clock::now();
+        ticket.issued_at = ticket.created_at;
+        ticket.key_epoch = 0;
+        std::vector<uint8_t> resumption = crypto_.derive_resumption_secret(server_key);
+        std::copy(resumption.begin(), resumption.end(), ticket.resumption_secret.begin());
+        std::vector<uint8_t> sealed = tickets_.issue(ticket);
+        end_step(SERVER_TICKET);
+
+        std::vector<uint8_t> client_secret =
+            crypto_.perform_x25519_key_exchange(client_ecdh.private_key, server_ecdh.public_key);
+        end_step(CLIENT_EXCHANGE);
+        std::vector<uint8_t> client_key = crypto_.derive_shared_secret(client_secret, client_nonce);
+        end_step(CLIENT_DERIVE);
+        std::vector<uint8_t> client_resumption = crypto_.derive_resumption_secret(client_key);
+        end_step(CLIENT_RESUMPTION_SECRET);
+
+        if (client_key != server_key || client_resumption != resumption || sealed.empty()) {
+            throw std::runtime_error("In-process handshake derived mismatched keys");
+        }
+    }
+
+    const std::vector<SecureComm::LatencyHistogram>& steps() const { return steps_; }
+
+private:
+    SecureComm::CryptoManager crypto_;
+    SecureComm::SessionTicketManager& tickets_;
+    bool client_keygen_;
+    std::vector<SecureComm::LatencyHistogram> steps_;
+};
+
+ModeResult run_in_process(const Config& config) {
+    ModeResult result;
+    result.mode = "in-process";
+
+    SecureComm::SessionTicketManager tickets;
+    std::vector<std::unique_ptr<InProcessHandshake>> handshakes;
+    std::vector<SecureComm::LatencyHistogram> latencies(config.clients);
+    for (size_t t = 0; t < config.clients; ++t) {
+        handshakes.push_back(std::make_unique<InProcessHandshake>(tickets, config.client_keygen));
+    }
+    std::atomic<uint64_t> count(0);
+    std::atomic<uint64_t> failures(0);
+    Clock::time_point start = Clock::now();
+    Clock::time_point end = after_seconds(start, config.duration_s);
+    double cpu_begin = process_cpu_s();
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < config.clients; ++t) {
+        threads.emplace_back([&, t]() {
+            while (Clock::now() < end) {
+                Clock::time_point begin = Clock::now();
+                try {
+                    handshakes[t]->run();
+                    latencies[t].record(elapsed_ns(begin, Clock::now()));
+                    count.fetch_add(1, std::memory_order_relaxed);
+                } catch (const std::exception&) {
+                    failures.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    result.wall_s = std::chrono::duration<double>(Clock::now() - start).count();
+    result.cpu_s = process_cpu_s() - cpu_begin;
+    result.handshakes = count.load();
+    result.failures = failures.load();
+
+    for (size_t t = 0; t < config.clients; ++t) {
+        result.latency.merge(latencies[t]);
+    }
+    for (size_t step = 0; step < InProcessHandshake::STEP_COUNT; ++step) {
+        if (step == InProcessHandshake::CLIENT_RSA_KEYGEN && !config.client_keygen) {
+            continue;
+        }
+        Step merged{InProcessHandshake::step_name(step), SecureComm::LatencyHistogram()};
+        for (const auto& handshake : handshakes) {
+            merged.histogram.merge(handshake->steps()[step]);
+        }
+        result.steps.push_back(std::move(merged));
+    }
+    return result;
+}
+
+void print_result(const ModeResult& result) {
+    auto ms = [](double ns) { return ns / 1e6; };
+    const double per_s = static_cast<double>(result.handshakes) / result.wall_s;
+    std::cout << result.mode << ": " << result.handshakes << " handshakes in " << std::setprecision(2)
+              << result.wall_s << " s, " << result.failures << " failed";
+    if (result.rejected > 0) {
+        std::cout << " (" << result.rejected << " refused by the handshake pool)";
+    }
+    std::cout << std::endl;
+    std::cout << "  throughput:     " << std::setprecision(1) << per_s << " handshakes/s, "
+              << (result.cpu_s > 0 ? static_cast<double>(result.handshakes) / result.cpu_s : 0.0)
+              << " per CPU-second (" << std::setprecision(2)
+              << (result.handshakes > 0 ? 1000.0 * result.cpu_s / static_cast<double>(result.handshakes) : 0.0)
+              << " ms CPU each)" << std::endl;
+    std::cout << std::setprecision(3) << "  latency, ms:    p50 " << ms(result.latency.value_at_percentile(50))
+              << "   p99 " << ms(result.latency.value_at_percentile(99)) << "   max " << ms(result.latency.max())
+              << std::endl;
+    auto print_probe = [&ms](const char* label, const SecureComm::LatencyHistogram& h) {
+        std::cout << "  " << label << std::setprecision(3) << "p50 " << ms(h.value_at_percentile(50)) << "   p99 "
+                  << ms(h.value_at_percentile(99)) << "   max " << ms(h.max()) << "   (" << h.count()
+                  << " messages)" << std::endl;
+    };
+    if (result.flood_inits > 0) {
+        std::cout << "  flood:          " << result.flood_inits << " bogus inits (" << std::setprecision(1)
+                  << static_cast<double>(result.flood_inits) / result.wall_s << "/s), " << result.cookies_sent
+                  << " inits answered with a cookie" << std::endl;
+    }
+    if (result.cookies_echoed > 0) {
+        std::cout << "  cookie echoes:  " << result.cookies_echoed << " inits echoed one of "
+                  << result.cookies_fetched << " cookies, " << result.cookies_admitted << " admitted" << std::endl;
+    }
+    if (result.probe_idle.count() > 0) {
+        print_probe("messages, idle:  ", result.probe_idle);
+        print_probe("messages, storm: ", result.probe_storm);
+    }
+
+    // Share is each step's summed time against all steps together
+    double total_ns = 0;
+    for (const Step& step : result.steps) {
+        total_ns += static_cast<double>(step.histogram.sum());
+    }
+    std::cout << "  " << std::left << std::setw(30) << "step" << std::right << std::setw(10) << "count"
+              << std::setw(10) << "mean ms" << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(8)
+              << "share" << std::endl;
+    for (const Step& step : result.steps) {
+        const SecureComm::LatencyHistogram& h = step.histogram;
+        std::cout << "  " << std::left << std::setw(30) << step.name << std::right << std::setw(10) << h.count()
+                  << std::setprecision(3) << std::setw(10) << ms(h.mean())
+                  << std::setw(10) << ms(static_cast<double>(h.value_at_percentile(50)))
+                  << std::setw(10) << ms(static_cast<double>(h.value_at_percentile(99))) << std::setprecision(1)
+                  << std::setw(7) << (total_ns > 0 ? 100.0 * static_cast<double>(h.sum()) / total_ns : 0.0) << "%"
+                  << std::endl;
+    }
+}
+
+void write_result_json(std::ostream& out, const ModeResult& result) {
+    out << "    {\"mode\": \"" << result.mode << "\", \"handshakes\": " << result.handshakes
+        << ", \"failures\": " << result.failures << ", \"wall_s\": " << result.wall_s
+        << ", \"cpu_s\": " << result.cpu_s
+        << ", \"handshakes_per_sec\": " << static_cast<double>(result.handshakes) / result.wall_s
+        << ", \"handshakes_per_cpu_sec\": "
+        << (result.cpu_s > 0 ? static_cast<double>(result.handshakes) / result.cpu_s : 0.0)
+        << ", \"p50_ns\": " << result.latency.value_at_percentile(50)
+        << ", \"p99_ns\": " << result.latency.value_at_percentile(99) << ", \"rejected\": " << result.rejected
+        << ", \"probe_idle_p99_ns\": " << result.probe_idle.value_at_percentile(99)
+        << ", \"probe_storm_p99_ns\": " << result.probe_storm.value_at_percentile(99)
+        << ", \"flood_inits\": " << result.flood_inits << ", \"cookies_sent\": " << result.cookies_sent
+        << ", \"cookies_fetched\": " << result.cookies_fetched << ", \"cookies_echoed\": " << result.cookies_echoed << ", \"cookies_admitted\": " << result.cookies_admitted
+        << ",\n      \"steps\": [";
+    for (size_t i = 0; i < result.steps.size(); ++i) {
+        const SecureComm::LatencyHistogram& h = result.steps[i].histogram;
+        out << (i == 0 ? "" : ", ") << "{\"name\": \"" << result.steps[i].name << "\", \"count\": " << h.count()
+            << ", \"mean_ns\": " << h.mean() << ", \"p50_ns\": " << h.value_at_percentile(50)
+            << ", \"p99_ns\": " << h.value_at_percentile(99) << "}";
+    }
+    out << "]}";
+}
+
+void usage(const char* program) {
+    std::cerr << "Usage: " << program << " [--mode loopback|inprocess|both] [--clients <n>] [--duration <s>]"
+              << " [--port <port>] [--client-keygen] [--probe-sessions <n>] [--probe-rate <msgs/s>]"
+              << " [--handshake-workers <n>] [--handshake-queue <n>] [--flood <inits/s>] [--flood-echo]"
+              << " [--cookie-threshold <n>]"
+              << " [--json <path>]" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Config config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        try {
+            if (arg == "--mode" && i + 1 < argc) {
+                config.mode = argv[++i];
+                if (config.mode != "loopback" && config.mode != "inprocess" && config.mode != "both") {
+                    throw std::invalid_argument(config.mode);
+                }
+            } else if (arg == "--clients" && i + 1 < argc) {
+                config.clients = std::max<size_t>(1, std::stoul(argv[++i]));
+            } else if (arg == "--duration" && i + 1 < argc) {
+                config.duration_s = std::max(0.1, std::stod(argv[++i]));
+            } else if (arg == "--port" && i + 1 < argc) {
+                config.port = static_cast<uint16_t>(std::stoi(argv[++i]));
+            } else if (arg == "--client-keygen") {
+                config.client_keygen = true;
+            } else if (arg == "--probe-sessions" && i + 1 < argc) {
+                config.probe_sessions = std::stoul(argv[++i]);
+            } else if (arg == "--probe-rate" && i + 1 < argc) {
+                config.probe_rate = std::max(1.0, std::stod(argv[++i]));
+            } else if (arg == "--handshake-workers" && i + 1 < argc) {
+                config.handshake_pool = true;
+                config.pool_config.workers = std::stoul(argv[++i]);
+            } else if (arg == "--handshake-queue" && i + 1 < argc) {
+                config.handshake_pool = true;
+                config.pool_config.max_queue = std::stoul(argv[++i]);
+            } else if (arg == "--flood" && i + 1 < argc) {
+                config.flood_rate = std::max(0.0, std::stod(argv[++i]));
+            } else if (arg == "--flood-echo") {
+                config.flood_echo = true;
+            } else if (arg == "--cookie-threshold" && i + 1 < argc) {
+                config.handshake_cookies = true;
+                config.cookie_threshold = std::stoul(argv[++i]);
+            } else if (arg == "--json" && i + 1 < argc) {
+                config.json_path = argv[++i];
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+        } catch (const std::exception&) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Server and client logging would dominate the timings
+    std::ofstream null_stream("/dev/null");
+    std::streambuf* saved_cout = std::cout.rdbuf(null_stream.rdbuf());
+    std::streambuf* saved_cerr = std::cerr.rdbuf(null_stream.rdbuf());
+    SecureComm::Logger::instance().set_level(SecureComm::LogLevel::OFF);
+    // Keeps the tick rate behind the server's stage histograms calibrated
+    SecureComm::Metrics::instance().start(std::chrono::milliseconds(1000));
+
+    std::vector<ModeResult> results;
+    try {
+        if (config.mode != "inprocess") {
+            results.push_back(run_loopback(config));
+        }
+        if (config.mode != "loopback") {
+            results.push_back(run_in_process(config));
+        }
+    } catch (const std::exception& e) {
+        std::cout.rdbuf(saved_cout);
+        std::cerr.rdbuf(saved_cerr);
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    SecureComm::Metrics::instance().stop();
+    std::cout.rdbuf(saved_cout);
+    std::cerr.rdbuf(saved_cerr);
+
+    std::cout << "Handshake storm: " << config.clients << " parallel clients, " << config.duration_s
+              << " s per mode, " << std::thread::hardware_concurrency() << " hardware threads"
+              << (config.client_keygen ? ", new client RSA key per handshake" : "")
+              << (config.handshake_pool ? ", server handshake pool" : "")
+              << (config.flood_rate > 0 ? ", flood of " + std::to_string(static_cast<int>(config.flood_rate)) +
+                                              " inits/s" + (config.flood_echo ? " echoing cookies" : "") : "")
+              << (config.handshake_cookies ? ", cookie threshold " + std::to_string(config.cookie_threshold) : "")
+              << std::endl;
+    std::cout << std::fixed;
+    uint64_t failures = 0;
+    for (const ModeResult& result : results) {
+        print_result(result);
+        failures += result.failures - result.rejected;
+        // Each cookie admits one init; any echo beyond that was a replay let in
+        if (result.cookies_admitted > result.cookies_fetched) {
+            std::cout << "  " << result.cookies_admitted - result.cookies_fetched << " replayed cookies admitted"
+                      << std::endl;
+            ++failures;
+        }
+    }
+
+    if (!config.json_path.empty()) {
+        std::ofstream out(config.json_path);
+        out << std::setprecision(6);
+        out << "{\n  \"benchmark\": \"handshake_storm\",\n";
+        out << "  \"config\": {\"clients\": " << config.clients << ", \"duration_s\": " << config.duration_s
+            << ", \"client_keygen\": " << (config.client_keygen ? "true" : "false")
+            << ", \"hardware_threads\": " << std::thread::hardware_concurrency() << "},\n";
+        out << "  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            write_result_json(out, results[i]);
+            out << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+        if (!out) {
+            std::cerr << "Cannot write " << config.json_path << std::endl;
+            return 1;
+        }
+        std::cout << "Wrote " << config.json_path << std::endl;
+    }
+    return failures == 0 ? 0 : 2;
+}
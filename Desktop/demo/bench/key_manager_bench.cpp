@@ -0,0 +1,141 @@
+#include "common.h"
+#include "../crypto/crypto_utils.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// KeyManager contention benchmark: reader/writer mixes at increasing thread
+// counts. Compares the lock-free KeyManager (get_key copies the key,
+// borrow_key reads it in place) with the mutex + std::unordered_map layout
+// it replaced, which copied the key under the lock on every read.
+
+namespace {
+
+// The previous KeyManager storage, kept for comparison
+class MutexKeyMap {
+public:
+    void store_key(const std::string& key_id, const std::vector<uint8_t>& key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        keys_[key_id] = key;
+    }
+
+    std::vector<uint8_t> get_key(const std::string& key_id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = keys_.find(key_id);
+        return it == keys_.end() ? std::vector<uint8_t>() : it->second;
+    }
+
+private:
+    std::unordered_map<std::string, std::vector<uint8_t>> keys_;
+    std::mutex mutex_;
+};
+
+template <typename ReadFn, typename WriteFn>
+double run_mix(unsigned thread_count, double write_ratio, size_t key_count,
+               std::chrono::milliseconds duration, ReadFn read, WriteFn write) {
+    std::atomic<bool> start(false);
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> total_ops(0);
+    // Keeps the reads from being optimized away
+    std::atomic<uint64_t> checksum_sink(0);
+    std::vector<std::thread> workers;
+
+    for (unsigned t = 0; t < thread_count; ++t) {
+        workers.emplace_back([&, t]() {
+            std::mt19937 gen(t + 1);
+            std::uniform_int_distribution<size_t> pick(0, key_count - 1);
+            std::uniform_real_distribution<double> coin(0.0, 1.0);
+            uint64_t ops = 0;
+            uint64_t checksum = 0;
+            while (!start.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            while (!stop.load(std::memory_order_relaxed)) {
+                size_t index = pick(gen);
+                if (write_ratio > 0 && coin(gen) < write_ratio) {
+                    write(index);
+                } else {
+                    checksum += read(index);
+                }
+                ++ops;
+            }
+            total_ops.fetch_add(ops, std::memory_order_relaxed);
+            checksum_sink.fetch_add(checksum, std::memory_order_relaxed);
+        });
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(duration);
+    stop.store(true);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return static_cast<double>(total_ops.load()) / seconds / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t key_count = 100000;
+    unsigned max_threads = 8;
+    long run_ms = 500;
+    if (argc > 1) key_count = std::max<size_t>(1, std::stoul(argv[1]));
+    if (argc > 2) max_threads = std::max(1u, static_cast<unsigned>(std::stoul(argv[2])));
+    if (argc > 3) run_ms = std::stol(argv[3]);
+    auto duration = std::chrono::milliseconds(run_ms);
+
+    std::vector<std::string> ids(key_count);
+    SecureComm::CryptoManager crypto;
+    std::vector<uint8_t> key = crypto.generate_random_bytes(SecureComm::KEY_SIZE);
+    SecureComm::KeyManager manager;
+    MutexKeyMap baseline;
+    for (size_t i = 0; i < key_count; ++i) {
+        ids[i] = "client-key-" + std::to_string(i);
+        manager.store_key(ids[i], key);
+        baseline.store_key(ids[i], key);
+    }
+
+    std::cout << "KeyManager contention: " << key_count << " keys, " << run_ms
+              << " ms per run, Mops/s (" << std::thread::hardware_concurrency() << " hardware threads)" << std::endl;
+    std::cout << std::left << std::setw(9) << "threads" << std::setw(9) << "writes"
+              << std::right << std::setw(14) << "mutex+map" << std::setw(14) << "get_key"
+              << std::setw(14) << "borrow_key" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+
+    const double write_ratios[] = {0.0, 0.001, 0.01, 0.1};
+    for (double write_ratio : write_ratios) {
+        for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+            double mutex_map = run_mix(threads, write_ratio, key_count, duration,
+                [&](size_t i) { return static_cast<uint64_t>(baseline.get_key(ids[i])[0]); },
+                [&](size_t i) { baseline.store_key(ids[i], key); });
+            double copied = run_mix(threads, write_ratio, key_count, duration,
+                [&](size_t i) { return static_cast<uint64_t>(manager.get_key(ids[i])[0]); },
+                [&](size_t i) { manager.store_key(ids[i], key); });
+            double borrowed = run_mix(threads, write_ratio, key_count, duration,
+                [&](size_t i) {
+                    SecureComm::KeyManager::KeyView view = manager.borrow_key(std::string_view(ids[i]));
+                    return static_cast<uint64_t>(view.data()[0]);
+                },
+                [&](size_t i) { manager.store_key(ids[i], key); });
+
+            std::ostringstream writes;
+            writes << std::fixed << std::setprecision(1) << write_ratio * 100.0 << "%";
+            std::cout << std::left << std::setw(9) << threads << std::setw(9) << writes.str()
+                      << std::right << std::setw(14) << mutex_map << std::setw(14) << copied
+                      << std::setw(14) << borrowed << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "common.h"
+#include "../crypto/crypto_utils.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// KeyManager snapshot benchmark: fill a KeyManager with N keys, back it up
+// while another thread keeps looking keys up (to show how long lookups are
+// blocked by the snapshot copy), then restore into a fresh KeyManager and
+// time the lazy restore, first lookups that pull chunks in, and a full load.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsed_ms(Clock::time_point begin) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+}
+
+std::string key_id(size_t i) {
+    return "key-" + std::to_string(i);
+}
+
+std::vector<uint8_t> key_bytes(size_t i) {
+    std::vector<uint8_t> key(SecureComm::KEY_SIZE);
+    for (size_t j = 0; j < key.size(); ++j) {
+        key[j] = static_cast<uint8_t>(i * 131 + j * 7 + (i >> 8));
+    }
+    return key;
+}
+
+size_t file_size(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return 0;
+    }
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::fclose(file);
+    return size > 0 ? static_cast<size_t>(size) : 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t key_count = 1000000;
+    std::string path = "key_snapshot_bench.snap";
+    if (argc > 1) key_count = std::max<size_t>(1, std::stoul(argv[1]));
+    if (argc > 2) path = argv[2];
+
+    SecureComm::CryptoManager crypto;
+    std::vector<uint8_t> backup_key = crypto.generate_random_bytes(SecureComm::KEY_SIZE);
+    auto expires_at = std::chrono::system_clock::now() + std::chrono::hours(1);
+
+    std::cout << "Key snapshot benchmark: " << key_count << " keys" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    // Backup, with a concurrent reader measuring its worst lookup
+    {
+        SecureComm::KeyManager manager;
+        for (size_t i = 0; i < key_count; ++i) {
+            manager.store_key(key_id(i), key_bytes(i));
+            if (i % 10 == 0) {
+                manager.set_key_expiration(key_id(i), expires_at);
+            }
+        }
+
+        std::atomic<bool> done{false};
+        double worst_lookup_ms = 0;
+        size_t lookups = 0;
+        std::thread reader([&]() {
+            std::mt19937 rng(7);
+            std::uniform_int_distribution<size_t> pick(0, key_count - 1);
+            while (!done.load(std::memory_order_relaxed)) {
+                auto begin = Clock::now();
+                manager.get_key(key_id(pick(rng)));
+                worst_lookup_ms = std::max(worst_lookup_ms, elapsed_ms(begin));
+                lookups++;
+            }
+        });
+
+        auto begin = Clock::now();
+        size_t written = manager.backup_keys(path, backup_key);
+        double ms = elapsed_ms(begin);
+        done = true;
+        reader.join();
+
+        double mb = static_cast<double>(file_size(path)) / (1024.0 * 1024.0);
+        std::cout << "snapshot:          " << std::setw(10) << ms << " ms  ("
+                  << std::setprecision(0) << written / (ms / 1000.0) << " keys/s, "
+                  << std::setprecision(1) << mb / (ms / 1000.0) << " MB/s, " << mb << " MB)" << std::endl;
+        std::cout << "  concurrent lookups: " << lookups << ", worst " << std::setprecision(2)
+                  << worst_lookup_ms << " ms" << std::setprecision(1) << std::endl;
+    }
+
+    // Restore: index only, then chunks on demand
+    SecureComm::KeyManager restored;
+    auto begin = Clock::now();
+    size_t restored_count = restored.restore_keys(path, backup_key);
+    double restore_ms = elapsed_ms(begin);
+    std::cout << "restore (index):   " << std::setw(10) << restore_ms << " ms  ("
+              << restored_count << " keys)" << std::endl;
+
+    const size_t sample = std::min<size_t>(10000, key_count);
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<size_t> pick(0, key_count - 1);
+    begin = Clock::now();
+    for (size_t i = 0; i < sample; ++i) {
+        restored.get_key(key_id(pick(rng)));
+    }
+    double first_ms = elapsed_ms(begin);
+    std::cout << "first lookups:     " << std::setw(10) << first_ms << " ms  ("
+              << std::setprecision(2) << 1000.0 * first_ms / sample << " us/lookup over "
+              << sample << " random keys)" << std::setprecision(1) << std::endl;
+
+    size_t mismatches = 0;
+    begin = Clock::now();
+    for (size_t i = 0; i < key_count; ++i) {
+        if (restored.get_key(key_id(i)) != key_bytes(i)) {
+            mismatches++;
+        }
+    }
+    double full_ms = elapsed_ms(begin);
+    std::cout << "load all:          " << std::setw(10) << full_ms << " ms  ("
+              << std::setprecision(0) << key_count / (full_ms / 1000.0) << " keys/s)" << std::endl;
+
+    bool ok = restored_count == key_count && mismatches == 0 && !restored.is_key_expired(key_id(0));
+    if (!ok) {
+        std::cout << "MISMATCH: restored " << restored_count << ", " << mismatches << " wrong keys" << std::endl;
+    }
+
+    std::remove(path.c_str());
+    return ok ? 0 : 1;
+}
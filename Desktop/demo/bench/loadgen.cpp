@@ -0,0 +1,562 @@
+#include "common.h"
+#include "histogram.h"
+#include "logger.h"
+#include "../crypto/crypto_utils.h"
+#include "../client/secure_client.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+#else
+    #include <sys/resource.h>
+    #include <sys/socket.h>
+    #include <netdb.h>
+    #include <unistd.h>
+#endif
+
+// Load generator: opens many concurrent sessions against a running server
+// with the real handshake, then sends encrypted messages for a fixed time.
+//
+// Sessions are spread over worker threads; each worker keeps its sessions
+// open and sends on them in turn, so --connections sets how many sessions
+// the server holds and --threads how many requests are in flight. With
+// --rate the load is open loop: every worker follows its own Poisson
+// schedule, and message latency counts from the scheduled send time, so a
+// server that falls behind shows up as latency instead of a lower request
+// rate (no coordinated omission). --churn closes and reopens sessions on a
+// schedule as well, by full handshake or, with --resume, ticket resumption.
+//
+// Reports throughput and HDR latency percentiles for handshakes and
+// messages; --json writes them with the full histograms. With --scrape the
+// server's metrics endpoint is polled throughout the run, and the run
+// fails unless every scrape succeeds and the server's message counter
+// accounts for every reply received.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Config {
+    std::string host = "127.0.0.1";
+    uint16_t port = SecureComm::DEFAULT_PORT;
+    size_t connections = 1000;
+    size_t threads = 16;
+    // Messages per second over all workers; 0 sends back to back
+    double rate = 1000;
+    // Sessions closed and reopened per second over all workers
+    double churn = 0;
+    bool resume = false;
+    bool compress = false;
+    double duration_s = 10;
+    std::vector<size_t> sizes = {64, 512, 2048};
+    std::vector<double> weights = {60, 30, 10};
+    std::string json_path;
+    // Metrics endpoint port on the same host; 0 = don't scrape
+    uint16_t scrape_port = 0;
+};
+
+struct WorkerStats {
+    SecureComm::LatencyHistogram handshake;
+    SecureComm::LatencyHistogram message;
+    // From the actual send, without time spent waiting behind earlier requests
+    SecureComm::LatencyHistogram service;
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+    uint64_t message_errors = 0;
+    uint64_t handshake_failures = 0;
+    // How far the worker was behind its schedule when the run ended
+    double final_lag_ms = 0;
+};
+
+// Largest message whose reply ("Server received: " + message) and tag fit a frame
+constexpr size_t MAX_PAYLOAD = SecureComm::MAX_MESSAGE_SIZE - SecureComm::GCM_TAG_SIZE - 32;
+
+uint64_t elapsed_ns(Clock::time_point begin, Clock::time_point end) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+}
+
+// "64:60,512:30,2048:10" (size:weight) or a single size
+bool parse_sizes(const std::string& spec, Config& config) {
+    config.sizes.clear();
+    config.weights.clear();
+    std::stringstream stream(spec);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        size_t colon = item.find(':');
+        size_t size = std::stoul(item.substr(0, colon));
+        double weight = colon == std::string::npos ? 1.0 : std::stod(item.substr(colon + 1));
+        if (size == 0 || size > MAX_PAYLOAD || weight <= 0) {
+            return false;
+        }
+        config.sizes.push_back(size);
+        config.weights.push_back(weight);
+    }
+    return !config.sizes.empty();
+}
+
+class Worker {
+public:
+    Worker(const Config& config, size_t index, size_t connections, const SecureComm::KeyPair& identity)
+        : config_(config), rng_(0x5ec0 + index), size_choice_(config.weights.begin(), config.weights.end()),
+          cursor_(0), churn_cursor_(0) {
+        for (size_t i = 0; i < connections; ++i) {
+            clients_.push_back(std::make_unique<SecureClient>(identity));
+            if (config_.compress) {
+                SecureComm::Capabilities offered = SecureComm::local_capabilities();
+                clients_.back()->set_capabilities(offered);
+            }
+        }
+        std::uniform_int_distribution<int> letter('a', 'z');
+        payload_.resize(MAX_PAYLOAD);
+        for (char& c : payload_) {
+            c = static_cast<char>(letter(rng_));
+        }
+    }
+
+    void open_sessions() {
+        for (auto& client : clients_) {
+            handshake(*client, false);
+        }
+    }
+
+    void run(Clock::time_point start, Clock::time_point end) {
+        const double per_worker_rate = config_.rate / static_cast<double>(config_.threads);
+        const double per_worker_churn = config_.churn / static_cast<double>(config_.threads);
+        std::exponential_distribution<double> send_gap(per_worker_rate > 0 ? per_worker_rate : 1.0);
+        std::exponential_distribution<double> churn_gap(per_worker_churn > 0 ? per_worker_churn : 1.0);
+        Clock::time_point next_send = start;
+        Clock::time_point next_churn = per_worker_churn > 0 ? start + to_duration(churn_gap(rng_)) : end;
+        if (per_worker_rate > 0) {
+            next_send += to_duration(send_gap(rng_));
+        }
+
+        while (true) {
+            Clock::time_point due = std::min(next_send, next_churn);
+            if (due >= end || Clock::now() >= end) {
+                break;
+            }
+            std::this_thread::sleep_until(due);
+            if (next_churn <= next_send) {
+                SecureClient& client = *clients_[churn_cursor_++ % clients_.size()];
+                client.disconnect();
+                handshake(client, config_.resume);
+                next_churn += to_duration(churn_gap(rng_));
+                continue;
+            }
+
+            SecureClient& client = *clients_[cursor_++ % clients_.size()];
+            if (!client.has_session() && !handshake(client, config_.resume)) {
+                stats_.message_errors++;
+            } else {
+                size_t size = config_.sizes[size_choice_(rng_)];
+                std::string response;
+                Clock::time_point sent = Clock::now();
+                if (client.send_encrypted_message(payload_.substr(0, size), &response)) {
+                    Clock::time_point done = Clock::now();
+                    stats_.message.record(elapsed_ns(next_send, done));
+                    stats_.service.record(elapsed_ns(sent, done));
+                    stats_.messages++;
+                    stats_.bytes += size;
+                } else {
+                    // The connection is gone; reopen it on the next turn
+                    stats_.message_errors++;
+                    client.disconnect();
+                }
+            }
+            next_send = per_worker_rate > 0 ? next_send + to_duration(send_gap(rng_)) : Clock::now();
+        }
+        Clock::time_point now = Clock::now();
+        if (per_worker_rate > 0 && now > next_send) {
+            stats_.final_lag_ms = std::chrono::duration<double, std::milli>(now - next_send).count();
+        }
+    }
+
+    void close_sessions() {
+        for (auto& client : clients_) {
+            client->disconnect();
+        }
+    }
+
+    const WorkerStats& stats() const { return stats_; }
+
+private:
+    static Clock::duration to_duration(double seconds) {
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    }
+
+    bool handshake(SecureClient& client, bool resume) {
+        Clock::time_point begin = Clock::now();
+        bool ok = resume && client.has_ticket() ? client.reconnect(config_.host, config_.port)
+                                                : client.connect(config_.host, config_.port);
+        if (ok) {
+            stats_.handshake.record(elapsed_ns(begin, Clock::now()));
+        } else {
+            stats_.handshake_failures++;
+        }
+        return ok;
+    }
+
+    const Config& config_;
+    std::mt19937_64 rng_;
+    std::discrete_distribution<size_t> size_choice_;
+    std::vector<std::unique_ptr<SecureClient>> clients_;
+    std::string payload_;
+    size_t cursor_;
+    size_t churn_cursor_;
+    WorkerStats stats_;
+};
+
+// One GET against the metrics endpoint; the value of the named sample
+bool scrape_metric(const std::string& host, uint16_t port, const std::string& metric, uint64_t& value) {
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0 || !result) {
+        return false;
+    }
+    int sock = static_cast<int>(socket(result->ai_family, result->ai_socktype, result->ai_protocol));
+    bool connected = sock >= 0 && connect(sock, result->ai_addr, static_cast<socklen_t>(result->ai_addrlen)) == 0;
+    freeaddrinfo(result);
+
+    std::string response;
+    if (connected) {
+        const std::string request = "GET /metrics HTTP/1.1\r\nHost: " + host + "\r\nConnection: close\r\n\r\n";
+        if (send(sock, request.data(), static_cast<int>(request.size()), 0) == static_cast<int>(request.size())) {
+            char chunk[4096];
+            int received;
+            while ((received = recv(sock, chunk, sizeof(chunk), 0)) > 0) {
+                response.append(chunk, static_cast<size_t>(received));
+            }
+        }
+    }
+    if (sock >= 0) {
+#ifdef _WIN32
+        closesocket(sock);
+#else
+        close(sock);
+#endif
+    }
+
+    size_t line = response.find("\n" + metric + " ");
+    if (response.compare(0, 12, "HTTP/1.1 200") != 0 || line == std::string::npos) {
+        return false;
+    }
+    value = std::stoull(response.substr(line + metric.size() + 2));
+    return true;
+}
+
+// Polls the endpoint until stopped, checking the counter never goes back
+class Scraper {
+public:
+    explicit Scraper(const Config& config)
+        : config_(config), stop_(false), scrapes_(0), failures_(0), regressions_(0) {}
+
+    // Scrapes once for the baseline, then keeps polling in the background
+    void start() {
+        scrape();
+        first_ = last_;
+        thread_ = std::thread([this]() {
+            while (!stop_) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(250));
+                scrape();
+            }
+        });
+    }
+
+    // Scrapes once more after the server's next snapshot
+    void finish() {
+        stop_ = true;
+        thread_.join();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+        scrape();
+    }
+
+    uint64_t scrapes() const { return scrapes_; }
+    uint64_t failures() const { return failures_; }
+    uint64_t regressions() const { return regressions_; }
+    // Messages the server counted between the first and last scrape
+    uint64_t counted() const { return last_ - first_; }
+
+private:
+    void scrape() {
+        uint64_t value = 0;
+        scrapes_++;
+        if (!scrape_metric(config_.host, config_.scrape_port, "securecomm_messages_received_total", value)) {
+            failures_++;
+            return;
+        }
+        if (value < last_) {
+            regressions_++;
+        }
+        last_ = value;
+    }
+
+    const Config& config_;
+    std::atomic<bool> stop_;
+    std::thread thread_;
+    uint64_t scrapes_;
+    uint64_t failures_;
+    uint64_t regressions_;
+    uint64_t first_ = 0;
+    uint64_t last_ = 0;
+};
+
+void print_histogram(const std::string& label, const SecureComm::LatencyHistogram& histogram) {
+    auto ms = [](uint64_t ns) { return static_cast<double>(ns) / 1e6; };
+    std::cout << std::left << std::setw(12) << label << std::right << std::setw(10) << histogram.count();
+    if (histogram.count() == 0) {
+        std::cout << std::endl;
+        return;
+    }
+    std::cout << std::fixed << std::setprecision(3)
+              << std::setw(10) << ms(histogram.value_at_percentile(50))
+              << std::setw(10) << ms(histogram.value_at_percentile(90))
+              << std::setw(10) << ms(histogram.value_at_percentile(99))
+              << std::setw(10) << ms(histogram.value_at_percentile(99.9))
+              << std::setw(10) << ms(histogram.max()) << std::endl;
+}
+
+void write_histogram_json(std::ostream& out, const std::string& name, const SecureComm::LatencyHistogram& histogram) {
+    out << "    \"" << name << "\": {\"count\": " << histogram.count() << ", \"min_ns\": " << histogram.min()
+        << ", \"mean_ns\": " << histogram.mean() << ", \"p50_ns\": " << histogram.value_at_percentile(50)
+        << ", \"p90_ns\": " << histogram.value_at_percentile(90)
+        << ", \"p99_ns\": " << histogram.value_at_percentile(99)
+        << ", \"p999_ns\": " << histogram.value_at_percentile(99.9) << ", \"max_ns\": " << histogram.max()
+        << ",\n      \"buckets\": [";
+    // Non-empty buckets as [highest value in bucket, count]
+    bool first = true;
+    for (size_t i = 0; i < SecureComm::LatencyHistogram::BUCKET_COUNT; ++i) {
+        uint64_t count = histogram.count_at(i);
+        if (count != 0) {
+            out << (first ? "" : ", ") << "[" << SecureComm::LatencyHistogram::bucket_upper_bound(i) << ", "
+                << count << "]";
+            first = false;
+        }
+    }
+    out << "]}";
+}
+
+void usage(const char* program) {
+    std::cerr << "Usage: " << program << " [host] [port] [--connections <n>] [--threads <n>]"
+              << " [--rate <msgs/s, 0 = closed loop>] [--duration <s>] [--sizes <size:weight,...>]"
+              << " [--churn <reconnects/s>] [--resume] [--compress] [--scrape <metrics port>] [--json <path>]"
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Config config;
+    size_t positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        try {
+            if (arg == "--connections" && i + 1 < argc) {
+                config.connections = std::max<size_t>(1, std::stoul(argv[++i]));
+            } else if (arg == "--threads" && i + 1 < argc) {
+                config.threads = std::max<size_t>(1, std::stoul(argv[++i]));
+            } else if (arg == "--rate" && i + 1 < argc) {
+                config.rate = std::max(0.0, std::stod(argv[++i]));
+            } else if (arg == "--duration" && i + 1 < argc) {
+                config.duration_s = std::max(0.1, std::stod(argv[++i]));
+            } else if (arg == "--sizes" && i + 1 < argc) {
+                if (!parse_sizes(argv[++i], config)) {
+                    std::cerr << "Sizes must be 1.." << MAX_PAYLOAD << " bytes with positive weights" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--churn" && i + 1 < argc) {
+                config.churn = std::max(0.0, std::stod(argv[++i]));
+            } else if (arg == "--resume") {
+                config.resume = true;
+            } else if (arg == "--compress") {
+                config.compress = true;
+            } else if (arg == "--scrape" && i + 1 < argc) {
+                config.scrape_port = static_cast<uint16_t>(std::stoi(argv[++i]));
+            } else if (arg == "--json" && i + 1 < argc) {
+                config.json_path = argv[++i];
+            } else if (positional == 0 && arg[0] != '-') {
+                config.host = arg;
+                positional++;
+            } else if (positional == 1 && arg[0] != '-') {
+                config.port = static_cast<uint16_t>(std::stoi(arg));
+                positional++;
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+        } catch (const std::exception&) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    config.threads = std::min(config.threads, config.connections);
+
+#ifndef _WIN32
+    // Every session is a socket
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+#endif
+
+    // The client narrates every handshake and message on stdout
+    SecureComm::Logger::instance().set_level(SecureComm::LogLevel::OFF);
+    std::ofstream null_stream("/dev/null");
+    std::streambuf* saved_cout = std::cout.rdbuf(null_stream.rdbuf());
+    std::streambuf* saved_cerr = std::cerr.rdbuf(null_stream.rdbuf());
+
+    // One RSA identity for every session instead of one key generation each
+    SecureComm::CryptoManager crypto;
+    SecureComm::KeyPair identity = crypto.generate_rsa_keypair(2048);
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (size_t t = 0; t < config.threads; ++t) {
+        size_t share = config.connections / config.threads + (t < config.connections % config.threads ? 1 : 0);
+        workers.push_back(std::make_unique<Worker>(config, t, share, identity));
+    }
+
+    auto run_all = [&workers](auto&& step) {
+        std::vector<std::thread> threads;
+        for (auto& worker : workers) {
+            threads.emplace_back([&worker, &step]() { step(*worker); });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    };
+
+    Clock::time_point connect_begin = Clock::now();
+    run_all([](Worker& worker) { worker.open_sessions(); });
+    double connect_s = std::chrono::duration<double>(Clock::now() - connect_begin).count();
+    SecureComm::LatencyHistogram initial;
+    uint64_t initial_failures = 0;
+    for (auto& worker : workers) {
+        initial.merge(worker->stats().handshake);
+        initial_failures += worker->stats().handshake_failures;
+    }
+
+    Scraper scraper(config);
+    if (config.scrape_port != 0) {
+        scraper.start();
+    }
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(
+                                        std::chrono::duration<double>(config.duration_s));
+    run_all([start, end](Worker& worker) { worker.run(start, end); });
+    double run_s = std::chrono::duration<double>(Clock::now() - start).count();
+    run_all([](Worker& worker) { worker.close_sessions(); });
+    if (config.scrape_port != 0) {
+        scraper.finish();
+    }
+
+    std::cout.rdbuf(saved_cout);
+    std::cerr.rdbuf(saved_cerr);
+
+    // Handshake latency covers the initial sessions and every reconnect
+    SecureComm::LatencyHistogram handshakes;
+    SecureComm::LatencyHistogram messages;
+    SecureComm::LatencyHistogram service;
+    uint64_t message_count = 0, bytes = 0, message_errors = 0, handshake_failures = 0;
+    double max_lag_ms = 0;
+    for (auto& worker : workers) {
+        const WorkerStats& stats = worker->stats();
+        handshakes.merge(stats.handshake);
+        messages.merge(stats.message);
+        service.merge(stats.service);
+        message_count += stats.messages;
+        bytes += stats.bytes;
+        message_errors += stats.message_errors;
+        handshake_failures += stats.handshake_failures;
+        max_lag_ms = std::max(max_lag_ms, stats.final_lag_ms);
+    }
+    // Churn, plus reopening sessions that failed
+    uint64_t churn_count = handshakes.count() - initial.count();
+
+    std::cout << "Load: " << config.connections << " sessions on " << config.threads << " threads against "
+              << config.host << ":" << config.port << ", " << config.duration_s << " s, ";
+    if (config.rate > 0) {
+        std::cout << "open loop at " << config.rate << " msgs/s";
+    } else {
+        std::cout << "closed loop";
+    }
+    if (config.churn > 0) {
+        std::cout << ", churn " << config.churn << "/s" << (config.resume ? " (resume)" : " (full)");
+    }
+    std::cout << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Sessions opened:  " << initial.count() << " in " << connect_s << " s ("
+              << static_cast<double>(initial.count()) / connect_s << "/s), " << initial_failures << " failed"
+              << std::endl;
+    std::cout << "Messages:         " << static_cast<double>(message_count) / run_s << " msgs/s, "
+              << static_cast<double>(bytes) / run_s / 1e6 << " MB/s payload, " << message_errors << " errors"
+              << std::endl;
+    std::cout << "Run handshakes:   " << static_cast<double>(churn_count) / run_s << "/s, "
+              << handshake_failures - initial_failures << " failed" << std::endl;
+    if (config.rate > 0 && max_lag_ms > 100) {
+        std::cout << "Offered rate not sustained: workers ended " << max_lag_ms << " ms behind schedule"
+                  << std::endl;
+    }
+    std::cout << "Latency, ms" << std::endl;
+    std::cout << std::left << std::setw(12) << "" << std::right << std::setw(10) << "count" << std::setw(10) << "p50"
+              << std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(10) << "p99.9" << std::setw(10)
+              << "max" << std::endl;
+    print_histogram("handshake", handshakes);
+    print_histogram("message", messages);
+    print_histogram("service", service);
+    bool scrape_ok = true;
+    if (config.scrape_port != 0) {
+        // Replies the server sent must have been counted as received
+        scrape_ok = scraper.failures() == 0 && scraper.regressions() == 0 && scraper.counted() >= message_count;
+        std::cout << "Metrics scrapes:  " << scraper.scrapes() << ", " << scraper.failures() << " failed, "
+                  << scraper.regressions() << " counter regressions; server counted " << scraper.counted()
+                  << " messages for " << message_count << " replies" << (scrape_ok ? "" : " (FAILED)") << std::endl;
+    }
+
+    if (!config.json_path.empty()) {
+        std::ofstream out(config.json_path);
+        out << std::setprecision(6);
+        out << "{\n  \"benchmark\": \"loadgen\",\n";
+        out << "  \"config\": {\"host\": \"" << config.host << "\", \"port\": " << config.port
+            << ", \"connections\": " << config.connections << ", \"threads\": " << config.threads
+            << ", \"rate\": " << config.rate << ", \"churn\": " << config.churn
+            << ", \"resume\": " << (config.resume ? "true" : "false")
+            << ", \"compress\": " << (config.compress ? "true" : "false")
+            << ", \"duration_s\": " << config.duration_s << "},\n";
+        out << "  \"sessions_opened\": " << initial.count() << ", \"session_open_failures\": " << initial_failures
+            << ", \"connect_s\": " << connect_s << ",\n";
+        out << "  \"run_s\": " << run_s << ", \"messages\": " << message_count << ", \"payload_bytes\": " << bytes
+            << ", \"message_errors\": " << message_errors << ", \"messages_per_sec\": "
+            << static_cast<double>(message_count) / run_s << ", \"churn_handshakes\": " << churn_count
+            << ", \"churn_failures\": " << handshake_failures - initial_failures
+            << ", \"max_schedule_lag_ms\": " << max_lag_ms << ",\n";
+        out << "  \"histograms\": {\n";
+        write_histogram_json(out, "handshake", handshakes);
+        out << ",\n";
+        write_histogram_json(out, "message", messages);
+        out << ",\n";
+        write_histogram_json(out, "service", service);
+        out << "\n  }\n}\n";
+        if (!out) {
+            std::cerr << "Cannot write " << config.json_path << std::endl;
+            return 1;
+        }
+        std::cout << "Wrote " << config.json_path << std::endl;
+    }
+    return message_errors == 0 && handshake_failures == 0 && scrape_ok ? 0 : 2;
+}
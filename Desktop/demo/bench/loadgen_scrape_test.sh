@@ -0,0 +1,53 @@
+#!/bin/bash
+# Smoke test for the metrics endpoint: starts a server with --metrics-port,
+# runs a short loadgen --scrape against it and fails if loadgen does (a
+# failed scrape, a counter regression or a reply the server did not count).
+#
+# Usage: loadgen_scrape_test.sh <server> <loadgen> [port] [metrics port]
+
+SERVER="$1"
+LOADGEN="$2"
+PORT="${3:-9710}"
+METRICS_PORT="${4:-9711}"
+LOG="$(mktemp)"
+
+if [ ! -x "$SERVER" ] || [ ! -x "$LOADGEN" ]; then
+    echo "Usage: $0 <server> <loadgen> [port] [metrics port]"
+    exit 1
+fi
+
+"$SERVER" "$PORT" --metrics-port "$METRICS_PORT" --log-level warn >"$LOG" 2>&1 &
+SERVER_PID=$!
+# SIGKILL as in cluster_harness: the server does not stop on SIGTERM
+trap 'kill -KILL "$SERVER_PID" 2>/dev/null; wait "$SERVER_PID" 2>/dev/null; rm -f "$LOG"' EXIT
+
+# True once the endpoint serves a snapshot; it answers 503 until the
+# server publishes its first one, a second after starting
+metrics_ready() (
+    exec 3<>"/dev/tcp/127.0.0.1/$METRICS_PORT" || exit 1
+    printf 'GET /metrics HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n' >&3
+    read -r status <&3
+    [[ "$status" == "HTTP/1.1 200"* ]]
+)
+
+# Loadgen's first scrape is its baseline: wait for a snapshot and for the
+# protocol listener before starting it
+for _ in $(seq 1 100); do
+    if metrics_ready 2>/dev/null && (exec 3<>"/dev/tcp/127.0.0.1/$PORT") 2>/dev/null; then
+        break
+    fi
+    if ! kill -0 "$SERVER_PID" 2>/dev/null; then
+        echo "Server exited before listening:"
+        cat "$LOG"
+        exit 1
+    fi
+    sleep 0.1
+done
+
+"$LOADGEN" 127.0.0.1 "$PORT" --connections 8 --threads 2 --rate 200 --duration 2 --scrape "$METRICS_PORT"
+STATUS=$?
+if [ "$STATUS" -ne 0 ]; then
+    echo "loadgen exited with status $STATUS; server log:"
+    cat "$LOG"
+fi
+exit "$STATUS"
@@ -0,0 +1,129 @@
+#include "common.h"
+#include "logger.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Logger benchmark: caller-side cost of a typical server log line through
+// the asynchronous logger (enabled, filtered at runtime, compiled out)
+// against std::cout with std::endl, then N threads logging flat out to show
+// writer throughput and the drop counter. Output goes to /dev/null.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// ns per call; calls run in bursts that fit a ring, with a flush between
+// bursts so the enabled case measures recording, not drops
+template <typename LogFn>
+double time_calls(size_t calls, LogFn log_line) {
+    const size_t burst = SecureComm::Logger::RING_CAPACITY / 2;
+    double total_ns = 0;
+    for (size_t done = 0; done < calls; done += burst) {
+        auto begin = Clock::now();
+        for (size_t i = 0; i < burst; ++i) {
+            log_line(done + i);
+        }
+        total_ns += std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+        SecureComm::Logger::instance().flush();
+    }
+    return total_ns / static_cast<double>(((calls + burst - 1) / burst) * burst);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t calls = 200000;
+    size_t max_threads = 4;
+    int run_ms = 500;
+    if (argc > 1) calls = std::max<size_t>(1, std::stoul(argv[1]));
+    if (argc > 2) max_threads = std::max<size_t>(1, std::stoul(argv[2]));
+    if (argc > 3) run_ms = std::max(1, std::stoi(argv[3]));
+
+    FILE* null_file = std::fopen("/dev/null", "w");
+    if (!null_file) {
+        std::cerr << "Cannot open /dev/null" << std::endl;
+        return 1;
+    }
+    SecureComm::Logger& logger = SecureComm::Logger::instance();
+    logger.set_output(null_file);
+
+    std::cout << "Logger benchmark: " << calls << " calls per case, ns per call" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    const std::string peer = "203.0.113.7";
+
+    double async_ns = time_calls(calls, [&](size_t i) {
+        SC_LOG_INFO("Resumed session {} (key epoch {}) from {}", static_cast<uint32_t>(i), 3, peer);
+    });
+    logger.set_level(SecureComm::LogLevel::WARN);
+    double filtered_ns = time_calls(calls, [&](size_t i) {
+        SC_LOG_INFO("Resumed session {} (key epoch {}) from {}", static_cast<uint32_t>(i), 3, peer);
+    });
+    logger.set_level(SecureComm::LogLevel::INFO);
+    // Below the default SECURECOMM_LOG_LEVEL, so the call is compiled out
+    double compiled_out_ns = time_calls(calls, [&](size_t i) {
+        SC_LOG_DEBUG("Resumed session {} (key epoch {}) from {}", static_cast<uint32_t>(i), 3, peer);
+    });
+
+    // What the server did before: format on the calling thread and flush every line
+    std::ofstream null_stream("/dev/null");
+    std::streambuf* saved_cout = std::cout.rdbuf(null_stream.rdbuf());
+    auto begin = Clock::now();
+    for (size_t i = 0; i < calls; ++i) {
+        std::cout << "Resumed session " << static_cast<uint32_t>(i) << " (key epoch " << 3 << ") from "
+                  << peer << std::endl;
+    }
+    double cout_ns = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() /
+                     static_cast<double>(calls);
+    std::cout.rdbuf(saved_cout);
+
+    std::cout << "std::cout + std::endl: " << std::setw(8) << cout_ns << std::endl;
+    std::cout << "SC_LOG_INFO:           " << std::setw(8) << async_ns << std::endl;
+    std::cout << "filtered at runtime:   " << std::setw(8) << filtered_ns << std::endl;
+    std::cout << "compiled out (DEBUG):  " << std::setw(8) << compiled_out_ns << std::endl;
+
+    std::cout << "Flat out for " << run_ms << " ms (ring " << SecureComm::Logger::RING_CAPACITY
+              << " records per thread):" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(14) << "calls/s" << std::setw(14) << "written/s"
+              << std::setw(12) << "dropped" << std::endl;
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        logger.flush();
+        SecureComm::Logger::Stats before = logger.stats();
+        std::atomic<bool> stop(false);
+        std::atomic<uint64_t> total_calls(0);
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                uint64_t local = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    SC_LOG_INFO("Worker {} message {} from {}", static_cast<uint32_t>(t), local, peer);
+                    local++;
+                }
+                total_calls.fetch_add(local);
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(run_ms));
+        stop = true;
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        logger.flush();
+        SecureComm::Logger::Stats after = logger.stats();
+        double seconds = run_ms / 1000.0;
+        std::cout << std::setw(8) << threads << std::setw(14) << total_calls.load() / seconds
+                  << std::setw(14) << (after.written - before.written) / seconds
+                  << std::setw(12) << after.dropped - before.dropped << std::endl;
+    }
+
+    logger.stop();
+    logger.set_output(nullptr);
+    std::fclose(null_file);
+    return 0;
+}
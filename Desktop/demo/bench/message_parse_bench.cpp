@@ -0,0 +1,128 @@
+#include "common.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Message parse benchmark: the copying deserialize_* path the server and
+// client used (header copy, payload vector, struct copy, then vectors for
+// the key, nonce, IV and ciphertext) against reading the same fields in
+// place through MessageView, HandshakeView and EncryptedMessageView.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<uint8_t> build_message(SecureComm::MessageType type, uint16_t payload_size,
+                                   const std::vector<uint8_t>& body) {
+    SecureComm::MessageHeader header{};
+    header.version = SecureComm::ProtocolVersion::V1_0;
+    header.type = type;
+    header.sequence_number = 1;
+    header.timestamp = SecureComm::get_current_timestamp_seconds();
+    header.payload_size = payload_size;
+    header.flags = 0;
+    std::vector<uint8_t> data(SecureComm::HEADER_WIRE_SIZE + body.size());
+    SecureComm::MessageHeaderLayout::encode(header, data.data());
+    std::memcpy(data.data() + SecureComm::HEADER_WIRE_SIZE, body.data(), body.size());
+    return data;
+}
+
+// Messages parsed per second
+template <typename ParseFn>
+double time_parse(size_t iterations, ParseFn parse) {
+    auto begin = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        parse();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    return static_cast<double>(iterations) / seconds;
+}
+
+void report(const char* label, double copying, double views) {
+    std::cout << std::left << std::setw(12) << label << std::right
+              << std::setw(14) << copying / 1e6 << std::setw(14) << views / 1e6
+              << std::setw(10) << views / copying << "x" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t iterations = 2000000;
+    size_t message_size = 1024;
+    if (argc > 1) iterations = std::max<size_t>(1, std::stoul(argv[1]));
+    if (argc > 2) message_size = std::min<size_t>(SecureComm::MAX_MESSAGE_SIZE, std::max<size_t>(1, std::stoul(argv[2])));
+
+    SecureComm::HandshakeMessage handshake{};
+    handshake.client_id = 7;
+    handshake.session_id = 42;
+    handshake.fs_type = SecureComm::ForwardSecrecyType::ECDH;
+    std::vector<uint8_t> handshake_data = build_message(SecureComm::MessageType::HANDSHAKE_INIT,
+        SecureComm::HANDSHAKE_WIRE_SIZE, SecureComm::serialize_handshake(handshake));
+
+    SecureComm::EncryptedMessage encrypted{};
+    encrypted.session_id = 42;
+    encrypted.message_id = 1;
+    std::memset(encrypted.encrypted_data, 0x5a, message_size);
+    std::vector<uint8_t> encrypted_data = build_message(SecureComm::MessageType::ENCRYPTED_MESSAGE,
+        static_cast<uint16_t>(message_size), SecureComm::serialize_encrypted_message(encrypted));
+
+    // Keeps the parsed fields from being optimized away
+    std::atomic<uint64_t> sink(0);
+
+    std::cout << "Message parse: " << iterations << " messages per run, " << message_size
+              << "-byte ciphertext, M msgs/s" << std::endl;
+    std::cout << std::left << std::setw(12) << "message" << std::right << std::setw(14) << "deserialize"
+              << std::setw(14) << "views" << std::setw(11) << "speedup" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+
+    double header_copy = time_parse(iterations, [&]() {
+        SecureComm::MessageHeader header = SecureComm::deserialize_header(encrypted_data);
+        sink.fetch_add(header.payload_size, std::memory_order_relaxed);
+    });
+    double header_view = time_parse(iterations, [&]() {
+        SecureComm::MessageView message(encrypted_data);
+        sink.fetch_add(message.payload_size(), std::memory_order_relaxed);
+    });
+    report("header", header_copy, header_view);
+
+    double handshake_copy = time_parse(iterations, [&]() {
+        SecureComm::MessageHeader header = SecureComm::deserialize_header(handshake_data);
+        std::vector<uint8_t> payload(handshake_data.begin() + SecureComm::HEADER_WIRE_SIZE, handshake_data.end());
+        SecureComm::HandshakeMessage parsed = SecureComm::deserialize_handshake(payload);
+        std::vector<uint8_t> public_key(parsed.public_key, parsed.public_key + SecureComm::KEY_SIZE);
+        std::vector<uint8_t> nonce(parsed.nonce, parsed.nonce + SecureComm::IV_SIZE);
+        sink.fetch_add(parsed.client_id + header.flags + public_key[0] + nonce[0], std::memory_order_relaxed);
+    });
+    double handshake_view = time_parse(iterations, [&]() {
+        SecureComm::MessageView message(handshake_data);
+        SecureComm::HandshakeView parsed(message.body());
+        sink.fetch_add(parsed.client_id() + message.flags() + parsed.public_key().data()[0] +
+                       parsed.nonce().data()[0], std::memory_order_relaxed);
+    });
+    report("handshake", handshake_copy, handshake_view);
+
+    double encrypted_copy = time_parse(iterations, [&]() {
+        SecureComm::MessageHeader header = SecureComm::deserialize_header(encrypted_data);
+        std::vector<uint8_t> payload(encrypted_data.begin() + SecureComm::HEADER_WIRE_SIZE, encrypted_data.end());
+        SecureComm::EncryptedMessage parsed = SecureComm::deserialize_encrypted_message(payload);
+        std::vector<uint8_t> iv(parsed.iv, parsed.iv + SecureComm::IV_SIZE);
+        std::vector<uint8_t> ciphertext(parsed.encrypted_data, parsed.encrypted_data + header.payload_size);
+        sink.fetch_add(parsed.message_id + iv[0] + ciphertext.back(), std::memory_order_relaxed);
+    });
+    double encrypted_view = time_parse(iterations, [&]() {
+        SecureComm::MessageView message(encrypted_data);
+        SecureComm::EncryptedMessageView parsed(message.body());
+        SecureComm::ByteView ciphertext = parsed.ciphertext(message.payload_size());
+        sink.fetch_add(parsed.message_id() + parsed.iv().data()[0] + ciphertext.data()[ciphertext.size() - 1],
+                       std::memory_order_relaxed);
+    });
+    report("encrypted", encrypted_copy, encrypted_view);
+
+    std::cout << "checksum " << sink.load() << std::endl;
+    return 0;
+}
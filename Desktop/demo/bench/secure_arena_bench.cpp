@@ -0,0 +1,137 @@
+#include "common.h"
+#include "../crypto/crypto_utils.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Secure arena benchmark: key-sized allocate/free against the ordinary heap,
+// on one thread and on T threads at once, then arena occupancy with a SessionManager and a KeyManager filled with
+// N sessions and keys, and again after they are released.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsed_ns(Clock::time_point begin) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+}
+
+// Allocates batch blocks, then frees them, repeatedly; ns per allocate+free
+template <typename AllocateFn, typename FreeFn>
+double time_alloc_free(size_t batch, size_t rounds, AllocateFn allocate, FreeFn release) {
+    std::vector<void*> blocks(batch);
+    auto begin = Clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < batch; ++i) {
+            blocks[i] = allocate();
+        }
+        for (size_t i = 0; i < batch; ++i) {
+            release(blocks[i]);
+        }
+    }
+    return elapsed_ns(begin) / static_cast<double>(batch * rounds);
+}
+
+// time_alloc_free on thread_count threads at once; wall ns per allocate+free
+// summed over all threads
+template <typename AllocateFn, typename FreeFn>
+double time_alloc_free_threads(unsigned thread_count, size_t batch, size_t rounds,
+                               AllocateFn allocate, FreeFn release) {
+    std::atomic<bool> start(false);
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < thread_count; ++t) {
+        workers.emplace_back([&]() {
+            while (!start.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            time_alloc_free(batch, rounds, allocate, release);
+        });
+    }
+    auto begin = Clock::now();
+    start.store(true, std::memory_order_release);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return elapsed_ns(begin) / static_cast<double>(batch * rounds * thread_count);
+}
+
+void print_stats(const char* label) {
+    SecureComm::SecureArena::Stats stats = SecureComm::SecureArena::instance().stats();
+    std::cout << label << ": " << stats.slots_in_use << " / " << stats.slots_total << " slots in use, "
+              << stats.slabs << " slabs, " << stats.large_blocks << " large blocks, "
+              << stats.reserved_bytes / 1024 << " KB reserved, " << stats.locked_bytes / 1024
+              << " KB locked, " << stats.lock_failures << " lock failures" << std::endl;
+    for (const SecureComm::SecureArena::ClassStats& size_class : stats.classes) {
+        if (size_class.slabs == 0) {
+            continue;
+        }
+        std::cout << "  " << std::setw(5) << size_class.slot_size << " B: "
+                  << std::setw(8) << size_class.slots_in_use << " in use, "
+                  << std::setw(8) << size_class.peak_slots_in_use << " peak, "
+                  << std::setw(8) << size_class.slots_total << " slots" << std::endl;
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = 100000;
+    unsigned threads = 4;
+    if (argc > 1) count = std::max<size_t>(1, std::stoul(argv[1]));
+    if (argc > 2) threads = std::max(1u, static_cast<unsigned>(std::stoul(argv[2])));
+
+    std::cout << "Secure arena benchmark: " << count << " sessions and keys" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    // Keeps the allocations from being optimized away
+    std::atomic<uintptr_t> sink(0);
+    const size_t batch = 1024;
+    const size_t rounds = std::max<size_t>(1, count / batch);
+    auto heap_allocate = [&]() {
+        void* block = ::operator new(SecureComm::KEY_SIZE);
+        sink.fetch_xor(reinterpret_cast<uintptr_t>(block), std::memory_order_relaxed);
+        return block;
+    };
+    auto heap_release = [](void* block) { ::operator delete(block); };
+    auto arena_allocate = [&]() {
+        void* block = SecureComm::SecureArena::instance().allocate(SecureComm::KEY_SIZE);
+        sink.fetch_xor(reinterpret_cast<uintptr_t>(block), std::memory_order_relaxed);
+        return block;
+    };
+    auto arena_release = [](void* block) {
+        SecureComm::SecureArena::instance().deallocate(block, SecureComm::KEY_SIZE);
+    };
+    double heap_ns = time_alloc_free(batch, rounds, heap_allocate, heap_release);
+    double arena_ns = time_alloc_free(batch, rounds, arena_allocate, arena_release);
+    std::cout << "32-byte allocate+free: heap " << heap_ns << " ns, arena " << arena_ns
+              << " ns (arena zeroizes on free)" << std::endl;
+    heap_ns = time_alloc_free_threads(threads, batch, rounds, heap_allocate, heap_release);
+    arena_ns = time_alloc_free_threads(threads, batch, rounds, arena_allocate, arena_release);
+    std::cout << "32-byte allocate+free on " << threads << " threads: heap " << heap_ns
+              << " ns, arena " << arena_ns << " ns" << std::endl;
+
+    print_stats("idle");
+    {
+        SecureComm::SessionManager sessions;
+        SecureComm::KeyManager keys;
+        SecureComm::CryptoManager crypto;
+        std::vector<uint8_t> key = crypto.generate_random_bytes(SecureComm::KEY_SIZE);
+
+        auto begin = Clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            SecureComm::SessionHandle session = sessions.create_session(static_cast<uint32_t>(i + 1));
+            session->set_current_key(key);
+            keys.store_key("key-" + std::to_string(i), key);
+        }
+        double fill_ms = elapsed_ns(begin) / 1e6;
+        std::cout << "filled in " << fill_ms << " ms" << std::endl;
+        print_stats("loaded");
+    }
+    print_stats("released");
+    return 0;
+}
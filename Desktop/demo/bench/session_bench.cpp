@@ -0,0 +1,116 @@
+#include "common.h"
+#include "../crypto/crypto_utils.h"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <string>
+
+// Multi-threaded contention benchmark for SessionManager.
+// Each operation mirrors the per-message work of the server:
+// verify_session_auth, get_session_key and update_session_activity.
+
+namespace {
+
+struct RunResult {
+    unsigned threads;
+    uint64_t operations;
+    double seconds;
+};
+
+RunResult run_contention(SecureComm::SessionManager& manager,
+                         const std::vector<uint32_t>& session_ids,
+                         unsigned thread_count,
+                         std::chrono::milliseconds duration) {
+    std::atomic<bool> start(false);
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> total_ops(0);
+    // Keeps the key reads from being optimized away
+    std::atomic<uint64_t> checksum_sink(0);
+    std::vector<std::thread> workers;
+    const std::vector<uint8_t> no_signature;
+
+    for (unsigned t = 0; t < thread_count; ++t) {
+        workers.emplace_back([&, t]() {
+            std::mt19937 gen(t + 1);
+            std::uniform_int_distribution<size_t> pick(0, session_ids.size() - 1);
+            uint64_t ops = 0;
+            uint64_t checksum = 0;
+            while (!start.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            while (!stop.load(std::memory_order_relaxed)) {
+                uint32_t session_id = session_ids[pick(gen)];
+                if (manager.verify_session_auth(session_id, no_signature) == SecureComm::AuthResult::SUCCESS) {
+                    SecureComm::SessionKey key = manager.get_session_key(session_id);
+                    checksum += key[0];
+                    manager.update_session_activity(session_id);
+                }
+                ++ops;
+            }
+            total_ops.fetch_add(ops, std::memory_order_relaxed);
+            checksum_sink.fetch_add(checksum, std::memory_order_relaxed);
+        });
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(duration);
+    stop.store(true);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    return RunResult{thread_count, total_ops.load(),
+                     std::chrono::duration<double>(end - begin).count()};
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t session_count = 10000;
+    unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::chrono::milliseconds duration(1000);
+
+    if (argc > 1) session_count = static_cast<size_t>(std::stoul(argv[1]));
+    if (argc > 2) max_threads = static_cast<unsigned>(std::stoul(argv[2]));
+    if (argc > 3) duration = std::chrono::milliseconds(std::stoul(argv[3]));
+
+    SecureComm::SessionManager manager;
+    std::vector<uint32_t> session_ids;
+    session_ids.reserve(session_count);
+    SecureComm::SessionKey key;
+    key.fill(0x42);
+    for (size_t i = 0; i < session_count; ++i) {
+        SecureComm::SessionHandle session = manager.create_session(static_cast<uint32_t>(i));
+        session->set_current_key(key);
+        session->set_authenticated(true);
+        session_ids.push_back(session->session_id());
+    }
+
+    std::cout << "SessionManager contention benchmark" << std::endl;
+    std::cout << "Sessions: " << session_count
+              << ", shards: " << SecureComm::SessionManager::SHARD_COUNT
+              << ", run: " << duration.count() << " ms" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(16) << "ops/s"
+              << std::setw(16) << "ops/s/thread" << std::setw(10) << "scaling" << std::endl;
+
+    double single_thread_rate = 0.0;
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+        RunResult result = run_contention(manager, session_ids, threads, duration);
+        double rate = static_cast<double>(result.operations) / result.seconds;
+        if (threads == 1) {
+            single_thread_rate = rate;
+        }
+        std::cout << std::setw(8) << result.threads
+                  << std::setw(16) << std::fixed << std::setprecision(0) << rate
+                  << std::setw(16) << rate / threads
+                  << std::setw(9) << std::setprecision(2) << rate / single_thread_rate << "x" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include "common.h"
+#include "../crypto/crypto_utils.h"
+#include "../crypto/session_table.h"
+#include <iostream>
+#include <iomanip>
+#include <unordered_map>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <string>
+
+// Insert and lookup benchmark: FlatSessionTable vs. the node-based
+// std::unordered_map it replaced, at 10k, 100k and 1M sessions.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double ns_per_op(Clock::time_point begin, Clock::time_point end, size_t ops) {
+    return std::chrono::duration<double, std::nano>(end - begin).count() / static_cast<double>(ops);
+}
+
+struct Result {
+    double insert_ns;
+    double hit_ns;
+    double miss_ns;
+};
+
+template <typename InsertFn, typename FindFn>
+Result run(const std::vector<SecureComm::SessionHandle>& sessions,
+           const std::vector<uint32_t>& lookups,
+           const std::vector<uint32_t>& misses,
+           InsertFn insert, FindFn find) {
+    Result result;
+    auto begin = Clock::now();
+    for (const auto& session : sessions) {
+        insert(session);
+    }
+    result.insert_ns = ns_per_op(begin, Clock::now(), sessions.size());
+
+    size_t found = 0;
+    begin = Clock::now();
+    for (uint32_t id : lookups) {
+        found += find(id) ? 1 : 0;
+    }
+    result.hit_ns = ns_per_op(begin, Clock::now(), lookups.size());
+
+    begin = Clock::now();
+    for (uint32_t id : misses) {
+        found += find(id) ? 1 : 0;
+    }
+    result.miss_ns = ns_per_op(begin, Clock::now(), misses.size());
+
+    if (found != lookups.size()) {
+        std::cerr << "Unexpected lookup result count: " << found << std::endl;
+    }
+    return result;
+}
+
+void print_row(const std::string& name, size_t count, const Result& r) {
+    std::cout << std::setw(10) << count << std::setw(16) << name
+              << std::fixed << std::setprecision(1)
+              << std::setw(12) << r.insert_ns
+              << std::setw(12) << r.hit_ns
+              << std::setw(12) << r.miss_ns << std::endl;
+}
+
+} // namespace
+
+int main() {
+    const size_t sizes[] = {10000, 100000, 1000000};
+    const size_t lookup_count = 2000000;
+
+    std::cout << "Session table benchmark (ns/op)" << std::endl;
+    std::cout << std::setw(10) << "sessions" << std::setw(16) << "table"
+              << std::setw(12) << "insert" << std::setw(12) << "hit"
+              << std::setw(12) << "miss" << std::endl;
+
+    std::mt19937 gen(42);
+    for (size_t count : sizes) {
+        std::vector<SecureComm::SessionHandle> sessions;
+        sessions.reserve(count);
+        std::unordered_map<uint32_t, bool> used;
+        while (sessions.size() < count) {
+            uint32_t id = SecureComm::generate_session_id();
+            if (used.emplace(id, true).second) {
+                sessions.push_back(std::make_shared<SecureComm::Session>(id, static_cast<uint32_t>(sessions.size())));
+            }
+        }
+
+        std::uniform_int_distribution<size_t> pick(0, count - 1);
+        std::vector<uint32_t> lookups(lookup_count);
+        std::vector<uint32_t> misses(lookup_count);
+        for (size_t i = 0; i < lookup_count; ++i) {
+            lookups[i] = sessions[pick(gen)]->session_id();
+            uint32_t miss;
+            do {
+                miss = SecureComm::generate_session_id();
+            } while (used.count(miss));
+            misses[i] = miss;
+        }
+
+        {
+            SecureComm::FlatSessionTable table;
+            Result r = run(sessions, lookups, misses,
+                [&](const SecureComm::SessionHandle& s) { table.insert(s->session_id(), s); },
+                [&](uint32_t id) { return table.find(id) != nullptr; });
+            print_row("flat", count, r);
+
+            // Erase everything and confirm the table gave its memory back
+            for (const auto& session : sessions) {
+                table.erase(session->session_id());
+            }
+            std::cout << std::setw(26) << "capacity after erase: " << table.capacity() << std::endl;
+        }
+        {
+            std::unordered_map<uint32_t, SecureComm::SessionHandle> table;
+            Result r = run(sessions, lookups, misses,
+                [&](const SecureComm::SessionHandle& s) { table[s->session_id()] = s; },
+                [&](uint32_t id) {
+                    // Return the handle, as SessionManager::find_session does
+                    auto it = table.find(id);
+                    return it == table.end() ? SecureComm::SessionHandle() : it->second;
+                });
+            print_row("unordered_map", count, r);
+        }
+    }
+
+    return 0;
+}
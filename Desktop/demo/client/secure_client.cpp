@@ -0,0 +1,774 @@
+#include "secure_client.h"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #pragma comment(lib, "ws2_32.lib")
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+#endif
+
+#include <cstring>
+
+SecureClient::SecureClient() : SecureClient(SecureComm::KeyPair()) {}
+
+SecureClient::SecureClient(SecureComm::KeyPair identity)
+    : client_socket_(-1), decompressor_(message_buffers_), ticket_pending_(false), message_counter_(0) {
+#ifdef _WIN32
+    // Initialize Winsock
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        throw std::runtime_error("WSAStartup failed");
+    }
+#endif
+
+    crypto_manager_ = std::make_unique<SecureComm::CryptoManager>();
+    session_manager_ = std::make_unique<SecureComm::SessionManager>();
+    key_manager_ = std::make_unique<SecureComm::KeyManager>();
+    current_session_.session_id = 0;
+    current_session_.client_id = 0;
+    current_session_.message_counter = 0;
+    current_session_.authenticated = false;
+    current_session_.key_rotated = false;
+    current_session_.capabilities = SecureComm::baseline_capabilities();
+    offered_capabilities_ = SecureComm::local_capabilities();
+    offered_capabilities_.features &= ~SecureComm::FEATURE_COMPRESSION;
+    profile_ = SecureComm::make_session_profile(current_session_.capabilities);
+
+    if (!identity.private_key.empty()) {
+        client_keypair_ = std::move(identity);
+        return;
+    }
+    // Generate client's RSA key pair
+    client_keypair_ = crypto_manager_->generate_rsa_keypair(2048);
+    std::cout << "Client RSA key pair generated successfully" << std::endl;
+}
+
+SecureClient::~SecureClient() {
+    disconnect();
+    if (!session_key_.empty()) {
+        OPENSSL_cleanse(session_key_.data(), session_key_.size());
+    }
+    discard_ticket();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+bool SecureClient::connect(const std::string& server_ip, uint16_t port) {
+    if (!open_socket(server_ip, port)) {
+        return false;
+    }
+
+    // Perform secure handshake
+    if (!perform_handshake(server_ip, port)) {
+        std::cerr << "Handshake failed" << std::endl;
+        close_socket();
+        return false;
+    }
+
+    std::cout << "Secure connection established" << std::endl;
+    return true;
+}
+
+bool SecureClient::resume(const std::string& server_ip, uint16_t port) {
+    if (!has_session() || !open_socket(server_ip, port)) {
+        return false;
+    }
+
+    if (!perform_resume(false)) {
+        close_socket();
+        return false;
+    }
+
+    std::cout << "Resumed session " << current_session_.session_id << std::endl;
+    return true;
+}
+
+bool SecureClient::resume_with_ticket(const std::string& server_ip, uint16_t port) {
+    // Collects a ticket still in flight on the current connection
+    close_socket();
+    if (!has_ticket() || !open_socket(server_ip, port)) {
+        return false;
+    }
+
+    if (!perform_resume(true)) {
+        close_socket();
+        return false;
+    }
+
+    std::cout << "Resumed session " << current_session_.session_id << " from ticket" << std::endl;
+    return true;
+}
+
+bool SecureClient::resume_with_early_data(const std::string& server_ip, uint16_t port,
+                                          const std::string& message, std::string& response) {
+    close_socket();
+    if (message.size() > SecureComm::MAX_EARLY_DATA_SIZE || !has_ticket() || !open_socket(server_ip, port)) {
+        return false;
+    }
+
+    if (!perform_resume(true, &message, &response)) {
+        close_socket();
+        return false;
+    }
+
+    std::cout << "Resumed session " << current_session_.session_id << " with early data" << std::endl;
+    return true;
+}
+
+bool SecureClient::reconnect(const std::string& server_ip, uint16_t port) {
+    disconnect();
+    // Tickets only open on the node that issued them; other nodes of a
+    // cluster know the session through replication
+    if (resume_with_ticket(server_ip, port) || resume(server_ip, port)) {
+        return true;
+    }
+    std::cout << "Session not resumable, performing full handshake" << std::endl;
+    return connect(server_ip, port);
+}
+
+void SecureClient::disconnect() {
+    close_socket();
+}
+
+bool SecureClient::has_ticket() const {
+    return !session_ticket_.empty() && std::chrono::steady_clock::now() < ticket_expires_at_;
+}
+
+void SecureClient::set_failover_servers(std::vector<std::pair<std::string, uint16_t>> servers) {
+    failover_servers_ = std::move(servers);
+}
+
+bool SecureClient::open_socket(const std::string& server_ip, uint16_t port) {
+    close_socket();
+
+    client_socket_ = static_cast<int>(socket(AF_INET, SOCK_STREAM, 0));
+    if (client_socket_ < 0) {
+        std::cerr << "Failed to create socket" << std::endl;
+        return false;
+    }
+
+    struct sockaddr_in server_addr;
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(port);
+
+    if (inet_pton(AF_INET, server_ip.c_str(), &server_addr.sin_addr) <= 0) {
+        std::cerr << "Invalid server address" << std::endl;
+        close_socket();
+        return false;
+    }
+
+    if (::connect(client_socket_, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+        std::cerr << "Failed to connect to server" << std::endl;
+        close_socket();
+        return false;
+    }
+
+    // Handshake flights are small writes; don't let Nagle hold them back
+    int nodelay = 1;
+    setsockopt(client_socket_, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&nodelay), sizeof(nodelay));
+
+    std::cout << "Connected to server " << server_ip << ":" << port << std::endl;
+    return true;
+}
+
+void SecureClient::close_socket() {
+    if (client_socket_ >= 0) {
+        if (ticket_pending_) {
+            receive_session_ticket();
+        }
+#ifdef _WIN32
+        closesocket(client_socket_);
+#else
+        close(client_socket_);
+#endif
+        client_socket_ = -1;
+    }
+}
+
+bool SecureClient::send_encrypted_message(const std::string& message, std::string* response) {
+    try {
+        std::vector<uint8_t> message_data(message.begin(), message.end());
+        // Compress only what fits the frame even if it does not shrink, so a
+        // message never enters the stream without being sent
+        uint16_t extra_flags = 0;
+        if (profile_.compress && message_data.size() >= SecureComm::COMPRESSION_THRESHOLD &&
+            message_data.size() + SecureComm::COMPRESSION_OVERHEAD + SecureComm::GCM_TAG_SIZE <= profile_.max_frame_size) {
+            message_data = compressor_.compress(message_data);
+            extra_flags = SecureComm::FLAG_COMPRESSED;
+        }
+        // Ciphertext || tag must fit the negotiated frame size
+        if (message_data.size() + SecureComm::GCM_TAG_SIZE > profile_.max_frame_size) {
+            std::cerr << "Message too large" << std::endl;
+            return false;
+        }
+        uint32_t message_id = 0;
+        std::vector<uint8_t> message_key = send_chain_.next_message_key(&message_id);
+        std::vector<uint8_t> iv = crypto_manager_->generate_random_bytes(SecureComm::IV_SIZE);
+
+        // The header is sealed with the message as associated data
+        const SecureComm::MessageHeader header = SecureComm::encrypted_message_header(
+            profile_, message_counter_, extra_flags, message_data.size() + SecureComm::GCM_TAG_SIZE);
+        std::vector<uint8_t> encrypted_data = crypto_manager_->seal_aead(
+            profile_.cipher, message_data, message_key, iv,
+            SecureComm::encrypted_message_aad(header, current_session_.session_id, message_id));
+
+        // Sign the encrypted data unless the server accepts AEAD-only messages
+        std::vector<uint8_t> signature;
+        if (profile_.sign_messages) {
+            signature = crypto_manager_->sign_data(encrypted_data, client_keypair_.private_key);
+        }
+
+        std::vector<uint8_t> request_data = SecureComm::encode_encrypted_message(
+            profile_, header, current_session_.session_id, message_id, iv, encrypted_data, signature);
+
+        if (!send_data(request_data)) {
+            std::cerr << "Failed to send encrypted message" << std::endl;
+            return false;
+        }
+
+        message_counter_++;
+        std::cout << "Sent encrypted message: " << message << std::endl;
+
+        // Receive response
+        std::string reply = receive_encrypted_message();
+        if (!reply.empty()) {
+            std::cout << "Server response: " << reply << std::endl;
+        }
+        if (response) {
+            *response = reply;
+            return !reply.empty();
+        }
+
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to send encrypted message: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool SecureClient::request_key_rotation() {
+    try {
+        SecureComm::MessageHeader header;
+        header.version = SecureComm::ProtocolVersion::V1_0;
+        header.type = SecureComm::MessageType::KEY_ROTATION;
+        header.sequence_number = message_counter_;
+        header.timestamp = SecureComm::get_current_timestamp_seconds();
+        header.payload_size = 0;
+        header.flags = 0;
+
+        std::vector<uint8_t> request_data = SecureComm::serialize_header(header);
+
+        if (!send_data(request_data)) {
+            std::cerr << "Failed to send key rotation request" << std::endl;
+            return false;
+        }
+
+        // Receive key rotation response
+        std::vector<uint8_t> response_data = receive_reply();
+        if (response_data.empty()) {
+            std::cerr << "No response to key rotation request" << std::endl;
+            return false;
+        }
+
+        if (SecureComm::MessageView(response_data).type() == SecureComm::MessageType::KEY_ROTATION) {
+            // Update session key
+            std::vector<uint8_t> id_bytes(sizeof(current_session_.session_id));
+            SecureComm::store_le(id_bytes.data(), current_session_.session_id);
+            session_key_ = SecureComm::to_secure_bytes(crypto_manager_->rotate_session_key(session_key_, id_bytes));
+            reset_ratchets();
+
+            std::cout << "Key rotation completed successfully" << std::endl;
+            return true;
+        } else {
+            std::cerr << "Unexpected response to key rotation request" << std::endl;
+            return false;
+        }
+
+    } catch (const std::exception& e) {
+        std::cerr << "Key rotation failed: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void SecureClient::interactive_mode() {
+    std::cout << "\nInteractive mode - Type 'quit' to exit, 'rotate' to rotate keys" << std::endl;
+    std::string input;
+
+    while (true) {
+        std::cout << "> ";
+        if (!std::getline(std::cin, input)) {
+            break;
+        }
+
+        if (input == "quit" || input == "exit") {
+            break;
+        } else if (input == "rotate") {
+            if (request_key_rotation()) {
+                std::cout << "Key rotation successful" << std::endl;
+            } else {
+                std::cerr << "Key rotation failed" << std::endl;
+            }
+        } else if (!input.empty()) {
+            if (!send_encrypted_message(input)) {
+                std::cerr << "Failed to send message" << std::endl;
+
+                // Move the session to another node instead of giving up
+                bool reconnected = false;
+                for (const auto& server : failover_servers_) {
+                    if (reconnect(server.first, server.second)) {
+                        std::cout << "Failed over to " << server.first << ":" << server.second << std::endl;
+                        reconnected = true;
+                        break;
+                    }
+                }
+                if (!reconnected) {
+                    break;
+                }
+            }
+        }
+    }
+}
+
+bool SecureClient::perform_handshake(const std::string& server_ip, uint16_t port) {
+    try {
+        // Step 1: Generate an ephemeral X25519 key pair for forward secrecy
+        SecureComm::KeyPair ecdh_keypair = crypto_manager_->generate_x25519_keypair();
+
+        // Step 2: Send handshake init
+        uint32_t client_id = SecureComm::generate_client_id();
+        current_session_.client_id = client_id;
+        current_session_.session_id = SecureComm::generate_session_id();
+        current_session_.authenticated = false;
+
+        SecureComm::HandshakeMessage handshake;
+        handshake.client_id = client_id;
+        handshake.session_id = current_session_.session_id;
+        handshake.fs_type = SecureComm::ForwardSecrecyType::ECDH;
+
+        // Copy the ephemeral public key (not the RSA public key)
+        std::copy(ecdh_keypair.public_key.begin(), ecdh_keypair.public_key.end(), handshake.public_key);
+
+        // Generate nonce
+        std::vector<uint8_t> nonce = SecureComm::generate_nonce(SecureComm::IV_SIZE);
+        std::copy(nonce.begin(), nonce.end(), handshake.nonce);
+
+        // The same init, with the cookie appended once the server has sent one
+        auto send_init = [&](const std::vector<uint8_t>& cookie) {
+            SecureComm::MessageHeader header;
+            header.version = SecureComm::ProtocolVersion::V1_0;
+            header.type = SecureComm::MessageType::HANDSHAKE_INIT;
+            header.sequence_number = 0;
+            header.timestamp = SecureComm::get_current_timestamp_seconds();
+            header.payload_size = static_cast<uint16_t>(SecureComm::HANDSHAKE_WIRE_SIZE +
+                                                        SecureComm::CAPABILITIES_WIRE_SIZE + cookie.size());
+            header.flags = SecureComm::FLAG_CAPABILITIES | (cookie.empty() ? 0 : SecureComm::FLAG_COOKIE);
+
+            std::vector<uint8_t> request_data = SecureComm::serialize_header(header);
+            std::vector<uint8_t> handshake_payload = SecureComm::serialize_handshake(handshake);
+            request_data.insert(request_data.end(), handshake_payload.begin(), handshake_payload.end());
+            std::vector<uint8_t> offered = SecureComm::serialize_capabilities(offered_capabilities_);
+            request_data.insert(request_data.end(), offered.begin(), offered.end());
+            request_data.insert(request_data.end(), cookie.begin(), cookie.end());
+            return send_data(request_data);
+        };
+
+        if (!send_init({})) {
+            std::cerr << "Failed to send handshake init" << std::endl;
+            return false;
+        }
+
+        std::cout << "Sent handshake init" << std::endl;
+
+        // Step 3: Receive handshake response
+        std::vector<uint8_t> response_data = receive_data();
+        if (response_data.empty()) {
+            std::cerr << "No handshake response received" << std::endl;
+            return false;
+        }
+
+        // A loaded server answers with a cookie instead and closes the
+        // connection; present it once, on a new connection
+        SecureComm::MessageView first_reply(response_data);
+        if (first_reply.type() == SecureComm::MessageType::HANDSHAKE_COOKIE) {
+            std::vector<uint8_t> cookie(first_reply.body().begin(), first_reply.body().end());
+            std::cout << "Server requires a handshake cookie, retrying" << std::endl;
+            if (cookie.size() != SecureComm::HANDSHAKE_COOKIE_SIZE || !open_socket(server_ip, port) ||
+                !send_init(cookie)) {
+                std::cerr << "Failed to send handshake init with cookie" << std::endl;
+                return false;
+            }
+            response_data = receive_data();
+            if (response_data.empty()) {
+                std::cerr << "No handshake response received" << std::endl;
+                return false;
+            }
+        }
+
+        SecureComm::MessageView response(response_data);
+        if (response.type() != SecureComm::MessageType::HANDSHAKE_RESPONSE) {
+            std::cerr << "Expected HANDSHAKE_RESPONSE, got " << SecureComm::message_type_to_string(response.type()) << std::endl;
+            return false;
+        }
+
+        // Read the server handshake in place
+        SecureComm::HandshakeView server_handshake(response.body());
+
+        std::cout << "Received handshake response from server" << std::endl;
+
+        apply_capabilities(response, server_handshake);
+
+        // The server assigns the ids the session is known by (needed to resume)
+        current_session_.client_id = server_handshake.client_id();
+        current_session_.session_id = server_handshake.session_id();
+
+        // Step 4: Perform key exchange with the ephemeral keys
+        std::vector<uint8_t> shared_secret = crypto_manager_->perform_x25519_key_exchange(
+            ecdh_keypair.private_key, server_handshake.public_key());
+        OPENSSL_cleanse(ecdh_keypair.private_key.data(), ecdh_keypair.private_key.size());
+
+        // Derive session key
+        session_key_ = SecureComm::to_secure_bytes(
+            crypto_manager_->derive_shared_secret(shared_secret, server_handshake.nonce()));
+
+        current_session_.shared_secret = SecureComm::to_secure_bytes(std::move(shared_secret));
+        std::copy(session_key_.begin(), session_key_.end(), current_session_.current_key->begin());
+        reset_ratchets();
+
+        std::cout << "Session key derived successfully" << std::endl;
+
+        // Step 5: Send handshake complete
+        if (!send_handshake_complete()) {
+            return false;
+        }
+        // The server issues the ticket once it has HANDSHAKE_COMPLETE; it is
+        // read with the first reply instead of costing a round trip here
+        ticket_pending_ = true;
+
+        current_session_.authenticated = true;
+        std::cout << "Handshake completed successfully" << std::endl;
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Handshake error: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool SecureClient::perform_resume(bool use_ticket, const std::string* early_data, std::string* early_response) {
+    try {
+        // The binder proves we hold the session key (or the ticket's secret) without sending it
+        const SecureComm::SecureBytes& secret = use_ticket ? resumption_secret_ : session_key_;
+        std::vector<uint8_t> nonce = SecureComm::generate_nonce(SecureComm::IV_SIZE);
+        std::vector<uint8_t> binder = crypto_manager_->resume_binder(secret, current_session_.session_id, nonce);
+        uint16_t flag = use_ticket ? SecureComm::FLAG_TICKET : SecureComm::FLAG_RESUME;
+
+        SecureComm::HandshakeMessage handshake;
+        handshake.client_id = current_session_.client_id;
+        handshake.session_id = current_session_.session_id;
+        handshake.fs_type = SecureComm::ForwardSecrecyType::ECDH;
+        std::copy(binder.begin(), binder.end(), handshake.public_key);
+        std::copy(nonce.begin(), nonce.end(), handshake.nonce);
+
+        std::vector<uint8_t> handshake_payload = SecureComm::serialize_handshake(handshake);
+        std::vector<uint8_t> offered = SecureComm::serialize_capabilities(offered_capabilities_);
+        handshake_payload.insert(handshake_payload.end(), offered.begin(), offered.end());
+        if (use_ticket) {
+            handshake_payload.insert(handshake_payload.end(), session_ticket_.begin(), session_ticket_.end());
+        }
+        if (use_ticket && early_data) {
+            // Early-data frame: IV | message sealed under a key the server can
+            // derive from the ticket alone, bound to the ticket
+            std::vector<uint8_t> early_key = crypto_manager_->derive_early_data_key(resumption_secret_, nonce);
+            std::vector<uint8_t> early_iv = crypto_manager_->generate_random_bytes(SecureComm::IV_SIZE);
+            std::vector<uint8_t> sealed = crypto_manager_->seal_aes_gcm(
+                std::vector<uint8_t>(early_data->begin(), early_data->end()), early_key, early_iv, session_ticket_);
+            OPENSSL_cleanse(early_key.data(), early_key.size());
+            handshake_payload.insert(handshake_payload.end(), early_iv.begin(), early_iv.end());
+            handshake_payload.insert(handshake_payload.end(), sealed.begin(), sealed.end());
+        }
+
+        SecureComm::MessageHeader header;
+        header.version = SecureComm::ProtocolVersion::V1_0;
+        header.type = SecureComm::MessageType::HANDSHAKE_INIT;
+        header.sequence_number = 0;
+        header.timestamp = SecureComm::get_current_timestamp_seconds();
+        header.payload_size = static_cast<uint16_t>(handshake_payload.size());
+        header.flags = flag | SecureComm::FLAG_CAPABILITIES;
+        if (use_ticket && early_data) {
+            header.flags |= SecureComm::FLAG_EARLY_DATA;
+        }
+
+        std::vector<uint8_t> request_data = SecureComm::serialize_header(header);
+        request_data.insert(request_data.end(), handshake_payload.begin(), handshake_payload.end());
+
+        if (!send_data(request_data)) {
+            std::cerr << "Failed to send resume request" << std::endl;
+            return false;
+        }
+
+        std::vector<uint8_t> response_data = receive_data();
+        if (response_data.empty()) {
+            std::cerr << "No resume response received" << std::endl;
+            return false;
+        }
+
+        SecureComm::MessageView response(response_data);
+        if (response.type() != SecureComm::MessageType::HANDSHAKE_RESPONSE ||
+            !(response.flags() & flag)) {
+            std::cerr << "Server declined to resume session " << current_session_.session_id << std::endl;
+            if (use_ticket) {
+                discard_ticket();
+            }
+            return false;
+        }
+
+        SecureComm::HandshakeView server_handshake(response.body());
+        apply_capabilities(response, server_handshake);
+
+        // The server proves it derived the same resumed key
+        std::vector<uint8_t> resumed_key = crypto_manager_->derive_resumed_key(secret, nonce, server_handshake.nonce());
+        if (!SecureComm::constant_time_compare(server_handshake.public_key(),
+                                               crypto_manager_->resume_finished(resumed_key))) {
+            OPENSSL_cleanse(resumed_key.data(), resumed_key.size());
+            std::cerr << "Resume verification failed" << std::endl;
+            return false;
+        }
+
+        // ...and we prove it back; the server adopts the key only then
+        std::vector<uint8_t> finished = crypto_manager_->resume_client_finished(resumed_key);
+
+        // The previous key's buffer is zeroized when the arena takes it back
+        session_key_ = SecureComm::to_secure_bytes(std::move(resumed_key));
+        std::copy(session_key_.begin(), session_key_.end(), current_session_.current_key->begin());
+        reset_ratchets();
+
+        if (!send_handshake_complete(finished)) {
+            return false;
+        }
+        // The server answered the early data right after its response
+        if (early_data && !receive_early_response(*early_response)) {
+            return false;
+        }
+        // Tickets are single use; the server sends a replacement
+        discard_ticket();
+        ticket_pending_ = true;
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Resume error: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool SecureClient::send_handshake_complete(SecureComm::ByteView finished) {
+    SecureComm::MessageHeader complete_header;
+    complete_header.version = SecureComm::ProtocolVersion::V1_0;
+    complete_header.type = SecureComm::MessageType::HANDSHAKE_COMPLETE;
+    complete_header.sequence_number = 1;
+    complete_header.timestamp = SecureComm::get_current_timestamp_seconds();
+    complete_header.payload_size = static_cast<uint16_t>(finished.size());
+    complete_header.flags = 0;
+
+    std::vector<uint8_t> complete_data = SecureComm::serialize_header(complete_header);
+    complete_data.insert(complete_data.end(), finished.begin(), finished.end());
+
+    if (!send_data(complete_data)) {
+        std::cerr << "Failed to send handshake complete" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool SecureClient::receive_early_response(std::string& response) {
+    std::vector<uint8_t> response_data = receive_data();
+    if (response_data.size() < SecureComm::HEADER_WIRE_SIZE + SecureComm::IV_SIZE + SecureComm::GCM_TAG_SIZE) {
+        std::cerr << "No early data response received" << std::endl;
+        return false;
+    }
+
+    SecureComm::MessageView message(response_data);
+    if (message.type() != SecureComm::MessageType::EARLY_DATA) {
+        std::cerr << "Expected EARLY_DATA, got " << SecureComm::message_type_to_string(message.type()) << std::endl;
+        return false;
+    }
+
+    // Body: IV | sealed response
+    SecureComm::ByteView frame = message.body();
+    std::vector<uint8_t> key = crypto_manager_->derive_early_response_key(session_key_);
+    try {
+        std::vector<uint8_t> plaintext = crypto_manager_->open_aes_gcm(
+            frame.subview(SecureComm::IV_SIZE), key, frame.subview(0, SecureComm::IV_SIZE));
+        response.assign(plaintext.begin(), plaintext.end());
+    } catch (const std::exception& e) {
+        OPENSSL_cleanse(key.data(), key.size());
+        std::cerr << "Failed to decrypt early data response: " << e.what() << std::endl;
+        return false;
+    }
+    OPENSSL_cleanse(key.data(), key.size());
+    return true;
+}
+
+bool SecureClient::receive_session_ticket() {
+    return store_session_ticket(receive_data());
+}
+
+bool SecureClient::store_session_ticket(const std::vector<uint8_t>& ticket_data) {
+    ticket_pending_ = false;
+    if (ticket_data.size() < SecureComm::HEADER_WIRE_SIZE + 4 + SecureComm::SessionTicketManager::TICKET_SIZE) {
+        std::cerr << "No session ticket received" << std::endl;
+        return false;
+    }
+
+    SecureComm::MessageView message(ticket_data);
+    if (message.type() != SecureComm::MessageType::SESSION_TICKET) {
+        std::cerr << "Expected SESSION_TICKET, got " << SecureComm::message_type_to_string(message.type()) << std::endl;
+        return false;
+    }
+
+    // Payload: lifetime in seconds (LE) followed by the opaque ticket
+    const uint8_t* payload = ticket_data.data() + SecureComm::HEADER_WIRE_SIZE;
+    uint32_t lifetime = SecureComm::load_le<uint32_t>(payload);
+
+    discard_ticket();
+    session_ticket_.assign(payload + 4, payload + 4 + SecureComm::SessionTicketManager::TICKET_SIZE);
+    resumption_secret_ = SecureComm::to_secure_bytes(crypto_manager_->derive_resumption_secret(session_key_));
+    ticket_expires_at_ = std::chrono::steady_clock::now() + std::chrono::seconds(lifetime);
+    return true;
+}
+
+void SecureClient::discard_ticket() {
+    if (!resumption_secret_.empty()) {
+        OPENSSL_cleanse(resumption_secret_.data(), resumption_secret_.size());
+    }
+    resumption_secret_.clear();
+    session_ticket_.clear();
+}
+
+void SecureClient::apply_capabilities(const SecureComm::MessageView& response,
+                                      const SecureComm::HandshakeView& handshake) {
+    current_session_.capabilities = SecureComm::baseline_capabilities();
+    if (response.flags() & SecureComm::FLAG_CAPABILITIES) {
+        // Intersect again: never use something we did not offer
+        current_session_.capabilities = SecureComm::negotiate_capabilities(
+            offered_capabilities_, SecureComm::deserialize_capabilities(handshake.trailer()));
+    }
+    profile_ = SecureComm::make_session_profile(current_session_.capabilities);
+    compressor_.reset();
+    decompressor_.reset();
+}
+
+void SecureClient::reset_ratchets() {
+    send_chain_.reset(session_key_, SecureComm::RATCHET_LABEL_CLIENT_TO_SERVER);
+    recv_chain_.reset(session_key_, SecureComm::RATCHET_LABEL_SERVER_TO_CLIENT);
+}
+
+std::string SecureClient::receive_encrypted_message() {
+    try {
+        std::vector<uint8_t> encrypted_data = receive_reply();
+        if (encrypted_data.empty()) {
+            return "";
+        }
+
+        SecureComm::MessageView view(encrypted_data);
+
+        if (view.type() == SecureComm::MessageType::ENCRYPTED_MESSAGE) {
+            // Read the encrypted message in place
+            SecureComm::EncryptedMessageView encrypted_msg(view.body(), (view.flags() & SecureComm::FLAG_COMPACT) != 0);
+
+            // Decrypt message
+            if (view.payload_size() > profile_.max_frame_size) {
+                std::cerr << "Invalid encrypted message size" << std::endl;
+                return "";
+            }
+            // The chain only moves once the message has authenticated
+            const uint32_t message_id = encrypted_msg.message_id();
+            SecureComm::ChainKeyRatchet::PendingKey pending = recv_chain_.pending_key_for(message_id);
+            std::vector<uint8_t> decrypted_data = crypto_manager_->open_aead(
+                profile_.cipher, encrypted_msg.ciphertext(view.payload_size()), pending.key(), encrypted_msg.iv(),
+                SecureComm::encrypted_message_aad(view.header(), current_session_.session_id, message_id));
+            recv_chain_.commit(pending);
+
+            if (view.flags() & SecureComm::FLAG_COMPRESSED) {
+                SecureComm::BufferPool::Buffer plaintext;
+                if (!profile_.compress ||
+                    !decompressor_.decompress(decrypted_data, profile_.max_frame_size, plaintext)) {
+                    std::cerr << "Invalid compressed message" << std::endl;
+                    return "";
+                }
+                return std::string(plaintext.data(), plaintext.data() + plaintext.size());
+            }
+
+            std::string message(decrypted_data.begin(), decrypted_data.end());
+            return message;
+
+        } else if (view.type() == SecureComm::MessageType::ERROR_MESSAGE) {
+            SecureComm::ByteView payload = view.body();
+            if (payload.size() >= SecureComm::WireCodec<SecureComm::ErrorCode>::size) {
+                SecureComm::ErrorCode error_code = SecureComm::WireCodec<SecureComm::ErrorCode>::load(payload.data());
+                std::cerr << "Server error: " << SecureComm::error_code_to_string(error_code) << std::endl;
+            }
+            return "";
+
+        } else {
+            std::cerr << "Unexpected message type: " << SecureComm::message_type_to_string(view.type()) << std::endl;
+            return "";
+        }
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error receiving encrypted message: " << e.what() << std::endl;
+        return "";
+    }
+}
+
+std::vector<uint8_t> SecureClient::receive_data() {
+    // One message per call: the header, then the body it announces
+    std::vector<uint8_t> buffer(SecureComm::HEADER_WIRE_SIZE);
+    if (!receive_exact(buffer.data(), buffer.size())) {
+        return std::vector<uint8_t>();
+    }
+
+    size_t body_size = SecureComm::message_body_size(SecureComm::MessageView(buffer).header());
+    buffer.resize(SecureComm::HEADER_WIRE_SIZE + body_size);
+    if (!receive_exact(buffer.data() + SecureComm::HEADER_WIRE_SIZE, body_size)) {
+        return std::vector<uint8_t>();
+    }
+    return buffer;
+}
+
+std::vector<uint8_t> SecureClient::receive_reply() {
+    std::vector<uint8_t> reply = receive_data();
+    if (ticket_pending_ && !reply.empty() &&
+        SecureComm::MessageView(reply).type() == SecureComm::MessageType::SESSION_TICKET) {
+        store_session_ticket(reply);
+        reply = receive_data();
+    }
+    return reply;
+}
+
+bool SecureClient::receive_exact(uint8_t* data, size_t size) {
+    size_t received = 0;
+    while (received < size) {
+        int bytes_received = recv(client_socket_, reinterpret_cast<char*>(data + received),
+                                  static_cast<int>(size - received), 0);
+        if (bytes_received <= 0) {
+            return false;
+        }
+        received += static_cast<size_t>(bytes_received);
+    }
+    return true;
+}
+
+bool SecureClient::send_data(const std::vector<uint8_t>& data) {
+    int bytes_sent = send(client_socket_, reinterpret_cast<const char*>(data.data()), static_cast<int>(data.size()), 0);
+    return bytes_sent == static_cast<int>(data.size());
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "common.h"
+#include "../crypto/crypto_utils.h"
+#include "../crypto/compression.h"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Secure client: full handshake, session and ticket resumption, and
+// encrypted messages.
+// Used by the client executable and by the local cluster harness.
+class SecureClient {
+public:
+    SecureClient();
+    // Uses an existing RSA key pair instead of generating one, so load tests
+    // can open thousands of clients without thousands of key generations
+    explicit SecureClient(SecureComm::KeyPair identity);
+    ~SecureClient();
+
+    // Connect and run a full key-exchange handshake
+    bool connect(const std::string& server_ip, uint16_t port = SecureComm::DEFAULT_PORT);
+    // Reconnect (to any node of the cluster) and resume the current session
+    // without a key exchange; false if the node does not know the session
+    bool resume(const std::string& server_ip, uint16_t port = SecureComm::DEFAULT_PORT);
+    // Resume from the ticket the server issued last; the server needs no
+    // session state, only the ticket key it sealed the ticket under
+    bool resume_with_ticket(const std::string& server_ip, uint16_t port = SecureComm::DEFAULT_PORT);
+    // resume_with_ticket() carrying message as 0-RTT early data in the first
+    // flight; the server's reply arrives one round trip after connecting.
+    // Early data is replay-protected only by the server's single-use ticket
+    // cache, so send requests that are safe to act on before the handshake ends.
+    bool resume_with_early_data(const std::string& server_ip, uint16_t port,
+                                const std::string& message, std::string& response);
+    // resume_with_ticket(), then resume(), falling back to a full handshake
+    bool reconnect(const std::string& server_ip, uint16_t port = SecureComm::DEFAULT_PORT);
+    void disconnect();
+
+    bool has_session() const { return current_session_.authenticated; }
+    bool has_ticket() const;
+    uint32_t session_id() const { return current_session_.session_id; }
+    // What the next handshake offers (default: everything this build supports
+    // except FEATURE_COMPRESSION, which leaks plaintext similarity through
+    // message sizes and is left for callers to opt into)
+    void set_capabilities(const SecureComm::Capabilities& offered) { offered_capabilities_ = offered; }
+    // What the server selected in the last handshake
+    const SecureComm::Capabilities& negotiated_capabilities() const { return current_session_.capabilities; }
+
+    // Other nodes to reconnect to when the current one drops
+    void set_failover_servers(std::vector<std::pair<std::string, uint16_t>> servers);
+
+    // Sends the message and waits for the server's reply (stored in response if given)
+    bool send_encrypted_message(const std::string& message, std::string* response = nullptr);
+    bool request_key_rotation();
+    void interactive_mode();
+
+private:
+    bool open_socket(const std::string& server_ip, uint16_t port);
+    void close_socket();
+    // Reconnects to server_ip:port once if the server answers with a cookie challenge
+    bool perform_handshake(const std::string& server_ip, uint16_t port);
+    bool perform_resume(bool use_ticket, const std::string* early_data = nullptr,
+                        std::string* early_response = nullptr);
+    // On resumption the message carries our finished MAC for the resumed key
+    bool send_handshake_complete(SecureComm::ByteView finished = {});
+    // Adopt the server's selection from a handshake response (baseline if it sent none)
+    void apply_capabilities(const SecureComm::MessageView& response, const SecureComm::HandshakeView& handshake);
+    // Store the ticket the server sends after every handshake
+    bool receive_session_ticket();
+    bool store_session_ticket(const std::vector<uint8_t>& ticket_data);
+    bool receive_early_response(std::string& response);
+    void discard_ticket();
+    void reset_ratchets();
+    std::string receive_encrypted_message();
+    // Reads exactly one message; empty on disconnect
+    std::vector<uint8_t> receive_data();
+    // receive_data(), first storing a pending ticket that arrives ahead of the reply
+    std::vector<uint8_t> receive_reply();
+    bool receive_exact(uint8_t* data, size_t size);
+    bool send_data(const std::vector<uint8_t>& data);
+
+    int client_socket_;
+    std::unique_ptr<SecureComm::CryptoManager> crypto_manager_;
+    std::unique_ptr<SecureComm::SessionManager> session_manager_;
+    std::unique_ptr<SecureComm::KeyManager> key_manager_;
+    SecureComm::KeyPair client_keypair_;
+    SecureComm::SessionInfo current_session_;
+    SecureComm::Capabilities offered_capabilities_;
+    // Resolved from current_session_.capabilities after each handshake
+    SecureComm::SessionProfile profile_;
+    // Compression streams, restarted with every handshake
+    SecureComm::BufferPool message_buffers_;
+    SecureComm::MessageCompressor compressor_;
+    SecureComm::MessageDecompressor decompressor_;
+    SecureComm::SecureBytes session_key_;
+    std::vector<uint8_t> session_ticket_;
+    SecureComm::SecureBytes resumption_secret_;
+    std::chrono::steady_clock::time_point ticket_expires_at_;
+    // Set after HANDSHAKE_COMPLETE until the server's ticket has been read
+    bool ticket_pending_;
+    SecureComm::ChainKeyRatchet send_chain_;
+    SecureComm::ChainKeyRatchet recv_chain_;
+    uint32_t message_counter_;
+    std::vector<std::pair<std::string, uint16_t>> failover_servers_;
+};
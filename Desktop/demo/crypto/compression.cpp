@@ -0,0 +1,176 @@
+#include "compression.h"
+#include <openssl/crypto.h>
+#include <algorithm>
+#include <stdexcept>
+
+namespace SecureComm {
+
+namespace {
+
+// Every Z_SYNC_FLUSH ends with an empty stored block
+constexpr uint8_t SYNC_FLUSH_MARKER[4] = {0x00, 0x00, 0xFF, 0xFF};
+constexpr size_t MIN_OUTPUT_SIZE = 1024;
+
+} // namespace
+
+BufferPool::Buffer::Buffer(Buffer&& other) noexcept
+    : pool_(other.pool_), storage_(std::move(other.storage_)), size_(other.size_) {
+    other.pool_ = nullptr;
+    other.size_ = 0;
+}
+
+BufferPool::Buffer& BufferPool::Buffer::operator=(Buffer&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool_ = other.pool_;
+        storage_ = std::move(other.storage_);
+        size_ = other.size_;
+        other.pool_ = nullptr;
+        other.size_ = 0;
+    }
+    return *this;
+}
+
+BufferPool::Buffer::~Buffer() {
+    release();
+}
+
+void BufferPool::Buffer::release() {
+    // Only the filled prefix can hold data; the rest was wiped on an earlier release
+    OPENSSL_cleanse(storage_.data(), std::min(size_, storage_.size()));
+    if (pool_) {
+        pool_->give_back(std::move(storage_));
+        pool_ = nullptr;
+    }
+    storage_ = std::vector<uint8_t>();
+    size_ = 0;
+}
+
+BufferPool::Buffer BufferPool::acquire() {
+    std::vector<uint8_t> storage;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!idle_.empty()) {
+            storage = std::move(idle_.back());
+            idle_.pop_back();
+        }
+    }
+    return Buffer(this, std::move(storage));
+}
+
+size_t BufferPool::idle_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return idle_.size();
+}
+
+void BufferPool::give_back(std::vector<uint8_t>&& storage) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (idle_.size() < max_idle_) {
+        idle_.push_back(std::move(storage));
+    }
+}
+
+MessageCompressor::MessageCompressor(int level) : stream_(), initialized_(false), level_(level) {}
+
+MessageCompressor::~MessageCompressor() {
+    reset();
+}
+
+void MessageCompressor::reset() {
+    if (initialized_) {
+        deflateEnd(&stream_);
+        initialized_ = false;
+    }
+}
+
+std::vector<uint8_t> MessageCompressor::compress(ByteView data) {
+    // The deflate state (about 256 KB) is only allocated once compression is used
+    if (!initialized_) {
+        stream_ = z_stream();
+        if (deflateInit2(&stream_, level_, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw std::runtime_error("Failed to initialize compression stream");
+        }
+        initialized_ = true;
+    }
+
+    std::vector<uint8_t> out(deflateBound(&stream_, static_cast<uLong>(data.size())) + COMPRESSION_OVERHEAD);
+    stream_.next_in = const_cast<Bytef*>(data.data());
+    stream_.avail_in = static_cast<uInt>(data.size());
+    size_t produced = 0;
+    do {
+        if (produced == out.size()) {
+            out.resize(out.size() * 2);
+        }
+        stream_.next_out = out.data() + produced;
+        stream_.avail_out = static_cast<uInt>(out.size() - produced);
+        if (deflate(&stream_, Z_SYNC_FLUSH) != Z_OK) {
+            throw std::runtime_error("Compression failed");
+        }
+        produced = out.size() - stream_.avail_out;
+    } while (stream_.avail_out == 0);
+
+    if (produced >= sizeof(SYNC_FLUSH_MARKER) &&
+        std::equal(SYNC_FLUSH_MARKER, SYNC_FLUSH_MARKER + sizeof(SYNC_FLUSH_MARKER),
+                   out.begin() + (produced - sizeof(SYNC_FLUSH_MARKER)))) {
+        produced -= sizeof(SYNC_FLUSH_MARKER);
+    }
+    out.resize(produced);
+    return out;
+}
+
+MessageDecompressor::MessageDecompressor(BufferPool& pool) : pool_(pool), stream_(), initialized_(false) {}
+
+MessageDecompressor::~MessageDecompressor() {
+    reset();
+}
+
+void MessageDecompressor::reset() {
+    if (initialized_) {
+        inflateEnd(&stream_);
+        initialized_ = false;
+    }
+}
+
+bool MessageDecompressor::decompress(ByteView data, size_t max_size, BufferPool::Buffer& out) {
+    if (!initialized_) {
+        stream_ = z_stream();
+        if (inflateInit2(&stream_, -MAX_WBITS) != Z_OK) {
+            return false;
+        }
+        initialized_ = true;
+    }
+
+    out = pool_.acquire();
+    std::vector<uint8_t>& storage = out.storage();
+    size_t produced = 0;
+    // The message, then the flush marker the sender left out
+    const ByteView inputs[] = {data, ByteView(SYNC_FLUSH_MARKER, sizeof(SYNC_FLUSH_MARKER))};
+    for (const ByteView& input : inputs) {
+        stream_.next_in = const_cast<Bytef*>(input.data());
+        stream_.avail_in = static_cast<uInt>(input.size());
+        while (true) {
+            if (produced == storage.size()) {
+                if (produced >= max_size) {
+                    out.set_size(produced);
+                    return false;
+                }
+                storage.resize(std::min(max_size, std::max(storage.size() * 2, MIN_OUTPUT_SIZE)));
+            }
+            stream_.next_out = storage.data() + produced;
+            stream_.avail_out = static_cast<uInt>(storage.size() - produced);
+            int rc = inflate(&stream_, Z_SYNC_FLUSH);
+            produced = storage.size() - stream_.avail_out;
+            if (rc != Z_OK && rc != Z_BUF_ERROR) {
+                out.set_size(produced);
+                return false;
+            }
+            if (stream_.avail_in == 0 && stream_.avail_out > 0) {
+                break;
+            }
+        }
+    }
+    out.set_size(produced);
+    return true;
+}
+
+} // namespace SecureComm
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "common.h"
+#include <mutex>
+#include <vector>
+#include <zlib.h>
+
+namespace SecureComm {
+
+// Plaintext shorter than this is sent uncompressed
+constexpr size_t COMPRESSION_THRESHOLD = 64;
+// Most a compressed message can exceed its input by (one stored block and
+// the flush marker); a message is only compressed if it fits the frame
+// even then, so compression never turns a sendable message into one too large
+constexpr size_t COMPRESSION_OVERHEAD = 16;
+
+// Free list of byte buffers that keep their capacity between uses, so a
+// connection decompressing a message per request does not allocate for each.
+// Buffers are wiped when they are returned.
+class BufferPool {
+public:
+    class Buffer {
+    public:
+        Buffer() : pool_(nullptr), size_(0) {}
+        Buffer(Buffer&& other) noexcept;
+        Buffer& operator=(Buffer&& other) noexcept;
+        ~Buffer();
+
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+
+        const uint8_t* data() const { return storage_.data(); }
+        size_t size() const { return size_; }
+        ByteView view() const { return ByteView(storage_.data(), size_); }
+
+        // Scratch space for the producer; size() is set separately
+        std::vector<uint8_t>& storage() { return storage_; }
+        void set_size(size_t size) { size_ = size; }
+
+    private:
+        friend class BufferPool;
+        Buffer(BufferPool* pool, std::vector<uint8_t>&& storage)
+            : pool_(pool), storage_(std::move(storage)), size_(0) {}
+        void release();
+
+        BufferPool* pool_;
+        std::vector<uint8_t> storage_;
+        size_t size_;
+    };
+
+    explicit BufferPool(size_t max_idle = 64) : max_idle_(max_idle) {}
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    Buffer acquire();
+    size_t idle_count() const;
+
+private:
+    void give_back(std::vector<uint8_t>&& storage);
+
+    mutable std::mutex mutex_;
+    std::vector<std::vector<uint8_t>> idle_;
+    const size_t max_idle_;
+};
+
+// Streaming compression for one direction of a connection.
+// Raw deflate; every message ends with a sync flush so it decodes on its
+// own, but the 32 KB window carries over, so keys, phrases and values
+// repeated from earlier messages cost a few bits each even in short
+// messages. The 4-byte marker every sync flush ends with is implied and
+// not sent. The peer's MessageDecompressor must see every compressed
+// message in order; uncompressed messages do not touch the stream.
+class MessageCompressor {
+public:
+    explicit MessageCompressor(int level = Z_DEFAULT_COMPRESSION);
+    ~MessageCompressor();
+
+    MessageCompressor(const MessageCompressor&) = delete;
+    MessageCompressor& operator=(const MessageCompressor&) = delete;
+
+    // Throws std::runtime_error if zlib fails
+    std::vector<uint8_t> compress(ByteView data);
+    // Start a fresh stream (new connection)
+    void reset();
+
+private:
+    z_stream stream_;
+    bool initialized_;
+    int level_;
+};
+
+class MessageDecompressor {
+public:
+    explicit MessageDecompressor(BufferPool& pool);
+    ~MessageDecompressor();
+
+    MessageDecompressor(const MessageDecompressor&) = delete;
+    MessageDecompressor& operator=(const MessageDecompressor&) = delete;
+
+    // Inflates one message into a pooled buffer; false if the input is
+    // corrupt or inflates past max_size, after which the stream is unusable
+    bool decompress(ByteView data, size_t max_size, BufferPool::Buffer& out);
+    void reset();
+
+private:
+    BufferPool& pool_;
+    z_stream stream_;
+    bool initialized_;
+};
+
+} // namespace SecureComm
@@ -1,10 +1,12 @@
 #include "crypto_utils.h"
-#include <iostream>
+#include "logger.h"
 #include <iomanip>
 #include <sstream>
 #include <random>
 #include <algorithm>
 #include <cstring>
+#include <fstream>
+#include <openssl/crypto.h>
 
 namespace SecureComm {
 
@@ -126,7 +128,7 @@ KeyPair CryptoManager::generate_dh_keypair() {
     int priv_len = BN_num_bytes(priv_key);
     
     std::vector<uint8_t> pub_bytes(pub_len);
-    std::vector<uint8_t> priv_bytes(priv_len);
+    SecureBytes priv_bytes(priv_len);
     
     if (BN_bn2bin(pub_key, pub_bytes.data()) != pub_len) {
         DH_free(dh);
@@ -152,7 +154,7 @@ KeyPair CryptoManager::generate_dh_keypair() {
     }
     
     // Store the full private key for key exchange
-    keypair.private_key = priv_bytes;
+    keypair.private_key = std::move(priv_bytes);
     
     keypair.created_at = get_current_timestamp();
     keypair.expires_at = keypair.created_at + std::chrono::hours(1);
@@ -161,12 +163,52 @@ KeyPair CryptoManager::generate_dh_keypair() {
     return keypair;
 }
 
+KeyPair CryptoManager::generate_x25519_keypair() {
+    EVP_PKEY_CTX* pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_X25519, nullptr);
+    if (!pctx) {
+        throw CryptoException("Failed to create X25519 context");
+    }
+
+    EVP_PKEY* pkey = nullptr;
+    if (EVP_PKEY_keygen_init(pctx) != 1 || EVP_PKEY_keygen(pctx, &pkey) != 1) {
+        EVP_PKEY_CTX_free(pctx);
+        throw CryptoException("Failed to generate X25519 key pair");
+    }
+    EVP_PKEY_CTX_free(pctx);
+
+    KeyPair keypair;
+    keypair.public_key.resize(KEY_SIZE);
+    keypair.private_key.resize(KEY_SIZE);
+    size_t pub_len = keypair.public_key.size();
+    size_t priv_len = keypair.private_key.size();
+    if (EVP_PKEY_get_raw_public_key(pkey, keypair.public_key.data(), &pub_len) != 1 ||
+        EVP_PKEY_get_raw_private_key(pkey, keypair.private_key.data(), &priv_len) != 1 ||
+        pub_len != KEY_SIZE || priv_len != KEY_SIZE) {
+        EVP_PKEY_free(pkey);
+        throw CryptoException("Failed to export X25519 key pair");
+    }
+
+    keypair.created_at = get_current_timestamp();
+    keypair.expires_at = keypair.created_at + std::chrono::hours(1);
+
+    EVP_PKEY_free(pkey);
+    return keypair;
+}
+
 std::vector<uint8_t> CryptoManager::generate_symmetric_key(size_t size) {
     return generate_random_bytes(size);
 }
 
+SecureBytes CryptoManager::generate_secure_key(size_t size) {
+    SecureBytes key(size);
+    if (RAND_bytes(key.data(), static_cast<int>(size)) != 1) {
+        throw CryptoException("Failed to generate random bytes");
+    }
+    return key;
+}
+
 std::vector<uint8_t> CryptoManager::encrypt_aes_gcm(const std::vector<uint8_t>& data,
-                                                   const std::vector<uint8_t>& key,
+                                                   ByteView key,
                                                    const std::vector<uint8_t>& iv) {
     EVPContext ctx;
     const EVP_CIPHER* cipher = EVP_aes_256_gcm();
@@ -192,7 +234,7 @@ std::vector<uint8_t> CryptoManager::encrypt_aes_gcm(const std::vector<uint8_t>&
 }
 
 std::vector<uint8_t> CryptoManager::decrypt_aes_gcm(const std::vector<uint8_t>& encrypted_data,
-                                                   const std::vector<uint8_t>& key,
+                                                   ByteView key,
                                                    const std::vector<uint8_t>& iv) {
     EVPContext ctx;
     const EVP_CIPHER* cipher = EVP_aes_256_gcm();
@@ -217,8 +259,106 @@ std::vector<uint8_t> CryptoManager::decrypt_aes_gcm(const std::vector<uint8_t>&
     return decrypted;
 }
 
-std::vector<uint8_t> CryptoManager::perform_dh_key_exchange(const std::vector<uint8_t>& private_key,
-                                                           const std::vector<uint8_t>& peer_public_key) {
+std::vector<uint8_t> CryptoManager::seal_aes_gcm(ByteView data,
+                                                ByteView key,
+                                                ByteView iv,
+                                                ByteView aad) {
+    return seal_aead(EVP_aes_256_gcm(), data, key, iv, aad);
+}
+
+std::vector<uint8_t> CryptoManager::open_aes_gcm(ByteView sealed_data,
+                                                ByteView key,
+                                                ByteView iv,
+                                                ByteView aad) {
+    return open_aead(EVP_aes_256_gcm(), sealed_data, key, iv, aad);
+}
+
+std::vector<uint8_t> CryptoManager::seal_aead(const EVP_CIPHER* cipher,
+                                             ByteView data,
+                                             ByteView key,
+                                             ByteView iv,
+                                             ByteView aad) {
+    if (key.size() != KEY_SIZE || iv.size() != IV_SIZE) {
+        throw CryptoException("Invalid AEAD key or IV size");
+    }
+
+    EVPContext ctx;
+    if (EVP_EncryptInit_ex(ctx.get(), cipher, nullptr, key.data(), iv.data()) != 1) {
+        throw CryptoException("Failed to initialize AEAD encryption");
+    }
+
+    int len = 0;
+    if (!aad.empty() &&
+        EVP_EncryptUpdate(ctx.get(), nullptr, &len, aad.data(), static_cast<int>(aad.size())) != 1) {
+        throw CryptoException("Failed to authenticate associated data");
+    }
+
+    std::vector<uint8_t> sealed(data.size() + GCM_TAG_SIZE);
+    if (EVP_EncryptUpdate(ctx.get(), sealed.data(), &len, data.data(), static_cast<int>(data.size())) != 1) {
+        throw CryptoException("Failed to encrypt data");
+    }
+
+    int final_len = 0;
+    if (EVP_EncryptFinal_ex(ctx.get(), sealed.data() + len, &final_len) != 1) {
+        throw CryptoException("Failed to finalize encryption");
+    }
+
+    size_t ciphertext_len = static_cast<size_t>(len + final_len);
+    if (EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_AEAD_GET_TAG, static_cast<int>(GCM_TAG_SIZE),
+                            sealed.data() + ciphertext_len) != 1) {
+        throw CryptoException("Failed to get AEAD tag");
+    }
+
+    sealed.resize(ciphertext_len + GCM_TAG_SIZE);
+    return sealed;
+}
+
+std::vector<uint8_t> CryptoManager::open_aead(const EVP_CIPHER* cipher,
+                                             ByteView sealed_data,
+                                             ByteView key,
+                                             ByteView iv,
+                                             ByteView aad) {
+    if (key.size() != KEY_SIZE || iv.size() != IV_SIZE) {
+        throw CryptoException("Invalid AEAD key or IV size");
+    }
+    if (sealed_data.size() < GCM_TAG_SIZE) {
+        throw CryptoException("Sealed data too short");
+    }
+
+    EVPContext ctx;
+    if (EVP_DecryptInit_ex(ctx.get(), cipher, nullptr, key.data(), iv.data()) != 1) {
+        throw CryptoException("Failed to initialize AEAD decryption");
+    }
+
+    int len = 0;
+    if (!aad.empty() &&
+        EVP_DecryptUpdate(ctx.get(), nullptr, &len, aad.data(), static_cast<int>(aad.size())) != 1) {
+        throw CryptoException("Failed to authenticate associated data");
+    }
+
+    size_t ciphertext_len = sealed_data.size() - GCM_TAG_SIZE;
+    std::vector<uint8_t> decrypted(ciphertext_len);
+    if (EVP_DecryptUpdate(ctx.get(), decrypted.data(), &len, sealed_data.data(),
+                          static_cast<int>(ciphertext_len)) != 1) {
+        throw CryptoException("Failed to decrypt data");
+    }
+
+    std::vector<uint8_t> tag(sealed_data.end() - GCM_TAG_SIZE, sealed_data.end());
+    if (EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_AEAD_SET_TAG, static_cast<int>(GCM_TAG_SIZE), tag.data()) != 1) {
+        throw CryptoException("Failed to set AEAD tag");
+    }
+
+    int final_len = 0;
+    if (EVP_DecryptFinal_ex(ctx.get(), decrypted.data() + len, &final_len) != 1) {
+        throw CryptoException("AEAD authentication failed");
+    }
+
+    decrypted.resize(len + final_len);
+    return decrypted;
+}
+
+std::vector<uint8_t> CryptoManager::perform_dh_key_exchange(ByteView private_key,
+                                                           ByteView peer_public_key) {
     // Create DH structure with predefined parameters
     DH* dh = DH_get_2048_256();
     if (!dh) {
@@ -271,8 +411,36 @@ std::vector<uint8_t> CryptoManager::perform_dh_key_exchange(const std::vector<ui
     return secret;
 }
 
-std::vector<uint8_t> CryptoManager::derive_shared_secret(const std::vector<uint8_t>& dh_result,
-                                                        const std::vector<uint8_t>& salt) {
+std::vector<uint8_t> CryptoManager::perform_x25519_key_exchange(ByteView private_key,
+                                                               ByteView peer_public_key) {
+    if (private_key.size() != KEY_SIZE || peer_public_key.size() != KEY_SIZE) {
+        throw CryptoException("Invalid X25519 key size");
+    }
+
+    EVP_PKEY* pkey = EVP_PKEY_new_raw_private_key(EVP_PKEY_X25519, nullptr, private_key.data(), private_key.size());
+    EVP_PKEY* peer = EVP_PKEY_new_raw_public_key(EVP_PKEY_X25519, nullptr, peer_public_key.data(), peer_public_key.size());
+    EVP_PKEY_CTX* ctx = pkey ? EVP_PKEY_CTX_new(pkey, nullptr) : nullptr;
+
+    std::vector<uint8_t> secret(KEY_SIZE);
+    size_t secret_len = secret.size();
+    bool ok = ctx && peer &&
+              EVP_PKEY_derive_init(ctx) == 1 &&
+              EVP_PKEY_derive_set_peer(ctx, peer) == 1 &&
+              EVP_PKEY_derive(ctx, secret.data(), &secret_len) == 1;
+
+    EVP_PKEY_CTX_free(ctx);
+    EVP_PKEY_free(peer);
+    EVP_PKEY_free(pkey);
+
+    if (!ok) {
+        throw CryptoException("Failed to compute X25519 shared secret");
+    }
+    secret.resize(secret_len);
+    return secret;
+}
+
+std::vector<uint8_t> CryptoManager::derive_shared_secret(ByteView dh_result,
+                                                        ByteView salt) {
     return derive_key(dh_result, salt, KEY_SIZE);
 }
 
@@ -297,7 +465,7 @@ std::vector<uint8_t> CryptoManager::sha256_hash(const std::vector<uint8_t>& data
 }
 
 std::vector<uint8_t> CryptoManager::hmac_sha256(const std::vector<uint8_t>& data,
-                                               const std::vector<uint8_t>& key) {
+                                               ByteView key) {
     unsigned int hmac_len = EVP_MD_size(EVP_sha256());
     std::vector<uint8_t> hmac(hmac_len);
 
@@ -310,7 +478,7 @@ std::vector<uint8_t> CryptoManager::hmac_sha256(const std::vector<uint8_t>& data
 }
 
 std::vector<uint8_t> CryptoManager::sign_data(const std::vector<uint8_t>& data,
-                                             const std::vector<uint8_t>& private_key) {
+                                             ByteView private_key) {
     EVP_PKEY* pkey = bytes_to_rsa_private_key(private_key);
     EVPMDContext ctx;
 
@@ -369,8 +537,8 @@ uint32_t CryptoManager::generate_random_uint32() {
     return value;
 }
 
-std::vector<uint8_t> CryptoManager::derive_key(const std::vector<uint8_t>& master_key,
-                                              const std::vector<uint8_t>& salt,
+std::vector<uint8_t> CryptoManager::derive_key(ByteView master_key,
+                                              ByteView salt,
                                               size_t key_size) {
     std::vector<uint8_t> derived_key(key_size);
     
@@ -383,15 +551,66 @@ std::vector<uint8_t> CryptoManager::derive_key(const std::vector<uint8_t>& maste
     return derived_key;
 }
 
-std::vector<uint8_t> CryptoManager::rotate_session_key(const std::vector<uint8_t>& current_key,
+std::vector<uint8_t> CryptoManager::rotate_session_key(ByteView current_key,
                                                       const std::vector<uint8_t>& session_id) {
     std::vector<uint8_t> salt = sha256_hash(session_id);
     return derive_key(current_key, salt, KEY_SIZE);
 }
 
+std::vector<uint8_t> CryptoManager::resume_binder(ByteView session_key,
+                                                 uint32_t session_id,
+                                                 ByteView client_nonce) {
+    std::string label = "SecureComm resume binder";
+    std::vector<uint8_t> data(label.begin(), label.end());
+    for (int i = 0; i < 4; ++i) {
+        data.push_back(static_cast<uint8_t>(session_id >> (8 * i)));
+    }
+    data.insert(data.end(), client_nonce.begin(), client_nonce.end());
+    return hmac_sha256(data, session_key);
+}
+
+std::vector<uint8_t> CryptoManager::derive_resumed_key(ByteView session_key,
+                                                      ByteView client_nonce,
+                                                      ByteView server_nonce) {
+    std::string label = "SecureComm resume key";
+    std::vector<uint8_t> data(label.begin(), label.end());
+    data.insert(data.end(), client_nonce.begin(), client_nonce.end());
+    data.insert(data.end(), server_nonce.begin(), server_nonce.end());
+    return hmac_sha256(data, session_key);
+}
+
+std::vector<uint8_t> CryptoManager::resume_finished(ByteView resumed_key) {
+    std::string label = "SecureComm resume finished";
+    return hmac_sha256(std::vector<uint8_t>(label.begin(), label.end()), resumed_key);
+}
+
+std::vector<uint8_t> CryptoManager::resume_client_finished(ByteView resumed_key) {
+    std::string label = "SecureComm resume client finished";
+    return hmac_sha256(std::vector<uint8_t>(label.begin(), label.end()), resumed_key);
+}
+
+std::vector<uint8_t> CryptoManager::derive_resumption_secret(ByteView session_key) {
+    std::string label = "SecureComm resumption secret";
+    return hmac_sha256(std::vector<uint8_t>(label.begin(), label.end()), session_key);
+}
+
+std::vector<uint8_t> CryptoManager::derive_early_data_key(ByteView resumption_secret,
+                                                         ByteView client_nonce) {
+    std::string label = "SecureComm early data";
+    std::vector<uint8_t> data(label.begin(), label.end());
+    data.insert(data.end(), client_nonce.begin(), client_nonce.end());
+    return hmac_sha256(data, resumption_secret);
+}
+
+std::vector<uint8_t> CryptoManager::derive_early_response_key(ByteView resumed_key) {
+    std::string label = "SecureComm early response";
+    return hmac_sha256(std::vector<uint8_t>(label.begin(), label.end()), resumed_key);
+}
+
 // Private helper methods
-std::vector<uint8_t> CryptoManager::rsa_private_key_to_bytes(EVP_PKEY* pkey) {
-    BIO* bio = BIO_new(BIO_s_mem());
+SecureBytes CryptoManager::rsa_private_key_to_bytes(EVP_PKEY* pkey) {
+    // Secure memory BIO: the PEM buffer is wiped when the BIO is freed
+    BIO* bio = BIO_new(BIO_s_secmem());
     if (!bio) {
         throw CryptoException("Failed to create BIO for private key");
     }
@@ -403,7 +622,7 @@ std::vector<uint8_t> CryptoManager::rsa_private_key_to_bytes(EVP_PKEY* pkey) {
 
     BUF_MEM* bptr;
     BIO_get_mem_ptr(bio, &bptr);
-    std::vector<uint8_t> key_data(bptr->data, bptr->data + bptr->length);
+    SecureBytes key_data(bptr->data, bptr->data + bptr->length);
     BIO_free(bio);
 
     return key_data;
@@ -428,7 +647,7 @@ std::vector<uint8_t> CryptoManager::rsa_public_key_to_bytes(EVP_PKEY* pkey) {
     return key_data;
 }
 
-EVP_PKEY* CryptoManager::bytes_to_rsa_private_key(const std::vector<uint8_t>& data) {
+EVP_PKEY* CryptoManager::bytes_to_rsa_private_key(ByteView data) {
     BIO* bio = BIO_new_mem_buf(data.data(), data.size());
     if (!bio) {
         throw CryptoException("Failed to create BIO from private key data");
@@ -460,44 +679,253 @@ EVP_PKEY* CryptoManager::bytes_to_rsa_public_key(const std::vector<uint8_t>& dat
     return pkey;
 }
 
+// ChainKeyRatchet implementation
+namespace {
+constexpr uint8_t RATCHET_MESSAGE_KEY_CONSTANT = 0x01;
+constexpr uint8_t RATCHET_CHAIN_KEY_CONSTANT = 0x02;
+}
+
+ChainKeyRatchet::ChainKeyRatchet() : chain_key_{}, counter_(0), initialized_(false) {}
+
+ChainKeyRatchet::ChainKeyRatchet(ByteView root_key, const std::string& label)
+    : chain_key_{}, counter_(0), initialized_(false) {
+    reset(root_key, label);
+}
+
+ChainKeyRatchet::~ChainKeyRatchet() {
+    wipe();
+}
+
+void ChainKeyRatchet::reset(ByteView root_key, const std::string& label) {
+    if (root_key.empty()) {
+        throw CryptoException("Ratchet root key is empty");
+    }
+    wipe();
+
+    unsigned int len = static_cast<unsigned int>(chain_key_->size());
+    if (HMAC(EVP_sha256(), root_key.data(), static_cast<int>(root_key.size()),
+             reinterpret_cast<const unsigned char*>(label.data()), label.size(),
+             chain_key_->data(), &len) == nullptr) {
+        throw CryptoException("Failed to derive ratchet chain key");
+    }
+    counter_ = 0;
+    initialized_ = true;
+}
+
+void ChainKeyRatchet::step(const ChainKey& chain_key, ChainKey& message_key, ChainKey& next_chain_key) {
+    unsigned int len = static_cast<unsigned int>(message_key.size());
+    if (HMAC(EVP_sha256(), chain_key.data(), static_cast<int>(chain_key.size()),
+             &RATCHET_MESSAGE_KEY_CONSTANT, 1, message_key.data(), &len) == nullptr) {
+        throw CryptoException("Failed to derive ratchet message key");
+    }
+
+    len = static_cast<unsigned int>(next_chain_key.size());
+    if (HMAC(EVP_sha256(), chain_key.data(), static_cast<int>(chain_key.size()),
+             &RATCHET_CHAIN_KEY_CONSTANT, 1, next_chain_key.data(), &len) == nullptr) {
+        throw CryptoException("Failed to advance ratchet chain key");
+    }
+}
+
+std::vector<uint8_t> ChainKeyRatchet::next_message_key(uint32_t* counter) {
+    if (!initialized_) {
+        throw CryptoException("Ratchet not initialized");
+    }
+
+    ChainKey message_key;
+    ChainKey next_chain_key;
+    step(*chain_key_, message_key, next_chain_key);
+    chain_key_ = next_chain_key;
+    OPENSSL_cleanse(next_chain_key.data(), next_chain_key.size());
+    if (counter) {
+        *counter = counter_;
+    }
+    counter_++;
+
+    std::vector<uint8_t> key(message_key.begin(), message_key.end());
+    OPENSSL_cleanse(message_key.data(), message_key.size());
+    return key;
+}
+
+ChainKeyRatchet::PendingKey ChainKeyRatchet::pending_key_for(uint32_t counter) const {
+    if (!initialized_) {
+        throw CryptoException("Ratchet not initialized");
+    }
+
+    PendingKey pending;
+    pending.counter_ = counter;
+    pending.base_counter_ = counter_;
+
+    // Late message: only valid if its key was cached when it was skipped
+    if (counter < counter_) {
+        auto it = skipped_keys_.find(counter);
+        if (it == skipped_keys_.end()) {
+            throw CryptoException("Message key already used or expired: " + std::to_string(counter));
+        }
+        pending.message_key_ = it->second;
+        pending.from_skipped_ = true;
+        return pending;
+    }
+
+    if (counter - counter_ > MAX_SKIP) {
+        throw CryptoException("Message counter too far ahead: " + std::to_string(counter));
+    }
+
+    // Early message: walk a copy of the chain, keeping the keys of the
+    // messages we jump over; only the newest MAX_SKIPPED_KEYS can survive
+    // eviction on commit
+    ChainKey chain_key = *chain_key_;
+    ChainKey next_chain_key;
+    pending.skipped_keys_.reserve(std::min<size_t>(counter - counter_, MAX_SKIPPED_KEYS));
+    for (uint32_t current = counter_;; ++current) {
+        step(chain_key, *pending.message_key_, next_chain_key);
+        chain_key = next_chain_key;
+        if (current == counter) {
+            break;
+        }
+        if (counter - current <= MAX_SKIPPED_KEYS) {
+            pending.skipped_keys_.emplace_back(current, *pending.message_key_);
+        }
+    }
+    pending.chain_key_ = chain_key;
+    OPENSSL_cleanse(chain_key.data(), chain_key.size());
+    OPENSSL_cleanse(next_chain_key.data(), next_chain_key.size());
+    return pending;
+}
+
+void ChainKeyRatchet::commit(const PendingKey& pending) {
+    if (pending.from_skipped_) {
+        auto it = skipped_keys_.find(pending.counter_);
+        if (it == skipped_keys_.end()) {
+            throw CryptoException("Message key already used or expired: " + std::to_string(pending.counter_));
+        }
+        OPENSSL_cleanse(it->second.data(), it->second.size());
+        skipped_keys_.erase(it);
+        return;
+    }
+
+    if (!initialized_ || pending.base_counter_ != counter_) {
+        throw CryptoException("Ratchet advanced since the message key was derived");
+    }
+    for (const auto& skipped : pending.skipped_keys_) {
+        if (skipped_keys_.size() >= MAX_SKIPPED_KEYS) {
+            auto oldest = skipped_keys_.begin();
+            OPENSSL_cleanse(oldest->second.data(), oldest->second.size());
+            skipped_keys_.erase(oldest);
+        }
+        skipped_keys_[skipped.first] = skipped.second;
+    }
+    chain_key_ = *pending.chain_key_;
+    counter_ = pending.counter_ + 1;
+}
+
+void ChainKeyRatchet::wipe() {
+    OPENSSL_cleanse(chain_key_->data(), chain_key_->size());
+    for (auto& pair : skipped_keys_) {
+        OPENSSL_cleanse(pair.second.data(), pair.second.size());
+    }
+    skipped_keys_.clear();
+    counter_ = 0;
+    initialized_ = false;
+}
+
 // KeyManager implementation
-KeyManager::KeyManager() = default;
-KeyManager::~KeyManager() = default;
+KeyManager::KeyManager() : timer_wheel_(nullptr), restore_pending_(false) {}
+
+KeyManager::~KeyManager() {
+    if (timer_wheel_) {
+        for (const auto& pair : key_expiry_timers_) {
+            timer_wheel_->cancel(pair.second);
+        }
+    }
+}
 
-void KeyManager::store_key(const std::string& key_id, const std::vector<uint8_t>& key) {
+void KeyManager::set_timer_wheel(TimerWheel* wheel) {
     std::lock_guard<std::mutex> lock(keys_mutex_);
-    keys_[key_id] = key;
+    timer_wheel_ = wheel;
 }
 
-std::vector<uint8_t> KeyManager::get_key(const std::string& key_id) {
+void KeyManager::store_key(const std::string& key_id, ByteView key) {
     std::lock_guard<std::mutex> lock(keys_mutex_);
-    auto it = keys_.find(key_id);
-    if (it == keys_.end()) {
-        throw CryptoException("Key not found: " + key_id);
+    keys_.insert_or_assign(key_id, key.data(), key.size());
+    pending_keys_.erase(key_id);
+}
+
+std::vector<uint8_t> KeyManager::get_key(std::string_view key_id) {
+    KeyView view = find_key(key_id);
+    if (!view) {
+        throw CryptoException("Key not found: " + std::string(key_id));
+    }
+    return std::vector<uint8_t>(view.data(), view.data() + view.size());
+}
+
+KeyManager::KeyView KeyManager::borrow_key(std::string_view key_id) {
+    return find_key(key_id);
+}
+
+KeyManager::KeyView KeyManager::find_key(std::string_view key_id) {
+    {
+        ConcurrentKeyTable::ReadGuard guard = keys_.read();
+        const KeyNode* node = keys_.find(key_id);
+        if (node || !restore_pending_.load(std::memory_order_acquire)) {
+            return KeyView(std::move(guard), node);
+        }
+    }
+    // The guard is released first: loading a chunk writes to the table
+    {
+        std::lock_guard<std::mutex> lock(keys_mutex_);
+        load_pending_locked(std::string(key_id));
     }
-    return it->second;
+    ConcurrentKeyTable::ReadGuard guard = keys_.read();
+    const KeyNode* node = keys_.find(key_id);
+    return KeyView(std::move(guard), node);
 }
 
 void KeyManager::remove_key(const std::string& key_id) {
     std::lock_guard<std::mutex> lock(keys_mutex_);
     keys_.erase(key_id);
+    pending_keys_.erase(key_id);
     key_expirations_.erase(key_id);
+    auto timer = key_expiry_timers_.find(key_id);
+    if (timer != key_expiry_timers_.end()) {
+        if (timer_wheel_) {
+            timer_wheel_->cancel(timer->second);
+        }
+        key_expiry_timers_.erase(timer);
+    }
 }
 
-bool KeyManager::key_exists(const std::string& key_id) {
+bool KeyManager::key_exists(std::string_view key_id) {
+    {
+        ConcurrentKeyTable::ReadGuard guard = keys_.read();
+        if (keys_.find(key_id)) {
+            return true;
+        }
+    }
+    if (!restore_pending_.load(std::memory_order_acquire)) {
+        return false;
+    }
     std::lock_guard<std::mutex> lock(keys_mutex_);
-    return keys_.find(key_id) != keys_.end();
+    return pending_keys_.find(std::string(key_id)) != pending_keys_.end();
 }
 
 void KeyManager::rotate_key(const std::string& key_id) {
     std::lock_guard<std::mutex> lock(keys_mutex_);
-    auto it = keys_.find(key_id);
-    if (it != keys_.end()) {
-        // Generate new key based on current key
-        CryptoManager crypto;
-        std::vector<uint8_t> salt = crypto.generate_random_bytes(32);
-        it->second = crypto.derive_key(it->second, salt, KEY_SIZE);
+    load_pending_locked(key_id);
+    SecureBytes current;
+    {
+        ConcurrentKeyTable::ReadGuard guard = keys_.read();
+        const KeyNode* node = keys_.find(key_id);
+        if (!node) {
+            return;
+        }
+        current.assign(node->key(), node->key() + node->key_size);
     }
+    // Generate new key based on current key
+    CryptoManager crypto;
+    std::vector<uint8_t> salt = crypto.generate_random_bytes(32);
+    std::vector<uint8_t> rotated = crypto.derive_key(current, salt, KEY_SIZE);
+    keys_.insert_or_assign(key_id, rotated.data(), rotated.size());
+    OPENSSL_cleanse(rotated.data(), rotated.size());
 }
 
 std::vector<uint8_t> KeyManager::generate_new_key(const std::string& key_id) {
@@ -511,6 +939,26 @@ void KeyManager::set_key_expiration(const std::string& key_id,
                                    std::chrono::system_clock::time_point expires_at) {
     std::lock_guard<std::mutex> lock(keys_mutex_);
     key_expirations_[key_id] = expires_at;
+    schedule_expiry_locked(key_id, expires_at);
+}
+
+void KeyManager::schedule_expiry_locked(const std::string& key_id,
+                                        std::chrono::system_clock::time_point expires_at) {
+    if (!timer_wheel_) {
+        return;
+    }
+    auto previous = key_expiry_timers_.find(key_id);
+    if (previous != key_expiry_timers_.end()) {
+        timer_wheel_->cancel(previous->second);
+    }
+    auto deadline = TimerWheel::Clock::now() +
+        std::chrono::duration_cast<TimerWheel::Clock::duration>(expires_at - std::chrono::system_clock::now());
+    key_expiry_timers_[key_id] = timer_wheel_->schedule_at(deadline, [this, key_id]() {
+        // The expiration may have been extended since this was scheduled
+        if (is_key_expired(key_id)) {
+            remove_key(key_id);
+        }
+    });
 }
 
 bool KeyManager::is_key_expired(const std::string& key_id) {
@@ -522,136 +970,617 @@ bool KeyManager::is_key_expired(const std::string& key_id) {
     return std::chrono::system_clock::now() > it->second;
 }
 
-void KeyManager::backup_keys(const std::string& backup_path) {
-    // Implementation for key backup
-    // This would typically encrypt and store keys to a secure location
+size_t KeyManager::backup_keys(const std::string& backup_path) {
+    return backup_keys(backup_path, PersistentSessionStore::load_or_create_key(backup_path + ".key"));
 }
 
-void KeyManager::restore_keys(const std::string& backup_path) {
-    // Implementation for key restoration
-    // This would typically decrypt and load keys from a secure location
+size_t KeyManager::restore_keys(const std::string& backup_path) {
+    std::string key_path = backup_path + ".key";
+    if (!std::ifstream(key_path, std::ios::binary)) {
+        throw CryptoException("Key backup key not found: " + key_path);
+    }
+    return restore_keys(backup_path, PersistentSessionStore::load_or_create_key(key_path));
 }
 
-// SessionManager implementation
-SessionManager::SessionManager() = default;
-SessionManager::~SessionManager() = default;
+size_t KeyManager::backup_keys(const std::string& backup_path, ByteView backup_key) {
+    KeySnapshotWriter writer;
+    {
+        std::lock_guard<std::mutex> lock(keys_mutex_);
+        // Keys still waiting in a restored snapshot belong in the new one too
+        load_all_pending_locked();
+        writer.reserve(keys_.size());
+        keys_.for_each([&writer](const KeyNode& node) {
+            writer.add(node.key_id(), node.key(), node.key_size);
+        });
+        ConcurrentKeyTable::ReadGuard guard = keys_.read();
+        for (const auto& pair : key_expirations_) {
+            if (keys_.find(pair.first)) {
+                writer.add_expiration(pair.first, static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::milliseconds>(pair.second.time_since_epoch()).count()));
+            }
+        }
+    }
+    // Sealing and disk I/O work on the copy, so lookups are not blocked meanwhile
+    writer.write(backup_path, backup_key);
+    return writer.entry_count();
+}
 
-SessionInfo SessionManager::create_session(uint32_t client_id) {
-    SessionInfo session;
-    session.session_id = generate_session_id();
-    session.client_id = client_id;
-    session.created_at = get_current_timestamp();
-    session.last_activity = session.created_at;
-    session.message_counter = 0;
-    session.authenticated = false;
-    session.key_rotated = false;
-
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
-    sessions_[session.session_id] = session;
-    return session;
+size_t KeyManager::restore_keys(const std::string& backup_path, ByteView backup_key) {
+    // Map the file and open the index before taking the lock
+    auto reader = std::make_unique<KeySnapshotReader>(backup_path, backup_key);
+
+    std::lock_guard<std::mutex> lock(keys_mutex_);
+    // Finish any earlier restore so every pending key below is from this one
+    load_all_pending_locked();
+    {
+        ConcurrentKeyTable::ReadGuard guard = keys_.read();
+        for (const KeySnapshotReader::IndexEntry& entry : reader->index()) {
+            // A key stored since the snapshot was taken is newer; keep it
+            if (!keys_.find(entry.key_id)) {
+                pending_keys_.emplace(entry.key_id, entry.chunk);
+            }
+        }
+    }
+
+    auto now = std::chrono::system_clock::now();
+    for (const KeySnapshotReader::Expiration& expiration : reader->expirations()) {
+        auto pending = pending_keys_.find(expiration.key_id);
+        if (pending == pending_keys_.end()) {
+            continue;
+        }
+        std::chrono::system_clock::time_point expires_at(
+            std::chrono::milliseconds(static_cast<int64_t>(expiration.expires_at_ms)));
+        if (expires_at <= now) {
+            pending_keys_.erase(pending);
+            continue;
+        }
+        key_expirations_[expiration.key_id] = expires_at;
+        schedule_expiry_locked(expiration.key_id, expires_at);
+    }
+
+    size_t restored = pending_keys_.size();
+    if (restored > 0) {
+        snapshot_ = std::move(reader);
+        restore_pending_.store(true, std::memory_order_release);
+    }
+    return restored;
 }
 
-SessionInfo SessionManager::get_session(uint32_t session_id) {
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
-    auto it = sessions_.find(session_id);
-    if (it == sessions_.end()) {
-        throw CryptoException("Session not found: " + std::to_string(session_id));
+bool KeyManager::load_pending_locked(const std::string& key_id) {
+    auto pending = pending_keys_.find(key_id);
+    if (pending == pending_keys_.end()) {
+        return false;
     }
-    return it->second;
+    load_chunk_locked(pending->second);
+    return true;
 }
 
-void SessionManager::update_session_activity(uint32_t session_id) {
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
-    auto it = sessions_.find(session_id);
-    if (it != sessions_.end()) {
-        it->second.last_activity = get_current_timestamp();
-        it->second.message_counter++;
+void KeyManager::load_all_pending_locked() {
+    if (!snapshot_) {
+        return;
+    }
+    std::vector<bool> needed(snapshot_->chunk_count(), false);
+    for (const auto& pair : pending_keys_) {
+        needed[pair.second] = true;
+    }
+    for (uint32_t chunk = 0; chunk < needed.size() && snapshot_; ++chunk) {
+        if (needed[chunk]) {
+            load_chunk_locked(chunk);
+        }
     }
 }
 
-void SessionManager::remove_session(uint32_t session_id) {
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
-    sessions_.erase(session_id);
+void KeyManager::load_chunk_locked(uint32_t chunk) {
+    std::vector<KeySnapshotReader::Entry> entries = snapshot_->load_chunk(chunk);
+    for (KeySnapshotReader::Entry& entry : entries) {
+        // Keys stored or removed since the restore are no longer pending
+        auto pending = pending_keys_.find(entry.key_id);
+        if (pending != pending_keys_.end() && pending->second == chunk) {
+            keys_.insert_or_assign(entry.key_id, entry.key.data(), entry.key.size());
+            pending_keys_.erase(pending);
+        }
+        OPENSSL_cleanse(entry.key.data(), entry.key.size());
+    }
+    if (pending_keys_.empty()) {
+        restore_pending_.store(false, std::memory_order_release);
+        snapshot_.reset();
+    }
 }
 
-bool SessionManager::session_exists(uint32_t session_id) {
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
-    return sessions_.find(session_id) != sessions_.end();
+// Session implementation
+Session::Session(uint32_t session_id, uint32_t client_id)
+    : Session(session_id, client_id, get_current_timestamp(), 0) {}
+
+Session::Session(uint32_t session_id, uint32_t client_id,
+                 std::chrono::system_clock::time_point created_at, uint32_t key_epoch)
+    : session_id_(session_id),
+      message_counter_(0),
+      last_activity_(0),
+      authenticated_(false),
+      key_rotated_(key_epoch > 0),
+      revoked_(false),
+      key_epoch_(key_epoch),
+      current_key_{},
+      client_id_(client_id),
+      created_at_(created_at),
+      capabilities_(baseline_capabilities()),
+      resume_nonce_epoch_(key_epoch),
+      idle_timer_(TimerWheel::INVALID_TIMER),
+      lifetime_timer_(TimerWheel::INVALID_TIMER) {
+    last_activity_.store(get_current_timestamp().time_since_epoch().count(), std::memory_order_relaxed);
 }
 
-bool SessionManager::authenticate_session(uint32_t session_id, const std::vector<uint8_t>& auth_data) {
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
-    auto it = sessions_.find(session_id);
-    if (it != sessions_.end()) {
-        // Simple authentication - in real implementation, this would verify credentials
-        it->second.authenticated = true;
-        return true;
+Session::~Session() {
+    OPENSSL_cleanse(current_key_.data(), current_key_.size());
+}
+
+void Session::lock_key() const {
+    while (key_lock_.test_and_set(std::memory_order_acquire)) {
+        // Critical sections are a 32-byte copy; spin
     }
-    return false;
 }
 
-AuthResult SessionManager::verify_session_auth(uint32_t session_id, const std::vector<uint8_t>& signature) {
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
-    auto it = sessions_.find(session_id);
-    if (it == sessions_.end()) {
-        return AuthResult::UNKNOWN_CLIENT;
+std::chrono::system_clock::time_point Session::last_activity() const {
+    return std::chrono::system_clock::time_point(
+        std::chrono::system_clock::duration(last_activity_.load(std::memory_order_relaxed)));
+}
+
+void Session::touch() {
+    last_activity_.store(get_current_timestamp().time_since_epoch().count(), std::memory_order_relaxed);
+    message_counter_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Session::set_authenticated(bool authenticated) {
+    authenticated_.store(authenticated, std::memory_order_release);
+}
+
+void Session::revoke() {
+    revoked_.store(true, std::memory_order_release);
+}
+
+SessionKey Session::current_key() const {
+    lock_key();
+    SessionKey key = current_key_;
+    unlock_key();
+    return key;
+}
+
+void Session::set_current_key(const SessionKey& key) {
+    lock_key();
+    current_key_ = key;
+    unlock_key();
+}
+
+void Session::set_current_key(ByteView key) {
+    if (key.size() != KEY_SIZE) {
+        throw CryptoException("Invalid session key size: " + std::to_string(key.size()));
+    }
+    SessionKey fixed;
+    std::copy(key.begin(), key.end(), fixed.begin());
+    set_current_key(fixed);
+    OPENSSL_cleanse(fixed.data(), fixed.size());
+}
+
+SessionKey Session::rotate_key(CryptoManager& crypto) {
+    std::vector<uint8_t> id_bytes(sizeof(session_id_));
+    store_le(id_bytes.data(), session_id_);
+    // The KDF runs outside the lock; retry if another thread rotated meanwhile
+    while (true) {
+        SessionKey expected = current_key();
+        std::vector<uint8_t> rotated = crypto.rotate_session_key(expected, id_bytes);
+
+        SessionKey next;
+        std::copy(rotated.begin(), rotated.end(), next.begin());
+        OPENSSL_cleanse(rotated.data(), rotated.size());
+
+        lock_key();
+        bool unchanged = current_key_ == expected;
+        if (unchanged) {
+            current_key_ = next;
+            key_epoch_.fetch_add(1, std::memory_order_acq_rel);
+        }
+        unlock_key();
+        OPENSSL_cleanse(expected.data(), expected.size());
+
+        if (unchanged) {
+            key_rotated_.store(true, std::memory_order_relaxed);
+            return next;
+        }
+    }
+}
+
+bool Session::adopt_key(const SessionKey& key, uint32_t key_epoch) {
+    lock_key();
+    const uint32_t current_epoch = key_epoch_.load(std::memory_order_acquire);
+    bool newer = key_epoch > current_epoch;
+    // Two nodes resuming the same session at once both reach the next epoch
+    // with different keys; neither may overwrite the other's, or their
+    // crossing PUTs leave each table without the key its client holds. The
+    // same key delivered again (a snapshot after a reconnect) is accepted.
+    bool same = key_epoch == current_epoch && CRYPTO_memcmp(key.data(), current_key_.data(), key.size()) == 0;
+    if (newer) {
+        current_key_ = key;
+        key_epoch_.store(key_epoch, std::memory_order_release);
+    }
+    unlock_key();
+
+    if (newer && key_epoch > 0) {
+        key_rotated_.store(true, std::memory_order_relaxed);
+    }
+    return newer || same;
+}
+
+bool Session::claim_resume_nonce(ByteView client_nonce) {
+    if (client_nonce.size() != IV_SIZE) {
+        return false;
+    }
+    std::array<uint8_t, IV_SIZE> nonce;
+    std::copy(client_nonce.begin(), client_nonce.end(), nonce.begin());
+
+    std::lock_guard<std::mutex> lock(cold_mutex_);
+    // A new key makes every earlier binder unverifiable, so its nonces can go
+    uint32_t epoch = key_epoch();
+    if (epoch != resume_nonce_epoch_) {
+        resume_nonces_.clear();
+        resume_nonce_epoch_ = epoch;
+    }
+    if (resume_nonces_.size() >= MAX_RESUME_NONCES ||
+        std::find(resume_nonces_.begin(), resume_nonces_.end(), nonce) != resume_nonces_.end()) {
+        return false;
+    }
+    resume_nonces_.push_back(nonce);
+    return true;
+}
+
+SecureBytes Session::shared_secret() const {
+    std::lock_guard<std::mutex> lock(cold_mutex_);
+    return shared_secret_;
+}
+
+void Session::set_shared_secret(ByteView secret) {
+    std::lock_guard<std::mutex> lock(cold_mutex_);
+    // The old buffer is zeroized by the arena when it is released
+    shared_secret_.assign(secret.begin(), secret.end());
+}
+
+Capabilities Session::capabilities() const {
+    std::lock_guard<std::mutex> lock(cold_mutex_);
+    return capabilities_;
+}
+
+void Session::set_capabilities(const Capabilities& capabilities) {
+    std::lock_guard<std::mutex> lock(cold_mutex_);
+    capabilities_ = capabilities;
+}
+
+AuthResult Session::verify_auth(std::chrono::seconds max_age) const {
+    if (revoked()) {
+        return AuthResult::EXPIRED_SESSION;
     }
 
-    if (!it->second.authenticated) {
+    if (!authenticated()) {
         return AuthResult::INVALID_SIGNATURE;
     }
 
-    // Check if session is expired (24 hours)
-    auto now = get_current_timestamp();
-    if (now - it->second.created_at > std::chrono::hours(24)) {
+    if (get_current_timestamp() - created_at_ > max_age) {
         return AuthResult::EXPIRED_SESSION;
     }
 
     return AuthResult::SUCCESS;
 }
 
-void SessionManager::set_session_key(uint32_t session_id, const std::vector<uint8_t>& key) {
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
-    auto it = sessions_.find(session_id);
-    if (it != sessions_.end()) {
-        it->second.current_key = key;
+SessionInfo Session::snapshot() const {
+    SessionInfo info;
+    info.session_id = session_id_;
+    info.client_id = client_id_;
+    info.created_at = created_at_;
+    info.last_activity = last_activity();
+    info.shared_secret = shared_secret();
+    info.current_key = current_key();
+    info.message_counter = message_counter();
+    info.authenticated = authenticated();
+    info.key_rotated = key_rotated();
+    info.capabilities = capabilities();
+    return info;
+}
+
+// SessionManager implementation
+SessionManager::SessionManager()
+    : timer_wheel_(nullptr),
+      idle_timeout_(SESSION_IDLE_TIMEOUT),
+      max_lifetime_(SESSION_MAX_LIFETIME) {}
+
+SessionManager::~SessionManager() = default;
+
+SessionHandle SessionManager::create_session(uint32_t client_id) {
+    // insert() replaces an existing entry, so a colliding id would silently
+    // detach a live session from the table; draw again until the id is new
+    for (;;) {
+        auto session = std::allocate_shared<Session>(SecureAllocator<Session>(), generate_session_id(), client_id);
+        Shard& shard = shard_for(session->session_id());
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (shard.sessions.contains(session->session_id())) {
+                continue;
+            }
+            shard.sessions.insert(session->session_id(), session);
+        }
+        schedule_expiry(session);
+        return session;
     }
 }
 
-std::vector<uint8_t> SessionManager::get_session_key(uint32_t session_id) {
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
-    auto it = sessions_.find(session_id);
-    if (it == sessions_.end()) {
-        throw CryptoException("Session not found: " + std::to_string(session_id));
+void SessionManager::enable_expiry(TimerWheel* wheel,
+                                   std::chrono::seconds idle_timeout,
+                                   std::chrono::seconds max_lifetime) {
+    timer_wheel_ = wheel;
+    idle_timeout_ = idle_timeout;
+    max_lifetime_ = max_lifetime;
+}
+
+void SessionManager::attach_store(std::shared_ptr<PersistentSessionStore> store) {
+    store_ = std::move(store);
+}
+
+size_t SessionManager::restore_from_store() {
+    if (!store_) {
+        return 0;
     }
-    return it->second.current_key;
+
+    auto now = get_current_timestamp();
+    size_t restored = 0;
+    for (const PersistedSession& persisted : store_->load()) {
+        if (now - persisted.created_at > max_lifetime_) {
+            store_->remove(persisted.session_id);
+            continue;
+        }
+
+        auto session = std::allocate_shared<Session>(SecureAllocator<Session>(),
+                                                     persisted.session_id, persisted.client_id,
+                                                     persisted.created_at, persisted.key_epoch);
+        session->set_current_key(persisted.key);
+        session->set_authenticated(true);
+        {
+            Shard& shard = shard_for(session->session_id());
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.sessions.insert(session->session_id(), session);
+        }
+        if (schedule_expiry(session)) {
+            restored++;
+        }
+    }
+    return restored;
 }
 
-void SessionManager::rotate_session_key(uint32_t session_id) {
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
-    auto it = sessions_.find(session_id);
-    if (it != sessions_.end()) {
-        it->second.current_key = crypto_manager_.rotate_session_key(it->second.current_key, 
-                                                                   std::vector<uint8_t>(reinterpret_cast<const uint8_t*>(&session_id), 
-                                                                                       reinterpret_cast<const uint8_t*>(&session_id) + sizeof(session_id)));
-        it->second.key_rotated = true;
+void SessionManager::persist_session(const Session& session) {
+    if ((!store_ && !replicator_) || session.revoked()) {
+        return;
+    }
+
+    PersistedSession persisted = to_persisted(session);
+    if (store_) {
+        store_->put(persisted);
+    }
+    if (replicator_) {
+        replicator_->publish_put(persisted);
     }
+    OPENSSL_cleanse(persisted.key.data(), persisted.key.size());
 }
 
-void SessionManager::cleanup_expired_sessions(std::chrono::seconds max_age) {
-    auto now = get_current_timestamp();
-    std::vector<uint32_t> expired_sessions;
+PersistedSession SessionManager::to_persisted(const Session& session) {
+    PersistedSession persisted;
+    persisted.session_id = session.session_id();
+    persisted.client_id = session.client_id();
+    persisted.key_epoch = session.key_epoch();
+    persisted.created_at = session.created_at();
+    persisted.key = session.current_key();
+    return persisted;
+}
+
+void SessionManager::attach_replicator(std::shared_ptr<SessionReplicator> replicator) {
+    replicator_ = std::move(replicator);
+}
 
+void SessionManager::apply_replicated(const SessionChange& change) {
+    const PersistedSession& incoming = change.session;
+    if (change.op == SessionChange::Op::REMOVE) {
+        erase_session(incoming.session_id);
+        return;
+    }
+
+    if (!adopt_session(incoming)) {
+        return;
+    }
+    if (store_) {
+        store_->put(incoming);
+    }
+}
+
+SessionHandle SessionManager::adopt_session(const PersistedSession& state) {
+    if (state.session_id == 0 || get_current_timestamp() - state.created_at > max_lifetime_) {
+        return nullptr;
+    }
+
+    if (SessionHandle existing = find_session(state.session_id)) {
+        if (existing->client_id() != state.client_id ||
+            !existing->adopt_key(state.key, state.key_epoch)) {
+            return nullptr;
+        }
+        existing->set_authenticated(true);
+        return existing;
+    }
+
+    auto session = std::allocate_shared<Session>(SecureAllocator<Session>(),
+                                                 state.session_id, state.client_id,
+                                                 state.created_at, state.key_epoch);
+    session->set_current_key(state.key);
+    session->set_authenticated(true);
     {
-        std::lock_guard<std::mutex> lock(sessions_mutex_);
-        for (const auto& pair : sessions_) {
-            if (now - pair.second.created_at > max_age) {
-                expired_sessions.push_back(pair.first);
+        Shard& shard = shard_for(session->session_id());
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.sessions.contains(session->session_id())) {
+            return nullptr; // lost a race with a concurrent insert; the next change converges
+        }
+        shard.sessions.insert(session->session_id(), session);
+    }
+    if (!schedule_expiry(session)) {
+        return nullptr;
+    }
+    return session;
+}
+
+std::vector<PersistedSession> SessionManager::export_sessions() {
+    std::vector<PersistedSession> sessions;
+    for (Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.sessions.for_each([&sessions](uint32_t, const SessionHandle& session) {
+            if (session->authenticated() && !session->revoked()) {
+                sessions.push_back(to_persisted(*session));
             }
+        });
+    }
+    return sessions;
+}
+
+bool SessionManager::schedule_expiry(const SessionHandle& session) {
+    if (!timer_wheel_) {
+        return true;
+    }
+
+    uint32_t session_id = session->session_id();
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        session->created_at() + max_lifetime_ - get_current_timestamp());
+    if (remaining <= std::chrono::milliseconds::zero()) {
+        // Every node computes the same deadline, so this one only drops its copy
+        erase_session(session_id);
+        return false;
+    }
+    session->set_lifetime_timer(timer_wheel_->schedule_after(
+        remaining, [this, session_id]() { remove_session(session_id); }));
+    schedule_idle_check(session, std::chrono::duration_cast<std::chrono::milliseconds>(idle_timeout_));
+    return true;
+}
+
+void SessionManager::schedule_idle_check(const SessionHandle& session, std::chrono::milliseconds delay) {
+    std::weak_ptr<Session> weak_session = session;
+    session->set_idle_timer(timer_wheel_->schedule_after(delay, [this, weak_session]() {
+        SessionHandle current = weak_session.lock();
+        if (!current || current->revoked()) {
+            return;
         }
+        // Activity does not touch the wheel; re-arm for the remaining idle time
+        auto idle = std::chrono::duration_cast<std::chrono::milliseconds>(
+            get_current_timestamp() - current->last_activity());
+        if (idle >= idle_timeout_) {
+            // Local only: activity is never replicated, so a replica's copy
+            // looks idle while another node is serving the session
+            erase_session(current->session_id());
+        } else {
+            schedule_idle_check(current, std::chrono::duration_cast<std::chrono::milliseconds>(idle_timeout_) - idle);
+        }
+    }));
+}
+
+SessionHandle SessionManager::find_session(uint32_t session_id) {
+    Shard& shard = shard_for(session_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.sessions.find(session_id);
+}
+
+SessionHandle SessionManager::get_session(uint32_t session_id) {
+    SessionHandle session = find_session(session_id);
+    if (!session) {
+        throw CryptoException("Session not found: " + std::to_string(session_id));
     }
+    return session;
+}
 
-    for (uint32_t session_id : expired_sessions) {
+void SessionManager::update_session_activity(uint32_t session_id) {
+    if (SessionHandle session = find_session(session_id)) {
+        session->touch();
+    }
+}
+
+void SessionManager::remove_session(uint32_t session_id) {
+    if (erase_session(session_id) && replicator_) {
+        replicator_->publish_remove(session_id);
+    }
+}
+
+SessionHandle SessionManager::erase_session(uint32_t session_id) {
+    SessionHandle removed;
+    {
+        Shard& shard = shard_for(session_id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        removed = shard.sessions.erase(session_id);
+    }
+    if (removed) {
+        removed->revoke();
+        // Timers first: if the store write throws, none is left armed for
+        // a session the table no longer holds
+        if (timer_wheel_) {
+            timer_wheel_->cancel(removed->idle_timer());
+            timer_wheel_->cancel(removed->lifetime_timer());
+        }
+        if (store_) {
+            store_->remove(session_id);
+        }
+    }
+    return removed;
+}
+
+bool SessionManager::session_exists(uint32_t session_id) {
+    Shard& shard = shard_for(session_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.sessions.contains(session_id);
+}
+
+size_t SessionManager::session_count() {
+    size_t count = 0;
+    for (Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        count += shard.sessions.size();
+    }
+    return count;
+}
+
+bool SessionManager::authenticate_session(uint32_t session_id, const std::vector<uint8_t>& auth_data) {
+    if (SessionHandle session = find_session(session_id)) {
+        // Simple authentication - in real implementation, this would verify credentials
+        session->set_authenticated(true);
+        return true;
+    }
+    return false;
+}
+
+AuthResult SessionManager::verify_session_auth(uint32_t session_id, const std::vector<uint8_t>& signature) {
+    SessionHandle session = find_session(session_id);
+    if (!session) {
+        return AuthResult::UNKNOWN_CLIENT;
+    }
+    return session->verify_auth();
+}
+
+void SessionManager::set_session_key(uint32_t session_id, ByteView key) {
+    if (SessionHandle session = find_session(session_id)) {
+        session->set_current_key(key);
+    }
+}
+
+SessionKey SessionManager::get_session_key(uint32_t session_id) {
+    return get_session(session_id)->current_key();
+}
+
+void SessionManager::rotate_session_key(uint32_t session_id) {
+    if (SessionHandle session = find_session(session_id)) {
+        session->rotate_key(crypto_manager_);
+    }
+}
+
+void SessionManager::cleanup_expired_sessions(std::chrono::seconds max_age) {
+    // Removal takes the shard lock again and touches the store, the timers
+    // and the replicator, so it runs after the scan has let go of the lock
+    for (uint32_t session_id : get_expired_sessions(max_age)) {
         remove_session(session_id);
     }
 }
@@ -660,11 +1589,13 @@ std::vector<uint32_t> SessionManager::get_expired_sessions(std::chrono::seconds
     auto now = get_current_timestamp();
     std::vector<uint32_t> expired_sessions;
 
-    std::lock_guard<std::mutex> lock(sessions_mutex_);
-    for (const auto& pair : sessions_) {
-        if (now - pair.second.created_at > max_age) {
-            expired_sessions.push_back(pair.first);
-        }
+    for (Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.sessions.for_each([&](uint32_t session_id, const SessionHandle& session) {
+            if (now - session->created_at() > max_age) {
+                expired_sessions.push_back(session_id);
+            }
+        });
     }
 
     return expired_sessions;
@@ -716,20 +1647,83 @@ std::vector<uint8_t> base64_decode(const std::string& encoded) {
     return decoded;
 }
 
-bool constant_time_compare(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+bool constant_time_compare(ByteView a, ByteView b) {
     if (a.size() != b.size()) {
         return false;
     }
     
     int result = 0;
     for (size_t i = 0; i < a.size(); i++) {
-        result |= a[i] ^ b[i];
+        result |= a.data()[i] ^ b.data()[i];
     }
     return result == 0;
 }
 
+SessionProfile make_session_profile(const Capabilities& capabilities) {
+    SessionProfile profile;
+    profile.cipher = capabilities.cipher_suites == CIPHER_SUITE_CHACHA20_POLY1305
+        ? EVP_chacha20_poly1305() : EVP_aes_256_gcm();
+    profile.compact_framing = (capabilities.features & FEATURE_COMPACT_FRAMING) != 0;
+    profile.sign_messages = (capabilities.features & FEATURE_UNSIGNED_MESSAGES) == 0;
+    profile.compress = (capabilities.features & FEATURE_COMPRESSION) != 0;
+    profile.message_flags = 0;
+    if (profile.compact_framing) {
+        profile.message_flags = profile.sign_messages ? FLAG_COMPACT | FLAG_SIGNED : FLAG_COMPACT;
+    }
+    profile.max_frame_size = std::min<size_t>(capabilities.max_frame_size, MAX_MESSAGE_SIZE);
+    return profile;
+}
+
+MessageHeader encrypted_message_header(const SessionProfile& profile, uint32_t sequence_number,
+                                       uint16_t extra_flags, size_t sealed_size) {
+    if (sealed_size > profile.max_frame_size) {
+        throw CryptoException("Message too large");
+    }
+
+    MessageHeader header;
+    header.version = ProtocolVersion::V1_0;
+    header.type = MessageType::ENCRYPTED_MESSAGE;
+    header.sequence_number = sequence_number;
+    header.timestamp = get_current_timestamp_seconds();
+    header.payload_size = static_cast<uint16_t>(sealed_size);
+    header.flags = static_cast<uint16_t>(profile.message_flags | extra_flags);
+    return header;
+}
+
+std::array<uint8_t, ENCRYPTED_MESSAGE_AAD_SIZE> encrypted_message_aad(const MessageHeader& header,
+                                                                     uint32_t session_id, uint32_t message_id) {
+    std::array<uint8_t, ENCRYPTED_MESSAGE_AAD_SIZE> aad;
+    MessageHeaderLayout::encode(header, aad.data());
+    store_le(aad.data() + HEADER_WIRE_SIZE, session_id);
+    store_le(aad.data() + HEADER_WIRE_SIZE + sizeof(uint32_t), message_id);
+    return aad;
+}
+
+std::vector<uint8_t> encode_encrypted_message(const SessionProfile& profile, const MessageHeader& header,
+                                              uint32_t session_id, uint32_t message_id,
+                                              ByteView iv, ByteView ciphertext, ByteView signature) {
+    if (iv.size() != IV_SIZE || ciphertext.size() != header.payload_size) {
+        throw CryptoException("Encrypted message does not match its header");
+    }
+
+    size_t signature_size = profile.sign_messages ? std::min<size_t>(signature.size(), SIGNATURE_SIZE) : 0;
+    std::vector<uint8_t> data(HEADER_WIRE_SIZE + message_body_size(header));
+    MessageHeaderLayout::encode(header, data.data());
+    uint8_t* body = data.data() + HEADER_WIRE_SIZE;
+    // Both framings share the prefix; a full body is zero-padded around the ciphertext
+    store_le(body + EncryptedMessageLayout::offset_of<&EncryptedMessage::session_id>(), session_id);
+    store_le(body + EncryptedMessageLayout::offset_of<&EncryptedMessage::message_id>(), message_id);
+    std::copy(iv.begin(), iv.end(), body + EncryptedMessageLayout::offset_of<&EncryptedMessage::iv>());
+    std::copy(ciphertext.begin(), ciphertext.end(), body + COMPACT_PREFIX_WIRE_SIZE);
+    size_t signature_offset = profile.compact_framing
+        ? COMPACT_PREFIX_WIRE_SIZE + ciphertext.size()
+        : EncryptedMessageLayout::offset_of<&EncryptedMessage::signature>();
+    std::copy(signature.begin(), signature.begin() + signature_size, body + signature_offset);
+    return data;
+}
+
 void log_crypto_error(const std::string& operation) {
-    std::cerr << "Crypto error in " << operation << ": " << get_openssl_error_string() << std::endl;
+    SC_LOG_ERROR("Crypto error in {}: {}", operation, get_openssl_error_string());
 }
 
 std::string get_openssl_error_string() {
@@ -6,6 +6,13 @@
 #endif
 
 #include "common.h"
+#include "session_table.h"
+#include "timer_wheel.h"
+#include "session_store.h"
+#include "replication.h"
+#include "session_ticket.h"
+#include "key_snapshot.h"
+#include "key_table.h"
 #include <openssl/evp.h>
 #include <openssl/rsa.h>
 #include <openssl/dh.h>
@@ -18,6 +25,9 @@
 #include <openssl/bio.h>
 #include <memory>
 #include <unordered_map>
+#include <map>
+#include <array>
+#include <atomic>
 
 namespace SecureComm {
 
@@ -47,6 +57,24 @@ private:
     EVP_MD_CTX* ctx_;
 };
 
+// Message path for one connection, resolved once from the negotiated
+// Capabilities; sending and receiving read these precomputed values instead
+// of testing capability bits per message
+struct SessionProfile {
+    // AEAD for message payloads
+    const EVP_CIPHER* cipher;
+    // Header flags for outgoing ENCRYPTED_MESSAGEs
+    uint16_t message_flags;
+    bool compact_framing;
+    bool sign_messages;
+    // Plaintext of COMPRESSION_THRESHOLD bytes or more goes through the
+    // connection's MessageCompressor
+    bool compress;
+    size_t max_frame_size;
+};
+
+SessionProfile make_session_profile(const Capabilities& capabilities);
+
 // Main cryptographic manager class
 class CryptoManager {
 public:
@@ -56,30 +84,59 @@ public:
     // Key generation
     KeyPair generate_rsa_keypair(size_t bits = 2048);
     KeyPair generate_dh_keypair();
+    // X25519 ephemeral pair; both halves are KEY_SIZE raw bytes
+    KeyPair generate_x25519_keypair();
     std::vector<uint8_t> generate_symmetric_key(size_t size = KEY_SIZE);
+    // Random key generated directly in the SecureArena
+    SecureBytes generate_secure_key(size_t size = KEY_SIZE);
     
     // Encryption/Decryption
     std::vector<uint8_t> encrypt_aes_gcm(const std::vector<uint8_t>& data, 
-                                        const std::vector<uint8_t>& key,
+                                        ByteView key,
                                         const std::vector<uint8_t>& iv);
     std::vector<uint8_t> decrypt_aes_gcm(const std::vector<uint8_t>& encrypted_data,
-                                        const std::vector<uint8_t>& key,
+                                        ByteView key,
                                         const std::vector<uint8_t>& iv);
+
+    // Authenticated encryption: output is ciphertext || GCM_TAG_SIZE-byte tag.
+    // open_aes_gcm throws CryptoException if the tag does not verify.
+    std::vector<uint8_t> seal_aes_gcm(ByteView data,
+                                     ByteView key,
+                                     ByteView iv,
+                                     ByteView aad = ByteView());
+    std::vector<uint8_t> open_aes_gcm(ByteView sealed_data,
+                                     ByteView key,
+                                     ByteView iv,
+                                     ByteView aad = ByteView());
+    // The same under any AEAD with an IV_SIZE IV and GCM_TAG_SIZE tag
+    // (AES-256-GCM, ChaCha20-Poly1305), e.g. SessionProfile::cipher
+    std::vector<uint8_t> seal_aead(const EVP_CIPHER* cipher,
+                                  ByteView data,
+                                  ByteView key,
+                                  ByteView iv,
+                                  ByteView aad = ByteView());
+    std::vector<uint8_t> open_aead(const EVP_CIPHER* cipher,
+                                  ByteView sealed_data,
+                                  ByteView key,
+                                  ByteView iv,
+                                  ByteView aad = ByteView());
     
     // Key exchange
-    std::vector<uint8_t> perform_dh_key_exchange(const std::vector<uint8_t>& private_key,
-                                                const std::vector<uint8_t>& peer_public_key);
-    std::vector<uint8_t> derive_shared_secret(const std::vector<uint8_t>& dh_result,
-                                             const std::vector<uint8_t>& salt);
+    std::vector<uint8_t> perform_dh_key_exchange(ByteView private_key,
+                                                ByteView peer_public_key);
+    std::vector<uint8_t> perform_x25519_key_exchange(ByteView private_key,
+                                                    ByteView peer_public_key);
+    std::vector<uint8_t> derive_shared_secret(ByteView dh_result,
+                                             ByteView salt);
     
     // Hashing and HMAC
     std::vector<uint8_t> sha256_hash(const std::vector<uint8_t>& data);
     std::vector<uint8_t> hmac_sha256(const std::vector<uint8_t>& data,
-                                    const std::vector<uint8_t>& key);
+                                    ByteView key);
     
     // Digital signatures
     std::vector<uint8_t> sign_data(const std::vector<uint8_t>& data,
-                                  const std::vector<uint8_t>& private_key);
+                                  ByteView private_key);
     bool verify_signature(const std::vector<uint8_t>& data,
                          const std::vector<uint8_t>& signature,
                          const std::vector<uint8_t>& public_key);
@@ -89,35 +146,157 @@ public:
     uint32_t generate_random_uint32();
     
     // Key derivation
-    std::vector<uint8_t> derive_key(const std::vector<uint8_t>& master_key,
-                                   const std::vector<uint8_t>& salt,
+    std::vector<uint8_t> derive_key(ByteView master_key,
+                                   ByteView salt,
                                    size_t key_size = KEY_SIZE);
     
     // Forward secrecy
-    std::vector<uint8_t> rotate_session_key(const std::vector<uint8_t>& current_key,
+    std::vector<uint8_t> rotate_session_key(ByteView current_key,
                                            const std::vector<uint8_t>& session_id);
 
+    // Session resumption: the binder proves possession of the session key,
+    // the resumed key mixes fresh nonces from both sides into it
+    std::vector<uint8_t> resume_binder(ByteView session_key,
+                                      uint32_t session_id,
+                                      ByteView client_nonce);
+    std::vector<uint8_t> derive_resumed_key(ByteView session_key,
+                                           ByteView client_nonce,
+                                           ByteView server_nonce);
+    std::vector<uint8_t> resume_finished(ByteView resumed_key);
+    // Carried in the client's HANDSHAKE_COMPLETE: proves it derived the key too
+    std::vector<uint8_t> resume_client_finished(ByteView resumed_key);
+    // Secret carried in a resumption ticket, derived when the ticket is issued
+    std::vector<uint8_t> derive_resumption_secret(ByteView session_key);
+    // 0-RTT: early data is sealed under a key from the ticket's secret and
+    // the client nonce alone; the reply under a key from the resumed key
+    std::vector<uint8_t> derive_early_data_key(ByteView resumption_secret,
+                                              ByteView client_nonce);
+    std::vector<uint8_t> derive_early_response_key(ByteView resumed_key);
+
 private:
     void initialize_openssl();
     void cleanup_openssl();
     // Private helper methods
-    std::vector<uint8_t> rsa_private_key_to_bytes(EVP_PKEY* pkey);
+    SecureBytes rsa_private_key_to_bytes(EVP_PKEY* pkey);
     std::vector<uint8_t> rsa_public_key_to_bytes(EVP_PKEY* pkey);
-    EVP_PKEY* bytes_to_rsa_private_key(const std::vector<uint8_t>& data);
+    EVP_PKEY* bytes_to_rsa_private_key(ByteView data);
     EVP_PKEY* bytes_to_rsa_public_key(const std::vector<uint8_t>& data);
 };
 
+// Per-direction symmetric hash ratchet.
+// Each message key is derived from the chain key with one HMAC step and the
+// chain key is then advanced, so a compromised chain key cannot decrypt
+// earlier messages. Keys for skipped counters are cached (bounded) so
+// out-of-order delivery still decrypts.
+class ChainKeyRatchet {
+    using ChainKey = std::array<uint8_t, KEY_SIZE>;
+
+public:
+    static constexpr size_t MAX_SKIPPED_KEYS = 256;
+    // The counter arrives before the frame authenticates, so this bounds the
+    // chain steps (two HMACs each) a forged frame can cost the receiver
+    static constexpr uint32_t MAX_SKIP = 64;
+
+    // Key for one received message plus the chain state that accepting the
+    // message leads to; applied by commit()
+    class PendingKey {
+    public:
+        ByteView key() const { return *message_key_; }
+        uint32_t counter() const { return counter_; }
+
+    private:
+        friend class ChainKeyRatchet;
+
+        uint32_t counter_ = 0;
+        uint32_t base_counter_ = 0;
+        // The key was cached when its message was skipped
+        bool from_skipped_ = false;
+        SecureBox<ChainKey> message_key_;
+        SecureBox<ChainKey> chain_key_;
+        std::vector<std::pair<uint32_t, ChainKey>,
+                    SecureAllocator<std::pair<uint32_t, ChainKey>>> skipped_keys_;
+    };
+
+    ChainKeyRatchet();
+    ChainKeyRatchet(ByteView root_key, const std::string& label);
+    ~ChainKeyRatchet();
+
+    ChainKeyRatchet(const ChainKeyRatchet&) = delete;
+    ChainKeyRatchet& operator=(const ChainKeyRatchet&) = delete;
+
+    // Re-seed the chain (e.g. after an explicit key rotation)
+    void reset(ByteView root_key, const std::string& label);
+
+    // Sending side: key for the next message, counter is written to *counter
+    std::vector<uint8_t> next_message_key(uint32_t* counter);
+
+    // Receiving side: key for the message with the given counter. The chain
+    // does not move until commit(), so a message that fails authentication
+    // neither advances it nor evicts skipped keys.
+    // Throws CryptoException on replayed counters or gaps above MAX_SKIP.
+    PendingKey pending_key_for(uint32_t counter) const;
+    // Accept the message pending was derived for; throws CryptoException if
+    // the chain moved in between
+    void commit(const PendingKey& pending);
+
+    uint32_t next_counter() const { return counter_; }
+    size_t skipped_key_count() const { return skipped_keys_.size(); }
+    bool initialized() const { return initialized_; }
+
+private:
+    // Message key and successor of chain_key; next_chain_key must not alias chain_key
+    static void step(const ChainKey& chain_key, ChainKey& message_key, ChainKey& next_chain_key);
+    void wipe();
+
+    SecureBox<ChainKey> chain_key_;
+    uint32_t counter_;
+    bool initialized_;
+    // Ordered by counter so the oldest skipped key is evicted first; the
+    // map nodes come from the SecureArena like the chain key
+    std::map<uint32_t, ChainKey, std::less<uint32_t>,
+             SecureAllocator<std::pair<const uint32_t, ChainKey>>> skipped_keys_;
+};
+
+// Ratchet labels for the two directions of a session
+constexpr const char* RATCHET_LABEL_CLIENT_TO_SERVER = "SecureComm c2s chain";
+constexpr const char* RATCHET_LABEL_SERVER_TO_CLIENT = "SecureComm s2c chain";
+
 // Key management class
+// Key store tuned for many reads and few writes: lookups are lock-free
+// (see ConcurrentKeyTable) and take a string_view, so callers holding a
+// literal or a slice of a message do not build a std::string. Writers,
+// expirations and restore state are serialized by keys_mutex_.
 class KeyManager {
 public:
+    // Borrowed, read-only view of a key's bytes: no copy and no lock. The
+    // bytes stay valid while the view lives; writers that replace or remove
+    // the key wait for it, so keep views short and do not write keys (on
+    // this manager) while holding one.
+    class KeyView {
+    public:
+        const uint8_t* data() const { return node_ ? node_->key() : nullptr; }
+        size_t size() const { return node_ ? node_->key_size : 0; }
+        explicit operator bool() const { return node_ != nullptr; }
+
+    private:
+        friend class KeyManager;
+        KeyView(ConcurrentKeyTable::ReadGuard guard, const KeyNode* node)
+            : guard_(std::move(guard)), node_(node) {}
+
+        ConcurrentKeyTable::ReadGuard guard_;
+        const KeyNode* node_;
+    };
+
     KeyManager();
     ~KeyManager();
 
     // Key storage and retrieval
-    void store_key(const std::string& key_id, const std::vector<uint8_t>& key);
-    std::vector<uint8_t> get_key(const std::string& key_id);
+    void store_key(const std::string& key_id, ByteView key);
+    std::vector<uint8_t> get_key(std::string_view key_id);
+    // Empty view if the key does not exist
+    KeyView borrow_key(std::string_view key_id);
     void remove_key(const std::string& key_id);
-    bool key_exists(const std::string& key_id);
+    bool key_exists(std::string_view key_id);
     
     // Key rotation
     void rotate_key(const std::string& key_id);
@@ -127,47 +306,231 @@ public:
     void set_key_expiration(const std::string& key_id, 
                            std::chrono::system_clock::time_point expires_at);
     bool is_key_expired(const std::string& key_id);
+    // Expired keys are removed by the wheel instead of waiting to be asked
+    void set_timer_wheel(TimerWheel* wheel);
     
-    // Key backup and recovery
-    void backup_keys(const std::string& backup_path);
-    void restore_keys(const std::string& backup_path);
+    // Key backup and recovery as an encrypted snapshot (see key_snapshot.h).
+    // The one-argument forms use the key kept in <backup_path>.key. Backup
+    // copies the keys under the lock and seals/writes the copy outside it;
+    // restore opens only the index and decrypts a chunk of keys the first
+    // time one of them is used. Both return the number of keys.
+    size_t backup_keys(const std::string& backup_path);
+    size_t restore_keys(const std::string& backup_path);
+    size_t backup_keys(const std::string& backup_path, ByteView backup_key);
+    size_t restore_keys(const std::string& backup_path, ByteView backup_key);
 
 private:
-    std::unordered_map<std::string, std::vector<uint8_t>> keys_;
+    void schedule_expiry_locked(const std::string& key_id, std::chrono::system_clock::time_point expires_at);
+    // Decrypt the snapshot chunk holding a restored key; false if it is not pending
+    bool load_pending_locked(const std::string& key_id);
+    void load_all_pending_locked();
+    void load_chunk_locked(uint32_t chunk);
+
+    // Restored keys are decrypted lazily, in load_pending_locked (slow path)
+    KeyView find_key(std::string_view key_id);
+
+    ConcurrentKeyTable keys_;
     std::unordered_map<std::string, std::chrono::system_clock::time_point> key_expirations_;
+    std::unordered_map<std::string, TimerWheel::TimerId> key_expiry_timers_;
+    TimerWheel* timer_wheel_;
+    // Restored keys whose snapshot chunk has not been decrypted yet
+    std::unique_ptr<KeySnapshotReader> snapshot_;
+    std::unordered_map<std::string, uint32_t> pending_keys_;
+    // Mirrors snapshot_ != nullptr so lookups that miss skip the lock otherwise
+    std::atomic<bool> restore_pending_;
     std::mutex keys_mutex_;
 };
 
+// Live session state shared between the session table and the connection
+// handlers. Hot per-message fields (key, counters, flags) come first and the
+// key is stored inline; cold handshake-time fields follow. Scalars are
+// atomics and the key is copied under a tiny spinlock, so holders of a
+// SessionHandle see updates in place without going back through
+// SessionManager. SessionManager allocates sessions from the SecureArena,
+// so the inline key lives in locked memory.
+class Session {
+public:
+    Session(uint32_t session_id, uint32_t client_id);
+    // Rebuild a session from persisted state
+    Session(uint32_t session_id, uint32_t client_id,
+            std::chrono::system_clock::time_point created_at, uint32_t key_epoch);
+    ~Session();
+
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+    uint32_t session_id() const { return session_id_; }
+    uint32_t client_id() const { return client_id_; }
+    std::chrono::system_clock::time_point created_at() const { return created_at_; }
+    std::chrono::system_clock::time_point last_activity() const;
+    uint32_t message_counter() const { return message_counter_.load(std::memory_order_relaxed); }
+    bool authenticated() const { return authenticated_.load(std::memory_order_acquire); }
+    bool key_rotated() const { return key_rotated_.load(std::memory_order_relaxed); }
+    bool revoked() const { return revoked_.load(std::memory_order_acquire); }
+    // Number of rotations applied to the handshake key
+    uint32_t key_epoch() const { return key_epoch_.load(std::memory_order_acquire); }
+
+    // Record activity for one message
+    void touch();
+    void set_authenticated(bool authenticated);
+    // Called when the session is removed from the table
+    void revoke();
+
+    SessionKey current_key() const;
+    void set_current_key(const SessionKey& key);
+    void set_current_key(ByteView key);
+    // Replace the current key with rotate(current); returns the new key
+    SessionKey rotate_key(CryptoManager& crypto);
+    // Install a key derived elsewhere (resumption, another node) with its
+    // epoch; refused unless the epoch is newer than the session's, except
+    // that the key the session already holds at its epoch is accepted again
+    bool adopt_key(const SessionKey& key, uint32_t key_epoch);
+
+    // Record a resume attempt's client nonce against the current key; false
+    // if it was already used (a replayed first flight) or too many attempts
+    // under this key were never completed. Like tickets, single use.
+    static constexpr size_t MAX_RESUME_NONCES = 32;
+    bool claim_resume_nonce(ByteView client_nonce);
+
+    // Cold: only read during the handshake
+    SecureBytes shared_secret() const;
+    void set_shared_secret(ByteView secret);
+
+    AuthResult verify_auth(std::chrono::seconds max_age = SESSION_MAX_LIFETIME) const;
+
+    // Negotiated in the handshake that (re)established the session (cold)
+    Capabilities capabilities() const;
+    void set_capabilities(const Capabilities& capabilities);
+
+    // Expiry timers registered by SessionManager (cold)
+    void set_idle_timer(TimerWheel::TimerId id) { idle_timer_.store(id, std::memory_order_relaxed); }
+    void set_lifetime_timer(TimerWheel::TimerId id) { lifetime_timer_.store(id, std::memory_order_relaxed); }
+    TimerWheel::TimerId idle_timer() const { return idle_timer_.load(std::memory_order_relaxed); }
+    TimerWheel::TimerId lifetime_timer() const { return lifetime_timer_.load(std::memory_order_relaxed); }
+
+    // Point-in-time copy in the legacy SessionInfo layout
+    SessionInfo snapshot() const;
+
+private:
+    void lock_key() const;
+    void unlock_key() const { key_lock_.clear(std::memory_order_release); }
+
+    // Hot fields
+    const uint32_t session_id_;
+    std::atomic<uint32_t> message_counter_;
+    std::atomic<std::chrono::system_clock::rep> last_activity_;
+    std::atomic<bool> authenticated_;
+    std::atomic<bool> key_rotated_;
+    std::atomic<bool> revoked_;
+    std::atomic<uint32_t> key_epoch_;
+    mutable std::atomic_flag key_lock_ = ATOMIC_FLAG_INIT;
+    SessionKey current_key_;
+
+    // Cold fields
+    const uint32_t client_id_;
+    const std::chrono::system_clock::time_point created_at_;
+    mutable std::mutex cold_mutex_;
+    SecureBytes shared_secret_;
+    Capabilities capabilities_;
+    // Client nonces of resume attempts under the key at resume_nonce_epoch_
+    std::vector<std::array<uint8_t, IV_SIZE>> resume_nonces_;
+    uint32_t resume_nonce_epoch_;
+    std::atomic<TimerWheel::TimerId> idle_timer_;
+    std::atomic<TimerWheel::TimerId> lifetime_timer_;
+};
+
 // Session management class
+// The session table is split into 2^SHARD_BITS shards selected from the
+// session_id bits; each shard has its own lock and sits on its own cache line
+// so lookups for different sessions do not contend.
 class SessionManager {
 public:
+    static constexpr size_t SHARD_BITS = 4;
+    static constexpr size_t SHARD_COUNT = size_t(1) << SHARD_BITS;
+
     SessionManager();
     ~SessionManager();
 
     // Session creation and management
-    SessionInfo create_session(uint32_t client_id);
-    SessionInfo get_session(uint32_t session_id);
+    // Handles stay valid after removal; the session is then marked revoked.
+    SessionHandle create_session(uint32_t client_id);
+    // nullptr if there is no such session; one lookup, so unlike
+    // session_exists followed by get_session it cannot race a removal
+    SessionHandle find_session(uint32_t session_id);
+    // Throws CryptoException if there is no such session
+    SessionHandle get_session(uint32_t session_id);
     void update_session_activity(uint32_t session_id);
     void remove_session(uint32_t session_id);
     bool session_exists(uint32_t session_id);
+    size_t session_count();
     
     // Session authentication
     bool authenticate_session(uint32_t session_id, const std::vector<uint8_t>& auth_data);
     AuthResult verify_session_auth(uint32_t session_id, const std::vector<uint8_t>& signature);
     
     // Session key management
-    void set_session_key(uint32_t session_id, const std::vector<uint8_t>& key);
-    std::vector<uint8_t> get_session_key(uint32_t session_id);
+    void set_session_key(uint32_t session_id, ByteView key);
+    SessionKey get_session_key(uint32_t session_id);
     void rotate_session_key(uint32_t session_id);
     
     // Session cleanup
-    void cleanup_expired_sessions(std::chrono::seconds max_age = std::chrono::hours(24));
-    std::vector<uint32_t> get_expired_sessions(std::chrono::seconds max_age = std::chrono::hours(24));
+    void cleanup_expired_sessions(std::chrono::seconds max_age = SESSION_MAX_LIFETIME);
+    std::vector<uint32_t> get_expired_sessions(std::chrono::seconds max_age = SESSION_MAX_LIFETIME);
+
+    // Track idle and absolute timeouts on a timer wheel; sessions created
+    // afterwards are removed individually when a timer fires (no full scans).
+    // Idle expiry drops only this node's copy; lifetime expiry is replicated
+    void enable_expiry(TimerWheel* wheel,
+                       std::chrono::seconds idle_timeout = SESSION_IDLE_TIMEOUT,
+                       std::chrono::seconds max_lifetime = SESSION_MAX_LIFETIME);
+
+    // Optional persistent backend so sessions survive restarts
+    void attach_store(std::shared_ptr<PersistentSessionStore> store);
+    // Load persisted sessions into the table; returns the number restored
+    size_t restore_from_store();
+    // Write the session's current key state through to the store and
+    // publish it to the other nodes
+    void persist_session(const Session& session);
+
+    // Optional channel that replicates sessions to other server nodes
+    void attach_replicator(std::shared_ptr<SessionReplicator> replicator);
+    // Apply a change received from another node (written to the store, not re-published)
+    void apply_replicated(const SessionChange& change);
+    // Insert an authenticated session from persisted state, or move an
+    // existing one to the given key; nullptr if expired, owned by another
+    // client or the key epoch is stale
+    SessionHandle adopt_session(const PersistedSession& state);
+    // Authenticated, live sessions in persisted form (full sync for a new peer)
+    std::vector<PersistedSession> export_sessions();
 
 private:
-    std::unordered_map<uint32_t, SessionInfo> sessions_;
-    std::mutex sessions_mutex_;
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    struct alignas(CACHE_LINE_SIZE) Shard {
+        std::mutex mutex;
+        FlatSessionTable sessions;
+    };
+
+    // Fibonacci hashing spreads sequential or low-entropy ids across shards
+    static size_t shard_index(uint32_t session_id) {
+        return static_cast<size_t>((session_id * 0x9E3779B1u) >> (32 - SHARD_BITS));
+    }
+    Shard& shard_for(uint32_t session_id) { return shards_[shard_index(session_id)]; }
+    SessionHandle erase_session(uint32_t session_id);
+    static PersistedSession to_persisted(const Session& session);
+    // Lifetime runs from created_at, so restored and adopted sessions keep
+    // their original deadline; false if it has already passed and the
+    // session was erased
+    bool schedule_expiry(const SessionHandle& session);
+    void schedule_idle_check(const SessionHandle& session, std::chrono::milliseconds delay);
+
+    std::array<Shard, SHARD_COUNT> shards_;
     CryptoManager crypto_manager_;
+    TimerWheel* timer_wheel_;
+    std::chrono::seconds idle_timeout_;
+    std::chrono::seconds max_lifetime_;
+    std::shared_ptr<PersistentSessionStore> store_;
+    std::shared_ptr<SessionReplicator> replicator_;
 };
 
 // Utility functions
@@ -175,7 +538,27 @@ std::string bytes_to_hex(const std::vector<uint8_t>& data);
 std::vector<uint8_t> hex_to_bytes(const std::string& hex);
 std::string base64_encode(const std::vector<uint8_t>& data);
 std::vector<uint8_t> base64_decode(const std::string& encoded);
-bool constant_time_compare(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b);
+bool constant_time_compare(ByteView a, ByteView b);
+
+// Header of an ENCRYPTED_MESSAGE carrying sealed_size bytes of ciphertext
+// and tag; extra_flags (e.g. FLAG_COMPRESSED) are added to the profile's
+// message flags. Throws CryptoException if it exceeds the frame size.
+MessageHeader encrypted_message_header(const SessionProfile& profile, uint32_t sequence_number,
+                                       uint16_t extra_flags, size_t sealed_size);
+
+// Associated data of an encrypted message: the encoded header followed by
+// the session and message ids, so none of them can be altered or replayed
+// into another session without failing authentication
+constexpr size_t ENCRYPTED_MESSAGE_AAD_SIZE = HEADER_WIRE_SIZE + 2 * sizeof(uint32_t);
+std::array<uint8_t, ENCRYPTED_MESSAGE_AAD_SIZE> encrypted_message_aad(const MessageHeader& header,
+                                                                     uint32_t session_id, uint32_t message_id);
+
+// Header and body of an ENCRYPTED_MESSAGE in the profile's framing; header
+// comes from encrypted_message_header() for this ciphertext; signature is
+// ignored unless profile.sign_messages
+std::vector<uint8_t> encode_encrypted_message(const SessionProfile& profile, const MessageHeader& header,
+                                              uint32_t session_id, uint32_t message_id,
+                                              ByteView iv, ByteView ciphertext, ByteView signature);
 
 // Error handling
 class CryptoException : public std::runtime_error {
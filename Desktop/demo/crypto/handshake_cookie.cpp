@@ -0,0 +1,90 @@
+#include "handshake_cookie.h"
+#include "crypto_utils.h"
+#include "wire_codec.h"
+#include <cstring>
+#include <openssl/crypto.h>
+#include <openssl/hmac.h>
+
+namespace SecureComm {
+
+namespace {
+
+constexpr size_t MAC_SIZE = HANDSHAKE_COOKIE_SIZE - 4;
+
+// Seconds on the steady clock; cookies never outlive the process that issued them
+uint32_t now_seconds() {
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+} // namespace
+
+HandshakeCookies::HandshakeCookies() {
+    CryptoManager crypto;
+    key_ = crypto.generate_secure_key(KEY_SIZE);
+}
+
+HandshakeCookies::~HandshakeCookies() {
+    OPENSSL_cleanse(key_.data(), key_.size());
+}
+
+std::vector<uint8_t> HandshakeCookies::issue(uint32_t peer_address, const HandshakeView& init) const {
+    std::vector<uint8_t> cookie(HANDSHAKE_COOKIE_SIZE);
+    const uint32_t issued_at = now_seconds();
+    store_le<uint32_t>(cookie.data(), issued_at);
+    compute_mac(issued_at, peer_address, init, cookie.data() + 4);
+    return cookie;
+}
+
+bool HandshakeCookies::redeem(ByteView cookie, uint32_t peer_address, const HandshakeView& init) {
+    if (cookie.size() != HANDSHAKE_COOKIE_SIZE) {
+        return false;
+    }
+    const uint32_t issued_at = load_le<uint32_t>(cookie.data());
+    const uint32_t now = now_seconds();
+    const uint32_t lifetime = static_cast<uint32_t>(HANDSHAKE_COOKIE_LIFETIME.count());
+    if (now - issued_at > lifetime) {
+        return false;
+    }
+    uint8_t expected[MAC_SIZE];
+    compute_mac(issued_at, peer_address, init, expected);
+    if (CRYPTO_memcmp(expected, cookie.data() + 4, MAC_SIZE) != 0) {
+        return false;
+    }
+
+    // Only authentic cookies get here, so the set holds at most what was
+    // issued in the last lifetime
+    const uint64_t tag = load_le<uint64_t>(expected);
+    std::lock_guard<std::mutex> lock(redeemed_mutex_);
+    while (!redeemed_order_.empty() && now - redeemed_order_.front().issued_at > lifetime) {
+        redeemed_.erase(redeemed_order_.front().tag);
+        redeemed_order_.pop_front();
+    }
+    if (redeemed_.size() >= MAX_REDEEMED || !redeemed_.insert(tag).second) {
+        return false;
+    }
+    redeemed_order_.push_back({issued_at, tag});
+    return true;
+}
+
+void HandshakeCookies::compute_mac(uint32_t issued_at, uint32_t peer_address, const HandshakeView& init,
+                                   uint8_t* mac) const {
+    // address | issued at | client id | session id | public key | nonce
+    uint8_t input[16 + KEY_SIZE + IV_SIZE];
+    std::memcpy(input, &peer_address, 4);
+    store_le<uint32_t>(input + 4, issued_at);
+    store_le<uint32_t>(input + 8, init.client_id());
+    store_le<uint32_t>(input + 12, init.session_id());
+    std::memcpy(input + 16, init.public_key().data(), KEY_SIZE);
+    std::memcpy(input + 16 + KEY_SIZE, init.nonce().data(), IV_SIZE);
+
+    uint8_t digest[HMAC_SIZE];
+    unsigned int digest_len = sizeof(digest);
+    if (HMAC(EVP_sha256(), key_.data(), static_cast<int>(key_.size()), input, sizeof(input), digest,
+             &digest_len) == nullptr) {
+        throw CryptoException("Failed to compute handshake cookie");
+    }
+    std::memcpy(mac, digest, MAC_SIZE);
+}
+
+} // namespace SecureComm
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "common.h"
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace SecureComm {
+
+// Stateless handshake cookies.
+// Under load the server answers a HANDSHAKE_INIT with a cookie instead of a
+// key exchange, and only runs the key exchange for an init that echoes it.
+// The cookie is an HMAC, under a key only this process knows, of the peer's
+// address, the issue time and the init itself (ids, public key, nonce), so
+// the server keeps nothing per challenged peer and checking one costs a
+// single HMAC. A cookie is good for HANDSHAKE_COOKIE_LIFETIME, only for the
+// same init from the same address, and only once: redeemed cookies are
+// remembered until they would have expired anyway, so one round trip buys
+// one key exchange, not a lifetime's worth of replays.
+//
+// Wire layout (HANDSHAKE_COOKIE_SIZE bytes): issued at (4, LE) | truncated HMAC-SHA256 (16)
+class HandshakeCookies {
+public:
+    HandshakeCookies();
+    ~HandshakeCookies();
+
+    HandshakeCookies(const HandshakeCookies&) = delete;
+    HandshakeCookies& operator=(const HandshakeCookies&) = delete;
+
+    // peer_address is the IPv4 address in network byte order
+    std::vector<uint8_t> issue(uint32_t peer_address, const HandshakeView& init) const;
+    // False if the cookie is malformed, expired, was not issued for this
+    // address and init, or has been redeemed before
+    bool redeem(ByteView cookie, uint32_t peer_address, const HandshakeView& init);
+
+private:
+    // Redeemed cookies remembered at once; past this, cookies are refused
+    // until the oldest expire
+    static constexpr size_t MAX_REDEEMED = 65536;
+
+    struct Redeemed {
+        uint32_t issued_at;
+        uint64_t tag;
+    };
+
+    void compute_mac(uint32_t issued_at, uint32_t peer_address, const HandshakeView& init, uint8_t* mac) const;
+
+    SecureBytes key_;
+
+    // Leading MAC bytes of each redeemed cookie, and the same in redemption order for expiry
+    std::mutex redeemed_mutex_;
+    std::unordered_set<uint64_t> redeemed_;
+    std::deque<Redeemed> redeemed_order_;
+};
+
+} // namespace SecureComm
@@ -0,0 +1,125 @@
+#include "handshake_pool.h"
+#include "logger.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#ifdef __linux__
+    #include <cerrno>
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+namespace SecureComm {
+
+#ifdef __linux__
+namespace {
+
+// CPUs this process may run on (cgroup cpuset, taskset), in ascending order
+std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        SC_LOG_WARN("Handshake pool: cannot read CPU affinity ({}), workers left unpinned", std::strerror(errno));
+        return cpus;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set)) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+} // namespace
+#endif
+
+HandshakePool::HandshakePool(HandshakePoolConfig config) : config_(config), stopping_(false) {
+    size_t count = config_.workers;
+    if (count == 0) {
+        count = std::max<size_t>(1, std::thread::hardware_concurrency() / 2);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        workers_.emplace_back(&HandshakePool::worker_loop, this, i);
+    }
+    SC_LOG_INFO("Handshake pool: {} workers, queue limit {}", count, config_.max_queue);
+}
+
+HandshakePool::~HandshakePool() {
+    stop();
+}
+
+bool HandshakePool::run(std::function<void()> task) {
+    std::future<void> done;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ || queue_.size() >= config_.max_queue) {
+            return false;
+        }
+        queue_.emplace_back(std::move(task));
+        done = queue_.back().get_future();
+    }
+    ready_.notify_one();
+    done.get();
+    return true;
+}
+
+void HandshakePool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+    }
+    // Workers drain what is queued, so no caller is left waiting
+    ready_.notify_all();
+    for (std::thread& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+size_t HandshakePool::queue_depth() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+void HandshakePool::worker_loop(size_t index) {
+#ifdef __linux__
+    if (config_.pin_workers) {
+        std::vector<int> cpus = allowed_cpus();
+        if (cpus.size() > 1) {
+            // One allowed CPU per worker, counting down from the last
+            int cpu = cpus[cpus.size() - 1 - index % cpus.size()];
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+            if (result != 0) {
+                SC_LOG_WARN("Handshake pool: cannot pin worker {} to CPU {} ({})", index, cpu, std::strerror(result));
+            }
+        }
+    }
+#else
+    (void)index;
+#endif
+
+    while (true) {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ready_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;
+            }
+            task = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        task();
+    }
+}
+
+} // namespace SecureComm
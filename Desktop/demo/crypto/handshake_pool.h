@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SecureComm {
+
+struct HandshakePoolConfig {
+    // Crypto workers; 0 = half the hardware threads, at least one
+    size_t workers = 0;
+    // Handshakes allowed to wait for a worker; more are turned away
+    size_t max_queue = 64;
+    // Pin each worker to its own CPU, counting down from the last CPU the
+    // process may run on (Linux)
+    bool pin_workers = true;
+};
+
+// Bounded pool for the CPU-heavy part of full handshakes.
+// Connection threads hand their key generation, exchange and derivation to
+// a fixed set of workers and wait for the result, so however many clients
+// reconnect at once, at most `workers` handshakes compute at a time and
+// the threads serving established sessions keep the rest of the CPU. A
+// handshake that finds the queue full is refused at once rather than
+// queued behind work it would time out waiting for.
+class HandshakePool {
+public:
+    explicit HandshakePool(HandshakePoolConfig config);
+    ~HandshakePool();
+
+    HandshakePool(const HandshakePool&) = delete;
+    HandshakePool& operator=(const HandshakePool&) = delete;
+
+    // Runs task on a worker and waits for it, rethrowing what it throws.
+    // False, without running it, if the queue is full or the pool stopped.
+    bool run(std::function<void()> task);
+    void stop();
+
+    size_t worker_count() const { return workers_.size(); }
+    size_t queue_depth() const;
+
+private:
+    void worker_loop(size_t index);
+
+    HandshakePoolConfig config_;
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<std::packaged_task<void()>> queue_;
+    bool stopping_;
+    std::vector<std::thread> workers_;
+};
+
+} // namespace SecureComm
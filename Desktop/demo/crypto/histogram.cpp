@@ -0,0 +1,94 @@
+#include "histogram.h"
+#include <algorithm>
+#include <cmath>
+
+namespace SecureComm {
+
+LatencyHistogram::LatencyHistogram()
+    : counts_(new std::atomic<uint64_t>[BUCKET_COUNT]), total_(0), sum_(0), min_(UINT64_MAX), max_(0) {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        counts_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+LatencyHistogram::LatencyHistogram(const LatencyHistogram& other) : LatencyHistogram() {
+    merge(other);
+}
+
+LatencyHistogram& LatencyHistogram::operator=(const LatencyHistogram& other) {
+    if (this != &other) {
+        reset();
+        merge(other);
+    }
+    return *this;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    // Bucket by bucket, so the total can briefly disagree with the buckets
+    // while other is being recorded into
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        uint64_t count = other.counts_[i].load(std::memory_order_relaxed);
+        if (count != 0) {
+            counts_[i].fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+    total_.fetch_add(other.total_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    sum_.fetch_add(other.sum_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    uint64_t value = other.max_.load(std::memory_order_relaxed);
+    uint64_t seen = max_.load(std::memory_order_relaxed);
+    while (value > seen && !max_.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+    value = other.min_.load(std::memory_order_relaxed);
+    seen = min_.load(std::memory_order_relaxed);
+    while (value < seen && !min_.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset() {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        counts_[i].store(0, std::memory_order_relaxed);
+    }
+    total_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    min_.store(UINT64_MAX, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::min() const {
+    uint64_t value = min_.load(std::memory_order_relaxed);
+    return value == UINT64_MAX ? 0 : value;
+}
+
+double LatencyHistogram::mean() const {
+    uint64_t total = count();
+    return total == 0 ? 0.0 : static_cast<double>(sum()) / static_cast<double>(total);
+}
+
+uint64_t LatencyHistogram::value_at_percentile(double percentile) const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        total += counts_[i].load(std::memory_order_relaxed);
+    }
+    if (total == 0) {
+        return 0;
+    }
+    double fraction = percentile < 0 ? 0 : (percentile > 100 ? 1 : percentile / 100.0);
+    uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(total))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += counts_[i].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            return std::min(bucket_upper_bound(i), max());
+        }
+    }
+    return max();
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(size_t index) {
+    const size_t half = size_t(1) << (SUB_BUCKET_BITS - 1);
+    unsigned bucket = index < 2 * half ? 0 : static_cast<unsigned>(index / half - 1);
+    uint64_t lowest = static_cast<uint64_t>(index - (static_cast<size_t>(bucket) << (SUB_BUCKET_BITS - 1))) << bucket;
+    return lowest + (uint64_t(1) << bucket) - 1;
+}
+
+} // namespace SecureComm
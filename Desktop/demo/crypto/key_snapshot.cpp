@@ -0,0 +1,395 @@
+#include "key_snapshot.h"
+#include "crypto_utils.h"
+#include "mapped_file.h"
+#include "wire_codec.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+    #include <unistd.h>
+#endif
+
+namespace SecureComm {
+
+namespace {
+
+constexpr char FILE_MAGIC[8] = {'S', 'C', 'K', 'S', 'N', 'A', 'P', '1'};
+constexpr char FOOTER_MAGIC[8] = {'S', 'C', 'K', 'S', 'E', 'N', 'D', '1'};
+constexpr uint32_t FILE_VERSION = 1;
+constexpr size_t FILE_HEADER_SIZE = 32;
+constexpr size_t FOOTER_SIZE = 16;
+constexpr size_t SNAPSHOT_ID_SIZE = 16;
+
+// Chunk frame: kind (1) | reserved (3) | sequence (4) | plaintext size (4) | IV (12),
+// then the ciphertext and the GCM tag. The first 12 bytes are associated data.
+constexpr size_t FRAME_KIND = 0;
+constexpr size_t FRAME_SEQUENCE = 4;
+constexpr size_t FRAME_SIZE = 8;
+constexpr size_t FRAME_IV = 12;
+constexpr size_t FRAME_HEADER_SIZE = FRAME_IV + IV_SIZE;
+constexpr uint8_t CHUNK_DATA = 0x01;
+constexpr uint8_t CHUNK_INDEX = 0x02;
+
+// Entry: key id length (2) | key length (2) | key id | key
+constexpr size_t ENTRY_HEADER_SIZE = 4;
+// Index entry: key id length (2) | chunk (4) | key id
+constexpr size_t INDEX_ENTRY_HEADER_SIZE = 6;
+// Expiration: key id length (2) | expires at, ms since epoch (8) | key id
+constexpr size_t EXPIRATION_HEADER_SIZE = 10;
+// Index chunk: entry count (8) | chunk count (4) | expiration count (4) |
+// chunk offsets (8 each) | index entries | expirations
+constexpr size_t INDEX_HEADER_SIZE = 16;
+
+void sync_file(std::FILE* file) {
+    std::fflush(file);
+#ifdef _WIN32
+    _commit(_fileno(file));
+#else
+    fdatasync(fileno(file));
+#endif
+}
+
+// Streams sealed chunks to a FILE, tracking the write offset
+class ChunkSink {
+public:
+    ChunkSink(std::FILE* file, ByteView key, const uint8_t* file_header)
+        : file_(file), file_header_(file_header), offset_(0), failed_(false) {
+        if (EVP_EncryptInit_ex(ctx_.get(), EVP_aes_256_gcm(), nullptr, key.data(), nullptr) != 1) {
+            throw CryptoException("Failed to initialize key snapshot cipher");
+        }
+    }
+
+    void raw(const uint8_t* data, size_t size) {
+        if (std::fwrite(data, 1, size, file_) != size) {
+            failed_ = true;
+        }
+        offset_ += size;
+    }
+
+    void seal(uint8_t kind, uint32_t sequence, const uint8_t* plaintext, size_t size) {
+        uint8_t frame[FRAME_HEADER_SIZE] = {};
+        frame[FRAME_KIND] = kind;
+        store_le<uint32_t>(frame + FRAME_SEQUENCE, sequence);
+        store_le<uint32_t>(frame + FRAME_SIZE, static_cast<uint32_t>(size));
+        if (RAND_bytes(frame + FRAME_IV, static_cast<int>(IV_SIZE)) != 1) {
+            throw CryptoException("Failed to generate key snapshot IV");
+        }
+
+        sealed_.resize(size + GCM_TAG_SIZE);
+        EVP_CIPHER_CTX* ctx = ctx_.get();
+        int len = 0;
+        int final_len = 0;
+        if (EVP_EncryptInit_ex(ctx, nullptr, nullptr, nullptr, frame + FRAME_IV) != 1 ||
+            EVP_EncryptUpdate(ctx, nullptr, &len, file_header_, static_cast<int>(FILE_HEADER_SIZE)) != 1 ||
+            EVP_EncryptUpdate(ctx, nullptr, &len, frame, static_cast<int>(FRAME_IV)) != 1 ||
+            EVP_EncryptUpdate(ctx, sealed_.data(), &len, plaintext, static_cast<int>(size)) != 1 ||
+            EVP_EncryptFinal_ex(ctx, sealed_.data() + len, &final_len) != 1 ||
+            EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, static_cast<int>(GCM_TAG_SIZE),
+                                sealed_.data() + size) != 1) {
+            throw CryptoException("Failed to seal key snapshot chunk");
+        }
+        raw(frame, sizeof(frame));
+        raw(sealed_.data(), sealed_.size());
+    }
+
+    uint64_t offset() const { return offset_; }
+    bool failed() const { return failed_; }
+
+private:
+    std::FILE* file_;
+    const uint8_t* file_header_;
+    EVPContext ctx_;
+    std::vector<uint8_t> sealed_;
+    uint64_t offset_;
+    bool failed_;
+};
+
+} // namespace
+
+KeySnapshotWriter::KeySnapshotWriter() : entry_count_(0), expiration_count_(0) {}
+
+KeySnapshotWriter::~KeySnapshotWriter() {
+    OPENSSL_cleanse(entries_.data(), entries_.size());
+}
+
+void KeySnapshotWriter::reserve(size_t entry_count) {
+    // Sized for short ids and KEY_SIZE keys; add() still grows past this if needed
+    constexpr size_t TYPICAL_ID_SIZE = 16;
+    entries_.reserve(entry_count * (ENTRY_HEADER_SIZE + TYPICAL_ID_SIZE + KEY_SIZE));
+    index_.reserve(entry_count * (INDEX_ENTRY_HEADER_SIZE + TYPICAL_ID_SIZE));
+}
+
+void KeySnapshotWriter::add(std::string_view key_id, const uint8_t* key, size_t key_size) {
+    if (key_id.size() > UINT16_MAX || key_size > UINT16_MAX) {
+        throw CryptoException("Key too large for snapshot: " + std::string(key_id.substr(0, 64)));
+    }
+
+    // Start a new chunk rather than split an entry across two
+    size_t entry_size = ENTRY_HEADER_SIZE + key_id.size() + key_size;
+    size_t chunk_begin = chunk_ends_.empty() ? 0 : chunk_ends_.back();
+    if (entries_.size() > chunk_begin && entries_.size() - chunk_begin + entry_size > CHUNK_SIZE) {
+        chunk_ends_.push_back(entries_.size());
+    }
+    uint32_t chunk = static_cast<uint32_t>(chunk_ends_.size());
+
+    size_t offset = entries_.size();
+    if (entries_.capacity() < offset + entry_size) {
+        // Grow by hand so the old buffer is wiped rather than freed with keys in it
+        std::vector<uint8_t> grown;
+        grown.reserve(std::max(offset + entry_size, entries_.capacity() * 2));
+        grown.assign(entries_.begin(), entries_.end());
+        OPENSSL_cleanse(entries_.data(), entries_.size());
+        entries_.swap(grown);
+    }
+    entries_.resize(offset + entry_size);
+    uint8_t* out = entries_.data() + offset;
+    store_le<uint16_t>(out, static_cast<uint16_t>(key_id.size()));
+    store_le<uint16_t>(out + 2, static_cast<uint16_t>(key_size));
+    std::memcpy(out + ENTRY_HEADER_SIZE, key_id.data(), key_id.size());
+    if (key_size > 0) {
+        std::memcpy(out + ENTRY_HEADER_SIZE + key_id.size(), key, key_size);
+    }
+
+    size_t index_offset = index_.size();
+    index_.resize(index_offset + INDEX_ENTRY_HEADER_SIZE + key_id.size());
+    uint8_t* index_out = index_.data() + index_offset;
+    store_le<uint16_t>(index_out, static_cast<uint16_t>(key_id.size()));
+    store_le<uint32_t>(index_out + 2, chunk);
+    std::memcpy(index_out + INDEX_ENTRY_HEADER_SIZE, key_id.data(), key_id.size());
+
+    entry_count_++;
+}
+
+void KeySnapshotWriter::add_expiration(std::string_view key_id, uint64_t expires_at_ms) {
+    if (key_id.size() > UINT16_MAX) {
+        throw CryptoException("Key id too large for snapshot: " + std::string(key_id.substr(0, 64)));
+    }
+    size_t offset = expirations_.size();
+    expirations_.resize(offset + EXPIRATION_HEADER_SIZE + key_id.size());
+    uint8_t* out = expirations_.data() + offset;
+    store_le<uint16_t>(out, static_cast<uint16_t>(key_id.size()));
+    store_le<uint64_t>(out + 2, expires_at_ms);
+    std::memcpy(out + EXPIRATION_HEADER_SIZE, key_id.data(), key_id.size());
+    expiration_count_++;
+}
+
+void KeySnapshotWriter::write(const std::string& path, ByteView snapshot_key) {
+    if (snapshot_key.size() != KEY_SIZE) {
+        throw CryptoException("Key snapshot key must be " + std::to_string(KEY_SIZE) + " bytes");
+    }
+    if (entries_.size() > (chunk_ends_.empty() ? 0 : chunk_ends_.back())) {
+        chunk_ends_.push_back(entries_.size());
+    }
+
+    uint8_t header[FILE_HEADER_SIZE] = {};
+    std::memcpy(header, FILE_MAGIC, sizeof(FILE_MAGIC));
+    store_le<uint32_t>(header + 8, FILE_VERSION);
+    store_le<uint32_t>(header + 12, static_cast<uint32_t>(CHUNK_SIZE));
+    if (RAND_bytes(header + 16, static_cast<int>(SNAPSHOT_ID_SIZE)) != 1) {
+        throw CryptoException("Failed to generate key snapshot id");
+    }
+
+    std::string temp_path = path + ".tmp";
+    std::FILE* file = std::fopen(temp_path.c_str(), "wb");
+    if (!file) {
+        throw CryptoException("Failed to create key snapshot: " + temp_path);
+    }
+    std::vector<char> io_buffer(1 << 20);
+    std::setvbuf(file, io_buffer.data(), _IOFBF, io_buffer.size());
+
+    bool write_ok = false;
+    try {
+        ChunkSink sink(file, snapshot_key, header);
+        sink.raw(header, sizeof(header));
+
+        std::vector<uint8_t> index(INDEX_HEADER_SIZE + 8 * chunk_ends_.size());
+        store_le<uint64_t>(index.data(), entry_count_);
+        store_le<uint32_t>(index.data() + 8, static_cast<uint32_t>(chunk_ends_.size()));
+        store_le<uint32_t>(index.data() + 12, static_cast<uint32_t>(expiration_count_));
+        size_t begin = 0;
+        for (size_t chunk = 0; chunk < chunk_ends_.size(); ++chunk) {
+            store_le<uint64_t>(index.data() + INDEX_HEADER_SIZE + 8 * chunk, sink.offset());
+            sink.seal(CHUNK_DATA, static_cast<uint32_t>(chunk), entries_.data() + begin, chunk_ends_[chunk] - begin);
+            begin = chunk_ends_[chunk];
+        }
+        index.insert(index.end(), index_.begin(), index_.end());
+        index.insert(index.end(), expirations_.begin(), expirations_.end());
+
+        uint8_t footer[FOOTER_SIZE];
+        store_le<uint64_t>(footer, sink.offset());
+        std::memcpy(footer + 8, FOOTER_MAGIC, sizeof(FOOTER_MAGIC));
+        sink.seal(CHUNK_INDEX, static_cast<uint32_t>(chunk_ends_.size()), index.data(), index.size());
+        sink.raw(footer, sizeof(footer));
+
+        sync_file(file);
+        write_ok = !sink.failed() && !std::ferror(file);
+    } catch (...) {
+        std::fclose(file);
+        std::remove(temp_path.c_str());
+        throw;
+    }
+    std::fclose(file);
+    if (!write_ok) {
+        std::remove(temp_path.c_str());
+        throw CryptoException("Failed to write key snapshot: " + temp_path);
+    }
+
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+    // rename() is atomic, so a crash leaves either the old or the new snapshot
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        throw CryptoException("Failed to replace key snapshot: " + path);
+    }
+}
+
+KeySnapshotReader::KeySnapshotReader(const std::string& path, ByteView snapshot_key)
+    : path_(path),
+      file_(std::make_unique<MappedFile>(path, MappedFile::Access::RANDOM)),
+      open_ctx_(std::make_unique<EVPContext>()) {
+    if (snapshot_key.size() != KEY_SIZE) {
+        throw CryptoException("Key snapshot key must be " + std::to_string(KEY_SIZE) + " bytes");
+    }
+    if (EVP_DecryptInit_ex(open_ctx_->get(), EVP_aes_256_gcm(), nullptr, snapshot_key.data(), nullptr) != 1) {
+        throw CryptoException("Failed to initialize key snapshot cipher");
+    }
+
+    const uint8_t* data = file_->data();
+    size_t size = file_->size();
+    if (!data) {
+        throw CryptoException("Failed to open key snapshot: " + path_);
+    }
+    if (size < FILE_HEADER_SIZE + FOOTER_SIZE ||
+        std::memcmp(data, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 ||
+        std::memcmp(data + size - sizeof(FOOTER_MAGIC), FOOTER_MAGIC, sizeof(FOOTER_MAGIC)) != 0) {
+        throw CryptoException("Unrecognized or truncated key snapshot: " + path_);
+    }
+    if (load_le<uint32_t>(data + 8) != FILE_VERSION) {
+        throw CryptoException("Unsupported key snapshot version " + std::to_string(load_le<uint32_t>(data + 8)) +
+                              ": " + path_);
+    }
+
+    uint32_t index_sequence = 0;
+    std::vector<uint8_t> index = open_chunk(load_le<uint64_t>(data + size - FOOTER_SIZE), CHUNK_INDEX, index_sequence);
+    auto corrupt = [this]() { return CryptoException("Corrupt key snapshot index: " + path_); };
+    if (index.size() < INDEX_HEADER_SIZE) {
+        throw corrupt();
+    }
+
+    uint64_t entry_count = load_le<uint64_t>(index.data());
+    uint32_t chunk_count = load_le<uint32_t>(index.data() + 8);
+    uint32_t expiration_count = load_le<uint32_t>(index.data() + 12);
+    if (chunk_count != index_sequence || (index.size() - INDEX_HEADER_SIZE) / 8 < chunk_count) {
+        throw corrupt();
+    }
+    chunk_offsets_.resize(chunk_count);
+    for (uint32_t chunk = 0; chunk < chunk_count; ++chunk) {
+        chunk_offsets_[chunk] = load_le<uint64_t>(index.data() + INDEX_HEADER_SIZE + 8 * chunk);
+    }
+
+    size_t offset = INDEX_HEADER_SIZE + 8 * static_cast<size_t>(chunk_count);
+    index_.reserve(static_cast<size_t>(std::min<uint64_t>(entry_count, index.size() / INDEX_ENTRY_HEADER_SIZE)));
+    while (index_.size() < entry_count) {
+        if (index.size() - offset < INDEX_ENTRY_HEADER_SIZE) {
+            throw corrupt();
+        }
+        const uint8_t* in = index.data() + offset;
+        size_t id_size = load_le<uint16_t>(in);
+        if (index.size() - offset - INDEX_ENTRY_HEADER_SIZE < id_size || load_le<uint32_t>(in + 2) >= chunk_count) {
+            throw corrupt();
+        }
+        index_.push_back({std::string(reinterpret_cast<const char*>(in + INDEX_ENTRY_HEADER_SIZE), id_size),
+                          load_le<uint32_t>(in + 2)});
+        offset += INDEX_ENTRY_HEADER_SIZE + id_size;
+    }
+
+    expirations_.reserve(std::min<size_t>(expiration_count, index.size() / EXPIRATION_HEADER_SIZE));
+    while (expirations_.size() < expiration_count) {
+        if (index.size() - offset < EXPIRATION_HEADER_SIZE) {
+            throw corrupt();
+        }
+        const uint8_t* in = index.data() + offset;
+        size_t id_size = load_le<uint16_t>(in);
+        if (index.size() - offset - EXPIRATION_HEADER_SIZE < id_size) {
+            throw corrupt();
+        }
+        expirations_.push_back({std::string(reinterpret_cast<const char*>(in + EXPIRATION_HEADER_SIZE), id_size),
+                                load_le<uint64_t>(in + 2)});
+        offset += EXPIRATION_HEADER_SIZE + id_size;
+    }
+    if (offset != index.size()) {
+        throw corrupt();
+    }
+}
+
+KeySnapshotReader::~KeySnapshotReader() = default;
+
+std::vector<KeySnapshotReader::Entry> KeySnapshotReader::load_chunk(uint32_t chunk) {
+    if (chunk >= chunk_offsets_.size()) {
+        throw CryptoException("Key snapshot chunk out of range: " + std::to_string(chunk));
+    }
+
+    uint32_t sequence = 0;
+    std::vector<uint8_t> plaintext = open_chunk(chunk_offsets_[chunk], CHUNK_DATA, sequence);
+    if (sequence != chunk) {
+        OPENSSL_cleanse(plaintext.data(), plaintext.size());
+        throw CryptoException("Key snapshot chunk out of order: " + path_);
+    }
+
+    std::vector<Entry> entries;
+    size_t offset = 0;
+    while (offset + ENTRY_HEADER_SIZE <= plaintext.size()) {
+        const uint8_t* in = plaintext.data() + offset;
+        size_t id_size = load_le<uint16_t>(in);
+        size_t key_size = load_le<uint16_t>(in + 2);
+        if (plaintext.size() - offset - ENTRY_HEADER_SIZE < id_size + key_size) {
+            break;
+        }
+        const uint8_t* key = in + ENTRY_HEADER_SIZE + id_size;
+        entries.push_back({std::string(reinterpret_cast<const char*>(in + ENTRY_HEADER_SIZE), id_size),
+                           std::vector<uint8_t>(key, key + key_size)});
+        offset += ENTRY_HEADER_SIZE + id_size + key_size;
+    }
+    bool complete = offset == plaintext.size();
+    OPENSSL_cleanse(plaintext.data(), plaintext.size());
+    if (!complete) {
+        throw CryptoException("Corrupt key snapshot chunk " + std::to_string(chunk) + ": " + path_);
+    }
+    return entries;
+}
+
+std::vector<uint8_t> KeySnapshotReader::open_chunk(uint64_t offset, uint8_t kind, uint32_t& sequence) {
+    const uint8_t* data = file_->data();
+    size_t end = file_->size() - FOOTER_SIZE;
+    if (offset < FILE_HEADER_SIZE || offset > end || end - offset < FRAME_HEADER_SIZE + GCM_TAG_SIZE) {
+        throw CryptoException("Key snapshot chunk outside the file: " + path_);
+    }
+    const uint8_t* frame = data + offset;
+    size_t size = load_le<uint32_t>(frame + FRAME_SIZE);
+    if (frame[FRAME_KIND] != kind || end - offset - FRAME_HEADER_SIZE - GCM_TAG_SIZE < size) {
+        throw CryptoException("Malformed key snapshot chunk: " + path_);
+    }
+    sequence = load_le<uint32_t>(frame + FRAME_SEQUENCE);
+
+    const uint8_t* sealed = frame + FRAME_HEADER_SIZE;
+    uint8_t tag[GCM_TAG_SIZE];
+    std::memcpy(tag, sealed + size, GCM_TAG_SIZE);
+    std::vector<uint8_t> plaintext(size);
+    EVP_CIPHER_CTX* ctx = open_ctx_->get();
+    int len = 0;
+    int final_len = 0;
+    if (EVP_DecryptInit_ex(ctx, nullptr, nullptr, nullptr, frame + FRAME_IV) != 1 ||
+        EVP_DecryptUpdate(ctx, nullptr, &len, data, static_cast<int>(FILE_HEADER_SIZE)) != 1 ||
+        EVP_DecryptUpdate(ctx, nullptr, &len, frame, static_cast<int>(FRAME_IV)) != 1 ||
+        EVP_DecryptUpdate(ctx, plaintext.data(), &len, sealed, static_cast<int>(size)) != 1 ||
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, static_cast<int>(GCM_TAG_SIZE), tag) != 1 ||
+        EVP_DecryptFinal_ex(ctx, plaintext.data() + len, &final_len) != 1) {
+        OPENSSL_cleanse(plaintext.data(), plaintext.size());
+        throw CryptoException("Key snapshot chunk failed authentication: " + path_);
+    }
+    return plaintext;
+}
+
+} // namespace SecureComm
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "common.h"
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace SecureComm {
+
+class EVPContext;
+class MappedFile;
+
+// Versioned, encrypted KeyManager snapshot.
+// The file is a 32-byte header (magic, version, chunk size, random snapshot
+// id), a stream of data chunks, one index chunk and a 16-byte footer that
+// points at the index. Every chunk is sealed on its own with AES-256-GCM
+// under the snapshot key; its kind, sequence number and size plus the file
+// header are associated data, so chunks cannot be reordered, dropped or
+// spliced in from another snapshot. The index maps each key id to the
+// chunk holding it, which lets a restore open only the index up front and
+// decrypt data chunks as their keys are first asked for.
+class KeySnapshotWriter {
+public:
+    // Plaintext bytes per data chunk
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    KeySnapshotWriter();
+    ~KeySnapshotWriter();
+
+    KeySnapshotWriter(const KeySnapshotWriter&) = delete;
+    KeySnapshotWriter& operator=(const KeySnapshotWriter&) = delete;
+
+    // Copy one key or expiration into the snapshot (no encryption or I/O;
+    // cheap enough to run under the owner's lock). Expirations are kept in
+    // their own index section so keys without one cost nothing extra.
+    void add(std::string_view key_id, const uint8_t* key, size_t key_size);
+    void add_expiration(std::string_view key_id, uint64_t expires_at_ms);
+
+    // Size the copy buffers up front for about this many keys
+    void reserve(size_t entry_count);
+
+    // Seal and stream everything added so far to path (temp file + rename)
+    void write(const std::string& path, ByteView snapshot_key);
+
+    size_t entry_count() const { return entry_count_; }
+
+private:
+    // Serialized entries; chunk i covers [chunk_ends_[i-1], chunk_ends_[i])
+    std::vector<uint8_t> entries_;
+    std::vector<size_t> chunk_ends_;
+    std::vector<uint8_t> index_;
+    std::vector<uint8_t> expirations_;
+    size_t entry_count_;
+    size_t expiration_count_;
+};
+
+class KeySnapshotReader {
+public:
+    struct IndexEntry {
+        std::string key_id;
+        uint32_t chunk;
+    };
+
+    struct Expiration {
+        std::string key_id;
+        uint64_t expires_at_ms;
+    };
+
+    struct Entry {
+        std::string key_id;
+        std::vector<uint8_t> key;
+    };
+
+    // Maps the file and authenticates the header and index (throws CryptoException)
+    KeySnapshotReader(const std::string& path, ByteView snapshot_key);
+    ~KeySnapshotReader();
+
+    KeySnapshotReader(const KeySnapshotReader&) = delete;
+    KeySnapshotReader& operator=(const KeySnapshotReader&) = delete;
+
+    const std::vector<IndexEntry>& index() const { return index_; }
+    const std::vector<Expiration>& expirations() const { return expirations_; }
+    size_t chunk_count() const { return chunk_offsets_.size(); }
+
+    // Decrypt one data chunk (throws CryptoException if it fails authentication)
+    std::vector<Entry> load_chunk(uint32_t chunk);
+
+private:
+    // Authenticate and decrypt the chunk at offset; sequence is read from its frame
+    std::vector<uint8_t> open_chunk(uint64_t offset, uint8_t kind, uint32_t& sequence);
+
+    std::string path_;
+    std::unique_ptr<MappedFile> file_;
+    std::unique_ptr<EVPContext> open_ctx_;
+    std::vector<uint64_t> chunk_offsets_;
+    std::vector<IndexEntry> index_;
+    std::vector<Expiration> expirations_;
+};
+
+} // namespace SecureComm
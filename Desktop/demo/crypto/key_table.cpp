@@ -0,0 +1,221 @@
+#include "key_table.h"
+#include <cstring>
+#include <functional>
+#include <new>
+#include <thread>
+
+namespace SecureComm {
+
+// RcuDomain implementation
+RcuDomain::RcuDomain() : phase_(0) {
+    for (Slot& slot : slots_) {
+        slot.readers[0].store(0, std::memory_order_relaxed);
+        slot.readers[1].store(0, std::memory_order_relaxed);
+    }
+}
+
+void RcuDomain::synchronize() {
+    std::lock_guard<std::mutex> lock(synchronize_mutex_);
+    // Pairs with the reader's increment: whatever was unpublished before this
+    // point is invisible to readers whose increment we do not see below
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    // Two flips: a reader that read the phase before a previous flip may have
+    // counted itself on either side
+    for (int round = 0; round < 2; ++round) {
+        uint32_t old_phase = phase_.load(std::memory_order_relaxed);
+        phase_.store(old_phase ^ 1, std::memory_order_seq_cst);
+        for (Slot& slot : slots_) {
+            while (slot.readers[old_phase].load(std::memory_order_acquire) != 0) {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
+
+// ConcurrentKeyTable implementation
+namespace {
+const KeyNode TOMBSTONE_NODE{0, 0, 0};
+}
+
+ConcurrentKeyTable::Table::Table(size_t capacity)
+    : mask(capacity - 1), slots(new std::atomic<const KeyNode*>[capacity]) {
+    for (size_t i = 0; i < capacity; ++i) {
+        slots[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+ConcurrentKeyTable::ConcurrentKeyTable()
+    : table_(new Table(MIN_CAPACITY)), size_(0), tombstones_(0) {}
+
+ConcurrentKeyTable::~ConcurrentKeyTable() {
+    Table* table = table_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i <= table->mask; ++i) {
+        const KeyNode* node = table->slots[i].load(std::memory_order_relaxed);
+        if (node && node != tombstone()) {
+            destroy_node(node);
+        }
+    }
+    delete table;
+}
+
+const KeyNode* ConcurrentKeyTable::tombstone() {
+    return &TOMBSTONE_NODE;
+}
+
+uint64_t ConcurrentKeyTable::hash(std::string_view key_id) {
+    return static_cast<uint64_t>(std::hash<std::string_view>()(key_id));
+}
+
+const KeyNode* ConcurrentKeyTable::make_node(std::string_view key_id, uint64_t hash,
+                                             const uint8_t* key, size_t key_size) {
+    // Nodes hold key bytes, so they live in the secure arena
+    void* memory = SecureArena::instance().allocate(sizeof(KeyNode) + key_size + key_id.size());
+    KeyNode* node = new (memory) KeyNode{hash, static_cast<uint32_t>(key_id.size()), static_cast<uint32_t>(key_size)};
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(node + 1);
+    if (key_size > 0) {
+        std::memcpy(bytes, key, key_size);
+    }
+    std::memcpy(bytes + key_size, key_id.data(), key_id.size());
+    return node;
+}
+
+void ConcurrentKeyTable::destroy_node(const KeyNode* node) {
+    KeyNode* owned = const_cast<KeyNode*>(node);
+    size_t size = sizeof(KeyNode) + owned->key_size + owned->id_size;
+    owned->~KeyNode();
+    // The arena zeroizes the slot
+    SecureArena::instance().deallocate(owned, size);
+}
+
+const KeyNode* ConcurrentKeyTable::find(std::string_view key_id) const {
+    uint64_t key_hash = hash(key_id);
+    const Table* table = table_.load(std::memory_order_acquire);
+    for (size_t i = key_hash & table->mask;; i = (i + 1) & table->mask) {
+        const KeyNode* node = table->slots[i].load(std::memory_order_acquire);
+        if (!node) {
+            return nullptr;
+        }
+        if (node != tombstone() && node->hash == key_hash && node->key_id() == key_id) {
+            return node;
+        }
+    }
+}
+
+size_t ConcurrentKeyTable::probe(const Table& table, std::string_view key_id, uint64_t key_hash,
+                                 bool& found) const {
+    size_t first_free = table.mask + 1;
+    for (size_t i = key_hash & table.mask;; i = (i + 1) & table.mask) {
+        const KeyNode* node = table.slots[i].load(std::memory_order_relaxed);
+        if (!node) {
+            found = false;
+            return first_free <= table.mask ? first_free : i;
+        }
+        if (node == tombstone()) {
+            if (first_free > table.mask) {
+                first_free = i;
+            }
+        } else if (node->hash == key_hash && node->key_id() == key_id) {
+            found = true;
+            return i;
+        }
+    }
+}
+
+bool ConcurrentKeyTable::insert_or_assign(std::string_view key_id, const uint8_t* key, size_t key_size) {
+    uint64_t key_hash = hash(key_id);
+    const KeyNode* fresh = make_node(key_id, key_hash, key, key_size);
+
+    std::unique_lock<std::mutex> lock(write_mutex_);
+    Table* table = table_.load(std::memory_order_relaxed);
+    // Keep at least half the slots empty (tombstones count as used) so probes stay short
+    size_t size = size_.load(std::memory_order_relaxed);
+    if ((size + tombstones_ + 1) * 2 > table->mask + 1) {
+        size_t capacity = MIN_CAPACITY;
+        while (capacity < (size + 1) * 4) {
+            capacity *= 2;
+        }
+        rehash(capacity);
+        table = table_.load(std::memory_order_relaxed);
+    }
+
+    bool found = false;
+    size_t slot = probe(*table, key_id, key_hash, found);
+    const KeyNode* replaced = table->slots[slot].load(std::memory_order_relaxed);
+    table->slots[slot].store(fresh, std::memory_order_release);
+    if (!found) {
+        if (replaced == tombstone()) {
+            tombstones_--;
+        }
+        size_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    lock.unlock();
+
+    // Readers may still hold the old node
+    domain_.synchronize();
+    destroy_node(replaced);
+    return false;
+}
+
+bool ConcurrentKeyTable::erase(std::string_view key_id) {
+    uint64_t key_hash = hash(key_id);
+
+    std::unique_lock<std::mutex> lock(write_mutex_);
+    Table* table = table_.load(std::memory_order_relaxed);
+    bool found = false;
+    size_t slot = probe(*table, key_id, key_hash, found);
+    if (!found) {
+        return false;
+    }
+    const KeyNode* removed = table->slots[slot].load(std::memory_order_relaxed);
+    table->slots[slot].store(tombstone(), std::memory_order_release);
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    tombstones_++;
+    lock.unlock();
+
+    domain_.synchronize();
+    destroy_node(removed);
+    return true;
+}
+
+void ConcurrentKeyTable::clear() {
+    std::unique_lock<std::mutex> lock(write_mutex_);
+    Table* old_table = table_.exchange(new Table(MIN_CAPACITY), std::memory_order_acq_rel);
+    size_.store(0, std::memory_order_relaxed);
+    tombstones_ = 0;
+    lock.unlock();
+
+    domain_.synchronize();
+    for (size_t i = 0; i <= old_table->mask; ++i) {
+        const KeyNode* node = old_table->slots[i].load(std::memory_order_relaxed);
+        if (node && node != tombstone()) {
+            destroy_node(node);
+        }
+    }
+    delete old_table;
+}
+
+void ConcurrentKeyTable::rehash(size_t capacity) {
+    Table* old_table = table_.load(std::memory_order_relaxed);
+    Table* new_table = new Table(capacity);
+    for (size_t i = 0; i <= old_table->mask; ++i) {
+        const KeyNode* node = old_table->slots[i].load(std::memory_order_relaxed);
+        if (!node || node == tombstone()) {
+            continue;
+        }
+        size_t slot = node->hash & new_table->mask;
+        while (new_table->slots[slot].load(std::memory_order_relaxed)) {
+            slot = (slot + 1) & new_table->mask;
+        }
+        new_table->slots[slot].store(node, std::memory_order_relaxed);
+    }
+    table_.store(new_table, std::memory_order_release);
+    tombstones_ = 0;
+
+    // Nodes moved to the new array; only the old array is freed
+    domain_.synchronize();
+    delete old_table;
+}
+
+} // namespace SecureComm
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "common.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string_view>
+
+namespace SecureComm {
+
+// Read-copy-update domain for read-mostly structures.
+// A reader bumps a counter in one of SLOT_COUNT cache-line slots (picked
+// once per thread), so readers on different threads never write the same
+// line and never wait. Writers publish new data first and then call
+// synchronize(), which flips the reader phase twice and waits for the
+// counters of each old phase to drain; afterwards no reader can still see
+// what was unpublished, and it can be freed.
+class RcuDomain {
+public:
+    static constexpr size_t SLOT_COUNT = 64;
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    class ReadGuard {
+    public:
+        explicit ReadGuard(const RcuDomain& domain);
+        ~ReadGuard() { release(); }
+        ReadGuard(ReadGuard&& other) noexcept : counter_(other.counter_) { other.counter_ = nullptr; }
+        ReadGuard& operator=(ReadGuard&& other) noexcept;
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+    private:
+        void release() {
+            if (counter_) {
+                counter_->fetch_sub(1, std::memory_order_release);
+                counter_ = nullptr;
+            }
+        }
+
+        std::atomic<uint32_t>* counter_;
+    };
+
+    RcuDomain();
+
+    // Waits for every reader that started before the call; must not be
+    // called by a thread that holds a ReadGuard on this domain
+    void synchronize();
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Slot {
+        std::atomic<uint32_t> readers[2];
+    };
+
+    static size_t thread_slot();
+
+    mutable std::array<Slot, SLOT_COUNT> slots_;
+    std::atomic<uint32_t> phase_;
+    std::mutex synchronize_mutex_;
+};
+
+inline RcuDomain::ReadGuard::ReadGuard(const RcuDomain& domain) {
+    uint32_t phase = domain.phase_.load(std::memory_order_relaxed);
+    counter_ = &domain.slots_[thread_slot()].readers[phase];
+    // Full barrier: the increment is visible before any published pointer is read
+    counter_->fetch_add(1, std::memory_order_seq_cst);
+}
+
+inline RcuDomain::ReadGuard& RcuDomain::ReadGuard::operator=(ReadGuard&& other) noexcept {
+    if (this != &other) {
+        release();
+        counter_ = other.counter_;
+        other.counter_ = nullptr;
+    }
+    return *this;
+}
+
+inline size_t RcuDomain::thread_slot() {
+    static std::atomic<size_t> next_slot{0};
+    static thread_local size_t slot = next_slot.fetch_add(1, std::memory_order_relaxed) % SLOT_COUNT;
+    return slot;
+}
+
+// Immutable key entry: header, then the key bytes, then the key id bytes,
+// in one SecureArena allocation. Replacing a key publishes a new node.
+struct KeyNode {
+    uint64_t hash;
+    uint32_t id_size;
+    uint32_t key_size;
+
+    const uint8_t* key() const { return reinterpret_cast<const uint8_t*>(this + 1); }
+    std::string_view key_id() const {
+        return std::string_view(reinterpret_cast<const char*>(key() + key_size), id_size);
+    }
+};
+
+// Concurrent key-id -> key map for KeyManager.
+// Lookups take a string_view (no std::string is built) and run without
+// locks inside a ReadGuard: they walk an open-addressing array of node
+// pointers with acquire loads. Writers are serialized by a mutex, replace
+// whole nodes (or the whole array when it grows) and free what they
+// replaced only after a grace period. Erased slots become tombstones so a
+// concurrent probe never misses a key that moved; they are dropped at the
+// next rehash.
+class ConcurrentKeyTable {
+public:
+    using ReadGuard = RcuDomain::ReadGuard;
+
+    static constexpr size_t MIN_CAPACITY = 64;
+
+    ConcurrentKeyTable();
+    ~ConcurrentKeyTable();
+
+    ConcurrentKeyTable(const ConcurrentKeyTable&) = delete;
+    ConcurrentKeyTable& operator=(const ConcurrentKeyTable&) = delete;
+
+    ReadGuard read() const { return ReadGuard(domain_); }
+    // Caller must hold a ReadGuard for as long as it uses the node
+    const KeyNode* find(std::string_view key_id) const;
+
+    // Inserts or replaces; returns true if the id was not present
+    bool insert_or_assign(std::string_view key_id, const uint8_t* key, size_t key_size);
+    bool erase(std::string_view key_id);
+    void clear();
+
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+    // fn(const KeyNode&) for every key, with writers held off
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        const Table* table = table_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i <= table->mask; ++i) {
+            const KeyNode* node = table->slots[i].load(std::memory_order_relaxed);
+            if (node && node != tombstone()) {
+                fn(*node);
+            }
+        }
+    }
+
+private:
+    struct Table {
+        explicit Table(size_t capacity);
+        size_t mask;
+        std::unique_ptr<std::atomic<const KeyNode*>[]> slots;
+    };
+
+    static const KeyNode* tombstone();
+    static uint64_t hash(std::string_view key_id);
+    static const KeyNode* make_node(std::string_view key_id, uint64_t hash, const uint8_t* key, size_t key_size);
+    static void destroy_node(const KeyNode* node);
+
+    // Index of the slot holding key_id, or of the first free slot on its probe path
+    size_t probe(const Table& table, std::string_view key_id, uint64_t hash, bool& found) const;
+    void rehash(size_t capacity);
+
+    mutable RcuDomain domain_;
+    std::atomic<Table*> table_;
+    std::atomic<size_t> size_;
+    size_t tombstones_;
+    mutable std::mutex write_mutex_;
+};
+
+} // namespace SecureComm
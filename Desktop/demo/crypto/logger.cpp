@@ -0,0 +1,290 @@
+#include "logger.h"
+#include <algorithm>
+#include <ctime>
+
+namespace SecureComm {
+
+namespace {
+
+// How long the writer sleeps when every ring was empty
+constexpr std::chrono::milliseconds IDLE_WAIT(1);
+
+const char* level_name(LogLevel level) {
+    switch (level) {
+        case LogLevel::DEBUG: return "DEBUG";
+        case LogLevel::INFO: return "INFO ";
+        case LogLevel::WARN: return "WARN ";
+        case LogLevel::ERR: return "ERROR";
+        default: return "?    ";
+    }
+}
+
+void write_all(FILE* stream, std::string& text) {
+    if (!text.empty()) {
+        std::fwrite(text.data(), 1, text.size(), stream);
+        std::fflush(stream);
+        text.clear();
+    }
+}
+
+// Drains whatever is still queued when the process exits normally
+struct ExitFlush {
+    ~ExitFlush() { Logger::instance().stop(); }
+} exit_flush;
+
+} // namespace
+
+Logger& Logger::instance() {
+    // Deliberately leaked: threads may still log while statics are destroyed
+    static Logger* logger = new Logger();
+    return *logger;
+}
+
+Logger::Logger()
+    : output_(nullptr), running_(true), passes_(0), written_(0), reported_drops_(0), retired_drops_(0),
+      cached_second_(-1), cached_time_() {}
+
+Logger::RingHandle::~RingHandle() {
+    ring->closed.store(true, std::memory_order_release);
+}
+
+Logger::Ring& Logger::register_thread() {
+    thread_local RingHandle handle{[]() {
+        auto ring = std::make_shared<Ring>();
+        instance().register_ring(ring);
+        return ring;
+    }()};
+    return *handle.ring;
+}
+
+Logger::Record* Logger::begin_record(Ring& ring) {
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= RING_CAPACITY) {
+        ring.dropped.store(ring.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    return &ring.records[head % RING_CAPACITY];
+}
+
+void Logger::put(Record& record, ArgType type, const void* data, size_t size) {
+    // Tag byte, then the value; strings carry a 2-byte length and are cut to fit
+    size_t space = sizeof(record.args) - record.arg_bytes;
+    size_t prefix = type == ARG_STRING ? 3 : 1;
+    if (space < prefix || (type != ARG_STRING && space < prefix + size)) {
+        return;
+    }
+    if (type == ARG_STRING) {
+        size = std::min(size, space - prefix);
+        uint16_t length = static_cast<uint16_t>(size);
+        std::memcpy(record.args + record.arg_bytes + 1, &length, sizeof(length));
+    }
+    uint8_t* out = record.args + record.arg_bytes;
+    out[0] = type;
+    std::memcpy(out + prefix, data, size);
+    record.arg_bytes = static_cast<uint16_t>(record.arg_bytes + prefix + size);
+    record.arg_count++;
+}
+
+void Logger::register_ring(const std::shared_ptr<Ring>& ring) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rings_.push_back(ring);
+    if (running_ && !writer_.joinable()) {
+        writer_ = std::thread(&Logger::writer_loop, this);
+    }
+}
+
+void Logger::writer_loop() {
+    std::string out;
+    std::string err;
+    while (true) {
+        bool running;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running = running_;
+        }
+        // A stop request still gets one last pass
+        clock_.refine();
+        size_t written = drain(out, err);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            passes_++;
+        }
+        flushed_.notify_all();
+        if (!running) {
+            break;
+        }
+        if (written == 0) {
+            std::this_thread::sleep_for(IDLE_WAIT);
+        }
+    }
+}
+
+size_t Logger::drain(std::string& out, std::string& err) {
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rings = rings_;
+    }
+
+    size_t written = 0;
+    FILE* output = nullptr;
+    std::vector<Ring*> finished;
+    for (const std::shared_ptr<Ring>& ring : rings) {
+        // Read closed first: a closed ring gets no records after its head
+        bool closed = ring->closed.load(std::memory_order_acquire);
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        for (; tail != head; ++tail) {
+            const Record& record = ring->records[tail % RING_CAPACITY];
+            format_record(record, record.level >= LogLevel::WARN ? err : out);
+            written++;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+        if (closed) {
+            finished.push_back(ring.get());
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (Ring* ring : finished) {
+            for (auto it = rings_.begin(); it != rings_.end(); ++it) {
+                if (it->get() == ring) {
+                    retired_drops_ += ring->dropped.load(std::memory_order_relaxed);
+                    rings_.erase(it);
+                    break;
+                }
+            }
+        }
+        written_ += written;
+        uint64_t dropped = retired_drops_;
+        for (const std::shared_ptr<Ring>& ring : rings_) {
+            dropped += ring->dropped.load(std::memory_order_relaxed);
+        }
+        if (dropped > reported_drops_) {
+            err += "Logger: dropped " + std::to_string(dropped - reported_drops_) + " records (ring full)\n";
+            reported_drops_ = dropped;
+        }
+        output = output_;
+    }
+    write_all(output ? output : stdout, out);
+    write_all(output ? output : stderr, err);
+    return written;
+}
+
+void Logger::format_record(const Record& record, std::string& line) {
+    int64_t wall_ns = clock_.wall_ns(record.ticks);
+    int64_t second = wall_ns / 1000000000;
+    if (second != cached_second_) {
+        std::time_t seconds = static_cast<std::time_t>(second);
+        std::tm local{};
+#ifdef _WIN32
+        localtime_s(&local, &seconds);
+#else
+        localtime_r(&seconds, &local);
+#endif
+        std::strftime(cached_time_, sizeof(cached_time_), "%Y-%m-%d %H:%M:%S", &local);
+        cached_second_ = second;
+    }
+    char prefix[48];
+    std::snprintf(prefix, sizeof(prefix), "%s.%03d %s ", cached_time_,
+                  static_cast<int>((wall_ns / 1000000) % 1000), level_name(record.level));
+    line += prefix;
+
+    const uint8_t* arg = record.args;
+    const uint8_t* end = record.args + record.arg_bytes;
+    for (const char* p = record.format; *p; ++p) {
+        if (p[0] != '{' || p[1] != '}') {
+            line += *p;
+            continue;
+        }
+        ++p;
+        if (arg >= end) {
+            line += "{}";
+            continue;
+        }
+        switch (static_cast<ArgType>(*arg)) {
+            case ARG_INT: {
+                int64_t value;
+                std::memcpy(&value, arg + 1, sizeof(value));
+                line += std::to_string(value);
+                arg += 1 + sizeof(value);
+                break;
+            }
+            case ARG_UINT: {
+                uint64_t value;
+                std::memcpy(&value, arg + 1, sizeof(value));
+                line += std::to_string(value);
+                arg += 1 + sizeof(value);
+                break;
+            }
+            case ARG_DOUBLE: {
+                double value;
+                std::memcpy(&value, arg + 1, sizeof(value));
+                char text[32];
+                std::snprintf(text, sizeof(text), "%g", value);
+                line += text;
+                arg += 1 + sizeof(value);
+                break;
+            }
+            case ARG_BOOL: {
+                bool value;
+                std::memcpy(&value, arg + 1, sizeof(value));
+                line += value ? "true" : "false";
+                arg += 1 + sizeof(value);
+                break;
+            }
+            case ARG_STRING: {
+                uint16_t length;
+                std::memcpy(&length, arg + 1, sizeof(length));
+                line.append(reinterpret_cast<const char*>(arg + 3), length);
+                arg += 3 + length;
+                break;
+            }
+        }
+    }
+    line += '\n';
+}
+
+void Logger::set_output(FILE* stream) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    output_ = stream;
+}
+
+void Logger::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!writer_.joinable() || !running_) {
+        return;
+    }
+    // The first pass may have started before this call; the second cannot have
+    uint64_t target = passes_ + 2;
+    flushed_.wait(lock, [&]() { return passes_ >= target || !running_; });
+}
+
+void Logger::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    flushed_.notify_all();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+}
+
+Logger::Stats Logger::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.written = written_;
+    stats.dropped = retired_drops_;
+    for (const std::shared_ptr<Ring>& ring : rings_) {
+        stats.dropped += ring->dropped.load(std::memory_order_relaxed);
+    }
+    stats.rings = rings_.size();
+    return stats;
+}
+
+} // namespace SecureComm
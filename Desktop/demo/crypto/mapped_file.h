@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace SecureComm {
+
+// Read-only view of a whole file; memory-mapped where available, read into
+// memory otherwise. An empty view means the file is missing or empty.
+class MappedFile {
+public:
+    enum class Access {
+        SEQUENTIAL, // replayed front to back once
+        RANDOM      // kept open and read piecemeal
+    };
+
+    explicit MappedFile(const std::string& path, Access access = Access::SEQUENTIAL)
+        : data_(nullptr), size_(0) {
+#ifdef _WIN32
+        (void)access;
+        std::ifstream in(path, std::ios::binary);
+        if (in) {
+            buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            data_ = reinterpret_cast<const uint8_t*>(buffer_.data());
+            size_ = buffer_.size();
+        }
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* mapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                madvise(mapped, static_cast<size_t>(st.st_size),
+                        access == Access::SEQUENTIAL ? MADV_SEQUENTIAL : MADV_RANDOM);
+                data_ = static_cast<const uint8_t*>(mapped);
+                size_ = static_cast<size_t>(st.st_size);
+            }
+        }
+        ::close(fd);
+#endif
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (data_) {
+            munmap(const_cast<uint8_t*>(data_), size_);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+#ifdef _WIN32
+    std::string buffer_;
+#endif
+};
+
+} // namespace SecureComm
@@ -0,0 +1,147 @@
+#include "metrics.h"
+#include "logger.h"
+#include <algorithm>
+
+namespace SecureComm {
+
+namespace {
+
+const char* const COUNTER_NAMES[] = {"connections_accepted", "handshakes_full", "handshakes_resumed",
+                                     "handshakes_failed", "handshakes_rejected", "handshake_cookies_sent",
+                                     "handshake_cookies_rejected", "messages_received", "messages_sent",
+                                     "bytes_received", "bytes_sent", "message_errors", "key_rotations"};
+static_assert(sizeof(COUNTER_NAMES) / sizeof(COUNTER_NAMES[0]) == METRIC_COUNTER_COUNT,
+              "Every counter needs a name");
+
+const char* const GAUGE_NAMES[] = {"active_sessions", "connection_threads", "accept_queue_depth",
+                                   "handshake_queue_depth"};
+static_assert(sizeof(GAUGE_NAMES) / sizeof(GAUGE_NAMES[0]) == METRIC_GAUGE_COUNT, "Every gauge needs a name");
+
+int64_t wall_now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+const char* metric_counter_name(MetricCounter counter) {
+    size_t index = static_cast<size_t>(counter);
+    return index < METRIC_COUNTER_COUNT ? COUNTER_NAMES[index] : "unknown";
+}
+
+const char* metric_gauge_name(MetricGauge gauge) {
+    size_t index = static_cast<size_t>(gauge);
+    return index < METRIC_GAUGE_COUNT ? GAUGE_NAMES[index] : "unknown";
+}
+
+Metrics& Metrics::instance() {
+    // Deliberately leaked, like the logger: threads may record during exit
+    static Metrics* metrics = new Metrics();
+    return *metrics;
+}
+
+Metrics::Metrics()
+    : shard_count_(std::min<size_t>(32, std::max<size_t>(4, std::thread::hardware_concurrency()))),
+      shards_(new Shard[shard_count_]), next_shard_(0), ns_per_tick_(1.0), running_(false) {
+    ns_per_tick_.store(clock_.ns_per_tick(), std::memory_order_relaxed);
+    for (size_t i = 0; i < shard_count_; ++i) {
+        for (std::atomic<uint64_t>& counter : shards_[i].counters) {
+            counter.store(0, std::memory_order_relaxed);
+        }
+        shards_[i].stages.resize(METRIC_STAGE_COUNT);
+    }
+    for (std::atomic<int64_t>& gauge : gauges_) {
+        gauge.store(0, std::memory_order_relaxed);
+    }
+}
+
+MetricsSnapshot Metrics::collect() {
+    MetricsSnapshot snapshot;
+    snapshot.wall_ms = wall_now_ms();
+    snapshot.counters.fill(0);
+    snapshot.stages.resize(METRIC_STAGE_COUNT);
+    for (size_t i = 0; i < shard_count_; ++i) {
+        const Shard& shard = shards_[i];
+        for (size_t c = 0; c < METRIC_COUNTER_COUNT; ++c) {
+            snapshot.counters[c] += shard.counters[c].load(std::memory_order_relaxed);
+        }
+        for (size_t s = 0; s < METRIC_STAGE_COUNT; ++s) {
+            if (shard.stages[s].count() != 0) {
+                snapshot.stages[s].merge(shard.stages[s]);
+            }
+        }
+    }
+    for (size_t g = 0; g < METRIC_GAUGE_COUNT; ++g) {
+        snapshot.gauges[g] = gauges_[g].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+void Metrics::start(std::chrono::milliseconds interval, bool log_summary) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    snapshot_thread_ = std::thread(&Metrics::snapshot_loop, this, interval, log_summary);
+}
+
+void Metrics::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    wake_.notify_all();
+    if (snapshot_thread_.joinable()) {
+        snapshot_thread_.join();
+    }
+}
+
+std::shared_ptr<const MetricsSnapshot> Metrics::snapshot() const {
+    return std::atomic_load(&latest_);
+}
+
+void Metrics::snapshot_loop(std::chrono::milliseconds interval, bool log_summary) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        wake_.wait_for(lock, interval, [this]() { return !running_; });
+        if (!running_) {
+            break;
+        }
+        lock.unlock();
+        // The tick rate estimate sharpens the longer the process runs
+        clock_.refine();
+        ns_per_tick_.store(clock_.ns_per_tick(), std::memory_order_relaxed);
+        auto snapshot = std::make_shared<const MetricsSnapshot>(collect());
+        std::atomic_store(&latest_, snapshot);
+        if (log_summary) {
+            log_snapshot(*snapshot);
+        }
+        lock.lock();
+    }
+}
+
+void Metrics::log_snapshot(const MetricsSnapshot& snapshot) {
+    auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+    SC_LOG_INFO("Metrics: {} sessions, {} threads, accept queue {}, {} messages in, {} out, {} handshakes, "
+                "{} failed",
+                snapshot.gauges[static_cast<size_t>(MetricGauge::ACTIVE_SESSIONS)],
+                snapshot.gauges[static_cast<size_t>(MetricGauge::CONNECTION_THREADS)],
+                snapshot.gauges[static_cast<size_t>(MetricGauge::ACCEPT_QUEUE_DEPTH)],
+                snapshot.counters[static_cast<size_t>(MetricCounter::MESSAGES_RECEIVED)],
+                snapshot.counters[static_cast<size_t>(MetricCounter::MESSAGES_SENT)],
+                snapshot.counters[static_cast<size_t>(MetricCounter::HANDSHAKES_FULL)] +
+                    snapshot.counters[static_cast<size_t>(MetricCounter::HANDSHAKES_RESUMED)],
+                snapshot.counters[static_cast<size_t>(MetricCounter::HANDSHAKES_FAILED)]);
+    for (size_t s = 0; s < METRIC_STAGE_COUNT; ++s) {
+        const LatencyHistogram& histogram = snapshot.stages[s];
+        if (histogram.count() == 0) {
+            continue;
+        }
+        SC_LOG_INFO("  {}: n={} p50={}us p99={}us p99.9={}us max={}us", trace_stage_name(static_cast<TraceStage>(s)),
+                    histogram.count(), us(histogram.value_at_percentile(50)), us(histogram.value_at_percentile(99)),
+                    us(histogram.value_at_percentile(99.9)), us(histogram.max()));
+    }
+}
+
+} // namespace SecureComm
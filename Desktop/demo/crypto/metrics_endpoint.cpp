@@ -0,0 +1,250 @@
+#include "metrics_endpoint.h"
+#include "crypto_utils.h"
+#include "logger.h"
+#include <cstring>
+#include <sstream>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+#else
+    #include <sys/socket.h>
+    #include <sys/stat.h>
+    #include <sys/time.h>
+    #include <sys/un.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+#endif
+
+namespace SecureComm {
+
+namespace {
+
+// A request line and headers; anything longer is not a scraper
+constexpr size_t MAX_REQUEST_SIZE = 8192;
+constexpr int CLIENT_TIMEOUT_MS = 2000;
+
+// Bucket bounds exported per stage, in seconds: 1-2.5-5 steps from 1 us to 10 s
+const double STAGE_BOUNDS[] = {1e-6, 2.5e-6, 5e-6, 1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3,
+                               5e-3, 1e-2, 2.5e-2, 5e-2, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0};
+
+void close_socket(int socket) {
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+bool send_all(int socket, const std::string& data) {
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL; // a scraper that hangs up must not SIGPIPE the server
+#else
+    const int flags = 0;
+#endif
+    size_t offset = 0;
+    while (offset < data.size()) {
+        int sent = send(socket, data.data() + offset, static_cast<int>(data.size() - offset), flags);
+        if (sent <= 0) {
+            return false;
+        }
+        offset += static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+void set_timeouts(int socket) {
+#ifdef _WIN32
+    DWORD timeout = CLIENT_TIMEOUT_MS;
+#else
+    struct timeval timeout;
+    timeout.tv_sec = CLIENT_TIMEOUT_MS / 1000;
+    timeout.tv_usec = (CLIENT_TIMEOUT_MS % 1000) * 1000;
+#endif
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+    setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+}
+
+std::string http_response(const char* status, const std::string& body) {
+    std::ostringstream out;
+    out << "HTTP/1.1 " << status << "\r\n"
+        << "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+        << "Content-Length: " << body.size() << "\r\n"
+        << "Connection: close\r\n\r\n"
+        << body;
+    return out.str();
+}
+
+} // namespace
+
+MetricsEndpoint::MetricsEndpoint(MetricsEndpointConfig config)
+    : config_(std::move(config)), listen_socket_(-1), running_(false) {}
+
+MetricsEndpoint::~MetricsEndpoint() {
+    stop();
+}
+
+void MetricsEndpoint::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+
+    std::string where;
+    bool bound = false;
+    if (!config_.unix_path.empty()) {
+        where = config_.unix_path;
+#ifdef _WIN32
+        running_ = false;
+        throw CryptoException("Unix socket metrics endpoint is not supported on Windows");
+#else
+        struct sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (config_.unix_path.size() < sizeof(addr.sun_path)) {
+            std::memcpy(addr.sun_path, config_.unix_path.c_str(), config_.unix_path.size());
+            // A socket left behind by an earlier run would block bind
+            struct stat info;
+            if (stat(addr.sun_path, &info) == 0 && S_ISSOCK(info.st_mode)) {
+                unlink(addr.sun_path);
+            }
+            listen_socket_ = static_cast<int>(socket(AF_UNIX, SOCK_STREAM, 0));
+            bound = listen_socket_ >= 0 &&
+                    bind(listen_socket_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0;
+        }
+#endif
+    } else {
+        where = config_.bind_address + ":" + std::to_string(config_.port);
+        listen_socket_ = static_cast<int>(socket(AF_INET, SOCK_STREAM, 0));
+        int opt = 1;
+        setsockopt(listen_socket_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&opt), sizeof(opt));
+
+        struct sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(config_.port);
+        bound = listen_socket_ >= 0 && inet_pton(AF_INET, config_.bind_address.c_str(), &addr.sin_addr) == 1 &&
+                bind(listen_socket_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0;
+    }
+
+    if (!bound || listen(listen_socket_, 16) < 0) {
+        if (listen_socket_ >= 0) {
+            close_socket(listen_socket_);
+            listen_socket_ = -1;
+        }
+        running_ = false;
+        throw CryptoException("Failed to listen for metrics on " + where);
+    }
+    serve_thread_ = std::thread(&MetricsEndpoint::serve_loop, this);
+    SC_LOG_INFO("Serving metrics on {}", where);
+}
+
+void MetricsEndpoint::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    if (listen_socket_ >= 0) {
+#ifndef _WIN32
+        shutdown(listen_socket_, SHUT_RDWR);
+#endif
+        close_socket(listen_socket_);
+        listen_socket_ = -1;
+    }
+    if (serve_thread_.joinable()) {
+        serve_thread_.join();
+    }
+#ifndef _WIN32
+    if (!config_.unix_path.empty()) {
+        unlink(config_.unix_path.c_str());
+    }
+#endif
+}
+
+void MetricsEndpoint::serve_loop() {
+    const int listen_socket = listen_socket_;
+    while (running_) {
+        int sock = static_cast<int>(accept(listen_socket, nullptr, nullptr));
+        if (sock < 0) {
+            continue;
+        }
+        // Scrapes are served one at a time; the timeouts bound a stalled one
+        set_timeouts(sock);
+        serve(sock);
+        close_socket(sock);
+    }
+}
+
+void MetricsEndpoint::serve(int client_socket) {
+    std::string request;
+    char chunk[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < MAX_REQUEST_SIZE) {
+        int received = recv(client_socket, chunk, sizeof(chunk), 0);
+        if (received <= 0) {
+            return;
+        }
+        request.append(chunk, static_cast<size_t>(received));
+    }
+
+    if (request.compare(0, 4, "GET ") != 0) {
+        send_all(client_socket, http_response("405 Method Not Allowed", "Only GET is supported\n"));
+        return;
+    }
+    std::shared_ptr<const MetricsSnapshot> snapshot = Metrics::instance().snapshot();
+    if (!snapshot) {
+        send_all(client_socket, http_response("503 Service Unavailable", "No metrics snapshot yet\n"));
+        return;
+    }
+    send_all(client_socket, http_response("200 OK", format(*snapshot)));
+}
+
+std::string MetricsEndpoint::format(const MetricsSnapshot& snapshot) {
+    std::ostringstream out;
+    out.precision(15);
+
+    for (size_t c = 0; c < METRIC_COUNTER_COUNT; ++c) {
+        const char* name = metric_counter_name(static_cast<MetricCounter>(c));
+        out << "# TYPE securecomm_" << name << "_total counter\n"
+            << "securecomm_" << name << "_total " << snapshot.counters[c] << "\n";
+    }
+    for (size_t g = 0; g < METRIC_GAUGE_COUNT; ++g) {
+        const char* name = metric_gauge_name(static_cast<MetricGauge>(g));
+        out << "# TYPE securecomm_" << name << " gauge\n"
+            << "securecomm_" << name << " " << snapshot.gauges[g] << "\n";
+    }
+    out << "# TYPE securecomm_metrics_snapshot_timestamp_seconds gauge\n"
+        << "securecomm_metrics_snapshot_timestamp_seconds " << static_cast<double>(snapshot.wall_ms) / 1000.0
+        << "\n";
+
+    // Each exported bound counts the HDR buckets that end at or below it, so
+    // a value within 1.6% under a bound may be counted in the next one up
+    out << "# TYPE securecomm_stage_duration_seconds histogram\n";
+    for (size_t s = 0; s < snapshot.stages.size(); ++s) {
+        const LatencyHistogram& histogram = snapshot.stages[s];
+        const char* stage = trace_stage_name(static_cast<TraceStage>(s));
+        uint64_t cumulative = 0;
+        size_t index = 0;
+        for (double bound : STAGE_BOUNDS) {
+            const uint64_t bound_ns = static_cast<uint64_t>(bound * 1e9);
+            while (index < LatencyHistogram::BUCKET_COUNT &&
+                   LatencyHistogram::bucket_upper_bound(index) <= bound_ns) {
+                cumulative += histogram.count_at(index++);
+            }
+            out << "securecomm_stage_duration_seconds_bucket{stage=\"" << stage << "\",le=\"" << bound << "\"} "
+                << cumulative << "\n";
+        }
+        // Summed from the same buckets, so +Inf never falls below a bound
+        // even when the snapshot raced a recording thread
+        while (index < LatencyHistogram::BUCKET_COUNT) {
+            cumulative += histogram.count_at(index++);
+        }
+        const uint64_t count = cumulative;
+        out << "securecomm_stage_duration_seconds_bucket{stage=\"" << stage << "\",le=\"+Inf\"} " << count << "\n"
+            << "securecomm_stage_duration_seconds_sum{stage=\"" << stage << "\"} "
+            << static_cast<double>(histogram.sum()) / 1e9 << "\n"
+            << "securecomm_stage_duration_seconds_count{stage=\"" << stage << "\"} " << count << "\n";
+    }
+    return out.str();
+}
+
+} // namespace SecureComm
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "metrics.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+namespace SecureComm {
+
+struct MetricsEndpointConfig {
+    // TCP port for the HTTP listener; 0 disables it
+    uint16_t port = 0;
+    // Scrapes come from the local agent unless told otherwise
+    std::string bind_address = "127.0.0.1";
+    // Unix socket path served instead of the TCP port (POSIX only)
+    std::string unix_path;
+};
+
+// Serves Metrics snapshots in the Prometheus text format.
+// One thread accepts scrapes and answers each from the latest published
+// snapshot, so a scrape never reads the shards the workers record into;
+// counters and histograms are as old as the snapshot interval. Any GET
+// path is answered, so both "/metrics" and "/" work.
+class MetricsEndpoint {
+public:
+    explicit MetricsEndpoint(MetricsEndpointConfig config);
+    ~MetricsEndpoint();
+
+    MetricsEndpoint(const MetricsEndpoint&) = delete;
+    MetricsEndpoint& operator=(const MetricsEndpoint&) = delete;
+
+    // Throws CryptoException if the port or socket path cannot be bound
+    void start();
+    void stop();
+
+    // The exposition text for one snapshot
+    static std::string format(const MetricsSnapshot& snapshot);
+
+private:
+    void serve_loop();
+    void serve(int client_socket);
+
+    MetricsEndpointConfig config_;
+    int listen_socket_;
+    std::atomic<bool> running_;
+    std::thread serve_thread_;
+};
+
+} // namespace SecureComm
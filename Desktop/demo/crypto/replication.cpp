@@ -0,0 +1,701 @@
+#include "replication.h"
+#include "crypto_utils.h"
+#include "logger.h"
+#include "wire_codec.h"
+#include <algorithm>
+#include <cstring>
+#include <zlib.h>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <arpa/inet.h>
+    #include <netdb.h>
+    #include <unistd.h>
+#endif
+
+namespace SecureComm {
+
+namespace {
+
+constexpr uint32_t BATCH_MAGIC = 0x42524353; // "SCRB"
+constexpr uint8_t BATCH_VERSION = 3;
+constexpr uint8_t BATCH_FLAG_COMPRESSED = 0x01;
+
+// Receiver's hello, sent as soon as it accepts a connection
+constexpr uint32_t HELLO_MAGIC = 0x48524353; // "SCRH"
+constexpr size_t HELLO_OFF_MAGIC = 0;
+constexpr size_t HELLO_OFF_VERSION = 4;
+constexpr size_t HELLO_OFF_LINK_NONCE = 8;
+constexpr size_t HELLO_SIZE = 16;
+constexpr std::chrono::milliseconds HELLO_TIMEOUT{2000};
+
+// Batch header layout (little-endian); bytes [0, OFF_IV) are the GCM AAD
+constexpr size_t OFF_MAGIC = 0;
+constexpr size_t OFF_VERSION = 4;
+constexpr size_t OFF_FLAGS = 5;
+constexpr size_t OFF_NODE_ID = 8;
+constexpr size_t OFF_COUNT = 12;
+constexpr size_t OFF_SEQ = 16;
+constexpr size_t OFF_OLDEST_MS = 24;
+constexpr size_t OFF_RAW_SIZE = 32;
+constexpr size_t OFF_BODY_SIZE = 36;
+constexpr size_t OFF_LINK_NONCE = 40;
+constexpr size_t OFF_IV = 48;
+constexpr size_t HEADER_SIZE = OFF_IV + IV_SIZE;
+
+// Change layout inside the (decrypted, decompressed) body
+constexpr size_t CHANGE_OFF_OP = 0;
+constexpr size_t CHANGE_OFF_SESSION_ID = 1;
+constexpr size_t CHANGE_OFF_CLIENT_ID = 5;
+constexpr size_t CHANGE_OFF_KEY_EPOCH = 9;
+constexpr size_t CHANGE_OFF_CREATED_AT = 13;
+constexpr size_t CHANGE_OFF_KEY = 21;
+constexpr size_t CHANGE_SIZE = CHANGE_OFF_KEY + KEY_SIZE;
+
+// Largest batch either side handles; it bounds what a receiver buffers
+// before the batch has authenticated (under 1 MB)
+constexpr uint32_t MAX_BATCH_CHANGES = 1u << 14;
+constexpr uint32_t MAX_BODY_SIZE = MAX_BATCH_CHANGES * CHANGE_SIZE + GCM_TAG_SIZE;
+
+constexpr std::chrono::milliseconds RECONNECT_INTERVAL{500};
+// A link that keeps dropping is retried at most this rarely
+constexpr std::chrono::milliseconds RECONNECT_BACKOFF_MAX{8000};
+// Pause after a failed accept, doubled while failures persist
+constexpr std::chrono::milliseconds ACCEPT_BACKOFF_MIN{10};
+constexpr std::chrono::milliseconds ACCEPT_BACKOFF_MAX{RECONNECT_INTERVAL};
+
+uint64_t now_ms() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+void close_socket(int socket) {
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+bool send_all(int socket, const uint8_t* data, size_t size) {
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL; // a dead peer must not SIGPIPE the server
+#else
+    const int flags = 0;
+#endif
+    while (size > 0) {
+        int sent = send(socket, reinterpret_cast<const char*>(data), static_cast<int>(size), flags);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+bool recv_all(int socket, uint8_t* data, size_t size) {
+    while (size > 0) {
+        int received = recv(socket, reinterpret_cast<char*>(data), static_cast<int>(size), 0);
+        if (received <= 0) {
+            return false;
+        }
+        data += received;
+        size -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+void set_timeout(int socket, int option, std::chrono::milliseconds timeout_ms) {
+#ifdef _WIN32
+    DWORD timeout = static_cast<DWORD>(timeout_ms.count());
+#else
+    struct timeval timeout;
+    timeout.tv_sec = static_cast<time_t>(timeout_ms.count() / 1000);
+    timeout.tv_usec = static_cast<suseconds_t>((timeout_ms.count() % 1000) * 1000);
+#endif
+    setsockopt(socket, SOL_SOCKET, option, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+}
+
+// The send timeout also bounds connect() on Linux, so an unreachable peer
+// cannot hold the sender for the kernel's SYN retry period either
+int connect_to(const ReplicationPeer& peer, std::chrono::milliseconds send_timeout) {
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* result = nullptr;
+    std::string port = std::to_string(peer.port);
+    if (getaddrinfo(peer.host.c_str(), port.c_str(), &hints, &result) != 0 || !result) {
+        return -1;
+    }
+
+    int sock = static_cast<int>(socket(result->ai_family, result->ai_socktype, result->ai_protocol));
+    if (sock >= 0) {
+        set_timeout(sock, SO_SNDTIMEO, send_timeout);
+    }
+    if (sock >= 0 && connect(sock, result->ai_addr, static_cast<socklen_t>(result->ai_addrlen)) < 0) {
+        close_socket(sock);
+        sock = -1;
+    }
+    freeaddrinfo(result);
+
+    if (sock >= 0) {
+        int nodelay = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&nodelay), sizeof(nodelay));
+    }
+    return sock;
+}
+
+
+} // namespace
+
+SessionReplicator::SessionReplicator(ReplicationConfig config)
+    : config_(std::move(config)),
+      crypto_(std::make_unique<CryptoManager>()),
+      running_(false),
+      listen_socket_(-1),
+      batches_sent_(0),
+      changes_sent_(0),
+      raw_bytes_(0),
+      wire_bytes_(0),
+      batches_received_(0),
+      changes_applied_(0),
+      last_lag_ms_(0),
+      max_lag_ms_(0) {
+    if (config_.cluster_key.size() != KEY_SIZE) {
+        throw CryptoException("Invalid cluster key size");
+    }
+    config_.max_batch = std::min<size_t>(std::max<size_t>(config_.max_batch, 1), MAX_BATCH_CHANGES);
+    for (const ReplicationPeer& peer : config_.peers) {
+        links_.push_back(PeerLink{peer, -1, std::chrono::steady_clock::now(), 0, 0, RECONNECT_INTERVAL, {}});
+    }
+}
+
+SessionReplicator::~SessionReplicator() {
+    stop();
+    OPENSSL_cleanse(config_.cluster_key.data(), config_.cluster_key.size());
+}
+
+void SessionReplicator::set_apply_callback(ApplyFn apply) {
+    apply_ = std::move(apply);
+}
+
+void SessionReplicator::set_snapshot_callback(SnapshotFn snapshot) {
+    snapshot_ = std::move(snapshot);
+}
+
+void SessionReplicator::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+
+    if (config_.listen_port != 0) {
+        listen_socket_ = static_cast<int>(socket(AF_INET, SOCK_STREAM, 0));
+        int opt = 1;
+        setsockopt(listen_socket_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&opt), sizeof(opt));
+
+        struct sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(config_.listen_port);
+
+        if (listen_socket_ < 0 || inet_pton(AF_INET, config_.listen_address.c_str(), &addr.sin_addr) != 1 ||
+            bind(listen_socket_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            listen(listen_socket_, 16) < 0) {
+            if (listen_socket_ >= 0) {
+                close_socket(listen_socket_);
+                listen_socket_ = -1;
+            }
+            running_ = false;
+            throw CryptoException("Failed to listen for replication on " + config_.listen_address + ":" +
+                                  std::to_string(config_.listen_port));
+        }
+        accept_thread_ = std::thread(&SessionReplicator::accept_loop, this);
+    }
+
+    sender_thread_ = std::thread(&SessionReplicator::sender_loop, this);
+}
+
+void SessionReplicator::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    // The sender drains what is pending before it exits
+    pending_cv_.notify_all();
+    if (sender_thread_.joinable()) {
+        sender_thread_.join();
+    }
+    for (PeerLink& link : links_) {
+        if (link.socket >= 0) {
+            close_socket(link.socket);
+            link.socket = -1;
+        }
+    }
+
+    if (listen_socket_ >= 0) {
+#ifndef _WIN32
+        shutdown(listen_socket_, SHUT_RDWR);
+#endif
+        close_socket(listen_socket_);
+        listen_socket_ = -1;
+    }
+    if (accept_thread_.joinable()) {
+        accept_thread_.join();
+    }
+
+    std::vector<std::thread> receivers;
+    {
+        std::lock_guard<std::mutex> lock(receivers_mutex_);
+        for (int sock : receiver_sockets_) {
+#ifdef _WIN32
+            shutdown(sock, SD_BOTH);
+#else
+            shutdown(sock, SHUT_RDWR);
+#endif
+        }
+        receivers.swap(receiver_threads_);
+        finished_receivers_.clear();
+    }
+    for (std::thread& thread : receivers) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+void SessionReplicator::publish_put(const PersistedSession& session) {
+    enqueue(SessionChange{SessionChange::Op::PUT, session});
+}
+
+void SessionReplicator::publish_remove(uint32_t session_id) {
+    SessionChange change{};
+    change.op = SessionChange::Op::REMOVE;
+    change.session.session_id = session_id;
+    enqueue(change);
+}
+
+void SessionReplicator::enqueue(const SessionChange& change) {
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        // Coalesce: only the latest state of a session is shipped
+        auto it = pending_.find(change.session.session_id);
+        if (it != pending_.end()) {
+            OPENSSL_cleanse(it->second.change.session.key.data(), KEY_SIZE);
+            it->second.change = change;
+        } else {
+            pending_.emplace(change.session.session_id, PendingChange{change, now_ms()});
+        }
+    }
+    // The sender's predicates decide whether to start or cut a batch
+    pending_cv_.notify_one();
+}
+
+void SessionReplicator::sender_loop() {
+    std::vector<SessionChange> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(pending_mutex_);
+            pending_cv_.wait_for(lock, RECONNECT_INTERVAL, [this]() {
+                return !running_ || !pending_.empty();
+            });
+            // Linger so changes arriving close together share one batch
+            if (running_ && !pending_.empty() && pending_.size() < config_.max_batch) {
+                pending_cv_.wait_for(lock, config_.flush_interval, [this]() {
+                    return !running_ || pending_.size() >= config_.max_batch;
+                });
+            }
+
+            uint64_t oldest_ms = UINT64_MAX;
+            batch.clear();
+            batch.reserve(pending_.size());
+            for (auto& entry : pending_) {
+                batch.push_back(entry.second.change);
+                oldest_ms = std::min(oldest_ms, entry.second.queued_ms);
+                OPENSSL_cleanse(entry.second.change.session.key.data(), KEY_SIZE);
+            }
+            pending_.clear();
+            lock.unlock();
+
+            connect_peers();
+            for (size_t offset = 0; offset < batch.size(); offset += config_.max_batch) {
+                size_t count = std::min(config_.max_batch, batch.size() - offset);
+                std::vector<SessionChange> chunk(batch.begin() + offset, batch.begin() + offset + count);
+                std::vector<uint8_t> encoded = encode_batch(chunk, oldest_ms);
+                send_to_peers(encoded);
+                OPENSSL_cleanse(encoded.data(), encoded.size());
+                for (SessionChange& change : chunk) {
+                    OPENSSL_cleanse(change.session.key.data(), KEY_SIZE);
+                }
+            }
+            for (SessionChange& change : batch) {
+                OPENSSL_cleanse(change.session.key.data(), KEY_SIZE);
+            }
+        }
+
+        if (!running_) {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            if (pending_.empty()) {
+                break;
+            }
+        }
+    }
+}
+
+void SessionReplicator::connect_peers() {
+    auto now = std::chrono::steady_clock::now();
+    for (PeerLink& link : links_) {
+        if (link.socket >= 0 || now < link.next_attempt) {
+            continue;
+        }
+        link.next_attempt = now + link.backoff;
+        link.socket = connect_to(link.peer, config_.send_timeout);
+        if (link.socket < 0) {
+            continue;
+        }
+        link.connected_at = now;
+
+        // Bounds the wait for the receiver's hello; the sender never reads otherwise
+        uint8_t hello[HELLO_SIZE];
+        set_timeout(link.socket, SO_RCVTIMEO, HELLO_TIMEOUT);
+        if (!recv_all(link.socket, hello, HELLO_SIZE) || load_le<uint32_t>(hello + HELLO_OFF_MAGIC) != HELLO_MAGIC ||
+            hello[HELLO_OFF_VERSION] != BATCH_VERSION) {
+            SC_LOG_WARN("Replication: no valid hello from peer {}:{}", link.peer.host, link.peer.port);
+            drop_link(link);
+            continue;
+        }
+        link.link_nonce = load_le<uint64_t>(hello + HELLO_OFF_LINK_NONCE);
+        link.batch_seq = 0;
+        SC_LOG_INFO("Replication: connected to peer {}:{}", link.peer.host, link.peer.port);
+        // The peer may have missed changes while it was down
+        send_snapshot(link);
+    }
+}
+
+void SessionReplicator::send_to_peers(const std::vector<uint8_t>& batch) {
+    if (batch.empty()) {
+        return;
+    }
+    for (PeerLink& link : links_) {
+        if (link.socket < 0) {
+            continue;
+        }
+        std::vector<uint8_t> frame = seal_batch(batch, link);
+        if (send_all(link.socket, frame.data(), frame.size())) {
+            batches_sent_.fetch_add(1, std::memory_order_relaxed);
+            wire_bytes_.fetch_add(frame.size(), std::memory_order_relaxed);
+        } else {
+            // A full send buffer past the send timeout lands here too
+            SC_LOG_WARN("Replication: lost peer {}:{}", link.peer.host, link.peer.port);
+            drop_link(link);
+        }
+    }
+}
+
+void SessionReplicator::drop_link(PeerLink& link) {
+    close_socket(link.socket);
+    link.socket = -1;
+    // A peer that accepts but stops reading costs the sender one timeout per
+    // connection; back off so it cannot do that every reconnect interval
+    auto now = std::chrono::steady_clock::now();
+    if (now - link.connected_at >= RECONNECT_BACKOFF_MAX) {
+        link.backoff = RECONNECT_INTERVAL;
+    } else {
+        link.backoff = std::min(link.backoff * 2, RECONNECT_BACKOFF_MAX);
+    }
+    link.next_attempt = now + link.backoff;
+}
+
+void SessionReplicator::send_snapshot(PeerLink& link) {
+    if (!snapshot_) {
+        return;
+    }
+
+    std::vector<PersistedSession> sessions = snapshot_();
+    uint64_t snapshot_ms = now_ms();
+    for (size_t offset = 0; offset < sessions.size() && link.socket >= 0; offset += config_.max_batch) {
+        size_t count = std::min(config_.max_batch, sessions.size() - offset);
+        std::vector<SessionChange> chunk;
+        chunk.reserve(count);
+        for (size_t i = offset; i < offset + count; ++i) {
+            chunk.push_back(SessionChange{SessionChange::Op::PUT, sessions[i]});
+        }
+
+        std::vector<uint8_t> encoded = encode_batch(chunk, snapshot_ms);
+        std::vector<uint8_t> frame = seal_batch(encoded, link);
+        OPENSSL_cleanse(encoded.data(), encoded.size());
+        if (!send_all(link.socket, frame.data(), frame.size())) {
+            SC_LOG_WARN("Replication: lost peer {}:{} during snapshot", link.peer.host, link.peer.port);
+            drop_link(link);
+        }
+        for (SessionChange& change : chunk) {
+            OPENSSL_cleanse(change.session.key.data(), KEY_SIZE);
+        }
+    }
+    for (PersistedSession& session : sessions) {
+        OPENSSL_cleanse(session.key.data(), KEY_SIZE);
+    }
+}
+
+std::vector<uint8_t> SessionReplicator::encode_batch(const std::vector<SessionChange>& changes, uint64_t oldest_ms) {
+    if (changes.empty()) {
+        return std::vector<uint8_t>();
+    }
+
+    std::vector<uint8_t> raw(changes.size() * CHANGE_SIZE, 0);
+    uint8_t* out = raw.data();
+    for (const SessionChange& change : changes) {
+        out[CHANGE_OFF_OP] = static_cast<uint8_t>(change.op);
+        store_le<uint32_t>(out + CHANGE_OFF_SESSION_ID, change.session.session_id);
+        if (change.op == SessionChange::Op::PUT) {
+            store_le<uint32_t>(out + CHANGE_OFF_CLIENT_ID, change.session.client_id);
+            store_le<uint32_t>(out + CHANGE_OFF_KEY_EPOCH, change.session.key_epoch);
+            store_le<uint64_t>(out + CHANGE_OFF_CREATED_AT, static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    change.session.created_at.time_since_epoch()).count()));
+            std::memcpy(out + CHANGE_OFF_KEY, change.session.key.data(), KEY_SIZE);
+        }
+        out += CHANGE_SIZE;
+    }
+
+    // Compress before sealing; ciphertext does not compress
+    uint8_t flags = 0;
+    std::vector<uint8_t> body;
+    uLongf compressed_size = compressBound(static_cast<uLong>(raw.size()));
+    std::vector<uint8_t> compressed(compressed_size);
+    if (compress2(compressed.data(), &compressed_size, raw.data(), static_cast<uLong>(raw.size()),
+                  Z_BEST_SPEED) == Z_OK && compressed_size < raw.size()) {
+        compressed.resize(compressed_size);
+        body.swap(compressed);
+        flags |= BATCH_FLAG_COMPRESSED;
+    } else {
+        body = raw;
+    }
+
+    std::vector<uint8_t> batch(HEADER_SIZE, 0);
+    store_le<uint32_t>(batch.data() + OFF_MAGIC, BATCH_MAGIC);
+    batch[OFF_VERSION] = BATCH_VERSION;
+    batch[OFF_FLAGS] = flags;
+    store_le<uint32_t>(batch.data() + OFF_NODE_ID, config_.node_id);
+    store_le<uint32_t>(batch.data() + OFF_COUNT, static_cast<uint32_t>(changes.size()));
+    store_le<uint64_t>(batch.data() + OFF_OLDEST_MS, oldest_ms);
+    store_le<uint32_t>(batch.data() + OFF_RAW_SIZE, static_cast<uint32_t>(raw.size()));
+    store_le<uint32_t>(batch.data() + OFF_BODY_SIZE, static_cast<uint32_t>(body.size() + GCM_TAG_SIZE));
+    batch.insert(batch.end(), body.begin(), body.end());
+
+    OPENSSL_cleanse(raw.data(), raw.size());
+    OPENSSL_cleanse(body.data(), body.size());
+
+    changes_sent_.fetch_add(changes.size(), std::memory_order_relaxed);
+    raw_bytes_.fetch_add(raw.size(), std::memory_order_relaxed);
+    return batch;
+}
+
+std::vector<uint8_t> SessionReplicator::seal_batch(const std::vector<uint8_t>& batch, PeerLink& link) {
+    std::vector<uint8_t> frame(batch.begin(), batch.begin() + HEADER_SIZE);
+    store_le<uint64_t>(frame.data() + OFF_SEQ, ++link.batch_seq);
+    store_le<uint64_t>(frame.data() + OFF_LINK_NONCE, link.link_nonce);
+    std::vector<uint8_t> iv = crypto_->generate_random_bytes(IV_SIZE);
+    std::copy(iv.begin(), iv.end(), frame.begin() + OFF_IV);
+
+    std::vector<uint8_t> sealed = crypto_->seal_aes_gcm(ByteView(batch.data() + HEADER_SIZE, batch.size() - HEADER_SIZE),
+                                                        config_.cluster_key, iv, ByteView(frame.data(), OFF_IV));
+    frame.insert(frame.end(), sealed.begin(), sealed.end());
+    return frame;
+}
+
+void SessionReplicator::accept_loop() {
+    const int listen_socket = listen_socket_;
+    std::chrono::milliseconds backoff = ACCEPT_BACKOFF_MIN;
+    while (running_) {
+        struct sockaddr_in peer_addr;
+        socklen_t peer_len = sizeof(peer_addr);
+        int sock = static_cast<int>(accept(listen_socket, reinterpret_cast<struct sockaddr*>(&peer_addr), &peer_len));
+        if (sock < 0) {
+            // stop() closes the socket; anything else (fd exhaustion, say)
+            // tends to persist, so wait instead of spinning on it
+            if (running_) {
+                std::this_thread::sleep_for(backoff);
+                backoff = std::min(backoff * 2, ACCEPT_BACKOFF_MAX);
+            }
+            continue;
+        }
+        backoff = ACCEPT_BACKOFF_MIN;
+
+        // Join receivers whose peer went away, so reconnecting peers do
+        // not each leave a thread behind until stop()
+        reap_receivers();
+        std::lock_guard<std::mutex> lock(receivers_mutex_);
+        if (!running_) {
+            close_socket(sock);
+            break;
+        }
+        if (receiver_threads_.size() >= config_.max_receivers) {
+            SC_LOG_WARN("Replication: {} peer connections open, refusing another", receiver_threads_.size());
+            close_socket(sock);
+            continue;
+        }
+        receiver_sockets_.push_back(sock);
+        receiver_threads_.emplace_back(&SessionReplicator::receive_loop, this, sock);
+    }
+}
+
+void SessionReplicator::receive_loop(int socket) {
+    uint8_t header[HEADER_SIZE];
+    std::vector<uint8_t> body;
+
+    // Fresh for every connection: batches sealed for any other connection,
+    // including ones recorded before this process started, fail to open
+    uint8_t hello[HELLO_SIZE] = {};
+    store_le<uint32_t>(hello + HELLO_OFF_MAGIC, HELLO_MAGIC);
+    hello[HELLO_OFF_VERSION] = BATCH_VERSION;
+    std::vector<uint8_t> nonce = crypto_->generate_random_bytes(sizeof(uint64_t));
+    uint64_t link_nonce = load_le<uint64_t>(nonce.data());
+    store_le<uint64_t>(hello + HELLO_OFF_LINK_NONCE, link_nonce);
+    uint64_t last_seq = 0;
+
+    bool greeted = send_all(socket, hello, HELLO_SIZE);
+    while (greeted && running_ && recv_all(socket, header, HEADER_SIZE)) {
+        uint32_t body_size = load_le<uint32_t>(header + OFF_BODY_SIZE);
+        if (load_le<uint32_t>(header + OFF_MAGIC) != BATCH_MAGIC || header[OFF_VERSION] != BATCH_VERSION ||
+            body_size < GCM_TAG_SIZE || body_size > MAX_BODY_SIZE) {
+            SC_LOG_WARN("Replication: malformed batch header, dropping peer");
+            break;
+        }
+
+        body.resize(body_size);
+        if (!recv_all(socket, body.data(), body.size())) {
+            break;
+        }
+        if (!apply_batch(header, body, link_nonce, last_seq)) {
+            SC_LOG_WARN("Replication: rejected batch from node {}", load_le<uint32_t>(header + OFF_NODE_ID));
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(receivers_mutex_);
+    receiver_sockets_.erase(std::remove(receiver_sockets_.begin(), receiver_sockets_.end(), socket),
+                            receiver_sockets_.end());
+    close_socket(socket);
+    finished_receivers_.push_back(std::this_thread::get_id());
+}
+
+void SessionReplicator::reap_receivers() {
+    std::vector<std::thread> finished;
+    {
+        std::lock_guard<std::mutex> lock(receivers_mutex_);
+        for (std::thread::id id : finished_receivers_) {
+            auto it = std::find_if(receiver_threads_.begin(), receiver_threads_.end(),
+                                   [id](const std::thread& thread) { return thread.get_id() == id; });
+            if (it != receiver_threads_.end()) {
+                finished.push_back(std::move(*it));
+                std::swap(*it, receiver_threads_.back());
+                receiver_threads_.pop_back();
+            }
+        }
+        finished_receivers_.clear();
+    }
+    for (std::thread& thread : finished) {
+        thread.join();
+    }
+}
+
+bool SessionReplicator::apply_batch(const uint8_t* header, const std::vector<uint8_t>& body,
+                                     uint64_t link_nonce, uint64_t& last_seq) {
+    uint32_t count = load_le<uint32_t>(header + OFF_COUNT);
+    uint32_t raw_size = load_le<uint32_t>(header + OFF_RAW_SIZE);
+    uint64_t seq = load_le<uint64_t>(header + OFF_SEQ);
+    // Checked before decrypting; both fields are authenticated below
+    if (count > MAX_BATCH_CHANGES || raw_size != count * CHANGE_SIZE ||
+        load_le<uint64_t>(header + OFF_LINK_NONCE) != link_nonce || seq <= last_seq) {
+        return false;
+    }
+
+    std::vector<uint8_t> opened;
+    try {
+        opened = crypto_->open_aes_gcm(body, config_.cluster_key, ByteView(header + OFF_IV, IV_SIZE),
+                                       ByteView(header, OFF_IV));
+    } catch (const CryptoException&) {
+        return false;
+    }
+
+    last_seq = seq;
+
+    // Our own batches come back only through a misconfigured peer list
+    if (load_le<uint32_t>(header + OFF_NODE_ID) == config_.node_id) {
+        OPENSSL_cleanse(opened.data(), opened.size());
+        return true;
+    }
+
+    std::vector<uint8_t> raw;
+    if (header[OFF_FLAGS] & BATCH_FLAG_COMPRESSED) {
+        raw.resize(raw_size);
+        uLongf raw_len = raw_size;
+        int rc = uncompress(raw.data(), &raw_len, opened.data(), static_cast<uLong>(opened.size()));
+        OPENSSL_cleanse(opened.data(), opened.size());
+        if (rc != Z_OK || raw_len != raw_size) {
+            OPENSSL_cleanse(raw.data(), raw.size());
+            return false;
+        }
+    } else {
+        raw.swap(opened);
+        if (raw.size() != raw_size) {
+            OPENSSL_cleanse(raw.data(), raw.size());
+            return false;
+        }
+    }
+
+    const uint8_t* in = raw.data();
+    for (uint32_t i = 0; i < count; ++i, in += CHANGE_SIZE) {
+        SessionChange change{};
+        change.op = static_cast<SessionChange::Op>(in[CHANGE_OFF_OP]);
+        if (change.op != SessionChange::Op::PUT && change.op != SessionChange::Op::REMOVE) {
+            continue;
+        }
+        change.session.session_id = load_le<uint32_t>(in + CHANGE_OFF_SESSION_ID);
+        change.session.client_id = load_le<uint32_t>(in + CHANGE_OFF_CLIENT_ID);
+        change.session.key_epoch = load_le<uint32_t>(in + CHANGE_OFF_KEY_EPOCH);
+        change.session.created_at = std::chrono::system_clock::time_point(std::chrono::duration_cast<
+            std::chrono::system_clock::duration>(std::chrono::milliseconds(load_le<uint64_t>(in + CHANGE_OFF_CREATED_AT))));
+        std::memcpy(change.session.key.data(), in + CHANGE_OFF_KEY, KEY_SIZE);
+
+        if (apply_) {
+            apply_(change);
+        }
+        OPENSSL_cleanse(change.session.key.data(), KEY_SIZE);
+    }
+    OPENSSL_cleanse(raw.data(), raw.size());
+
+    uint64_t oldest_ms = load_le<uint64_t>(header + OFF_OLDEST_MS);
+    uint64_t now = now_ms();
+    uint64_t lag = now > oldest_ms ? now - oldest_ms : 0;
+    last_lag_ms_.store(lag, std::memory_order_relaxed);
+    uint64_t max_lag = max_lag_ms_.load(std::memory_order_relaxed);
+    while (lag > max_lag && !max_lag_ms_.compare_exchange_weak(max_lag, lag, std::memory_order_relaxed)) {
+    }
+    batches_received_.fetch_add(1, std::memory_order_relaxed);
+    changes_applied_.fetch_add(count, std::memory_order_relaxed);
+    return true;
+}
+
+ReplicationStats SessionReplicator::stats() const {
+    ReplicationStats stats;
+    stats.batches_sent = batches_sent_.load(std::memory_order_relaxed);
+    stats.changes_sent = changes_sent_.load(std::memory_order_relaxed);
+    stats.raw_bytes = raw_bytes_.load(std::memory_order_relaxed);
+    stats.wire_bytes = wire_bytes_.load(std::memory_order_relaxed);
+    stats.batches_received = batches_received_.load(std::memory_order_relaxed);
+    stats.changes_applied = changes_applied_.load(std::memory_order_relaxed);
+    stats.last_lag_ms = last_lag_ms_.load(std::memory_order_relaxed);
+    stats.max_lag_ms = max_lag_ms_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace SecureComm
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "common.h"
+#include "session_store.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace SecureComm {
+
+class CryptoManager;
+
+// One session-state change carried between nodes
+struct SessionChange {
+    enum class Op : uint8_t {
+        PUT = 0x01,
+        REMOVE = 0x02
+    };
+
+    Op op;
+    // Only session_id is meaningful for REMOVE
+    PersistedSession session;
+};
+
+struct ReplicationPeer {
+    std::string host;
+    uint16_t port;
+};
+
+struct ReplicationConfig {
+    uint32_t node_id = 0;
+    // Port other nodes push to; 0 disables the listener
+    uint16_t listen_port = 0;
+    // IPv4 address the listener binds; loopback unless the cluster spans hosts
+    std::string listen_address = "127.0.0.1";
+    // Peer connections served at once; each may buffer one batch (under 1 MB)
+    // before it authenticates, so this bounds that memory
+    size_t max_receivers = 32;
+    std::vector<ReplicationPeer> peers;
+    // KEY_SIZE bytes shared by every node in the cluster
+    SecureBytes cluster_key;
+    // How long a change may wait for others to join its batch
+    std::chrono::milliseconds flush_interval{10};
+    // Changes per batch, at most 16384
+    size_t max_batch = 1024;
+    // Longest one connect or send to a peer may block the sender thread; a
+    // peer that stops reading is dropped and reconnected instead of
+    // stalling replication to every other peer
+    std::chrono::milliseconds send_timeout{1000};
+};
+
+struct ReplicationStats {
+    uint64_t batches_sent;
+    uint64_t changes_sent;
+    uint64_t raw_bytes;
+    uint64_t wire_bytes;
+    uint64_t batches_received;
+    uint64_t changes_applied;
+    // Change-to-apply delay observed on this node, in milliseconds
+    uint64_t last_lag_ms;
+    uint64_t max_lag_ms;
+};
+
+// Asynchronous session replication between server nodes.
+// Local changes are coalesced per session and flushed by a sender thread as
+// one batch: zlib-compressed, sealed with AES-256-GCM under the cluster key,
+// then pushed to every peer over a persistent TCP connection. A peer that
+// (re)connects first receives a full snapshot. Received changes go to the
+// apply callback and are never re-published, so a full mesh of push links
+// does not loop. A receiver opens every connection by sending a fresh
+// random link nonce; the sender seals each batch for that link with the
+// nonce and a per-link sequence number in the authenticated header, and the
+// receiver rejects any batch whose sequence is not above the last one on the
+// connection. A batch recorded on an earlier connection, or before the
+// receiver restarted, therefore never authenticates again.
+class SessionReplicator {
+public:
+    using ApplyFn = std::function<void(const SessionChange&)>;
+    using SnapshotFn = std::function<std::vector<PersistedSession>()>;
+
+    explicit SessionReplicator(ReplicationConfig config);
+    ~SessionReplicator();
+
+    SessionReplicator(const SessionReplicator&) = delete;
+    SessionReplicator& operator=(const SessionReplicator&) = delete;
+
+    // Set both before start()
+    void set_apply_callback(ApplyFn apply);
+    void set_snapshot_callback(SnapshotFn snapshot);
+
+    // Throws CryptoException if the listen address cannot be bound
+    void start();
+    // Flushes pending changes to connected peers, then joins all threads
+    void stop();
+
+    void publish_put(const PersistedSession& session);
+    void publish_remove(uint32_t session_id);
+
+    uint32_t node_id() const { return config_.node_id; }
+    ReplicationStats stats() const;
+
+private:
+    struct PendingChange {
+        SessionChange change;
+        uint64_t queued_ms;
+    };
+
+    struct PeerLink {
+        ReplicationPeer peer;
+        int socket;
+        std::chrono::steady_clock::time_point next_attempt;
+        // From the receiver's hello; bound into every batch on this connection
+        uint64_t link_nonce;
+        uint64_t batch_seq;
+        // Wait before the next connect; doubles while the link keeps
+        // dropping soon after it connects
+        std::chrono::milliseconds backoff;
+        std::chrono::steady_clock::time_point connected_at;
+    };
+
+    void enqueue(const SessionChange& change);
+    void sender_loop();
+    void connect_peers();
+    // batch comes from encode_batch and is sealed separately for each link
+    void send_to_peers(const std::vector<uint8_t>& batch);
+    void send_snapshot(PeerLink& link);
+    // Closes the link and schedules its reconnect
+    void drop_link(PeerLink& link);
+    // Header with the link fields unset, then the plaintext (maybe
+    // compressed) body; holds key material until cleansed
+    std::vector<uint8_t> encode_batch(const std::vector<SessionChange>& changes, uint64_t oldest_ms);
+    std::vector<uint8_t> seal_batch(const std::vector<uint8_t>& batch, PeerLink& link);
+
+    void accept_loop();
+    void receive_loop(int socket);
+    void reap_receivers();
+    // last_seq is the highest sequence applied on this connection so far
+    bool apply_batch(const uint8_t* header, const std::vector<uint8_t>& body,
+                     uint64_t link_nonce, uint64_t& last_seq);
+
+    ReplicationConfig config_;
+    std::unique_ptr<CryptoManager> crypto_;
+    ApplyFn apply_;
+    SnapshotFn snapshot_;
+    std::atomic<bool> running_;
+
+    // Sender side: latest change per session, waiting for the next batch
+    std::mutex pending_mutex_;
+    std::condition_variable pending_cv_;
+    std::unordered_map<uint32_t, PendingChange> pending_;
+    std::vector<PeerLink> links_;
+    std::thread sender_thread_;
+
+    // Receiver side
+    int listen_socket_;
+    std::thread accept_thread_;
+    std::mutex receivers_mutex_;
+    std::vector<int> receiver_sockets_;
+    std::vector<std::thread> receiver_threads_;
+    // Receivers that have returned, joined by the accept loop
+    std::vector<std::thread::id> finished_receivers_;
+
+    std::atomic<uint64_t> batches_sent_;
+    std::atomic<uint64_t> changes_sent_;
+    std::atomic<uint64_t> raw_bytes_;
+    std::atomic<uint64_t> wire_bytes_;
+    std::atomic<uint64_t> batches_received_;
+    std::atomic<uint64_t> changes_applied_;
+    std::atomic<uint64_t> last_lag_ms_;
+    std::atomic<uint64_t> max_lag_ms_;
+};
+
+} // namespace SecureComm
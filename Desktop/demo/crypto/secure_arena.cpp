@@ -0,0 +1,341 @@
+#include "secure_arena.h"
+#include "logger.h"
+#include <algorithm>
+#include <openssl/crypto.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+namespace SecureComm {
+
+namespace {
+
+// Set while the calling thread's cache is being destroyed; later calls on
+// that thread go straight to the shared lists
+thread_local bool thread_cache_retired = false;
+
+} // namespace
+
+SecureArena& SecureArena::instance() {
+    // Deliberately leaked: outlives every static key holder
+    static SecureArena* arena = new SecureArena();
+    return *arena;
+}
+
+SecureArena::SecureArena()
+    : large_blocks_(0), large_bytes_(0), reserved_bytes_(0), locked_bytes_(0), lock_failures_(0) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    page_size_ = info.dwPageSize;
+#else
+    page_size_ = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+size_t SecureArena::class_index(size_t size) {
+    size_t index = 0;
+    size_t slot_size = MIN_SLOT_SIZE;
+    while (slot_size < size) {
+        slot_size <<= 1;
+        index++;
+    }
+    return index;
+}
+
+size_t SecureArena::class_slot_size(size_t index) {
+    return MIN_SLOT_SIZE << index;
+}
+
+size_t SecureArena::class_cache_limit(size_t index) {
+    // At most a quarter of a slab, and 16 slots, so the slots idle caches
+    // hold cannot keep many otherwise empty slabs mapped
+    size_t per_slab = SLAB_SIZE / class_slot_size(index);
+    return std::max<size_t>(2, std::min<size_t>(16, per_slab / 4));
+}
+
+SecureArena::ThreadCache* SecureArena::thread_cache() {
+    if (thread_cache_retired) {
+        return nullptr;
+    }
+    thread_local ThreadCache cache;
+    return &cache;
+}
+
+SecureArena::ThreadCache::~ThreadCache() {
+    thread_cache_retired = true;
+    SecureArena& arena = instance();
+    for (size_t i = 0; i < CLASS_COUNT; ++i) {
+        arena.drain(i, *this, counts[i]);
+    }
+}
+
+void* SecureArena::map_region(size_t size) {
+    size_t usable = (size + page_size_ - 1) / page_size_ * page_size_;
+    size_t total = usable + 2 * page_size_;
+
+#ifdef _WIN32
+    uint8_t* base = static_cast<uint8_t*>(VirtualAlloc(nullptr, total, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    if (!base) {
+        throw std::bad_alloc();
+    }
+    DWORD old_protect;
+    VirtualProtect(base, page_size_, PAGE_NOACCESS, &old_protect);
+    VirtualProtect(base + page_size_ + usable, page_size_, PAGE_NOACCESS, &old_protect);
+    bool locked = VirtualLock(base + page_size_, usable) != 0;
+#else
+    void* mapping = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    uint8_t* base = static_cast<uint8_t*>(mapping);
+    mprotect(base, page_size_, PROT_NONE);
+    mprotect(base + page_size_ + usable, page_size_, PROT_NONE);
+#ifdef MADV_DONTDUMP
+    madvise(base + page_size_, usable, MADV_DONTDUMP);
+#endif
+    bool locked = mlock(base + page_size_, usable) == 0;
+#endif
+
+    std::lock_guard<std::mutex> lock(region_mutex_);
+    reserved_bytes_ += usable;
+    if (locked) {
+        locked_bytes_ += usable;
+    } else if (lock_failures_++ == 0) {
+        SC_LOG_WARN("Secure arena: could not lock key memory into RAM, continuing unlocked");
+    }
+    return base + page_size_;
+}
+
+void SecureArena::unmap_region(void* pointer, size_t size) noexcept {
+    size_t usable = (size + page_size_ - 1) / page_size_ * page_size_;
+    uint8_t* base = static_cast<uint8_t*>(pointer) - page_size_;
+    OPENSSL_cleanse(pointer, usable);
+
+#ifdef _WIN32
+    bool locked = VirtualUnlock(pointer, usable) != 0;
+    VirtualFree(base, 0, MEM_RELEASE);
+#else
+    bool locked = munlock(pointer, usable) == 0;
+    munmap(base, usable + 2 * page_size_);
+#endif
+
+    std::lock_guard<std::mutex> lock(region_mutex_);
+    reserved_bytes_ -= usable;
+    if (locked) {
+        locked_bytes_ -= usable;
+    }
+}
+
+void SecureArena::add_slab_locked(size_t index) {
+    SizeClass& size_class = classes_[index];
+    size_t slot_size = class_slot_size(index);
+    size_t slot_count = SLAB_SIZE / slot_size;
+    auto slab = std::make_unique<Slab>();
+    slab->base = static_cast<uint8_t*>(map_region(SLAB_SIZE));
+    // Push in reverse so slots are handed out in address order
+    for (size_t i = slot_count; i-- > 0;) {
+        FreeSlot* slot = reinterpret_cast<FreeSlot*>(slab->base + i * slot_size);
+        slot->next = slab->free_list;
+        slab->free_list = slot;
+    }
+    slab->free_slots = slot_count;
+    slab->next = size_class.available;
+    if (size_class.available) {
+        size_class.available->prev = slab.get();
+    }
+    size_class.available = slab.get();
+    size_class.empty_slabs++;
+    size_class.slots_total += slot_count;
+    size_class.slabs.emplace(reinterpret_cast<uintptr_t>(slab->base), std::move(slab));
+}
+
+void SecureArena::unlink_slab(SizeClass& size_class, Slab* slab) noexcept {
+    if (slab->prev) {
+        slab->prev->next = slab->next;
+    } else {
+        size_class.available = slab->next;
+    }
+    if (slab->next) {
+        slab->next->prev = slab->prev;
+    }
+    slab->prev = nullptr;
+    slab->next = nullptr;
+}
+
+SecureArena::FreeSlot* SecureArena::pop_slot_locked(size_t index) {
+    SizeClass& size_class = classes_[index];
+    if (!size_class.available) {
+        add_slab_locked(index);
+    }
+    Slab* slab = size_class.available;
+    if (slab->free_slots == SLAB_SIZE / class_slot_size(index)) {
+        size_class.empty_slabs--;
+    }
+    FreeSlot* slot = slab->free_list;
+    slab->free_list = slot->next;
+    slot->next = nullptr;
+    if (--slab->free_slots == 0) {
+        unlink_slab(size_class, slab);
+    }
+    return slot;
+}
+
+void SecureArena::push_slot_locked(size_t index, FreeSlot* slot) noexcept {
+    SizeClass& size_class = classes_[index];
+    size_t slot_count = SLAB_SIZE / class_slot_size(index);
+    auto it = size_class.slabs.upper_bound(reinterpret_cast<uintptr_t>(slot));
+    --it;
+    Slab* slab = it->second.get();
+    slot->next = slab->free_list;
+    slab->free_list = slot;
+    if (slab->free_slots++ == 0) {
+        slab->next = size_class.available;
+        if (size_class.available) {
+            size_class.available->prev = slab;
+        }
+        size_class.available = slab;
+    }
+    if (slab->free_slots < slot_count) {
+        return;
+    }
+    // Keep one empty slab per class so a class hovering at a slab boundary
+    // does not map and unmap on every call
+    if (++size_class.empty_slabs > 1) {
+        unlink_slab(size_class, slab);
+        unmap_region(slab->base, SLAB_SIZE);
+        size_class.slabs.erase(it);
+        size_class.empty_slabs--;
+        size_class.slots_total -= slot_count;
+    }
+}
+
+void SecureArena::refill(size_t index, ThreadCache& cache) {
+    SizeClass& size_class = classes_[index];
+    size_t batch = class_cache_limit(index) / 2;
+    std::lock_guard<std::mutex> lock(size_class.mutex);
+    for (size_t i = 0; i < batch; ++i) {
+        FreeSlot* slot = pop_slot_locked(index);
+        slot->next = cache.slots[index];
+        cache.slots[index] = slot;
+        cache.counts[index]++;
+        size_class.slots_in_use++;
+    }
+    if (size_class.slots_in_use > size_class.peak_slots_in_use) {
+        size_class.peak_slots_in_use = size_class.slots_in_use;
+    }
+}
+
+void SecureArena::drain(size_t index, ThreadCache& cache, size_t count) noexcept {
+    if (count == 0) {
+        return;
+    }
+    SizeClass& size_class = classes_[index];
+    std::lock_guard<std::mutex> lock(size_class.mutex);
+    for (size_t i = 0; i < count; ++i) {
+        FreeSlot* slot = cache.slots[index];
+        cache.slots[index] = slot->next;
+        push_slot_locked(index, slot);
+    }
+    cache.counts[index] -= count;
+    size_class.slots_in_use -= count;
+}
+
+void* SecureArena::allocate(size_t size) {
+    if (size > MAX_SLOT_SIZE) {
+        void* block = map_region(size);
+        std::lock_guard<std::mutex> lock(region_mutex_);
+        large_blocks_++;
+        large_bytes_ += size;
+        return block;
+    }
+
+    size_t index = class_index(size);
+    if (ThreadCache* cache = thread_cache()) {
+        if (cache->counts[index] == 0) {
+            refill(index, *cache);
+        }
+        FreeSlot* slot = cache->slots[index];
+        cache->slots[index] = slot->next;
+        cache->counts[index]--;
+        slot->next = nullptr;
+        return slot;
+    }
+
+    SizeClass& size_class = classes_[index];
+    std::lock_guard<std::mutex> lock(size_class.mutex);
+    FreeSlot* slot = pop_slot_locked(index);
+    if (++size_class.slots_in_use > size_class.peak_slots_in_use) {
+        size_class.peak_slots_in_use = size_class.slots_in_use;
+    }
+    return slot;
+}
+
+void SecureArena::deallocate(void* pointer, size_t size) noexcept {
+    if (!pointer) {
+        return;
+    }
+    if (size > MAX_SLOT_SIZE) {
+        unmap_region(pointer, size);
+        std::lock_guard<std::mutex> lock(region_mutex_);
+        large_blocks_--;
+        large_bytes_ -= size;
+        return;
+    }
+
+    size_t index = class_index(size);
+    // Wiped before it is cached, so no thread cache ever holds key bytes
+    OPENSSL_cleanse(pointer, class_slot_size(index));
+    FreeSlot* slot = static_cast<FreeSlot*>(pointer);
+    if (ThreadCache* cache = thread_cache()) {
+        slot->next = cache->slots[index];
+        cache->slots[index] = slot;
+        size_t limit = class_cache_limit(index);
+        if (++cache->counts[index] > limit) {
+            drain(index, *cache, cache->counts[index] - limit / 2);
+        }
+        return;
+    }
+
+    SizeClass& size_class = classes_[index];
+    std::lock_guard<std::mutex> lock(size_class.mutex);
+    push_slot_locked(index, slot);
+    size_class.slots_in_use--;
+}
+
+SecureBytes to_secure_bytes(std::vector<uint8_t>&& bytes) {
+    SecureBytes secure(bytes.begin(), bytes.end());
+    OPENSSL_cleanse(bytes.data(), bytes.size());
+    bytes.clear();
+    return secure;
+}
+
+SecureArena::Stats SecureArena::stats() const {
+    Stats result{};
+    for (size_t i = 0; i < CLASS_COUNT; ++i) {
+        const SizeClass& size_class = classes_[i];
+        std::lock_guard<std::mutex> lock(size_class.mutex);
+        ClassStats& out = result.classes[i];
+        out.slot_size = class_slot_size(i);
+        out.slabs = size_class.slabs.size();
+        out.slots_total = size_class.slots_total;
+        out.slots_in_use = size_class.slots_in_use;
+        out.peak_slots_in_use = size_class.peak_slots_in_use;
+        result.slabs += out.slabs;
+        result.slots_total += out.slots_total;
+        result.slots_in_use += out.slots_in_use;
+    }
+    std::lock_guard<std::mutex> lock(region_mutex_);
+    result.large_blocks = large_blocks_;
+    result.large_bytes = large_bytes_;
+    result.reserved_bytes = reserved_bytes_;
+    result.locked_bytes = locked_bytes_;
+    result.lock_failures = lock_failures_;
+    return result;
+}
+
+} // namespace SecureComm
@@ -0,0 +1,502 @@
+#include "session_store.h"
+#include "crypto_utils.h"
+#include "mapped_file.h"
+#include "logger.h"
+#include "wire_codec.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace SecureComm {
+
+namespace {
+
+constexpr char FILE_MAGIC[8] = {'S', 'C', 'S', 'T', 'O', 'R', 'E', '1'};
+constexpr size_t FILE_HEADER_SIZE = 16;
+constexpr uint32_t FILE_VERSION = 1;
+constexpr uint32_t RECORD_MAGIC = 0x31524353; // "SCR1"
+
+// Record layout (little-endian)
+constexpr size_t OFF_MAGIC = 0;
+constexpr size_t OFF_OP = 4;
+constexpr size_t OFF_SESSION_ID = 8;
+constexpr size_t OFF_CLIENT_ID = 12;
+constexpr size_t OFF_KEY_EPOCH = 16;
+constexpr size_t OFF_CREATED_AT = 24;
+constexpr size_t OFF_IV = 32;
+constexpr size_t OFF_SEALED_KEY = 44;
+constexpr size_t OFF_CRC = 92;
+constexpr size_t SEALED_KEY_SIZE = KEY_SIZE + GCM_TAG_SIZE;
+static_assert(OFF_SEALED_KEY + SEALED_KEY_SIZE == OFF_CRC, "Record layout mismatch");
+static_assert(OFF_CRC + 4 == PersistentSessionStore::RECORD_SIZE, "Record layout mismatch");
+
+// Compact once the log holds this many dead records beyond the live set
+constexpr size_t COMPACT_SLACK_RECORDS = 4096;
+
+uint32_t crc32(const uint8_t* data, size_t size) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+std::vector<uint8_t> file_header() {
+    std::vector<uint8_t> header(FILE_HEADER_SIZE, 0);
+    std::memcpy(header.data(), FILE_MAGIC, sizeof(FILE_MAGIC));
+    store_le<uint32_t>(header.data() + 8, FILE_VERSION);
+    store_le<uint32_t>(header.data() + 12, static_cast<uint32_t>(PersistentSessionStore::RECORD_SIZE));
+    return header;
+}
+
+bool truncate_file(const std::string& path, size_t size) {
+#ifdef _WIN32
+    std::ifstream in(path, std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), static_cast<std::streamsize>(std::min(size, contents.size())));
+    return static_cast<bool>(out);
+#else
+    return ::truncate(path.c_str(), static_cast<off_t>(size)) == 0;
+#endif
+}
+
+void sync_file(std::FILE* file) {
+    std::fflush(file);
+#ifdef _WIN32
+    _commit(_fileno(file));
+#else
+    fdatasync(fileno(file));
+#endif
+}
+
+} // namespace
+
+PersistentSessionStore::PersistentSessionStore(const std::string& path, ByteView store_key)
+    : path_(path),
+      store_key_(store_key.begin(), store_key.end()),
+      seal_ctx_(std::make_unique<EVPContext>()),
+      open_ctx_(std::make_unique<EVPContext>()),
+      file_(nullptr),
+      file_records_(0),
+      compacting_(false),
+      compact_requested_(false),
+      stopping_(false) {
+    if (store_key_.size() != KEY_SIZE) {
+        throw CryptoException("Session store key must be " + std::to_string(KEY_SIZE) + " bytes");
+    }
+    if (EVP_EncryptInit_ex(seal_ctx_->get(), EVP_aes_256_gcm(), nullptr, store_key_.data(), nullptr) != 1 ||
+        EVP_DecryptInit_ex(open_ctx_->get(), EVP_aes_256_gcm(), nullptr, store_key_.data(), nullptr) != 1) {
+        throw CryptoException("Failed to initialize session store cipher");
+    }
+    compactor_ = std::thread(&PersistentSessionStore::compactor_loop, this);
+}
+
+PersistentSessionStore::~PersistentSessionStore() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    compact_cv_.notify_one();
+    compactor_.join();
+
+    if (file_) {
+        sync_file(file_);
+        std::fclose(file_);
+    }
+    OPENSSL_cleanse(store_key_.data(), store_key_.size());
+}
+
+std::vector<PersistedSession> PersistentSessionStore::load() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    live_.clear();
+    file_records_ = 0;
+
+    size_t valid_size = 0;
+    {
+        MappedFile mapped(path_);
+        const uint8_t* data = mapped.data();
+        size_t size = mapped.size();
+
+        if (size >= FILE_HEADER_SIZE) {
+            std::vector<uint8_t> expected = file_header();
+            if (std::memcmp(data, expected.data(), FILE_HEADER_SIZE) != 0) {
+                throw CryptoException("Unrecognized session store format: " + path_);
+            }
+            valid_size = FILE_HEADER_SIZE;
+            live_.reserve((size - FILE_HEADER_SIZE) / RECORD_SIZE);
+
+            // Replay; stop at the first damaged record (torn write at crash)
+            for (size_t offset = FILE_HEADER_SIZE; offset + RECORD_SIZE <= size; offset += RECORD_SIZE) {
+                const uint8_t* record = data + offset;
+                if (load_le<uint32_t>(record + OFF_MAGIC) != RECORD_MAGIC ||
+                    load_le<uint32_t>(record + OFF_CRC) != crc32(record, OFF_CRC)) {
+                    break;
+                }
+
+                uint32_t session_id = load_le<uint32_t>(record + OFF_SESSION_ID);
+                if (static_cast<RecordOp>(record[OFF_OP]) == RecordOp::PUT) {
+                    Record& slot = live_[session_id];
+                    std::memcpy(slot.data(), record, RECORD_SIZE);
+                } else {
+                    live_.erase(session_id);
+                }
+                file_records_++;
+                valid_size = offset + RECORD_SIZE;
+            }
+
+            if (valid_size != size) {
+                SC_LOG_WARN("Session store: dropping {} bytes of damaged tail from {}", size - valid_size, path_);
+            }
+        }
+    }
+
+    if (valid_size == 0) {
+        // New (or empty) store: start with a fresh header
+        std::FILE* file = std::fopen(path_.c_str(), "wb");
+        if (!file) {
+            throw CryptoException("Failed to create session store: " + path_);
+        }
+        std::vector<uint8_t> header = file_header();
+        std::fwrite(header.data(), 1, header.size(), file);
+        sync_file(file);
+        std::fclose(file);
+    } else if (!truncate_file(path_, valid_size)) {
+        throw CryptoException("Failed to truncate damaged session store: " + path_);
+    }
+
+    // Only live records are decrypted
+    std::vector<PersistedSession> sessions;
+    sessions.reserve(live_.size());
+    for (auto it = live_.begin(); it != live_.end();) {
+        PersistedSession session;
+        RecordOp op;
+        if (decode(it->second.data(), session, op)) {
+            sessions.push_back(session);
+            ++it;
+        } else {
+            SC_LOG_WARN("Session store: record for session {} failed authentication, skipping", it->first);
+            it = live_.erase(it);
+        }
+    }
+
+    open_for_append();
+    return sessions;
+}
+
+void PersistentSessionStore::put(const PersistedSession& session) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Record record = encode_put(session);
+    append(record);
+    live_[session.session_id] = record;
+    maybe_compact();
+}
+
+void PersistentSessionStore::remove(uint32_t session_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (live_.erase(session_id) == 0) {
+        return;
+    }
+    append(encode_delete(session_id));
+    maybe_compact();
+}
+
+void PersistentSessionStore::compact() {
+    std::lock_guard<std::mutex> compaction(compact_mutex_);
+
+    // Snapshot the live records; writers go on appending meanwhile
+    std::vector<Record> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!file_) {
+            throw CryptoException("Session store not loaded: " + path_);
+        }
+        snapshot.reserve(live_.size());
+        for (const auto& pair : live_) {
+            snapshot.push_back(pair.second);
+        }
+        compacting_ = true;
+        compact_tail_.clear();
+    }
+    auto abandon = [this]() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        compacting_ = false;
+        compact_tail_.clear();
+    };
+
+    std::string temp_path = path_ + ".tmp";
+    std::FILE* temp = std::fopen(temp_path.c_str(), "wb");
+    if (!temp) {
+        abandon();
+        throw CryptoException("Failed to create compaction file: " + temp_path);
+    }
+    std::vector<uint8_t> header = file_header();
+    std::fwrite(header.data(), 1, header.size(), temp);
+    for (const Record& record : snapshot) {
+        std::fwrite(record.data(), 1, RECORD_SIZE, temp);
+    }
+    sync_file(temp);
+    if (std::ferror(temp)) {
+        std::fclose(temp);
+        std::remove(temp_path.c_str());
+        abandon();
+        throw CryptoException("Failed to write compaction file: " + temp_path);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    compacting_ = false;
+    // Replay what was appended while the snapshot was written; the tail is
+    // short, so only its write and sync happen under the lock
+    for (const Record& record : compact_tail_) {
+        std::fwrite(record.data(), 1, RECORD_SIZE, temp);
+    }
+    size_t records = snapshot.size() + compact_tail_.size();
+    compact_tail_.clear();
+    sync_file(temp);
+    bool write_ok = !std::ferror(temp);
+    std::fclose(temp);
+    if (!write_ok) {
+        std::remove(temp_path.c_str());
+        throw CryptoException("Failed to write compaction file: " + temp_path);
+    }
+
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+#ifdef _WIN32
+    std::remove(path_.c_str());
+#endif
+    // rename() is atomic, so a crash leaves either the old or the new file
+    if (std::rename(temp_path.c_str(), path_.c_str()) != 0) {
+        open_for_append();
+        throw CryptoException("Failed to replace session store with compacted file");
+    }
+    file_records_ = records;
+    open_for_append();
+}
+
+void PersistentSessionStore::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_) {
+        sync_file(file_);
+    }
+}
+
+size_t PersistentSessionStore::live_records() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return live_.size();
+}
+
+size_t PersistentSessionStore::file_records() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return file_records_;
+}
+
+SecureBytes PersistentSessionStore::load_key(const std::string& key_path) {
+    std::ifstream in(key_path, std::ios::binary);
+    if (!in) {
+        throw CryptoException("Key file not found: " + key_path);
+    }
+    SecureBytes key(KEY_SIZE);
+    in.read(reinterpret_cast<char*>(key.data()), static_cast<std::streamsize>(key.size()));
+    if (in.gcount() != static_cast<std::streamsize>(KEY_SIZE) || in.peek() != std::ifstream::traits_type::eof()) {
+        throw CryptoException("Key file is not " + std::to_string(KEY_SIZE) + " bytes: " + key_path);
+    }
+    return key;
+}
+
+SecureBytes PersistentSessionStore::load_or_create_key(const std::string& key_path) {
+    if (std::ifstream(key_path, std::ios::binary)) {
+        return load_key(key_path);
+    }
+
+    CryptoManager crypto;
+    SecureBytes key = crypto.generate_secure_key(KEY_SIZE);
+    std::vector<uint8_t> suffix = crypto.generate_random_bytes(8);
+    std::string temp_path = key_path + "." + std::to_string(load_le<uint64_t>(suffix.data())) + ".tmp";
+#ifdef _WIN32
+    {
+        std::ofstream out(temp_path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(key.data()), static_cast<std::streamsize>(key.size()));
+        if (!out) {
+            std::remove(temp_path.c_str());
+            throw CryptoException("Failed to write key: " + key_path);
+        }
+    }
+    // Unlike POSIX, rename() here fails rather than replace an existing file
+    bool created = std::rename(temp_path.c_str(), key_path.c_str()) == 0;
+#else
+    // Owner-only permissions
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 || ::write(fd, key.data(), key.size()) != static_cast<ssize_t>(key.size()) || fsync(fd) != 0) {
+        if (fd >= 0) {
+            ::close(fd);
+            ::unlink(temp_path.c_str());
+        }
+        throw CryptoException("Failed to write key: " + key_path);
+    }
+    ::close(fd);
+    // link() publishes the complete file and, unlike rename(), fails if a
+    // concurrent creator got there first
+    bool created = ::link(temp_path.c_str(), key_path.c_str()) == 0;
+    int link_error = errno;
+    ::unlink(temp_path.c_str());
+    if (!created && link_error != EEXIST) {
+        throw CryptoException("Failed to write key: " + key_path + " (" + std::strerror(link_error) + ")");
+    }
+#endif
+    if (!created) {
+        // Lost the race; the winner's file is complete
+        std::remove(temp_path.c_str());
+        return load_key(key_path);
+    }
+    return key;
+}
+
+PersistentSessionStore::Record PersistentSessionStore::encode_put(const PersistedSession& session) {
+    Record record{};
+    store_le<uint32_t>(record.data() + OFF_MAGIC, RECORD_MAGIC);
+    record[OFF_OP] = static_cast<uint8_t>(RecordOp::PUT);
+    store_le<uint32_t>(record.data() + OFF_SESSION_ID, session.session_id);
+    store_le<uint32_t>(record.data() + OFF_CLIENT_ID, session.client_id);
+    store_le<uint32_t>(record.data() + OFF_KEY_EPOCH, session.key_epoch);
+    auto created_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        session.created_at.time_since_epoch()).count();
+    store_le<uint64_t>(record.data() + OFF_CREATED_AT, static_cast<uint64_t>(created_ms));
+
+    // Seal the key; the ids, epoch and timestamp are authenticated as associated data
+    if (RAND_bytes(record.data() + OFF_IV, static_cast<int>(IV_SIZE)) != 1) {
+        throw CryptoException("Failed to generate session store IV");
+    }
+    seal_key(record.data() + OFF_SESSION_ID, OFF_IV - OFF_SESSION_ID, session.key,
+             record.data() + OFF_IV, record.data() + OFF_SEALED_KEY);
+    store_le<uint32_t>(record.data() + OFF_CRC, crc32(record.data(), OFF_CRC));
+    return record;
+}
+
+PersistentSessionStore::Record PersistentSessionStore::encode_delete(uint32_t session_id) {
+    Record record{};
+    store_le<uint32_t>(record.data() + OFF_MAGIC, RECORD_MAGIC);
+    record[OFF_OP] = static_cast<uint8_t>(RecordOp::DEL);
+    store_le<uint32_t>(record.data() + OFF_SESSION_ID, session_id);
+    store_le<uint32_t>(record.data() + OFF_CRC, crc32(record.data(), OFF_CRC));
+    return record;
+}
+
+bool PersistentSessionStore::decode(const uint8_t* data, PersistedSession& session, RecordOp& op) {
+    op = static_cast<RecordOp>(data[OFF_OP]);
+    session.session_id = load_le<uint32_t>(data + OFF_SESSION_ID);
+    session.client_id = load_le<uint32_t>(data + OFF_CLIENT_ID);
+    session.key_epoch = load_le<uint32_t>(data + OFF_KEY_EPOCH);
+    session.created_at = std::chrono::system_clock::time_point(
+        std::chrono::milliseconds(static_cast<int64_t>(load_le<uint64_t>(data + OFF_CREATED_AT))));
+    if (op != RecordOp::PUT) {
+        return true;
+    }
+
+    return open_key(data + OFF_SESSION_ID, OFF_IV - OFF_SESSION_ID, data + OFF_SEALED_KEY,
+                    data + OFF_IV, session.key);
+}
+
+void PersistentSessionStore::seal_key(const uint8_t* aad, size_t aad_size, const SessionKey& key,
+                                      const uint8_t* iv, uint8_t* sealed_out) {
+    EVP_CIPHER_CTX* ctx = seal_ctx_->get();
+    int len = 0;
+    if (EVP_EncryptInit_ex(ctx, nullptr, nullptr, nullptr, iv) != 1 ||
+        EVP_EncryptUpdate(ctx, nullptr, &len, aad, static_cast<int>(aad_size)) != 1 ||
+        EVP_EncryptUpdate(ctx, sealed_out, &len, key.data(), static_cast<int>(key.size())) != 1 ||
+        EVP_EncryptFinal_ex(ctx, sealed_out + len, &len) != 1 ||
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, static_cast<int>(GCM_TAG_SIZE), sealed_out + KEY_SIZE) != 1) {
+        throw CryptoException("Failed to seal session key");
+    }
+}
+
+bool PersistentSessionStore::open_key(const uint8_t* aad, size_t aad_size, const uint8_t* sealed,
+                                      const uint8_t* iv, SessionKey& key_out) {
+    EVP_CIPHER_CTX* ctx = open_ctx_->get();
+    uint8_t tag[GCM_TAG_SIZE];
+    std::memcpy(tag, sealed + KEY_SIZE, GCM_TAG_SIZE);
+    int len = 0;
+    if (EVP_DecryptInit_ex(ctx, nullptr, nullptr, nullptr, iv) != 1 ||
+        EVP_DecryptUpdate(ctx, nullptr, &len, aad, static_cast<int>(aad_size)) != 1 ||
+        EVP_DecryptUpdate(ctx, key_out.data(), &len, sealed, static_cast<int>(KEY_SIZE)) != 1 ||
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, static_cast<int>(GCM_TAG_SIZE), tag) != 1 ||
+        EVP_DecryptFinal_ex(ctx, key_out.data() + len, &len) != 1) {
+        OPENSSL_cleanse(key_out.data(), key_out.size());
+        return false;
+    }
+    return true;
+}
+
+void PersistentSessionStore::append(const Record& record) {
+    if (!file_) {
+        throw CryptoException("Session store not loaded: " + path_);
+    }
+    if (std::fwrite(record.data(), 1, RECORD_SIZE, file_) != RECORD_SIZE) {
+        throw CryptoException("Failed to append to session store: " + path_);
+    }
+    file_records_++;
+    if (compacting_) {
+        compact_tail_.push_back(record);
+    }
+}
+
+void PersistentSessionStore::open_for_append() {
+    file_ = std::fopen(path_.c_str(), "ab");
+    if (!file_) {
+        throw CryptoException("Failed to open session store: " + path_);
+    }
+    // Unbuffered: each record is one write(), so it survives a process crash
+    std::setvbuf(file_, nullptr, _IONBF, 0);
+}
+
+void PersistentSessionStore::maybe_compact() {
+    // Called with mutex_ held: hand the rewrite to the compactor thread
+    if (!compacting_ && !compact_requested_ &&
+        file_records_ > live_.size() * 2 + COMPACT_SLACK_RECORDS) {
+        compact_requested_ = true;
+        compact_cv_.notify_one();
+    }
+}
+
+void PersistentSessionStore::compactor_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        compact_cv_.wait(lock, [this]() { return compact_requested_ || stopping_; });
+        if (stopping_) {
+            return;
+        }
+        lock.unlock();
+        try {
+            compact();
+        } catch (const std::exception& e) {
+            SC_LOG_WARN("Session store: background compaction failed: {}", e.what());
+        }
+        lock.lock();
+        compact_requested_ = false;
+    }
+}
+
+} // namespace SecureComm
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "common.h"
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace SecureComm {
+
+class EVPContext;
+
+// Session state written to disk
+struct PersistedSession {
+    uint32_t session_id;
+    uint32_t client_id;
+    uint32_t key_epoch;
+    std::chrono::system_clock::time_point created_at;
+    SessionKey key;
+};
+
+// Append-and-compact session log.
+// The file is a 16-byte header followed by fixed-size records (PUT or DEL).
+// Key material is sealed with AES-256-GCM under the store key and bound to
+// the record's ids as associated data; every record carries a CRC32 so a
+// torn tail left by a crash is detected and truncated on load. Loading
+// memory-maps the file and replays it (last record per session wins), and
+// compact() rewrites only the live records through a temp file + rename.
+// Compaction writes a snapshot of the live records without holding the
+// store lock, so put() and remove() carry on meanwhile; the records they
+// append in that window are replayed into the new file before the swap.
+// Automatic compaction runs on a background thread.
+class PersistentSessionStore {
+public:
+    static constexpr size_t RECORD_SIZE = 96;
+
+    PersistentSessionStore(const std::string& path, ByteView store_key);
+    ~PersistentSessionStore();
+
+    PersistentSessionStore(const PersistentSessionStore&) = delete;
+    PersistentSessionStore& operator=(const PersistentSessionStore&) = delete;
+
+    // Replay the log and return every live session (call once, before writes)
+    std::vector<PersistedSession> load();
+
+    void put(const PersistedSession& session);
+    void remove(uint32_t session_id);
+
+    // Rewrite the file with live records only; writers are not blocked
+    // while the snapshot is written
+    void compact();
+    // Push buffered records to disk (fdatasync where available)
+    void flush();
+
+    size_t live_records() const;
+    size_t file_records() const;
+
+    // Read the 32-byte key in key_path; throws CryptoException if the file
+    // is missing or not exactly KEY_SIZE bytes
+    static SecureBytes load_key(const std::string& key_path);
+    // load_key, creating the file first if it is missing. The key is written
+    // to a temp file and linked into place, so a reader never sees a partial
+    // key and concurrent creators all end up with the one that won
+    static SecureBytes load_or_create_key(const std::string& key_path);
+
+private:
+    enum class RecordOp : uint8_t {
+        PUT = 0x01,
+        DEL = 0x02
+    };
+
+    using Record = std::array<uint8_t, RECORD_SIZE>;
+
+    Record encode_put(const PersistedSession& session);
+    Record encode_delete(uint32_t session_id);
+    bool decode(const uint8_t* data, PersistedSession& session, RecordOp& op);
+    void seal_key(const uint8_t* aad, size_t aad_size, const SessionKey& key,
+                  const uint8_t* iv, uint8_t* sealed_out);
+    bool open_key(const uint8_t* aad, size_t aad_size, const uint8_t* sealed,
+                  const uint8_t* iv, SessionKey& key_out);
+    void append(const Record& record);
+    void open_for_append();
+    void maybe_compact();
+    void compactor_loop();
+
+    std::string path_;
+    SecureBytes store_key_;
+    // Keyed once; per record only the IV is reset (no key schedule per record)
+    std::unique_ptr<EVPContext> seal_ctx_;
+    std::unique_ptr<EVPContext> open_ctx_;
+    std::FILE* file_;
+    mutable std::mutex mutex_;
+    // Latest record per live session, used by compact()
+    std::unordered_map<uint32_t, Record> live_;
+    size_t file_records_;
+
+    // One compaction at a time; held without mutex_ while the snapshot is written
+    std::mutex compact_mutex_;
+    // Set while a snapshot is being written; append() then also queues its
+    // record in compact_tail_ for replay into the compacted file
+    bool compacting_;
+    std::vector<Record> compact_tail_;
+    std::condition_variable compact_cv_;
+    bool compact_requested_;
+    bool stopping_;
+    std::thread compactor_;
+};
+
+} // namespace SecureComm
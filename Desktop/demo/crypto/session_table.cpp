@@ -0,0 +1,142 @@
+#include "session_table.h"
+#include <stdexcept>
+#include <utility>
+
+namespace SecureComm {
+
+namespace {
+size_t round_up_pow2(size_t value) {
+    size_t capacity = FlatSessionTable::MIN_CAPACITY;
+    while (capacity < value) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+}
+
+FlatSessionTable::FlatSessionTable(size_t initial_capacity)
+    : size_(0), mask_(0) {
+    size_t capacity = round_up_pow2(initial_capacity);
+    ids_.assign(capacity, EMPTY_ID);
+    sessions_.resize(capacity);
+    mask_ = capacity - 1;
+}
+
+size_t FlatSessionTable::find_slot(uint32_t id) const {
+    size_t slot = home_slot(id);
+    while (ids_[slot] != EMPTY_ID) {
+        if (ids_[slot] == id) {
+            return slot;
+        }
+        slot = (slot + 1) & mask_;
+    }
+    return ids_.size();
+}
+
+SessionHandle FlatSessionTable::find(uint32_t session_id) const {
+    if (session_id == EMPTY_ID) {
+        return nullptr;
+    }
+    size_t slot = find_slot(session_id);
+    return slot == ids_.size() ? nullptr : sessions_[slot];
+}
+
+bool FlatSessionTable::contains(uint32_t session_id) const {
+    return session_id != EMPTY_ID && find_slot(session_id) != ids_.size();
+}
+
+bool FlatSessionTable::insert(uint32_t session_id, SessionHandle session) {
+    if (session_id == EMPTY_ID) {
+        throw std::invalid_argument("Session id 0 is reserved");
+    }
+
+    // Keep the load factor at or below 3/4
+    if ((size_ + 1) * 4 > ids_.size() * 3) {
+        rehash(ids_.size() * 2);
+    }
+
+    size_t slot = home_slot(session_id);
+    while (ids_[slot] != EMPTY_ID) {
+        if (ids_[slot] == session_id) {
+            sessions_[slot] = std::move(session);
+            return false;
+        }
+        slot = (slot + 1) & mask_;
+    }
+
+    ids_[slot] = session_id;
+    sessions_[slot] = std::move(session);
+    size_++;
+    return true;
+}
+
+SessionHandle FlatSessionTable::erase(uint32_t session_id) {
+    if (session_id == EMPTY_ID) {
+        return nullptr;
+    }
+    size_t slot = find_slot(session_id);
+    if (slot == ids_.size()) {
+        return nullptr;
+    }
+
+    SessionHandle removed = std::move(sessions_[slot]);
+    ids_[slot] = EMPTY_ID;
+    size_--;
+
+    // Backward-shift the rest of the probe run into the hole
+    size_t hole = slot;
+    size_t next = (hole + 1) & mask_;
+    while (ids_[next] != EMPTY_ID) {
+        size_t home = home_slot(ids_[next]);
+        // Move the entry only if its home slot is not in (hole, next]
+        if (((next - home) & mask_) >= ((next - hole) & mask_)) {
+            ids_[hole] = ids_[next];
+            sessions_[hole] = std::move(sessions_[next]);
+            ids_[next] = EMPTY_ID;
+            hole = next;
+        }
+        next = (next + 1) & mask_;
+    }
+
+    if (ids_.size() > MIN_CAPACITY && size_ * 8 < ids_.size()) {
+        rehash(ids_.size() / 2);
+    }
+    return removed;
+}
+
+void FlatSessionTable::clear() {
+    std::vector<uint32_t>(MIN_CAPACITY, EMPTY_ID).swap(ids_);
+    std::vector<SessionHandle>(MIN_CAPACITY).swap(sessions_);
+    size_ = 0;
+    mask_ = MIN_CAPACITY - 1;
+}
+
+void FlatSessionTable::reserve(size_t count) {
+    size_t needed = round_up_pow2((count * 4 + 2) / 3);
+    if (needed > ids_.size()) {
+        rehash(needed);
+    }
+}
+
+void FlatSessionTable::rehash(size_t new_capacity) {
+    new_capacity = round_up_pow2(new_capacity);
+    std::vector<uint32_t> old_ids(new_capacity, EMPTY_ID);
+    std::vector<SessionHandle> old_sessions(new_capacity);
+    old_ids.swap(ids_);
+    old_sessions.swap(sessions_);
+    mask_ = new_capacity - 1;
+
+    for (size_t i = 0; i < old_ids.size(); ++i) {
+        if (old_ids[i] == EMPTY_ID) {
+            continue;
+        }
+        size_t slot = home_slot(old_ids[i]);
+        while (ids_[slot] != EMPTY_ID) {
+            slot = (slot + 1) & mask_;
+        }
+        ids_[slot] = old_ids[i];
+        sessions_[slot] = std::move(old_sessions[i]);
+    }
+}
+
+} // namespace SecureComm
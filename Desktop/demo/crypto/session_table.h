@@ -0,0 +1,70 @@
+#pragma once
+
+#include "common.h"
+#include <memory>
+#include <vector>
+
+namespace SecureComm {
+
+class Session;
+using SessionHandle = std::shared_ptr<Session>;
+
+// Open-addressing session table keyed by session_id.
+// Probing walks a dense array of 4-byte ids (16 per cache line); the
+// handles live in a parallel array that is only touched on a hit.
+// Linear probing with backward-shift deletion leaves no tombstones, and
+// the table shrinks once it drops below 1/8 occupancy so erased sessions
+// give their memory back.
+class FlatSessionTable {
+public:
+    static constexpr size_t MIN_CAPACITY = 16;
+
+    explicit FlatSessionTable(size_t initial_capacity = MIN_CAPACITY);
+
+    SessionHandle find(uint32_t session_id) const;
+    bool contains(uint32_t session_id) const;
+    // Inserts or replaces; returns true if the id was not present
+    bool insert(uint32_t session_id, SessionHandle session);
+    // Returns the removed handle, or nullptr if the id was not present
+    SessionHandle erase(uint32_t session_id);
+    void clear();
+    void reserve(size_t count);
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return ids_.size(); }
+    bool empty() const { return size_ == 0; }
+
+    // fn(uint32_t session_id, const SessionHandle& session)
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        for (size_t i = 0; i < ids_.size(); ++i) {
+            if (ids_[i] != EMPTY_ID) {
+                fn(ids_[i], sessions_[i]);
+            }
+        }
+    }
+
+private:
+    // generate_session_id never returns 0, so it marks a free slot
+    static constexpr uint32_t EMPTY_ID = 0;
+
+    // Mixes the id independently of the shard selector in SessionManager
+    static uint32_t hash(uint32_t id) {
+        id ^= id >> 16;
+        id *= 0x85EBCA6Bu;
+        id ^= id >> 13;
+        id *= 0xC2B2AE35u;
+        id ^= id >> 16;
+        return id;
+    }
+    size_t home_slot(uint32_t id) const { return hash(id) & mask_; }
+    size_t find_slot(uint32_t id) const;
+    void rehash(size_t new_capacity);
+
+    std::vector<uint32_t> ids_;
+    std::vector<SessionHandle> sessions_;
+    size_t size_;
+    size_t mask_;
+};
+
+} // namespace SecureComm
@@ -0,0 +1,185 @@
+#include "session_ticket.h"
+#include "crypto_utils.h"
+#include "wire_codec.h"
+#include <algorithm>
+
+namespace SecureComm {
+
+namespace {
+
+// Ticket layout (little-endian)
+constexpr size_t OFF_KEY_ID = 0;
+constexpr size_t OFF_IV = 4;
+constexpr size_t OFF_SEALED = 16;
+
+// Sealed state layout
+constexpr size_t STATE_SESSION_ID = 0;
+constexpr size_t STATE_CLIENT_ID = 4;
+constexpr size_t STATE_CREATED_AT = 8;
+constexpr size_t STATE_ISSUED_AT = 16;
+constexpr size_t STATE_KEY_EPOCH = 24;
+constexpr size_t STATE_SECRET = 28;
+constexpr size_t PLAINTEXT_SIZE = STATE_SECRET + KEY_SIZE;
+static_assert(OFF_SEALED + PLAINTEXT_SIZE + GCM_TAG_SIZE == SessionTicketManager::TICKET_SIZE,
+              "Ticket layout mismatch");
+
+uint64_t to_ms(std::chrono::system_clock::time_point when) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        when.time_since_epoch()).count());
+}
+
+std::chrono::system_clock::time_point from_ms(uint64_t ms) {
+    return std::chrono::system_clock::time_point(std::chrono::milliseconds(static_cast<int64_t>(ms)));
+}
+
+} // namespace
+
+SessionTicketManager::SessionTicketManager(std::chrono::seconds ticket_lifetime)
+    : ticket_lifetime_(ticket_lifetime), next_key_id_(0), timer_wheel_(nullptr),
+      rotation_interval_(TICKET_KEY_ROTATION_INTERVAL), rotation_timer_(TimerWheel::INVALID_TIMER) {
+    CryptoManager crypto;
+    // Random starting id so ids from before a restart are not reused
+    next_key_id_ = crypto.generate_random_uint32();
+    rotate_keys();
+}
+
+SessionTicketManager::~SessionTicketManager() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (timer_wheel_ && rotation_timer_ != TimerWheel::INVALID_TIMER) {
+        timer_wheel_->cancel(rotation_timer_);
+    }
+    for (TicketKey& key : keys_) {
+        OPENSSL_cleanse(key.key.data(), key.key.size());
+    }
+}
+
+std::vector<uint8_t> SessionTicketManager::issue(const SessionTicket& ticket) {
+    std::vector<uint8_t> state(PLAINTEXT_SIZE);
+    store_le<uint32_t>(state.data() + STATE_SESSION_ID, ticket.session_id);
+    store_le<uint32_t>(state.data() + STATE_CLIENT_ID, ticket.client_id);
+    store_le<uint64_t>(state.data() + STATE_CREATED_AT, to_ms(ticket.created_at));
+    store_le<uint64_t>(state.data() + STATE_ISSUED_AT, to_ms(ticket.issued_at));
+    store_le<uint32_t>(state.data() + STATE_KEY_EPOCH, ticket.key_epoch);
+    std::copy(ticket.resumption_secret.begin(), ticket.resumption_secret.end(), state.begin() + STATE_SECRET);
+
+    CryptoManager crypto;
+    std::vector<uint8_t> iv = crypto.generate_random_bytes(IV_SIZE);
+    std::vector<uint8_t> sealed_ticket(OFF_SEALED);
+    std::vector<uint8_t> sealed_state;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const TicketKey& current = keys_.front();
+        store_le<uint32_t>(sealed_ticket.data() + OFF_KEY_ID, current.id);
+        sealed_state = crypto.seal_aes_gcm(state, current.key, iv, ByteView(sealed_ticket.data(), OFF_IV));
+    }
+    OPENSSL_cleanse(state.data(), state.size());
+
+    std::copy(iv.begin(), iv.end(), sealed_ticket.begin() + OFF_IV);
+    sealed_ticket.insert(sealed_ticket.end(), sealed_state.begin(), sealed_state.end());
+    return sealed_ticket;
+}
+
+bool SessionTicketManager::open(ByteView sealed, SessionTicket& ticket) {
+    if (sealed.size() != TICKET_SIZE) {
+        return false;
+    }
+
+    uint32_t key_id = load_le<uint32_t>(sealed.data() + OFF_KEY_ID);
+    ByteView aad = sealed.subview(0, OFF_IV);
+    ByteView iv = sealed.subview(OFF_IV, OFF_SEALED - OFF_IV);
+    ByteView sealed_state = sealed.subview(OFF_SEALED);
+
+    CryptoManager crypto;
+    std::vector<uint8_t> state;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto key = std::find_if(keys_.begin(), keys_.end(),
+                                [key_id](const TicketKey& candidate) { return candidate.id == key_id; });
+        if (key == keys_.end()) {
+            return false; // sealed under a key that has been rotated out
+        }
+        try {
+            state = crypto.open_aes_gcm(sealed_state, key->key, iv, aad);
+        } catch (const CryptoException&) {
+            return false;
+        }
+    }
+    if (state.size() != PLAINTEXT_SIZE) {
+        OPENSSL_cleanse(state.data(), state.size());
+        return false;
+    }
+
+    ticket.session_id = load_le<uint32_t>(state.data() + STATE_SESSION_ID);
+    ticket.client_id = load_le<uint32_t>(state.data() + STATE_CLIENT_ID);
+    ticket.created_at = from_ms(load_le<uint64_t>(state.data() + STATE_CREATED_AT));
+    ticket.issued_at = from_ms(load_le<uint64_t>(state.data() + STATE_ISSUED_AT));
+    ticket.key_epoch = load_le<uint32_t>(state.data() + STATE_KEY_EPOCH);
+    std::copy(state.begin() + STATE_SECRET, state.end(), ticket.resumption_secret.begin());
+    OPENSSL_cleanse(state.data(), state.size());
+
+    auto now = std::chrono::system_clock::now();
+    if (now - ticket.issued_at > ticket_lifetime_ || now - ticket.created_at > SESSION_MAX_LIFETIME) {
+        OPENSSL_cleanse(ticket.resumption_secret.data(), ticket.resumption_secret.size());
+        return false;
+    }
+    return true;
+}
+
+bool SessionTicketManager::redeem(ByteView sealed) {
+    if (sealed.size() != TICKET_SIZE) {
+        return false;
+    }
+
+    // The IV is random per ticket and covered by the tag, so it identifies the ticket
+    uint32_t key_id = load_le<uint32_t>(sealed.data() + OFF_KEY_ID);
+    uint64_t fingerprint = load_le<uint64_t>(sealed.data() + OFF_IV);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto key = std::find_if(keys_.begin(), keys_.end(),
+                            [key_id](const TicketKey& candidate) { return candidate.id == key_id; });
+    return key != keys_.end() && key->redeemed.insert(fingerprint).second;
+}
+
+void SessionTicketManager::rotate_keys() {
+    CryptoManager crypto;
+    TicketKey fresh{0, crypto.generate_secure_key(KEY_SIZE), {}};
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    fresh.id = next_key_id_++;
+    keys_.insert(keys_.begin(), std::move(fresh));
+    while (keys_.size() > MAX_KEYS) {
+        OPENSSL_cleanse(keys_.back().key.data(), keys_.back().key.size());
+        keys_.pop_back();
+    }
+}
+
+void SessionTicketManager::enable_rotation(TimerWheel* wheel, std::chrono::seconds interval) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (timer_wheel_ && rotation_timer_ != TimerWheel::INVALID_TIMER) {
+            timer_wheel_->cancel(rotation_timer_);
+        }
+        timer_wheel_ = wheel;
+        rotation_interval_ = interval;
+    }
+    schedule_rotation();
+}
+
+size_t SessionTicketManager::key_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return keys_.size();
+}
+
+void SessionTicketManager::schedule_rotation() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!timer_wheel_) {
+        return;
+    }
+    rotation_timer_ = timer_wheel_->schedule_after(
+        std::chrono::duration_cast<std::chrono::milliseconds>(rotation_interval_), [this]() {
+            rotate_keys();
+            schedule_rotation();
+        });
+}
+
+} // namespace SecureComm
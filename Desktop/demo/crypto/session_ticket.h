@@ -0,0 +1,84 @@
+#pragma once
+
+#include "common.h"
+#include "timer_wheel.h"
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace SecureComm {
+
+// Session state a client carries for the server
+struct SessionTicket {
+    uint32_t session_id;
+    uint32_t client_id;
+    std::chrono::system_clock::time_point created_at;
+    std::chrono::system_clock::time_point issued_at;
+    // Key epoch of the session when the ticket was issued; a node that no
+    // longer holds the session resumes it past this epoch, so the other
+    // nodes accept the replicated key
+    uint32_t key_epoch;
+    // Derived from the session key when the ticket was issued; the resumed
+    // key is derived from it and fresh nonces from both sides
+    SessionKey resumption_secret;
+};
+
+// Stateless resumption tickets.
+// A ticket is the session state sealed with AES-256-GCM under a ticket key
+// only this server knows; the key id travels in the clear and is bound as
+// associated data. Keys are rotated on a timer wheel and only the current
+// and previous key are kept, so once a key is dropped every ticket sealed
+// under it becomes undecryptable (forward secrecy for ticket contents).
+// Tickets are single use: each key keeps the set of tickets redeemed under
+// it, which bounds the replay cache to the tickets of two rotation intervals
+// and is dropped together with the key.
+//
+// Wire layout (TICKET_SIZE bytes): key id (4, LE) | IV (12) | sealed state (60) | tag (16)
+class SessionTicketManager {
+public:
+    static constexpr size_t TICKET_SIZE = 92;
+
+    explicit SessionTicketManager(std::chrono::seconds ticket_lifetime = TICKET_LIFETIME);
+    ~SessionTicketManager();
+
+    SessionTicketManager(const SessionTicketManager&) = delete;
+    SessionTicketManager& operator=(const SessionTicketManager&) = delete;
+
+    std::vector<uint8_t> issue(const SessionTicket& ticket);
+    // False if the ticket is malformed, was sealed under a dropped key,
+    // fails authentication or has expired
+    bool open(ByteView sealed, SessionTicket& ticket);
+    // Mark an opened ticket as used; false if it was already redeemed (a
+    // replay) or its key has been rotated out since it was opened
+    bool redeem(ByteView sealed);
+
+    // Make a fresh key current and drop every key older than the previous one
+    void rotate_keys();
+    // Rotate every interval on the wheel (keys are otherwise only rotated manually)
+    void enable_rotation(TimerWheel* wheel, std::chrono::seconds interval = TICKET_KEY_ROTATION_INTERVAL);
+
+    std::chrono::seconds ticket_lifetime() const { return ticket_lifetime_; }
+    size_t key_count() const;
+
+private:
+    static constexpr size_t MAX_KEYS = 2;
+
+    struct TicketKey {
+        uint32_t id;
+        SecureBytes key;
+        std::unordered_set<uint64_t> redeemed;
+    };
+
+    void schedule_rotation();
+
+    const std::chrono::seconds ticket_lifetime_;
+    mutable std::mutex mutex_;
+    // Newest first
+    std::vector<TicketKey> keys_;
+    uint32_t next_key_id_;
+    TimerWheel* timer_wheel_;
+    std::chrono::seconds rotation_interval_;
+    TimerWheel::TimerId rotation_timer_;
+};
+
+} // namespace SecureComm
@@ -0,0 +1,219 @@
+#include "timer_wheel.h"
+#include "logger.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace SecureComm {
+
+TimerWheel::TimerWheel(std::chrono::milliseconds tick, size_t slot_count)
+    : tick_(tick),
+      start_(Clock::now()),
+      slots_(slot_count, NIL),
+      overflow_(slot_count, NIL),
+      current_tick_(0),
+      pending_(0) {
+    if (tick_.count() <= 0 || slot_count == 0) {
+        throw std::invalid_argument("Timer wheel needs a positive tick and at least one slot");
+    }
+}
+
+uint64_t TimerWheel::tick_for(Clock::time_point when) const {
+    if (when <= start_) {
+        return 0;
+    }
+    return static_cast<uint64_t>((when - start_) / tick_);
+}
+
+TimerWheel::TimerId TimerWheel::schedule_after(std::chrono::milliseconds delay, Callback callback) {
+    return schedule_at(Clock::now() + delay, std::move(callback));
+}
+
+TimerWheel::TimerId TimerWheel::schedule_at(Clock::time_point deadline, Callback callback) {
+    // Round up so a timer never fires before its deadline
+    uint64_t deadline_tick = tick_for(deadline);
+    if (deadline > start_ + deadline_tick * tick_) {
+        deadline_tick++;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Anything already due fires on the next advance()
+    if (deadline_tick <= current_tick_) {
+        deadline_tick = current_tick_ + 1;
+    }
+
+    int32_t index = allocate_node();
+    Node& node = nodes_[index];
+    node.callback = std::move(callback);
+    node.deadline_tick = deadline_tick;
+    node.active = true;
+    link(index);
+    pending_++;
+    return make_id(index, node.generation);
+}
+
+bool TimerWheel::cancel(TimerId id) {
+    if (id == INVALID_TIMER) {
+        return false;
+    }
+    int32_t index = static_cast<int32_t>(static_cast<uint32_t>(id)) - 1;
+    uint32_t generation = static_cast<uint32_t>(id >> 32);
+
+    Callback discarded;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (index < 0 || static_cast<size_t>(index) >= nodes_.size()) {
+            return false;
+        }
+        Node& node = nodes_[index];
+        if (!node.active || node.generation != generation) {
+            return false;
+        }
+        unlink(index);
+        // Destroy the callback (and anything it captured) outside the lock
+        discarded = std::move(node.callback);
+        release(index);
+        pending_--;
+    }
+    return true;
+}
+
+size_t TimerWheel::advance(Clock::time_point now) {
+    std::vector<Callback> due;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t target_tick = tick_for(now);
+        const uint64_t slot_count = slots_.size();
+
+        if (target_tick > current_tick_ + slot_count) {
+            // After a long stall, settle every timer directly instead of
+            // stepping through each elapsed tick
+            std::vector<int32_t> waiting;
+            for (size_t i = 0; i < nodes_.size(); ++i) {
+                int32_t index = static_cast<int32_t>(i);
+                if (!nodes_[index].active) {
+                    continue;
+                }
+                unlink(index);
+                if (nodes_[index].deadline_tick <= target_tick) {
+                    due.push_back(std::move(nodes_[index].callback));
+                    release(index);
+                    pending_--;
+                } else {
+                    waiting.push_back(index);
+                }
+            }
+            current_tick_ = target_tick;
+            for (int32_t index : waiting) {
+                link(index);
+            }
+        }
+
+        while (current_tick_ < target_tick) {
+            current_tick_++;
+            if (current_tick_ % slot_count == 0) {
+                cascade();
+            }
+            // Everything in the slot falls due this tick
+            int32_t index = slots_[current_tick_ % slot_count];
+            while (index != NIL) {
+                int32_t next = nodes_[index].next;
+                unlink(index);
+                due.push_back(std::move(nodes_[index].callback));
+                release(index);
+                pending_--;
+                index = next;
+            }
+        }
+    }
+
+    // A failing callback (e.g. a session store write on a full disk) is
+    // logged; it must neither take down the thread driving the wheel nor
+    // stop the other due timers from firing
+    for (auto& callback : due) {
+        if (!callback) {
+            continue;
+        }
+        try {
+            callback();
+        } catch (const std::exception& e) {
+            SC_LOG_ERROR("Timer callback failed: {}", e.what());
+        } catch (...) {
+            SC_LOG_ERROR("Timer callback failed");
+        }
+    }
+    return due.size();
+}
+
+size_t TimerWheel::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_;
+}
+
+int32_t TimerWheel::allocate_node() {
+    if (!free_nodes_.empty()) {
+        int32_t index = free_nodes_.back();
+        free_nodes_.pop_back();
+        return index;
+    }
+    nodes_.emplace_back();
+    return static_cast<int32_t>(nodes_.size() - 1);
+}
+
+int32_t& TimerWheel::head_for(const Node& node) {
+    if (node.overflow) {
+        return overflow_[(node.deadline_tick / slots_.size()) % overflow_.size()];
+    }
+    return slots_[node.deadline_tick % slots_.size()];
+}
+
+void TimerWheel::link(int32_t index) {
+    Node& node = nodes_[index];
+    node.overflow = node.deadline_tick - current_tick_ >= slots_.size();
+    int32_t& head = head_for(node);
+    node.prev = NIL;
+    node.next = head;
+    if (head != NIL) {
+        nodes_[head].prev = index;
+    }
+    head = index;
+}
+
+void TimerWheel::unlink(int32_t index) {
+    Node& node = nodes_[index];
+    if (node.prev != NIL) {
+        nodes_[node.prev].next = node.next;
+    } else {
+        head_for(node) = node.next;
+    }
+    if (node.next != NIL) {
+        nodes_[node.next].prev = node.prev;
+    }
+    node.prev = NIL;
+    node.next = NIL;
+}
+
+void TimerWheel::cascade() {
+    const uint64_t revolution = current_tick_ / slots_.size();
+    int32_t index = overflow_[revolution % overflow_.size()];
+    while (index != NIL) {
+        int32_t next = nodes_[index].next;
+        // Timers a whole overflow cycle or more further out stay put
+        if (nodes_[index].deadline_tick / slots_.size() == revolution) {
+            unlink(index);
+            link(index);
+        }
+        index = next;
+    }
+}
+
+void TimerWheel::release(int32_t index) {
+    Node& node = nodes_[index];
+    node.active = false;
+    node.callback = nullptr;
+    // A stale TimerId for this slot no longer matches
+    node.generation++;
+    free_nodes_.push_back(index);
+}
+
+} // namespace SecureComm
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace SecureComm {
+
+// Hashed timer wheel with an overflow level.
+// Timers due within one revolution hash into slot (deadline_tick %
+// slot_count); later ones go to a coarser overflow level whose slots each
+// span a whole revolution, and move into the wheel when the revolution
+// they fall in begins. Both levels are intrusive doubly linked lists, so
+// schedule and cancel are O(1), and advance() touches only the timers due
+// in the ticks that elapsed plus, once per revolution, the overflow slot
+// being cascaded. Long timers (session lifetimes, ticket key rotation) are
+// not rescanned every revolution. Callbacks run outside the wheel lock and
+// may schedule or cancel other timers; one that throws is logged and the
+// rest still fire.
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimerId = uint64_t;
+    using Callback = std::function<void()>;
+
+    static constexpr TimerId INVALID_TIMER = 0;
+
+    explicit TimerWheel(std::chrono::milliseconds tick = std::chrono::milliseconds(100),
+                        size_t slot_count = 512);
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    TimerId schedule_after(std::chrono::milliseconds delay, Callback callback);
+    TimerId schedule_at(Clock::time_point deadline, Callback callback);
+    // Returns false if the timer already fired or was cancelled
+    bool cancel(TimerId id);
+
+    // Fire every timer due at or before now; returns the number fired
+    size_t advance(Clock::time_point now = Clock::now());
+
+    size_t pending() const;
+    std::chrono::milliseconds tick() const { return tick_; }
+
+private:
+    static constexpr int32_t NIL = -1;
+
+    struct Node {
+        Callback callback;
+        uint64_t deadline_tick = 0;
+        uint32_t generation = 0;
+        int32_t prev = NIL;
+        int32_t next = NIL;
+        bool active = false;
+        // Linked into overflow_ rather than slots_
+        bool overflow = false;
+    };
+
+    uint64_t tick_for(Clock::time_point when) const;
+    int32_t allocate_node();
+    // Links into the wheel if due within one revolution of current_tick_,
+    // otherwise into the overflow level
+    void link(int32_t index);
+    void unlink(int32_t index);
+    int32_t& head_for(const Node& node);
+    // Moves the timers due in the revolution starting at current_tick_ into the wheel
+    void cascade();
+    void release(int32_t index);
+    static TimerId make_id(int32_t index, uint32_t generation) {
+        return (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(index + 1);
+    }
+
+    const std::chrono::milliseconds tick_;
+    const Clock::time_point start_;
+    mutable std::mutex mutex_;
+    std::vector<int32_t> slots_;
+    // One slot per revolution, hashed by (deadline_tick / slot_count)
+    std::vector<int32_t> overflow_;
+    std::vector<Node> nodes_;
+    std::vector<int32_t> free_nodes_;
+    uint64_t current_tick_;
+    size_t pending_;
+};
+
+} // namespace SecureComm
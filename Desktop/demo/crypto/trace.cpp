@@ -0,0 +1,238 @@
+#include "trace.h"
+#include "logger.h"
+#include "wire_codec.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#ifndef _WIN32
+    #include <signal.h>
+#endif
+
+namespace SecureComm {
+
+namespace {
+
+constexpr char DUMP_MAGIC[8] = {'S', 'C', 'T', 'R', 'A', 'C', 'E', '1'};
+// magic, ns per tick, base ticks, base wall time, thread count
+constexpr size_t DUMP_HEADER_SIZE = 8 + 8 + 8 + 8 + 4;
+// thread index, event count
+constexpr size_t DUMP_THREAD_SIZE = 4 + 4;
+// start, duration, session id, message id, stage
+constexpr size_t DUMP_EVENT_SIZE = 8 + 4 + 4 + 4 + 1;
+
+const char* const STAGE_NAMES[] = {"recv", "parse", "auth", "decrypt", "decompress", "handler",
+                                   "compress", "encrypt", "sign", "send", "rotate", "accept",
+                                   "handshake", "handshake_init", "handshake_keygen", "handshake_exchange",
+                                   "handshake_derive", "handshake_response", "handshake_complete",
+                                   "handshake_resume", "handshake_queue"};
+static_assert(sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0]) == static_cast<size_t>(TraceStage::STAGE_COUNT),
+              "Every trace stage needs a name");
+
+#ifndef _WIN32
+std::atomic<bool> dump_requested(false);
+
+void on_dump_signal(int) {
+    dump_requested.store(true);
+}
+#endif
+
+} // namespace
+
+const char* trace_stage_name(TraceStage stage) {
+    size_t index = static_cast<size_t>(stage);
+    return index < static_cast<size_t>(TraceStage::STAGE_COUNT) ? STAGE_NAMES[index] : "unknown";
+}
+
+Tracer& Tracer::instance() {
+    // Deliberately leaked, like the logger: threads may trace during exit
+    static Tracer* tracer = new Tracer();
+    return *tracer;
+}
+
+Tracer::Tracer() : next_thread_index_(0), signal_running_(false), dump_count_(0) {}
+
+Tracer::RingHandle::~RingHandle() {
+    ring->closed.store(true, std::memory_order_release);
+}
+
+Tracer::Ring& Tracer::register_thread() {
+    thread_local RingHandle handle{[]() {
+        auto ring = std::make_shared<Ring>();
+        Tracer& tracer = instance();
+        std::lock_guard<std::mutex> lock(tracer.mutex_);
+        ring->thread_index = tracer.next_thread_index_++;
+        // Keep only the newest rings of exited threads
+        size_t retired = 0;
+        for (auto it = tracer.rings_.rbegin(); it != tracer.rings_.rend(); ++it) {
+            if ((*it)->closed.load(std::memory_order_acquire)) {
+                retired++;
+            }
+        }
+        for (auto it = tracer.rings_.begin(); it != tracer.rings_.end() && retired > MAX_RETIRED_RINGS;) {
+            if ((*it)->closed.load(std::memory_order_acquire)) {
+                it = tracer.rings_.erase(it);
+                retired--;
+            } else {
+                ++it;
+            }
+        }
+        tracer.rings_.push_back(ring);
+        return ring;
+    }()};
+    return *handle.ring;
+}
+
+size_t Tracer::dump(const std::string& path) {
+    std::lock_guard<std::mutex> dump_lock(dump_mutex_);
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rings = rings_;
+    }
+    clock_.refine();
+
+    std::vector<uint8_t> out(DUMP_HEADER_SIZE);
+    std::memcpy(out.data(), DUMP_MAGIC, sizeof(DUMP_MAGIC));
+    uint64_t tick_bits;
+    double ns_per_tick = clock_.ns_per_tick();
+    std::memcpy(&tick_bits, &ns_per_tick, sizeof(tick_bits));
+    store_le(out.data() + 8, tick_bits);
+    store_le(out.data() + 16, clock_.base_ticks());
+    store_le(out.data() + 24, clock_.base_wall_ns());
+    store_le(out.data() + 32, static_cast<uint32_t>(rings.size()));
+
+    size_t total = 0;
+    for (const std::shared_ptr<Ring>& ring : rings) {
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t first = head > RING_CAPACITY ? head - RING_CAPACITY : 0;
+        std::vector<std::array<uint64_t, 3>> words;
+        words.reserve(head - first);
+        for (uint64_t index = first; index < head; ++index) {
+            const auto& slot = ring->events[index % RING_CAPACITY];
+            words.push_back({slot[0].load(std::memory_order_relaxed), slot[1].load(std::memory_order_relaxed),
+                             slot[2].load(std::memory_order_relaxed)});
+        }
+        // Slots the thread reused while they were copied hold newer, possibly
+        // torn events; drop them
+        uint64_t head_after = ring->head.load(std::memory_order_acquire);
+        uint64_t valid_from = head_after >= RING_CAPACITY ? head_after - RING_CAPACITY + 1 : 0;
+        size_t skip = valid_from > first ? static_cast<size_t>(std::min(valid_from - first, head - first)) : 0;
+
+        size_t offset = out.size();
+        size_t count = words.size() - skip;
+        out.resize(offset + DUMP_THREAD_SIZE + count * DUMP_EVENT_SIZE);
+        store_le(out.data() + offset, ring->thread_index);
+        store_le(out.data() + offset + 4, static_cast<uint32_t>(count));
+        uint8_t* event = out.data() + offset + DUMP_THREAD_SIZE;
+        for (size_t i = skip; i < words.size(); ++i, event += DUMP_EVENT_SIZE) {
+            store_le(event, words[i][0]);
+            store_le(event + 8, static_cast<uint32_t>(words[i][2] >> 32));
+            store_le(event + 12, static_cast<uint32_t>(words[i][1]));
+            store_le(event + 16, static_cast<uint32_t>(words[i][1] >> 32));
+            event[20] = static_cast<uint8_t>(words[i][2]);
+        }
+        total += count;
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file || !file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()))) {
+        throw std::runtime_error("Cannot write trace dump " + path);
+    }
+    return total;
+}
+
+TraceDump Tracer::read_dump(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot open trace dump " + path);
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < DUMP_HEADER_SIZE || std::memcmp(data.data(), DUMP_MAGIC, sizeof(DUMP_MAGIC)) != 0) {
+        throw std::runtime_error("Not a trace dump: " + path);
+    }
+
+    TraceDump dump;
+    uint64_t tick_bits = load_le<uint64_t>(data.data() + 8);
+    std::memcpy(&dump.ns_per_tick, &tick_bits, sizeof(tick_bits));
+    dump.base_ticks = load_le<uint64_t>(data.data() + 16);
+    dump.base_wall_ns = load_le<int64_t>(data.data() + 24);
+    uint32_t thread_count = load_le<uint32_t>(data.data() + 32);
+
+    size_t offset = DUMP_HEADER_SIZE;
+    for (uint32_t t = 0; t < thread_count; ++t) {
+        if (data.size() - offset < DUMP_THREAD_SIZE) {
+            throw std::runtime_error("Truncated trace dump " + path);
+        }
+        TraceDump::Thread thread;
+        thread.thread_index = load_le<uint32_t>(data.data() + offset);
+        uint32_t count = load_le<uint32_t>(data.data() + offset + 4);
+        offset += DUMP_THREAD_SIZE;
+        if ((data.size() - offset) / DUMP_EVENT_SIZE < count) {
+            throw std::runtime_error("Truncated trace dump " + path);
+        }
+        thread.events.resize(count);
+        for (TraceEvent& event : thread.events) {
+            const uint8_t* in = data.data() + offset;
+            event.start_ticks = load_le<uint64_t>(in);
+            event.duration_ticks = load_le<uint32_t>(in + 8);
+            event.session_id = load_le<uint32_t>(in + 12);
+            event.message_id = load_le<uint32_t>(in + 16);
+            event.stage = static_cast<TraceStage>(in[20]);
+            offset += DUMP_EVENT_SIZE;
+        }
+        dump.threads.push_back(std::move(thread));
+    }
+    return dump;
+}
+
+void Tracer::dump_on_signal(const std::string& path_prefix) {
+#ifdef _WIN32
+    (void)path_prefix;
+    SC_LOG_WARN("Trace dumps on signal are not supported on Windows; call Tracer::dump()");
+#else
+    std::lock_guard<std::mutex> lock(dump_mutex_);
+    if (signal_running_) {
+        return;
+    }
+    signal_path_ = path_prefix;
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = on_dump_signal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, nullptr);
+    signal_running_ = true;
+    signal_thread_ = std::thread(&Tracer::signal_loop, this);
+#endif
+}
+
+void Tracer::signal_loop() {
+#ifndef _WIN32
+    // The handler only sets a flag; the dump itself runs here
+    while (signal_running_) {
+        if (dump_requested.exchange(false)) {
+            std::string path = signal_path_ + "." + std::to_string(++dump_count_) + ".trace";
+            try {
+                size_t events = dump(path);
+                SC_LOG_INFO("Wrote {} trace events to {}", events, path);
+            } catch (const std::exception& e) {
+                SC_LOG_ERROR("Trace dump failed: {}", e.what());
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+#endif
+}
+
+void Tracer::stop() {
+    signal_running_ = false;
+    if (signal_thread_.joinable()) {
+        signal_thread_.join();
+    }
+}
+
+} // namespace SecureComm
@@ -7,6 +7,8 @@
 
 #include <string>
 #include <vector>
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <chrono>
@@ -20,11 +22,9 @@
 #include <openssl/rsa.h>
 #include <openssl/dh.h>
 #include <openssl/aes.h>
-
-// MSVC compatibility - use pragma pack
-#ifdef _MSC_VER
-    #pragma pack(push, 1)
-#endif
+#include <openssl/rand.h>
+#include "secure_arena.h"
+#include "wire_codec.h"
 
 namespace SecureComm {
 
@@ -36,6 +36,20 @@ constexpr size_t IV_SIZE = 12;
 constexpr size_t HASH_SIZE = 32;
 constexpr size_t SIGNATURE_SIZE = 256;
 constexpr size_t HMAC_SIZE = 32;
+constexpr size_t GCM_TAG_SIZE = 16;
+constexpr size_t MAX_EARLY_DATA_SIZE = 1024;
+
+// Session expiry
+constexpr std::chrono::seconds SESSION_IDLE_TIMEOUT{30 * 60};
+constexpr std::chrono::seconds SESSION_MAX_LIFETIME{24 * 60 * 60};
+
+// Resumption tickets (a ticket key is accepted for two rotation intervals)
+constexpr std::chrono::seconds TICKET_LIFETIME{60 * 60};
+constexpr std::chrono::seconds TICKET_KEY_ROTATION_INTERVAL{60 * 60};
+
+// Handshake cookies (HandshakeCookies): issued at (4) | truncated HMAC (16)
+constexpr size_t HANDSHAKE_COOKIE_SIZE = 20;
+constexpr std::chrono::seconds HANDSHAKE_COOKIE_LIFETIME{10};
 
 // Message types
 enum class MessageType : uint8_t {
@@ -45,9 +59,45 @@ enum class MessageType : uint8_t {
     ENCRYPTED_MESSAGE = 0x04,
     KEY_ROTATION = 0x05,
     AUTHENTICATION = 0x06,
+    SESSION_TICKET = 0x07,
+    EARLY_DATA = 0x08,
+    HANDSHAKE_COOKIE = 0x09,
     ERROR_MESSAGE = 0xFF
 };
 
+// Header flags
+// HANDSHAKE_INIT/RESPONSE: resume an existing session instead of a key exchange
+constexpr uint16_t FLAG_RESUME = 0x0001;
+// HANDSHAKE_INIT/RESPONSE: resume from a session ticket (ticket follows the handshake)
+constexpr uint16_t FLAG_TICKET = 0x0002;
+// HANDSHAKE_INIT with FLAG_TICKET: an early-data frame follows the ticket
+constexpr uint16_t FLAG_EARLY_DATA = 0x0004;
+// HANDSHAKE_INIT/RESPONSE: Capabilities follow the handshake (before any ticket)
+constexpr uint16_t FLAG_CAPABILITIES = 0x0008;
+// ENCRYPTED_MESSAGE: compact body, sized to the ciphertext instead of MAX_MESSAGE_SIZE
+constexpr uint16_t FLAG_COMPACT = 0x0010;
+// ENCRYPTED_MESSAGE with FLAG_COMPACT: a signature follows the ciphertext
+constexpr uint16_t FLAG_SIGNED = 0x0020;
+// ENCRYPTED_MESSAGE: the plaintext is the next message of the sender's compression stream
+constexpr uint16_t FLAG_COMPRESSED = 0x0040;
+// HANDSHAKE_INIT: the cookie from a HANDSHAKE_COOKIE challenge follows the capabilities
+constexpr uint16_t FLAG_COOKIE = 0x0080;
+
+// Capability features
+// Compact ENCRYPTED_MESSAGE frames (FLAG_COMPACT)
+constexpr uint32_t FEATURE_COMPACT_FRAMING = 0x00000001;
+// Several messages per frame (reserved)
+constexpr uint32_t FEATURE_BATCHING = 0x00000002;
+// Compressed payloads (FLAG_COMPRESSED), one deflate stream per direction
+constexpr uint32_t FEATURE_COMPRESSION = 0x00000004;
+// Signature policy: the AEAD tag alone authenticates a message; the
+// per-message RSA signature is left out
+constexpr uint32_t FEATURE_UNSIGNED_MESSAGES = 0x00000008;
+
+// Cipher suites for message payloads; AES-256-GCM is mandatory
+constexpr uint8_t CIPHER_SUITE_AES_256_GCM = 0x01;
+constexpr uint8_t CIPHER_SUITE_CHACHA20_POLY1305 = 0x02;
+
 // Protocol versions
 enum class ProtocolVersion : uint8_t {
     V1_0 = 0x01
@@ -61,6 +111,9 @@ enum class ForwardSecrecyType : uint8_t {
     PERFECT_FORWARD_SECRECY = 0x03
 };
 
+// Protocol structs are in-memory only; the wire layouts below define what is
+// sent (little-endian, fields in this order, no padding)
+
 // Message header structure
 struct MessageHeader {
     ProtocolVersion version;
@@ -89,23 +142,134 @@ struct EncryptedMessage {
     uint8_t signature[SIGNATURE_SIZE];
 };
 
+using MessageHeaderLayout = WireLayout<MessageHeader,
+    WireField<&MessageHeader::version>,
+    WireField<&MessageHeader::type>,
+    WireField<&MessageHeader::sequence_number>,
+    WireField<&MessageHeader::timestamp>,
+    WireField<&MessageHeader::payload_size>,
+    WireField<&MessageHeader::flags>>;
+
+using HandshakeMessageLayout = WireLayout<HandshakeMessage,
+    WireField<&HandshakeMessage::client_id>,
+    WireField<&HandshakeMessage::session_id>,
+    WireField<&HandshakeMessage::fs_type>,
+    WireField<&HandshakeMessage::public_key>,
+    WireField<&HandshakeMessage::nonce>>;
+
+using EncryptedMessageLayout = WireLayout<EncryptedMessage,
+    WireField<&EncryptedMessage::session_id>,
+    WireField<&EncryptedMessage::message_id>,
+    WireField<&EncryptedMessage::iv>,
+    WireField<&EncryptedMessage::encrypted_data>,
+    WireField<&EncryptedMessage::signature>>;
+
+// Encoded sizes; changing one is a protocol change
+constexpr size_t HEADER_WIRE_SIZE = MessageHeaderLayout::size;
+constexpr size_t HANDSHAKE_WIRE_SIZE = HandshakeMessageLayout::size;
+constexpr size_t ENCRYPTED_MESSAGE_WIRE_SIZE = EncryptedMessageLayout::size;
+static_assert(HEADER_WIRE_SIZE == 14, "Message header wire size changed");
+static_assert(HANDSHAKE_WIRE_SIZE == 53, "Handshake wire size changed");
+static_assert(ENCRYPTED_MESSAGE_WIRE_SIZE == 4372, "Encrypted message wire size changed");
+
+// A FLAG_COMPACT body: session id, message id and IV, then the ciphertext
+constexpr size_t COMPACT_PREFIX_WIRE_SIZE = EncryptedMessageLayout::offset_of<&EncryptedMessage::encrypted_data>();
+
+// Capability bitmap. A client offers what it supports in HANDSHAKE_INIT; the
+// server answers with the selection both sides will use (one cipher suite).
+// A peer that sends none gets baseline_capabilities().
+struct Capabilities {
+    uint32_t features;
+    uint8_t cipher_suites;
+    // Largest ciphertext (with tag) either side accepts in one message
+    uint16_t max_frame_size;
+};
+
+using CapabilitiesLayout = WireLayout<Capabilities,
+    WireField<&Capabilities::features>,
+    WireField<&Capabilities::cipher_suites>,
+    WireField<&Capabilities::max_frame_size>>;
+
+constexpr size_t CAPABILITIES_WIRE_SIZE = CapabilitiesLayout::size;
+static_assert(CAPABILITIES_WIRE_SIZE == 7, "Capabilities wire size changed");
+
+// What a peer predating capability negotiation speaks
+inline Capabilities baseline_capabilities() {
+    return Capabilities{0, CIPHER_SUITE_AES_256_GCM, static_cast<uint16_t>(MAX_MESSAGE_SIZE)};
+}
+
+// What this build implements
+inline Capabilities local_capabilities() {
+    return Capabilities{FEATURE_COMPACT_FRAMING | FEATURE_UNSIGNED_MESSAGES | FEATURE_COMPRESSION,
+                        CIPHER_SUITE_AES_256_GCM | CIPHER_SUITE_CHACHA20_POLY1305,
+                        static_cast<uint16_t>(MAX_MESSAGE_SIZE)};
+}
+
+// Features and limits both sides support, with a single cipher suite:
+// AES-256-GCM unless ChaCha20-Poly1305 is the only one in common
+inline Capabilities negotiate_capabilities(const Capabilities& local, const Capabilities& peer) {
+    Capabilities result;
+    result.features = local.features & peer.features;
+    uint8_t common = local.cipher_suites & peer.cipher_suites;
+    result.cipher_suites = (common & CIPHER_SUITE_AES_256_GCM) || !(common & CIPHER_SUITE_CHACHA20_POLY1305)
+        ? CIPHER_SUITE_AES_256_GCM : CIPHER_SUITE_CHACHA20_POLY1305;
+    result.max_frame_size = local.max_frame_size < peer.max_frame_size ? local.max_frame_size : peer.max_frame_size;
+    return result;
+}
+
+// Fixed-size symmetric key stored inline (no heap allocation)
+using SessionKey = std::array<uint8_t, KEY_SIZE>;
+
+// Read-only view of key bytes. Key inputs take a ByteView so that keys held
+// in secure memory, in fixed-size arrays or in plain vectors are all passed
+// without being copied onto the heap.
+class ByteView {
+public:
+    ByteView() : data_(nullptr), size_(0) {}
+    ByteView(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+    template <typename Allocator>
+    ByteView(const std::vector<uint8_t, Allocator>& bytes) : data_(bytes.data()), size_(bytes.size()) {}
+    template <size_t N>
+    ByteView(const std::array<uint8_t, N>& bytes) : data_(bytes.data()), size_(N) {}
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const uint8_t* begin() const { return data_; }
+    const uint8_t* end() const { return data_ + size_; }
+
+    // Throws std::runtime_error if the range does not fit
+    ByteView subview(size_t offset, size_t size) const {
+        if (offset > size_ || size > size_ - offset) {
+            throw std::runtime_error("Byte range out of bounds");
+        }
+        return ByteView(data_ + offset, size);
+    }
+    ByteView subview(size_t offset) const { return subview(offset, offset <= size_ ? size_ - offset : 0); }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+};
+
 // Session information
 struct SessionInfo {
     uint32_t session_id;
     uint32_t client_id;
     std::chrono::system_clock::time_point created_at;
     std::chrono::system_clock::time_point last_activity;
-    std::vector<uint8_t> shared_secret;
-    std::vector<uint8_t> current_key;
+    SecureBytes shared_secret;
+    SecureBox<SessionKey> current_key;
     uint32_t message_counter;
     bool authenticated;
     bool key_rotated;
+    Capabilities capabilities;
 };
 
 // Key pair structure
 struct KeyPair {
     std::vector<uint8_t> public_key;
-    std::vector<uint8_t> private_key;
+    SecureBytes private_key;
     std::chrono::system_clock::time_point created_at;
     std::chrono::system_clock::time_point expires_at;
 };
@@ -129,6 +293,7 @@ enum class ErrorCode : uint16_t {
     ENCRYPTION_FAILED = 0x0005,
     DECRYPTION_FAILED = 0x0006,
     INVALID_PROTOCOL_VERSION = 0x0007,
+    SERVER_BUSY = 0x0008,
     INTERNAL_ERROR = 0x00FF
 };
 
@@ -143,6 +308,7 @@ inline std::string error_code_to_string(ErrorCode code) {
         case ErrorCode::ENCRYPTION_FAILED: return "Encryption Failed";
         case ErrorCode::DECRYPTION_FAILED: return "Decryption Failed";
         case ErrorCode::INVALID_PROTOCOL_VERSION: return "Invalid Protocol Version";
+        case ErrorCode::SERVER_BUSY: return "Server Busy";
         case ErrorCode::INTERNAL_ERROR: return "Internal Error";
         default: return "Unknown Error";
     }
@@ -156,6 +322,9 @@ inline std::string message_type_to_string(MessageType type) {
         case MessageType::ENCRYPTED_MESSAGE: return "Encrypted Message";
         case MessageType::KEY_ROTATION: return "Key Rotation";
         case MessageType::AUTHENTICATION: return "Authentication";
+        case MessageType::SESSION_TICKET: return "Session Ticket";
+        case MessageType::EARLY_DATA: return "Early Data";
+        case MessageType::HANDSHAKE_COOKIE: return "Handshake Cookie";
         case MessageType::ERROR_MESSAGE: return "Error";
         default: return "Unknown";
     }
@@ -170,28 +339,32 @@ inline std::string bytes_to_hex(const std::vector<uint8_t>& bytes) {
     return ss.str();
 }
 
+// Ids and nonces come from OpenSSL's generator, which is thread-safe and
+// unpredictable; these are called from every connection thread at once
+
+// Never 0, which marks a free session table slot and an unset client
+inline uint32_t generate_nonzero_id() {
+    uint32_t id = 0;
+    while (id == 0) {
+        if (RAND_bytes(reinterpret_cast<unsigned char*>(&id), sizeof(id)) != 1) {
+            throw std::runtime_error("Failed to generate random id");
+        }
+    }
+    return id;
+}
+
 inline uint32_t generate_session_id() {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_int_distribution<unsigned int> dis(1, 0xFFFFFFFF);
-    return static_cast<uint32_t>(dis(gen));
+    return generate_nonzero_id();
 }
 
 inline uint32_t generate_client_id() {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_int_distribution<unsigned int> dis(1, 0xFFFFFFFF);
-    return static_cast<uint32_t>(dis(gen));
+    return generate_nonzero_id();
 }
 
 inline std::vector<uint8_t> generate_nonce(size_t size) {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_int_distribution<unsigned int> dis(0, 255);
-    
     std::vector<uint8_t> nonce(size);
-    for (size_t i = 0; i < size; ++i) {
-        nonce[i] = static_cast<uint8_t>(dis(gen));
+    if (size > 0 && RAND_bytes(nonce.data(), static_cast<int>(size)) != 1) {
+        throw std::runtime_error("Failed to generate nonce");
     }
     return nonce;
 }
@@ -207,54 +380,170 @@ inline uint32_t get_current_timestamp_seconds() {
     return static_cast<uint32_t>(seconds.count());
 }
 
+// Zero-copy message parsing.
+// Read-only views over a received buffer: the constructor checks the size
+// once, then fields are decoded in place (scalars are loaded on demand and
+// byte fields come back as ByteViews into the buffer), so nothing is copied
+// out. The buffer must outlive the view and anything taken from it.
+class MessageView {
+public:
+    // Throws std::runtime_error if the buffer is shorter than a header
+    explicit MessageView(ByteView buffer) : buffer_(buffer) {
+        if (buffer.size() < HEADER_WIRE_SIZE) {
+            throw std::runtime_error("Invalid header data size");
+        }
+    }
+
+    ProtocolVersion version() const { return field<&MessageHeader::version>(); }
+    MessageType type() const { return field<&MessageHeader::type>(); }
+    uint32_t sequence_number() const { return field<&MessageHeader::sequence_number>(); }
+    uint32_t timestamp() const { return field<&MessageHeader::timestamp>(); }
+    uint16_t payload_size() const { return field<&MessageHeader::payload_size>(); }
+    uint16_t flags() const { return field<&MessageHeader::flags>(); }
+
+    MessageHeader header() const { return MessageHeaderLayout::decode(buffer_.data()); }
+    // Everything after the header
+    ByteView body() const { return buffer_.subview(HEADER_WIRE_SIZE); }
+
+private:
+    template <auto Member>
+    typename WireField<Member>::Type field() const { return MessageHeaderLayout::load<Member>(buffer_.data()); }
+
+    ByteView buffer_;
+};
+
+class HandshakeView {
+public:
+    // Throws std::runtime_error if the body is shorter than a handshake
+    explicit HandshakeView(ByteView body) : body_(body) {
+        if (body.size() < HANDSHAKE_WIRE_SIZE) {
+            throw std::runtime_error("Invalid handshake data size");
+        }
+    }
+
+    uint32_t client_id() const { return field<&HandshakeMessage::client_id>(); }
+    uint32_t session_id() const { return field<&HandshakeMessage::session_id>(); }
+    ForwardSecrecyType fs_type() const { return field<&HandshakeMessage::fs_type>(); }
+    ByteView public_key() const {
+        return body_.subview(HandshakeMessageLayout::offset_of<&HandshakeMessage::public_key>(), KEY_SIZE);
+    }
+    ByteView nonce() const {
+        return body_.subview(HandshakeMessageLayout::offset_of<&HandshakeMessage::nonce>(), IV_SIZE);
+    }
+    // Bytes after the handshake (resumption ticket, early data)
+    ByteView trailer() const { return body_.subview(HANDSHAKE_WIRE_SIZE); }
+
+private:
+    template <auto Member>
+    typename WireField<Member>::Type field() const { return HandshakeMessageLayout::load<Member>(body_.data()); }
+
+    ByteView body_;
+};
+
+class EncryptedMessageView {
+public:
+    // Throws std::runtime_error if the body is shorter than an encrypted
+    // message (or, for a FLAG_COMPACT body, than the compact prefix)
+    explicit EncryptedMessageView(ByteView body, bool compact = false) : body_(body) {
+        if (body.size() < (compact ? COMPACT_PREFIX_WIRE_SIZE : ENCRYPTED_MESSAGE_WIRE_SIZE)) {
+            throw std::runtime_error("Invalid encrypted message data size");
+        }
+    }
+
+    uint32_t session_id() const { return field<&EncryptedMessage::session_id>(); }
+    uint32_t message_id() const { return field<&EncryptedMessage::message_id>(); }
+    ByteView iv() const { return body_.subview(EncryptedMessageLayout::offset_of<&EncryptedMessage::iv>(), IV_SIZE); }
+    // The first size bytes of the ciphertext field (size is the header's
+    // payload_size); throws if it exceeds MAX_MESSAGE_SIZE
+    ByteView ciphertext(size_t size) const {
+        if (size > MAX_MESSAGE_SIZE) {
+            throw std::runtime_error("Invalid encrypted message size");
+        }
+        return body_.subview(EncryptedMessageLayout::offset_of<&EncryptedMessage::encrypted_data>(), size);
+    }
+    // Full (non-compact) bodies only
+    ByteView signature() const {
+        return body_.subview(EncryptedMessageLayout::offset_of<&EncryptedMessage::signature>(), SIGNATURE_SIZE);
+    }
+
+private:
+    template <auto Member>
+    typename WireField<Member>::Type field() const { return EncryptedMessageLayout::load<Member>(body_.data()); }
+
+    ByteView body_;
+};
+
 // Serialization helpers
 inline std::vector<uint8_t> serialize_header(const MessageHeader& header) {
-    std::vector<uint8_t> data(sizeof(MessageHeader));
-    std::memcpy(data.data(), &header, sizeof(MessageHeader));
+    std::vector<uint8_t> data(HEADER_WIRE_SIZE);
+    MessageHeaderLayout::encode(header, data.data());
     return data;
 }
 
-inline MessageHeader deserialize_header(const std::vector<uint8_t>& data) {
-    if (data.size() < sizeof(MessageHeader)) {
-        throw std::runtime_error("Invalid header data size");
+// Bytes that follow a header on the wire; encrypted messages carry the
+// whole EncryptedMessage, or with FLAG_COMPACT only its prefix, the
+// ciphertext and an optional signature, and use payload_size for the
+// ciphertext length
+inline size_t message_body_size(const MessageHeader& header) {
+    if (header.type == MessageType::ENCRYPTED_MESSAGE) {
+        if (header.flags & FLAG_COMPACT) {
+            return COMPACT_PREFIX_WIRE_SIZE + header.payload_size +
+                   (header.flags & FLAG_SIGNED ? SIGNATURE_SIZE : 0);
+        }
+        return ENCRYPTED_MESSAGE_WIRE_SIZE;
     }
-    MessageHeader header;
-    std::memcpy(&header, data.data(), sizeof(MessageHeader));
-    return header;
+    return header.payload_size;
+}
+
+inline MessageHeader deserialize_header(const std::vector<uint8_t>& data) {
+    return MessageView(data).header();
 }
 
 inline std::vector<uint8_t> serialize_handshake(const HandshakeMessage& handshake) {
-    std::vector<uint8_t> data(sizeof(HandshakeMessage));
-    std::memcpy(data.data(), &handshake, sizeof(HandshakeMessage));
+    std::vector<uint8_t> data(HANDSHAKE_WIRE_SIZE);
+    HandshakeMessageLayout::encode(handshake, data.data());
     return data;
 }
 
 inline HandshakeMessage deserialize_handshake(const std::vector<uint8_t>& data) {
-    if (data.size() < sizeof(HandshakeMessage)) {
+    if (data.size() < HANDSHAKE_WIRE_SIZE) {
         throw std::runtime_error("Invalid handshake data size");
     }
-    HandshakeMessage handshake;
-    std::memcpy(&handshake, data.data(), sizeof(HandshakeMessage));
-    return handshake;
+    return HandshakeMessageLayout::decode(data.data());
 }
 
 inline std::vector<uint8_t> serialize_encrypted_message(const EncryptedMessage& msg) {
-    std::vector<uint8_t> data(sizeof(EncryptedMessage));
-    std::memcpy(data.data(), &msg, sizeof(EncryptedMessage));
+    std::vector<uint8_t> data(ENCRYPTED_MESSAGE_WIRE_SIZE);
+    EncryptedMessageLayout::encode(msg, data.data());
     return data;
 }
 
 inline EncryptedMessage deserialize_encrypted_message(const std::vector<uint8_t>& data) {
-    if (data.size() < sizeof(EncryptedMessage)) {
+    if (data.size() < ENCRYPTED_MESSAGE_WIRE_SIZE) {
         throw std::runtime_error("Invalid encrypted message data size");
     }
-    EncryptedMessage msg;
-    std::memcpy(&msg, data.data(), sizeof(EncryptedMessage));
-    return msg;
+    return EncryptedMessageLayout::decode(data.data());
 }
 
-} // namespace SecureComm
+inline std::vector<uint8_t> serialize_capabilities(const Capabilities& capabilities) {
+    std::vector<uint8_t> data(CAPABILITIES_WIRE_SIZE);
+    CapabilitiesLayout::encode(capabilities, data.data());
+    return data;
+}
+
+// Throws std::runtime_error if data is shorter than CAPABILITIES_WIRE_SIZE
+inline Capabilities deserialize_capabilities(ByteView data) {
+    if (data.size() < CAPABILITIES_WIRE_SIZE) {
+        throw std::runtime_error("Invalid capabilities data size");
+    }
+    return CapabilitiesLayout::decode(data.data());
+}
+
+// Error message payload: the ErrorCode, little-endian
+inline std::vector<uint8_t> serialize_error_code(ErrorCode code) {
+    std::vector<uint8_t> data(WireCodec<ErrorCode>::size);
+    WireCodec<ErrorCode>::store(data.data(), code);
+    return data;
+}
 
-#ifdef _MSC_VER
-    #pragma pack(pop)
-#endif 
\ No newline at end of file
+} // namespace SecureComm 
\ No newline at end of file
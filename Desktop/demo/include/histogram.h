@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+namespace SecureComm {
+
+// HDR-style latency histogram.
+// Values (nanoseconds) fall into log-linear buckets: exact below 128, then
+// 64 linear sub-buckets per power of two, so any recorded value is
+// reported within 1/64 (1.6%) of itself up to MAX_VALUE; larger values are
+// clamped. Counters are relaxed atomics: record() never locks, and a
+// reader can merge or query a histogram while its owner keeps recording.
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 7;
+    static constexpr unsigned MAX_VALUE_BITS = 36;
+    // About 68 s in nanoseconds
+    static constexpr uint64_t MAX_VALUE = (uint64_t(1) << MAX_VALUE_BITS) - 1;
+    static constexpr size_t BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 2) << (SUB_BUCKET_BITS - 1);
+
+    LatencyHistogram();
+    LatencyHistogram(const LatencyHistogram& other);
+    LatencyHistogram& operator=(const LatencyHistogram& other);
+
+    void record(uint64_t value) {
+        if (value > MAX_VALUE) {
+            value = MAX_VALUE;
+        }
+        counts_[index_for(value)].fetch_add(1, std::memory_order_relaxed);
+        total_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+        uint64_t seen = max_.load(std::memory_order_relaxed);
+        while (value > seen && !max_.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+        }
+        seen = min_.load(std::memory_order_relaxed);
+        while (value < seen && !min_.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Adds other's counts into this one
+    void merge(const LatencyHistogram& other);
+    void reset();
+
+    uint64_t count() const { return total_.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+    // 0 when empty
+    uint64_t min() const;
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+    double mean() const;
+    // Highest value equivalent to the percentile's bucket (0-100); 0 when empty
+    uint64_t value_at_percentile(double percentile) const;
+
+    // Raw buckets, for exporting the whole distribution
+    uint64_t count_at(size_t index) const { return counts_[index].load(std::memory_order_relaxed); }
+    // Highest value that lands in the bucket
+    static uint64_t bucket_upper_bound(size_t index);
+
+    static size_t index_for(uint64_t value) {
+        // Bucket 0 covers [0, 2^SUB_BUCKET_BITS) linearly; bucket b >= 1
+        // covers [2^(b+6), 2^(b+7)) in steps of 2^b
+        unsigned magnitude = highest_bit(value);
+        unsigned bucket = magnitude < SUB_BUCKET_BITS ? 0 : magnitude - (SUB_BUCKET_BITS - 1);
+        return (static_cast<size_t>(bucket) << (SUB_BUCKET_BITS - 1)) + static_cast<size_t>(value >> bucket);
+    }
+
+private:
+    // Index of the highest set bit; 0 for 0
+    static unsigned highest_bit(uint64_t value) {
+        if (value == 0) {
+            return 0;
+        }
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return static_cast<unsigned>(index);
+#else
+        return 63 - static_cast<unsigned>(__builtin_clzll(value));
+#endif
+    }
+
+    std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+    std::atomic<uint64_t> total_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> min_;
+    std::atomic<uint64_t> max_;
+};
+
+} // namespace SecureComm
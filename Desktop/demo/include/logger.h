@@ -0,0 +1,200 @@
+#pragma once
+
+#include "tick_clock.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Lowest level compiled in (0 debug, 1 info, 2 warn, 3 error); calls below
+// it expand to nothing and their arguments are never evaluated
+#ifndef SECURECOMM_LOG_LEVEL
+#define SECURECOMM_LOG_LEVEL 1
+#endif
+
+namespace SecureComm {
+
+// ERR rather than ERROR, which <windows.h> defines as a macro
+enum class LogLevel : uint8_t {
+    DEBUG = 0,
+    INFO = 1,
+    WARN = 2,
+    ERR = 3,
+    OFF = 4
+};
+
+// Asynchronous logger.
+// A log call copies its format string pointer and arguments into a
+// fixed-size record in the calling thread's single-producer ring and
+// returns; nothing is formatted, locked or written on that thread. One
+// background thread drains every ring, formats the records ("{}" stands for
+// the next argument) and writes them in batches, info and debug to stdout,
+// warnings and errors to stderr. A full ring drops the record and counts it;
+// the writer reports drops as they happen.
+class Logger {
+public:
+    // Records per thread; a thread's ring is allocated on its first log call
+    static constexpr size_t RING_CAPACITY = 256;
+    static constexpr size_t RECORD_SIZE = 128;
+
+    struct Stats {
+        uint64_t written;
+        uint64_t dropped;
+        size_t rings;
+    };
+
+    // Process-wide logger; never destroyed, drained at exit
+    static Logger& instance();
+
+    // Runtime filter on top of SECURECOMM_LOG_LEVEL
+    static bool enabled(LogLevel level) {
+        return static_cast<uint8_t>(level) >= min_level_.load(std::memory_order_relaxed);
+    }
+    void set_level(LogLevel level) { min_level_.store(static_cast<uint8_t>(level), std::memory_order_relaxed); }
+    // Write every level to stream instead (nullptr: back to stdout/stderr)
+    void set_output(FILE* stream);
+
+    // format must be a string literal: only its address is recorded
+    template <size_t N, typename... Args>
+    static void log(LogLevel level, const char (&format)[N], const Args&... args);
+
+    // Blocks until everything logged before the call has been written
+    void flush();
+    // Drains and stops the writer; later records stay in their rings
+    void stop();
+    Stats stats() const;
+
+private:
+    enum ArgType : uint8_t { ARG_INT, ARG_UINT, ARG_DOUBLE, ARG_BOOL, ARG_STRING };
+
+    struct Record {
+        uint64_t ticks;
+        const char* format;
+        LogLevel level;
+        uint8_t arg_count;
+        uint16_t arg_bytes;
+        uint8_t args[RECORD_SIZE - 20];
+    };
+    static_assert(sizeof(Record) == RECORD_SIZE, "Log record size changed");
+
+    // Single producer (the owning thread), single consumer (the writer)
+    struct Ring {
+        alignas(64) std::atomic<uint64_t> head{0};
+        alignas(64) std::atomic<uint64_t> tail{0};
+        alignas(64) std::atomic<uint64_t> dropped{0};
+        std::atomic<bool> closed{false};
+        std::array<Record, RING_CAPACITY> records;
+    };
+
+    // Marks the thread's ring closed when the thread exits
+    struct RingHandle {
+        std::shared_ptr<Ring> ring;
+        ~RingHandle();
+    };
+
+    Logger();
+
+    // A plain thread_local pointer, so the hot path has no TLS init guard
+    static Ring& local_ring() {
+        static thread_local Ring* ring = nullptr;
+        if (!ring) {
+            ring = &register_thread();
+        }
+        return *ring;
+    }
+    static Ring& register_thread();
+    static Record* begin_record(Ring& ring);
+    static void commit_record(Ring& ring) {
+        ring.head.store(ring.head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    static void put(Record& record, ArgType type, const void* data, size_t size);
+    static void encode(Record& record, bool value) { put(record, ARG_BOOL, &value, sizeof(value)); }
+    static void encode(Record& record, double value) { put(record, ARG_DOUBLE, &value, sizeof(value)); }
+    static void encode(Record& record, float value) { encode(record, static_cast<double>(value)); }
+    static void encode(Record& record, const char* value) { put(record, ARG_STRING, value, std::strlen(value)); }
+    static void encode(Record& record, const std::string& value) {
+        put(record, ARG_STRING, value.data(), value.size());
+    }
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+    encode(Record& record, T value) {
+        if constexpr (std::is_enum<T>::value) {
+            encode(record, static_cast<typename std::underlying_type<T>::type>(value));
+        } else if constexpr (std::is_signed<T>::value) {
+            int64_t wide = value;
+            put(record, ARG_INT, &wide, sizeof(wide));
+        } else {
+            uint64_t wide = value;
+            put(record, ARG_UINT, &wide, sizeof(wide));
+        }
+    }
+
+    void register_ring(const std::shared_ptr<Ring>& ring);
+    void writer_loop();
+    // Formats and writes what the rings hold now; returns records written
+    size_t drain(std::string& out, std::string& err);
+    void format_record(const Record& record, std::string& line);
+
+    static inline std::atomic<uint8_t> min_level_{static_cast<uint8_t>(SECURECOMM_LOG_LEVEL)};
+    mutable std::mutex mutex_;
+    std::condition_variable flushed_;
+    std::vector<std::shared_ptr<Ring>> rings_;
+    std::thread writer_;
+    FILE* output_;
+    bool running_;
+    // Bumped by the writer after every pass; flush() waits for two
+    uint64_t passes_;
+    uint64_t written_;
+    // Dropped records already reported, and drops from rings since removed
+    uint64_t reported_drops_;
+    uint64_t retired_drops_;
+    // Record ticks to wall time (writer thread only)
+    TickCalibration clock_;
+    // Last second formatted (writer thread only)
+    int64_t cached_second_;
+    char cached_time_[24];
+};
+
+template <size_t N, typename... Args>
+void Logger::log(LogLevel level, const char (&format)[N], const Args&... args) {
+    Ring& ring = local_ring();
+    Record* record = begin_record(ring);
+    if (!record) {
+        return;
+    }
+    record->ticks = read_ticks();
+    record->format = format;
+    record->level = level;
+    record->arg_count = 0;
+    record->arg_bytes = 0;
+    (encode(*record, args), ...);
+    commit_record(ring);
+}
+
+} // namespace SecureComm
+
+// Call sites: SC_LOG_INFO("Created session {} for client {}", session_id, client_id);
+#define SC_LOG(level, ...)                                                                  \
+    do {                                                                                    \
+        if constexpr (static_cast<int>(level) >= SECURECOMM_LOG_LEVEL) {                    \
+            if (::SecureComm::Logger::enabled(level)) {                                     \
+                ::SecureComm::Logger::log(level, __VA_ARGS__);                              \
+            }                                                                               \
+        }                                                                                   \
+    } while (0)
+
+#define SC_LOG_DEBUG(...) SC_LOG(::SecureComm::LogLevel::DEBUG, __VA_ARGS__)
+#define SC_LOG_INFO(...) SC_LOG(::SecureComm::LogLevel::INFO, __VA_ARGS__)
+#define SC_LOG_WARN(...) SC_LOG(::SecureComm::LogLevel::WARN, __VA_ARGS__)
+#define SC_LOG_ERROR(...) SC_LOG(::SecureComm::LogLevel::ERR, __VA_ARGS__)
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "histogram.h"
+#include "trace.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SecureComm {
+
+enum class MetricCounter : uint8_t {
+    CONNECTIONS_ACCEPTED,
+    HANDSHAKES_FULL,
+    HANDSHAKES_RESUMED,
+    HANDSHAKES_FAILED,
+    // Turned away by the handshake pool's admission limit; also counted as failed
+    HANDSHAKES_REJECTED,
+    // Inits answered with a cookie challenge instead of a key exchange
+    HANDSHAKE_COOKIES_SENT,
+    // Inits carrying a bad or expired cookie; also counted as failed
+    HANDSHAKE_COOKIES_REJECTED,
+    MESSAGES_RECEIVED,
+    MESSAGES_SENT,
+    BYTES_RECEIVED,
+    BYTES_SENT,
+    MESSAGE_ERRORS,
+    KEY_ROTATIONS,
+    COUNTER_COUNT
+};
+
+enum class MetricGauge : uint8_t {
+    // Connections past the handshake
+    ACTIVE_SESSIONS,
+    CONNECTION_THREADS,
+    // Connections the kernel has queued for accept()
+    ACCEPT_QUEUE_DEPTH,
+    // Handshakes waiting for a pool worker, as of the latest submission
+    HANDSHAKE_QUEUE_DEPTH,
+    GAUGE_COUNT
+};
+
+const char* metric_counter_name(MetricCounter counter);
+const char* metric_gauge_name(MetricGauge gauge);
+
+constexpr size_t METRIC_COUNTER_COUNT = static_cast<size_t>(MetricCounter::COUNTER_COUNT);
+constexpr size_t METRIC_GAUGE_COUNT = static_cast<size_t>(MetricGauge::GAUGE_COUNT);
+constexpr size_t METRIC_STAGE_COUNT = static_cast<size_t>(TraceStage::STAGE_COUNT);
+
+// Everything merged at one point in time; counters and histograms are
+// cumulative since the process started
+struct MetricsSnapshot {
+    int64_t wall_ms;
+    std::array<uint64_t, METRIC_COUNTER_COUNT> counters;
+    std::array<int64_t, METRIC_GAUGE_COUNT> gauges;
+    // Stage latencies in nanoseconds, indexed by TraceStage
+    std::vector<LatencyHistogram> stages;
+};
+
+// Server counters, gauges and per-stage latency histograms.
+// Counters and histograms are split into shards, and each thread records
+// into the shard it was assigned on first use, so recording is a few
+// relaxed atomic adds on lines few other threads touch. The server runs a
+// thread per connection, so shards are shared round-robin rather than
+// owned one per thread. start() publishes a merged snapshot at a fixed
+// interval from its own thread, reading the shards while workers keep
+// recording; readers such as the metrics endpoint only ever see snapshots.
+class Metrics {
+public:
+    static Metrics& instance();
+
+    void add(MetricCounter counter, uint64_t amount = 1) {
+        local_shard().counters[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+    }
+    void add_gauge(MetricGauge gauge, int64_t delta) {
+        gauges_[static_cast<size_t>(gauge)].fetch_add(delta, std::memory_order_relaxed);
+    }
+    void set_gauge(MetricGauge gauge, int64_t value) {
+        gauges_[static_cast<size_t>(gauge)].store(value, std::memory_order_relaxed);
+    }
+    // Duration in read_ticks() units
+    void record(TraceStage stage, uint64_t duration_ticks) {
+        uint64_t ns = static_cast<uint64_t>(static_cast<double>(duration_ticks) *
+                                            ns_per_tick_.load(std::memory_order_relaxed));
+        local_shard().stages[static_cast<size_t>(stage)].record(ns);
+    }
+
+    // Publishes a snapshot every interval (and logs per-stage percentiles
+    // at each one with log_summary) until stop()
+    void start(std::chrono::milliseconds interval, bool log_summary = false);
+    void stop();
+    // Latest published snapshot; nullptr before the first
+    std::shared_ptr<const MetricsSnapshot> snapshot() const;
+    // Merges the shards now
+    MetricsSnapshot collect();
+
+private:
+    struct Shard {
+        alignas(64) std::array<std::atomic<uint64_t>, METRIC_COUNTER_COUNT> counters;
+        std::vector<LatencyHistogram> stages;
+    };
+
+    Metrics();
+
+    Shard& local_shard() {
+        static thread_local Shard* shard = nullptr;
+        if (!shard) {
+            shard = &shards_[next_shard_.fetch_add(1, std::memory_order_relaxed) % shard_count_];
+        }
+        return *shard;
+    }
+    void snapshot_loop(std::chrono::milliseconds interval, bool log_summary);
+    void log_snapshot(const MetricsSnapshot& snapshot);
+
+    size_t shard_count_;
+    std::unique_ptr<Shard[]> shards_;
+    std::atomic<size_t> next_shard_;
+    std::array<std::atomic<int64_t>, METRIC_GAUGE_COUNT> gauges_;
+    std::atomic<double> ns_per_tick_;
+    // Snapshot thread only
+    TickCalibration clock_;
+
+    std::shared_ptr<const MetricsSnapshot> latest_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool running_;
+    std::thread snapshot_thread_;
+};
+
+// Records a stage into the trace rings and the latency histograms
+inline void record_stage(TraceStage stage, uint32_t session_id, uint32_t message_id,
+                         uint64_t start_ticks, uint64_t end_ticks) {
+    Tracer::record(stage, session_id, message_id, start_ticks, end_ticks);
+    Metrics::instance().record(stage, end_ticks - start_ticks);
+}
+
+// record_stage() from construction to destruction; the ids can be filled in
+// once they are known
+class StageSpan {
+public:
+    StageSpan(TraceStage stage, uint32_t session_id, uint32_t message_id = 0)
+        : stage_(stage), session_id_(session_id), message_id_(message_id), start_(read_ticks()) {}
+    ~StageSpan() { record_stage(stage_, session_id_, message_id_, start_, read_ticks()); }
+
+    StageSpan(const StageSpan&) = delete;
+    StageSpan& operator=(const StageSpan&) = delete;
+
+    void set_session_id(uint32_t session_id) { session_id_ = session_id; }
+    void set_message_id(uint32_t message_id) { message_id_ = message_id; }
+
+private:
+    TraceStage stage_;
+    uint32_t session_id_;
+    uint32_t message_id_;
+    uint64_t start_;
+};
+
+// Adds to a gauge for the lifetime of the scope
+class GaugeGuard {
+public:
+    explicit GaugeGuard(MetricGauge gauge) : gauge_(gauge) { Metrics::instance().add_gauge(gauge_, 1); }
+    ~GaugeGuard() { Metrics::instance().add_gauge(gauge_, -1); }
+
+    GaugeGuard(const GaugeGuard&) = delete;
+    GaugeGuard& operator=(const GaugeGuard&) = delete;
+
+private:
+    MetricGauge gauge_;
+};
+
+} // namespace SecureComm
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace SecureComm {
+
+// Slab allocator for key material.
+// Memory comes from dedicated 64 KB mappings that are locked into RAM
+// (never swapped), excluded from core dumps and bracketed by inaccessible
+// guard pages, so running off either end of a slab faults instead of
+// reaching ordinary heap memory. Slots inside a slab are adjacent: an
+// overrun from one slot lands in the next slot of the same slab. Each slab
+// is cut into fixed-size slots of one size class (32 .. 4096 bytes), every
+// slot is zeroized when it is freed, and a slab whose slots are all free is
+// unmapped once its class has another empty slab in reserve. Each thread
+// keeps a few free slots per class, so most allocate and deallocate calls
+// take no lock; the shared per-class lists are refilled and drained in
+// batches. Larger blocks get a guarded mapping of their own. If the process
+// may not lock more memory the arena keeps working unlocked and counts the
+// failure in stats().
+class SecureArena {
+public:
+    static constexpr size_t MIN_SLOT_SIZE = 32;
+    static constexpr size_t MAX_SLOT_SIZE = 4096;
+    static constexpr size_t CLASS_COUNT = 8;
+    static constexpr size_t SLAB_SIZE = 64 * 1024;
+
+    struct ClassStats {
+        size_t slot_size;
+        size_t slabs;
+        size_t slots_total;
+        // Includes free slots held in per-thread caches
+        size_t slots_in_use;
+        size_t peak_slots_in_use;
+    };
+
+    struct Stats {
+        std::array<ClassStats, CLASS_COUNT> classes;
+        size_t slabs;
+        size_t slots_total;
+        size_t slots_in_use;
+        size_t large_blocks;
+        size_t large_bytes;
+        // Mapped bytes, excluding guard pages
+        size_t reserved_bytes;
+        size_t locked_bytes;
+        size_t lock_failures;
+    };
+
+    // Process-wide arena; never destroyed, so key holders with static
+    // storage duration can still free into it during exit
+    static SecureArena& instance();
+
+    // Throws std::bad_alloc when no memory can be mapped
+    void* allocate(size_t size);
+    // size must be the size passed to allocate()
+    void deallocate(void* pointer, size_t size) noexcept;
+
+    Stats stats() const;
+
+    SecureArena(const SecureArena&) = delete;
+    SecureArena& operator=(const SecureArena&) = delete;
+
+private:
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+
+    // One slab mapping; the bookkeeping lives on the ordinary heap, away
+    // from the key bytes
+    struct Slab {
+        uint8_t* base = nullptr;
+        FreeSlot* free_list = nullptr;
+        size_t free_slots = 0;
+        // Links in the class's list of slabs with free slots
+        Slab* prev = nullptr;
+        Slab* next = nullptr;
+    };
+
+    struct SizeClass {
+        mutable std::mutex mutex;
+        // By base address, to find the slab a freed slot belongs to
+        std::map<uintptr_t, std::unique_ptr<Slab>> slabs;
+        Slab* available = nullptr;
+        size_t empty_slabs = 0;
+        size_t slots_total = 0;
+        size_t slots_in_use = 0;
+        size_t peak_slots_in_use = 0;
+    };
+
+    // Free slots a thread holds per class; returned to the shared lists
+    // when the thread exits
+    struct ThreadCache {
+        std::array<FreeSlot*, CLASS_COUNT> slots{};
+        std::array<size_t, CLASS_COUNT> counts{};
+        ~ThreadCache();
+    };
+
+    SecureArena();
+
+    static size_t class_index(size_t size);
+    static size_t class_slot_size(size_t index);
+    static size_t class_cache_limit(size_t index);
+    // nullptr once the calling thread's cache has been torn down
+    static ThreadCache* thread_cache();
+
+    // Guarded, locked mapping of at least size bytes; returns the usable start
+    void* map_region(size_t size);
+    void unmap_region(void* pointer, size_t size) noexcept;
+    void add_slab_locked(size_t index);
+    static void unlink_slab(SizeClass& size_class, Slab* slab) noexcept;
+    FreeSlot* pop_slot_locked(size_t index);
+    void push_slot_locked(size_t index, FreeSlot* slot) noexcept;
+    void refill(size_t index, ThreadCache& cache);
+    void drain(size_t index, ThreadCache& cache, size_t count) noexcept;
+
+    std::array<SizeClass, CLASS_COUNT> classes_;
+    size_t page_size_;
+
+    mutable std::mutex region_mutex_;
+    size_t large_blocks_;
+    size_t large_bytes_;
+    size_t reserved_bytes_;
+    size_t locked_bytes_;
+    size_t lock_failures_;
+};
+
+// Standard allocator over SecureArena
+template <typename T>
+struct SecureAllocator {
+    using value_type = T;
+
+    SecureAllocator() noexcept = default;
+    template <typename U>
+    SecureAllocator(const SecureAllocator<U>&) noexcept {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(SecureArena::instance().allocate(count * sizeof(T)));
+    }
+    void deallocate(T* pointer, size_t count) noexcept {
+        SecureArena::instance().deallocate(pointer, count * sizeof(T));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const SecureAllocator<T>&, const SecureAllocator<U>&) noexcept { return true; }
+template <typename T, typename U>
+bool operator!=(const SecureAllocator<T>&, const SecureAllocator<U>&) noexcept { return false; }
+
+// Variable-length key material (private keys, shared secrets)
+using SecureBytes = std::vector<uint8_t, SecureAllocator<uint8_t>>;
+
+// Moves a key derived on the ordinary heap into secure memory: copies it
+// and zeroizes the source
+SecureBytes to_secure_bytes(std::vector<uint8_t>&& bytes);
+
+// One fixed-size value (a SessionKey, a ChainKey) in its own arena slot.
+// Copies copy the value into a fresh slot; the slot is zeroized on destruction.
+template <typename T>
+class SecureBox {
+    static_assert(std::is_trivially_copyable<T>::value, "SecureBox holds plain key bytes");
+
+public:
+    SecureBox() : value_(new (SecureArena::instance().allocate(sizeof(T))) T()) {}
+    explicit SecureBox(const T& value) : value_(new (SecureArena::instance().allocate(sizeof(T))) T(value)) {}
+    SecureBox(const SecureBox& other) : SecureBox(*other.value_) {}
+    ~SecureBox() { SecureArena::instance().deallocate(value_, sizeof(T)); }
+
+    SecureBox& operator=(const SecureBox& other) {
+        *value_ = *other.value_;
+        return *this;
+    }
+    SecureBox& operator=(const T& value) {
+        *value_ = value;
+        return *this;
+    }
+
+    T& operator*() { return *value_; }
+    const T& operator*() const { return *value_; }
+    T* operator->() { return value_; }
+    const T* operator->() const { return value_; }
+
+private:
+    T* value_;
+};
+
+} // namespace SecureComm
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Timestamps come from the TSC where there is one: a few ns instead of a clock read
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define SECURECOMM_HAVE_TSC 1
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <x86intrin.h>
+    #endif
+#endif
+
+namespace SecureComm {
+
+inline uint64_t steady_now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Raw timestamp for the logger and the tracer: TSC ticks, or steady_clock
+// nanoseconds; TickCalibration converts them
+inline uint64_t read_ticks() {
+#ifdef SECURECOMM_HAVE_TSC
+    return __rdtsc();
+#else
+    return steady_now_ns();
+#endif
+}
+
+// Maps ticks to nanoseconds and wall-clock time. The tick rate is measured
+// against steady_clock over the time since construction, so every refine()
+// makes it more precise. Not thread-safe; each reader keeps its own.
+class TickCalibration {
+public:
+    TickCalibration() : ns_per_tick_(1.0) {
+        base_wall_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        base_steady_ns_ = steady_now_ns();
+        base_ticks_ = read_ticks();
+#ifdef SECURECOMM_HAVE_TSC
+        // Spin briefly for a first estimate
+        while (steady_now_ns() - base_steady_ns_ < 200000) {
+        }
+        refine();
+#endif
+    }
+
+    void refine() {
+#ifdef SECURECOMM_HAVE_TSC
+        uint64_t ticks = read_ticks();
+        uint64_t steady = steady_now_ns();
+        if (ticks > base_ticks_ && steady > base_steady_ns_) {
+            ns_per_tick_ = static_cast<double>(steady - base_steady_ns_) / static_cast<double>(ticks - base_ticks_);
+        }
+#endif
+    }
+
+    double ns_per_tick() const { return ns_per_tick_; }
+    uint64_t base_ticks() const { return base_ticks_; }
+    int64_t base_wall_ns() const { return base_wall_ns_; }
+
+    // Ticks may predate the base slightly when threads run on different cores
+    int64_t wall_ns(uint64_t ticks) const {
+        int64_t elapsed = static_cast<int64_t>(ticks - base_ticks_);
+        return base_wall_ns_ + static_cast<int64_t>(static_cast<double>(elapsed) * ns_per_tick_);
+    }
+
+private:
+    uint64_t base_ticks_;
+    uint64_t base_steady_ns_;
+    int64_t base_wall_ns_;
+    double ns_per_tick_;
+};
+
+} // namespace SecureComm
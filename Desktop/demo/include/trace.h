@@ -0,0 +1,167 @@
+#pragma once
+
+#include "tick_clock.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 0 compiles every trace point out
+#ifndef SECURECOMM_TRACE
+#define SECURECOMM_TRACE 1
+#endif
+
+namespace SecureComm {
+
+// Stages of a message's lifecycle on the server, then of a connection's
+// handshake (appended, so older dumps still read)
+enum class TraceStage : uint8_t {
+    RECV = 0,
+    PARSE = 1,
+    AUTH = 2,
+    DECRYPT = 3,
+    DECOMPRESS = 4,
+    HANDLER = 5,
+    COMPRESS = 6,
+    ENCRYPT = 7,
+    SIGN = 8,
+    SEND = 9,
+    ROTATE = 10,
+    // accept() returning to the connection's thread starting
+    ACCEPT = 11,
+    HANDSHAKE = 12,
+    HANDSHAKE_INIT = 13,
+    HANDSHAKE_KEYGEN = 14,
+    HANDSHAKE_EXCHANGE = 15,
+    HANDSHAKE_DERIVE = 16,
+    HANDSHAKE_RESPONSE = 17,
+    // Waiting for the client's HANDSHAKE_COMPLETE
+    HANDSHAKE_COMPLETE = 18,
+    // A whole session-id or ticket resumption, in place of KEYGEN..COMPLETE
+    HANDSHAKE_RESUME = 19,
+    // Waiting for a handshake pool worker
+    HANDSHAKE_QUEUE = 20,
+    STAGE_COUNT = 21
+};
+
+const char* trace_stage_name(TraceStage stage);
+
+// One stage of one message: start and duration in ticks
+struct TraceEvent {
+    uint64_t start_ticks;
+    uint32_t duration_ticks;
+    uint32_t session_id;
+    uint32_t message_id;
+    TraceStage stage;
+};
+
+// A dump file read back by the offline tools
+struct TraceDump {
+    struct Thread {
+        uint32_t thread_index;
+        std::vector<TraceEvent> events;
+    };
+
+    double ns_per_tick;
+    uint64_t base_ticks;
+    int64_t base_wall_ns;
+    std::vector<Thread> threads;
+};
+
+// Always-on flight recorder for the message path.
+// Each thread records stage spans into its own ring of the last
+// RING_CAPACITY events, overwriting the oldest; recording is two TSC reads
+// and three relaxed stores, with no locks. dump() copies every ring (the
+// rings of recently exited threads included) to a binary file that
+// tools/trace_convert turns into Chrome trace JSON or a per-stage latency
+// report. On POSIX, dump_on_signal() makes SIGUSR1 write a dump.
+class Tracer {
+public:
+    static constexpr size_t RING_CAPACITY = 1024;
+    // Rings of exited threads kept for the next dump
+    static constexpr size_t MAX_RETIRED_RINGS = 64;
+
+    static Tracer& instance();
+
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+    static void set_enabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+
+    static void record(TraceStage stage, uint32_t session_id, uint32_t message_id,
+                       uint64_t start_ticks, uint64_t end_ticks) {
+        if constexpr (SECURECOMM_TRACE != 0) {
+            if (enabled()) {
+                local_ring().push(stage, session_id, message_id, start_ticks, end_ticks);
+            }
+        }
+    }
+
+    // Writes the current contents of every ring; returns the events written
+    // or throws std::runtime_error
+    size_t dump(const std::string& path);
+    // SIGUSR1 writes <path_prefix>.<n>.trace from a background thread
+    void dump_on_signal(const std::string& path_prefix);
+    void stop();
+
+    static TraceDump read_dump(const std::string& path);
+
+private:
+    // Events are stored as three words written with relaxed atomics, so a
+    // dump can copy a ring while its thread keeps recording
+    struct Ring {
+        alignas(64) std::atomic<uint64_t> head{0};
+        std::atomic<bool> closed{false};
+        uint32_t thread_index = 0;
+        std::array<std::array<std::atomic<uint64_t>, 3>, RING_CAPACITY> events;
+
+        void push(TraceStage stage, uint32_t session_id, uint32_t message_id,
+                  uint64_t start_ticks, uint64_t end_ticks) {
+            uint64_t index = head.load(std::memory_order_relaxed);
+            std::array<std::atomic<uint64_t>, 3>& slot = events[index % RING_CAPACITY];
+            uint64_t duration = end_ticks - start_ticks;
+            if (duration > UINT32_MAX) {
+                duration = UINT32_MAX;
+            }
+            slot[0].store(start_ticks, std::memory_order_relaxed);
+            slot[1].store(session_id | (static_cast<uint64_t>(message_id) << 32), std::memory_order_relaxed);
+            slot[2].store(static_cast<uint64_t>(stage) | (duration << 32), std::memory_order_relaxed);
+            head.store(index + 1, std::memory_order_release);
+        }
+    };
+
+    struct RingHandle {
+        std::shared_ptr<Ring> ring;
+        ~RingHandle();
+    };
+
+    Tracer();
+
+    static Ring& local_ring() {
+        static thread_local Ring* ring = nullptr;
+        if (!ring) {
+            ring = &register_thread();
+        }
+        return *ring;
+    }
+    static Ring& register_thread();
+    void signal_loop();
+
+    static inline std::atomic<bool> enabled_{true};
+
+    std::mutex mutex_;
+    std::vector<std::shared_ptr<Ring>> rings_;
+    uint32_t next_thread_index_;
+    // Serializes dumps and owns the tick rate written into them
+    std::mutex dump_mutex_;
+    TickCalibration clock_;
+    std::string signal_path_;
+    std::thread signal_thread_;
+    std::atomic<bool> signal_running_;
+    uint32_t dump_count_;
+};
+
+} // namespace SecureComm
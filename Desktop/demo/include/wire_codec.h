@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace SecureComm {
+
+// Compile-time wire codec.
+// A WireLayout lists a struct's fields in wire order; every field is written
+// little-endian at a fixed offset with no padding, whatever the host's byte
+// order and struct alignment. Sizes and offsets are constants, and encode
+// and decode expand to straight-line loads and stores per field.
+
+// Little-endian integer at p; p needs no alignment
+template <typename T>
+constexpr T load_le(const uint8_t* p) {
+    static_assert(std::is_integral<T>::value, "load_le reads integers");
+    using Unsigned = typename std::make_unsigned<T>::type;
+    Unsigned value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        value = static_cast<Unsigned>(value | static_cast<Unsigned>(static_cast<Unsigned>(p[i]) << (8 * i)));
+    }
+    return static_cast<T>(value);
+}
+
+template <typename T>
+constexpr void store_le(uint8_t* p, T value) {
+    static_assert(std::is_integral<T>::value, "store_le writes integers");
+    using Unsigned = typename std::make_unsigned<T>::type;
+    Unsigned bits = static_cast<Unsigned>(value);
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        p[i] = static_cast<uint8_t>(bits >> (8 * i));
+    }
+}
+
+// Encoding of one field type: integers and enums little-endian, byte arrays verbatim
+template <typename T, typename Enable = void>
+struct WireCodec;
+
+template <typename T>
+struct WireCodec<T, typename std::enable_if<std::is_integral<T>::value>::type> {
+    static constexpr size_t size = sizeof(T);
+    static constexpr T load(const uint8_t* in) { return load_le<T>(in); }
+    static constexpr void store(uint8_t* out, T value) { store_le<T>(out, value); }
+};
+
+template <typename T>
+struct WireCodec<T, typename std::enable_if<std::is_enum<T>::value>::type> {
+    using Underlying = typename std::underlying_type<T>::type;
+    static constexpr size_t size = sizeof(Underlying);
+    static constexpr T load(const uint8_t* in) { return static_cast<T>(load_le<Underlying>(in)); }
+    static constexpr void store(uint8_t* out, T value) { store_le<Underlying>(out, static_cast<Underlying>(value)); }
+};
+
+template <size_t N>
+struct WireCodec<uint8_t[N]> {
+    static constexpr size_t size = N;
+    static void load(const uint8_t* in, uint8_t (&value)[N]) { std::memcpy(value, in, N); }
+    static void store(uint8_t* out, const uint8_t (&value)[N]) { std::memcpy(out, value, N); }
+};
+
+template <typename MemberPointer>
+struct MemberPointerTraits;
+
+template <typename Owner, typename T>
+struct MemberPointerTraits<T Owner::*> {
+    using owner = Owner;
+    using type = T;
+};
+
+// One struct member, identified by its member pointer
+template <auto Member>
+struct WireField {
+    using Owner = typename MemberPointerTraits<decltype(Member)>::owner;
+    using Type = typename MemberPointerTraits<decltype(Member)>::type;
+    using Codec = WireCodec<Type>;
+    static constexpr size_t size = Codec::size;
+
+    static void encode(const Owner& value, uint8_t* out) { Codec::store(out, value.*Member); }
+    static void decode(const uint8_t* in, Owner& value) {
+        if constexpr (std::is_array<Type>::value) {
+            Codec::load(in, value.*Member);
+        } else {
+            value.*Member = Codec::load(in);
+        }
+    }
+};
+
+template <typename Struct, typename... Fields>
+struct WireLayout {
+    static_assert(sizeof...(Fields) > 0, "A wire layout needs at least one field");
+    static_assert((std::is_same<typename Fields::Owner, Struct>::value && ...),
+                  "Every field must belong to the layout's struct");
+
+    // Encoded size in bytes
+    static constexpr size_t size = (Fields::size + ...);
+
+    // Offset of a member on the wire
+    template <auto Member>
+    static constexpr size_t offset_of() {
+        static_assert((std::is_same<Fields, WireField<Member>>::value || ...),
+                      "Member is not part of this wire layout");
+        constexpr bool match[] = {std::is_same<Fields, WireField<Member>>::value...};
+        constexpr size_t sizes[] = {Fields::size...};
+        size_t offset = 0;
+        for (size_t i = 0; !match[i]; ++i) {
+            offset += sizes[i];
+        }
+        return offset;
+    }
+
+    // Scalar member read straight from an encoded buffer
+    template <auto Member>
+    static constexpr typename WireField<Member>::Type load(const uint8_t* in) {
+        return WireField<Member>::Codec::load(in + offset_of<Member>());
+    }
+
+    // out must hold size bytes
+    static void encode(const Struct& value, uint8_t* out) {
+        size_t offset = 0;
+        ((Fields::encode(value, out + offset), offset += Fields::size), ...);
+    }
+
+    // in must hold size bytes
+    static Struct decode(const uint8_t* in) {
+        Struct value{};
+        size_t offset = 0;
+        ((Fields::decode(in + offset, value), offset += Fields::size), ...);
+        return value;
+    }
+};
+
+} // namespace SecureComm
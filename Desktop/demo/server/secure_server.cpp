@@ -0,0 +1,1129 @@
+#include "secure_server.h"
+#include "logger.h"
+#include "metrics.h"
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #pragma comment(lib, "ws2_32.lib")
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+#endif
+
+#include <cstring>
+
+SecureServer::SecureServer()
+    : server_socket_(-1), running_(false), cookie_threshold_(0), key_exchanges_in_progress_(0) {
+#ifdef _WIN32
+    // Initialize Winsock
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        throw std::runtime_error("WSAStartup failed");
+    }
+#endif
+
+    crypto_manager_ = std::make_unique<SecureComm::CryptoManager>();
+    expiry_wheel_ = std::make_unique<SecureComm::TimerWheel>(std::chrono::seconds(1));
+    session_manager_ = std::make_unique<SecureComm::SessionManager>();
+    key_manager_ = std::make_unique<SecureComm::KeyManager>();
+    session_manager_->enable_expiry(expiry_wheel_.get());
+    key_manager_->set_timer_wheel(expiry_wheel_.get());
+    ticket_manager_ = std::make_unique<SecureComm::SessionTicketManager>();
+    ticket_manager_->enable_rotation(expiry_wheel_.get());
+
+    // Generate server's RSA key pair
+    server_keypair_ = crypto_manager_->generate_rsa_keypair(2048);
+    SC_LOG_INFO("Server RSA key pair generated successfully");
+}
+
+SecureServer::~SecureServer() {
+    stop();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+bool SecureServer::enable_session_store(const std::string& store_path) {
+    try {
+        SecureComm::SecureBytes store_key = SecureComm::PersistentSessionStore::load_or_create_key(store_path + ".key");
+        auto store = std::make_shared<SecureComm::PersistentSessionStore>(store_path, store_key);
+        session_manager_->attach_store(store);
+
+        auto load_start = std::chrono::steady_clock::now();
+        size_t restored = session_manager_->restore_from_store();
+        auto load_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - load_start).count();
+        SC_LOG_INFO("Restored {} sessions from {} in {} ms", restored, store_path, load_ms);
+        session_store_ = store;
+        return true;
+    } catch (const std::exception& e) {
+        SC_LOG_ERROR("Failed to open session store: {}", e.what());
+        return false;
+    }
+}
+
+bool SecureServer::enable_replication(const SecureComm::ReplicationConfig& config) {
+    try {
+        auto replicator = std::make_shared<SecureComm::SessionReplicator>(config);
+        SecureComm::SessionManager* sessions = session_manager_.get();
+        replicator->set_apply_callback([sessions](const SecureComm::SessionChange& change) {
+            sessions->apply_replicated(change);
+        });
+        replicator->set_snapshot_callback([sessions]() {
+            return sessions->export_sessions();
+        });
+        session_manager_->attach_replicator(replicator);
+        replicator->start();
+        replicator_ = replicator;
+
+        SC_LOG_INFO("Replication node {} listening on {}:{} with {} peers",
+                    config.node_id, config.listen_address, config.listen_port, config.peers.size());
+        return true;
+    } catch (const std::exception& e) {
+        SC_LOG_ERROR("Failed to enable replication: {}", e.what());
+        return false;
+    }
+}
+
+bool SecureServer::enable_handshake_pool(const SecureComm::HandshakePoolConfig& config) {
+    try {
+        handshake_pool_ = std::make_unique<SecureComm::HandshakePool>(config);
+        return true;
+    } catch (const std::exception& e) {
+        SC_LOG_ERROR("Failed to start handshake pool: {}", e.what());
+        return false;
+    }
+}
+
+bool SecureServer::enable_handshake_cookies(size_t threshold) {
+    try {
+        handshake_cookies_ = std::make_unique<SecureComm::HandshakeCookies>();
+        cookie_threshold_ = threshold;
+        SC_LOG_INFO("Handshake cookies required with {} or more key exchanges in progress", threshold);
+        return true;
+    } catch (const std::exception& e) {
+        SC_LOG_ERROR("Failed to set up handshake cookies: {}", e.what());
+        return false;
+    }
+}
+
+void SecureServer::set_session_idle_timeout(std::chrono::seconds idle_timeout) {
+    session_manager_->enable_expiry(expiry_wheel_.get(), idle_timeout);
+}
+
+bool SecureServer::start(uint16_t port) {
+    server_socket_ = static_cast<int>(socket(AF_INET, SOCK_STREAM, 0));
+    if (server_socket_ < 0) {
+        SC_LOG_ERROR("Failed to create socket");
+        return false;
+    }
+
+    int opt = 1;
+    if (setsockopt(server_socket_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&opt), sizeof(opt)) < 0) {
+        SC_LOG_ERROR("Failed to set socket options");
+#ifdef _WIN32
+        closesocket(server_socket_);
+#else
+        close(server_socket_);
+#endif
+        return false;
+    }
+
+    struct sockaddr_in server_addr;
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = INADDR_ANY;
+    server_addr.sin_port = htons(port);
+
+    if (bind(server_socket_, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+        SC_LOG_ERROR("Failed to bind socket");
+#ifdef _WIN32
+        closesocket(server_socket_);
+#else
+        close(server_socket_);
+#endif
+        return false;
+    }
+
+    // A deep accept queue, so a burst of connections is not met with dropped
+    // SYNs (and the client's one-second retransmit)
+    if (listen(server_socket_, SOMAXCONN) < 0) {
+        SC_LOG_ERROR("Failed to listen on socket");
+#ifdef _WIN32
+        closesocket(server_socket_);
+#else
+        close(server_socket_);
+#endif
+        return false;
+    }
+
+    running_ = true;
+    SC_LOG_INFO("Secure server started on port {}", port);
+    SC_LOG_INFO("Server public key: {}...", SecureComm::bytes_to_hex(server_keypair_.public_key).substr(0, 64));
+
+    // Drive session and key expiry one tick at a time
+    expiry_thread_ = std::thread([this]() {
+        while (running_) {
+            std::this_thread::sleep_for(expiry_wheel_->tick());
+            expiry_wheel_->advance();
+        }
+    });
+
+    return true;
+}
+
+void SecureServer::run() {
+    while (running_) {
+        struct sockaddr_in client_addr;
+        socklen_t client_len = sizeof(client_addr);
+
+        int client_socket = static_cast<int>(accept(server_socket_, (struct sockaddr*)&client_addr, &client_len));
+        if (client_socket < 0) {
+            if (running_) {
+                SC_LOG_ERROR("Failed to accept client connection");
+            }
+            continue;
+        }
+
+        uint64_t accepted_ticks = SecureComm::read_ticks();
+        SecureComm::Metrics::instance().add(SecureComm::MetricCounter::CONNECTIONS_ACCEPTED);
+#ifdef __linux__
+        // On a listening socket, the kernel reports its accept queue length here
+        struct tcp_info queue_info;
+        socklen_t queue_info_len = sizeof(queue_info);
+        if (getsockopt(server_socket_, IPPROTO_TCP, TCP_INFO, &queue_info, &queue_info_len) == 0) {
+            SecureComm::Metrics::instance().set_gauge(SecureComm::MetricGauge::ACCEPT_QUEUE_DEPTH,
+                                                      queue_info.tcpi_unacked);
+        }
+#endif
+
+        // Handshake flights are small writes; don't let Nagle hold them back
+        int nodelay = 1;
+        setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&nodelay), sizeof(nodelay));
+
+        SC_LOG_DEBUG("New client connected from {}:{}", inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
+
+        // Handle client in separate thread; finished ones are joined as we
+        // go, so short-lived connections (challenged or failed handshakes)
+        // do not each leave a thread stack behind until stop()
+        reap_client_threads();
+        uint32_t peer_address = client_addr.sin_addr.s_addr;
+        client_threads_.emplace_back([this, client_socket, peer_address, accepted_ticks]() {
+            handle_client(client_socket, peer_address, accepted_ticks);
+            std::lock_guard<std::mutex> lock(finished_threads_mutex_);
+            finished_threads_.push_back(std::this_thread::get_id());
+        });
+    }
+}
+
+void SecureServer::stop() {
+    running_ = false;
+
+    if (server_socket_ >= 0) {
+#ifdef _WIN32
+        closesocket(server_socket_);
+#else
+        // Wakes a run() blocked in accept()
+        shutdown(server_socket_, SHUT_RDWR);
+        close(server_socket_);
+#endif
+        server_socket_ = -1;
+    }
+
+    // Wait for all client threads to finish
+    for (auto& thread : client_threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    client_threads_.clear();
+
+    if (handshake_pool_) {
+        handshake_pool_->stop();
+    }
+
+    if (expiry_thread_.joinable()) {
+        expiry_thread_.join();
+    }
+
+    if (replicator_) {
+        replicator_->stop();
+    }
+
+    if (session_store_) {
+        session_store_->flush();
+    }
+}
+
+void SecureServer::reap_client_threads() {
+    std::vector<std::thread::id> finished;
+    {
+        std::lock_guard<std::mutex> lock(finished_threads_mutex_);
+        finished.swap(finished_threads_);
+    }
+    for (std::thread::id id : finished) {
+        auto it = std::find_if(client_threads_.begin(), client_threads_.end(),
+                               [id](const std::thread& thread) { return thread.get_id() == id; });
+        if (it != client_threads_.end()) {
+            it->join();
+            std::swap(*it, client_threads_.back());
+            client_threads_.pop_back();
+        }
+    }
+}
+
+void SecureServer::handle_client(int client_socket, uint32_t peer_address, uint64_t accepted_ticks) {
+    SecureComm::GaugeGuard thread_gauge(SecureComm::MetricGauge::CONNECTION_THREADS);
+    SecureComm::record_stage(SecureComm::TraceStage::ACCEPT, 0, 0, accepted_ticks, SecureComm::read_ticks());
+    try {
+        // The handle is held for the whole connection; no per-message table lookups
+        SecureComm::SessionHandle session;
+        bool challenged = false;
+        {
+            SecureComm::StageSpan span(SecureComm::TraceStage::HANDSHAKE, 0);
+            session = perform_handshake(client_socket, peer_address, &challenged);
+            if (session) {
+                span.set_session_id(session->session_id());
+            }
+        }
+        if (!session) {
+            // A challenged client comes back on a new connection with its cookie
+            if (!challenged) {
+                SC_LOG_WARN("Handshake failed");
+            }
+#ifdef _WIN32
+            closesocket(client_socket);
+#else
+            close(client_socket);
+#endif
+            return;
+        }
+
+        SC_LOG_DEBUG("Handshake completed successfully for client {}", session->client_id());
+
+        // Handle encrypted messages
+        SecureComm::GaugeGuard session_gauge(SecureComm::MetricGauge::ACTIVE_SESSIONS);
+        handle_encrypted_messages(client_socket, *session);
+
+    } catch (const std::exception& e) {
+        SC_LOG_ERROR("Error handling client: {}", e.what());
+    }
+
+#ifdef _WIN32
+    closesocket(client_socket);
+#else
+    close(client_socket);
+#endif
+    SC_LOG_DEBUG("Client disconnected");
+}
+
+SecureComm::SessionHandle SecureServer::perform_handshake(int client_socket, uint32_t peer_address,
+                                                          bool* challenged) {
+    SecureComm::Metrics& metrics = SecureComm::Metrics::instance();
+    try {
+        // Step 1: Receive handshake init
+        uint64_t header_ticks = 0;
+        std::vector<uint8_t> handshake_data = receive_data(client_socket, &header_ticks);
+        SecureComm::MessageView message(handshake_data);
+
+        if (message.type() != SecureComm::MessageType::HANDSHAKE_INIT) {
+            SC_LOG_WARN("Expected HANDSHAKE_INIT, got {}", SecureComm::message_type_to_string(message.type()));
+            metrics.add(SecureComm::MetricCounter::HANDSHAKES_FAILED);
+            return nullptr;
+        }
+
+        // Read the handshake in place
+        SecureComm::HandshakeView client_handshake(message.body());
+
+        SC_LOG_DEBUG("Received handshake init from client {}", client_handshake.client_id());
+
+        // Offered capabilities come first in the trailer; a client that
+        // sends none predates negotiation and gets the baseline
+        SecureComm::ByteView trailer = client_handshake.trailer();
+        SecureComm::Capabilities capabilities = SecureComm::baseline_capabilities();
+        if (message.flags() & SecureComm::FLAG_CAPABILITIES) {
+            capabilities = SecureComm::negotiate_capabilities(SecureComm::local_capabilities(),
+                                                              SecureComm::deserialize_capabilities(trailer));
+            trailer = trailer.subview(SecureComm::CAPABILITIES_WIRE_SIZE);
+        }
+        SecureComm::record_stage(SecureComm::TraceStage::HANDSHAKE_INIT, client_handshake.session_id(), 0,
+                                 header_ticks, SecureComm::read_ticks());
+
+        SecureComm::SessionHandle session;
+        bool resumed = (message.flags() & (SecureComm::FLAG_TICKET | SecureComm::FLAG_RESUME)) != 0;
+        if (message.flags() & SecureComm::FLAG_TICKET) {
+            // Ticket, then the optional early-data frame
+            if (trailer.size() < SecureComm::SessionTicketManager::TICKET_SIZE) {
+                metrics.add(SecureComm::MetricCounter::HANDSHAKES_FAILED);
+                send_error(client_socket, SecureComm::ErrorCode::INVALID_MESSAGE);
+                return nullptr;
+            }
+            SecureComm::ByteView ticket = trailer.subview(0, SecureComm::SessionTicketManager::TICKET_SIZE);
+            SecureComm::ByteView early_data;
+            if (message.flags() & SecureComm::FLAG_EARLY_DATA) {
+                early_data = trailer.subview(SecureComm::SessionTicketManager::TICKET_SIZE);
+            }
+            SecureComm::StageSpan span(SecureComm::TraceStage::HANDSHAKE_RESUME, client_handshake.session_id());
+            session = resume_from_ticket(client_socket, client_handshake, capabilities, ticket, early_data);
+        } else if (message.flags() & SecureComm::FLAG_RESUME) {
+            SecureComm::StageSpan span(SecureComm::TraceStage::HANDSHAKE_RESUME, client_handshake.session_id());
+            session = resume_session(client_socket, client_handshake, capabilities);
+        } else {
+            bool cookie_sent = false;
+            if (handshake_cookies_ && !admit_key_exchange(client_socket, peer_address, message.flags(),
+                                                          client_handshake, trailer, cookie_sent)) {
+                if (challenged) {
+                    *challenged = cookie_sent;
+                }
+                return nullptr;
+            }
+            key_exchanges_in_progress_.fetch_add(1, std::memory_order_relaxed);
+            try {
+                session = perform_key_exchange(client_socket, client_handshake, capabilities);
+            } catch (...) {
+                key_exchanges_in_progress_.fetch_sub(1, std::memory_order_relaxed);
+                throw;
+            }
+            key_exchanges_in_progress_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        metrics.add(!session ? SecureComm::MetricCounter::HANDSHAKES_FAILED
+                             : resumed ? SecureComm::MetricCounter::HANDSHAKES_RESUMED
+                                       : SecureComm::MetricCounter::HANDSHAKES_FULL);
+        return session;
+
+    } catch (const std::exception& e) {
+        SC_LOG_ERROR("Handshake error: {}", e.what());
+        metrics.add(SecureComm::MetricCounter::HANDSHAKES_FAILED);
+        return nullptr;
+    }
+}
+
+bool SecureServer::admit_key_exchange(int client_socket, uint32_t peer_address, uint16_t flags,
+                                      const SecureComm::HandshakeView& client_handshake,
+                                      SecureComm::ByteView trailer, bool& challenged) {
+    SecureComm::Metrics& metrics = SecureComm::Metrics::instance();
+    if (flags & SecureComm::FLAG_COOKIE) {
+        // A valid cookie is admitted whatever the load: the client has
+        // shown it receives at its address and waited a round trip for it.
+        // Each cookie is admitted once, so that round trip buys one exchange
+        if (trailer.size() >= SecureComm::HANDSHAKE_COOKIE_SIZE &&
+            handshake_cookies_->redeem(trailer.subview(0, SecureComm::HANDSHAKE_COOKIE_SIZE), peer_address,
+                                       client_handshake)) {
+            return true;
+        }
+        SC_LOG_WARN("Bad, expired or reused handshake cookie from client {}", client_handshake.client_id());
+        metrics.add(SecureComm::MetricCounter::HANDSHAKE_COOKIES_REJECTED);
+        metrics.add(SecureComm::MetricCounter::HANDSHAKES_FAILED);
+        send_error(client_socket, SecureComm::ErrorCode::AUTHENTICATION_FAILED);
+        return false;
+    }
+    if (key_exchanges_in_progress_.load(std::memory_order_relaxed) < cookie_threshold_) {
+        return true;
+    }
+
+    // No session, no key pair: the cookie carries all the server needs to
+    // admit the retry, and the connection ends here
+    std::vector<uint8_t> cookie = handshake_cookies_->issue(peer_address, client_handshake);
+    SecureComm::MessageHeader header;
+    header.version = SecureComm::ProtocolVersion::V1_0;
+    header.type = SecureComm::MessageType::HANDSHAKE_COOKIE;
+    header.sequence_number = 1;
+    header.timestamp = SecureComm::get_current_timestamp_seconds();
+    header.payload_size = static_cast<uint16_t>(cookie.size());
+    header.flags = 0;
+
+    std::vector<uint8_t> challenge = SecureComm::serialize_header(header);
+    challenge.insert(challenge.end(), cookie.begin(), cookie.end());
+    send_data(client_socket, challenge);
+    SC_LOG_DEBUG("Sent handshake cookie to client {}", client_handshake.client_id());
+    metrics.add(SecureComm::MetricCounter::HANDSHAKE_COOKIES_SENT);
+    challenged = true;
+    return false;
+}
+
+SecureComm::SessionHandle SecureServer::perform_key_exchange(int client_socket,
+                                                             const SecureComm::HandshakeView& client_handshake,
+                                                             const SecureComm::Capabilities& capabilities) {
+    uint32_t client_id = SecureComm::generate_client_id();
+    SecureComm::SessionHandle session = session_manager_->create_session(client_id);
+    SC_LOG_DEBUG("Created session {} for client {}", session->session_id(), client_id);
+
+    // Each step is timed from the end of the previous one
+    uint64_t step_ticks = SecureComm::read_ticks();
+    auto end_step = [&step_ticks, &session](SecureComm::TraceStage stage) {
+        uint64_t now = SecureComm::read_ticks();
+        SecureComm::record_stage(stage, session->session_id(), 0, step_ticks, now);
+        step_ticks = now;
+    };
+
+    try {
+        SecureComm::KeyPair ecdh_keypair;
+        std::vector<uint8_t> shared_secret;
+        std::vector<uint8_t> session_key;
+        auto key_exchange = [&]() {
+            if (handshake_pool_) {
+                end_step(SecureComm::TraceStage::HANDSHAKE_QUEUE);
+            }
+
+            // Step 2: Generate an ephemeral X25519 key pair for forward secrecy;
+            // its 32-byte public key fits the handshake message whole
+            ecdh_keypair = crypto_manager_->generate_x25519_keypair();
+            end_step(SecureComm::TraceStage::HANDSHAKE_KEYGEN);
+
+            // Step 3: Perform key exchange
+            shared_secret = crypto_manager_->perform_x25519_key_exchange(
+                ecdh_keypair.private_key, client_handshake.public_key());
+            OPENSSL_cleanse(ecdh_keypair.private_key.data(), ecdh_keypair.private_key.size());
+            end_step(SecureComm::TraceStage::HANDSHAKE_EXCHANGE);
+
+            // Derive session key
+            session_key = crypto_manager_->derive_shared_secret(shared_secret, client_handshake.nonce());
+            end_step(SecureComm::TraceStage::HANDSHAKE_DERIVE);
+        };
+
+        if (!handshake_pool_) {
+            key_exchange();
+        } else {
+            SecureComm::Metrics::instance().set_gauge(SecureComm::MetricGauge::HANDSHAKE_QUEUE_DEPTH,
+                                                      static_cast<int64_t>(handshake_pool_->queue_depth()));
+            if (!handshake_pool_->run(key_exchange)) {
+                // Over the admission limit: refuse now instead of queueing
+                SC_LOG_WARN("Handshake pool full, refusing client {}", client_id);
+                SecureComm::Metrics::instance().add(SecureComm::MetricCounter::HANDSHAKES_REJECTED);
+                send_error(client_socket, SecureComm::ErrorCode::SERVER_BUSY);
+                session_manager_->remove_session(session->session_id());
+                return nullptr;
+            }
+        }
+
+        // Store session key
+        session->set_shared_secret(shared_secret);
+        session->set_current_key(session_key);
+        session->set_capabilities(capabilities);
+        OPENSSL_cleanse(shared_secret.data(), shared_secret.size());
+        OPENSSL_cleanse(session_key.data(), session_key.size());
+
+        // Step 4: Send handshake response
+        SecureComm::HandshakeMessage server_handshake;
+        server_handshake.client_id = session->client_id();
+        server_handshake.session_id = session->session_id();
+        server_handshake.fs_type = SecureComm::ForwardSecrecyType::ECDH;
+        std::copy(ecdh_keypair.public_key.begin(), ecdh_keypair.public_key.end(), server_handshake.public_key);
+
+        // Copy nonce
+        SecureComm::ByteView client_nonce = client_handshake.nonce();
+        std::copy(client_nonce.begin(), client_nonce.end(), server_handshake.nonce);
+
+        SecureComm::MessageHeader response_header;
+        response_header.version = SecureComm::ProtocolVersion::V1_0;
+        response_header.type = SecureComm::MessageType::HANDSHAKE_RESPONSE;
+        response_header.sequence_number = 1;
+        response_header.timestamp = SecureComm::get_current_timestamp_seconds();
+        response_header.payload_size = SecureComm::HANDSHAKE_WIRE_SIZE + SecureComm::CAPABILITIES_WIRE_SIZE;
+        response_header.flags = SecureComm::FLAG_CAPABILITIES;
+
+        std::vector<uint8_t> response_data = SecureComm::serialize_header(response_header);
+        std::vector<uint8_t> handshake_payload = SecureComm::serialize_handshake(server_handshake);
+        response_data.insert(response_data.end(), handshake_payload.begin(), handshake_payload.end());
+        std::vector<uint8_t> selected = SecureComm::serialize_capabilities(capabilities);
+        response_data.insert(response_data.end(), selected.begin(), selected.end());
+
+        if (!send_data(client_socket, response_data)) {
+            SC_LOG_ERROR("Failed to send handshake response");
+            session_manager_->remove_session(session->session_id());
+            return nullptr;
+        }
+        end_step(SecureComm::TraceStage::HANDSHAKE_RESPONSE);
+
+        // Step 5: Receive handshake complete
+        if (!await_handshake_complete(client_socket)) {
+            session_manager_->remove_session(session->session_id());
+            return nullptr;
+        }
+
+        // Authenticate session and make it resumable on every node
+        session->set_authenticated(true);
+        session_manager_->persist_session(*session);
+
+        // Only a completed handshake earns a ticket: one issued earlier would
+        // let the client recreate a session the server went on to reject
+        if (!send_session_ticket(client_socket, *session)) {
+            SC_LOG_ERROR("Failed to send session ticket");
+            return nullptr;
+        }
+
+        SC_LOG_INFO("Handshake completed successfully for session {}", session->session_id());
+        return session;
+
+    } catch (const std::exception&) {
+        session_manager_->remove_session(session->session_id());
+        throw;
+    }
+}
+
+SecureComm::SessionHandle SecureServer::resume_session(int client_socket,
+                                                       const SecureComm::HandshakeView& client_handshake,
+                                                       const SecureComm::Capabilities& capabilities) {
+    uint32_t session_id = client_handshake.session_id();
+    SecureComm::SessionHandle session = session_manager_->find_session(session_id);
+    if (!session || session->client_id() != client_handshake.client_id() ||
+        session->verify_auth() != SecureComm::AuthResult::SUCCESS) {
+        SC_LOG_WARN("Cannot resume session {}", session_id);
+        send_error(client_socket, SecureComm::ErrorCode::SESSION_EXPIRED);
+        return nullptr;
+    }
+
+    // The binder proves the client holds the current session key
+    SecureComm::SessionKey session_key = session->current_key();
+    uint32_t key_epoch = session->key_epoch();
+
+    SecureComm::ByteView client_nonce = client_handshake.nonce();
+    if (!SecureComm::constant_time_compare(client_handshake.public_key(),
+            crypto_manager_->resume_binder(session_key, session_id, client_nonce))) {
+        OPENSSL_cleanse(session_key.data(), session_key.size());
+        SC_LOG_WARN("Invalid resume binder for session {}", session_id);
+        send_error(client_socket, SecureComm::ErrorCode::AUTHENTICATION_FAILED);
+        return nullptr;
+    }
+
+    // Single use per key, as tickets are: a replayed first flight is refused here
+    if (!session->claim_resume_nonce(client_nonce)) {
+        OPENSSL_cleanse(session_key.data(), session_key.size());
+        SC_LOG_WARN("Replayed resume request for session {}", session_id);
+        send_error(client_socket, SecureComm::ErrorCode::SESSION_EXPIRED);
+        return nullptr;
+    }
+
+    // Fresh nonces from both sides give the resumed connection a new key
+    std::vector<uint8_t> server_nonce = crypto_manager_->generate_random_bytes(SecureComm::IV_SIZE);
+    std::vector<uint8_t> resumed_key = crypto_manager_->derive_resumed_key(session_key, client_nonce, server_nonce);
+    OPENSSL_cleanse(session_key.data(), session_key.size());
+
+    // The new key stays with this connection until the client proves it has
+    // it too: adopting it earlier would strand a client that never saw the
+    // response on a key the cluster no longer holds
+    bool sent = send_resume_response(client_socket, client_handshake, capabilities, resumed_key,
+                                     server_nonce, SecureComm::FLAG_RESUME);
+    std::vector<uint8_t> client_finished = crypto_manager_->resume_client_finished(resumed_key);
+    SecureComm::SessionKey next_key;
+    std::copy(resumed_key.begin(), resumed_key.end(), next_key.begin());
+    OPENSSL_cleanse(resumed_key.data(), resumed_key.size());
+    if (!sent || !await_handshake_complete(client_socket, client_finished)) {
+        OPENSSL_cleanse(next_key.data(), next_key.size());
+        return nullptr;
+    }
+
+    bool adopted = session->adopt_key(next_key, key_epoch + 1);
+    OPENSSL_cleanse(next_key.data(), next_key.size());
+    if (!adopted) {
+        // Another node resumed the session first
+        SC_LOG_WARN("Session {} moved past key epoch {} during resume", session_id, key_epoch);
+        send_error(client_socket, SecureComm::ErrorCode::KEY_ROTATION_FAILED);
+        return nullptr;
+    }
+    session->set_capabilities(capabilities);
+    session_manager_->persist_session(*session);
+    if (!send_session_ticket(client_socket, *session)) {
+        return nullptr;
+    }
+
+    session->touch();
+    SC_LOG_INFO("Resumed session {} (key epoch {})", session_id, session->key_epoch());
+    return session;
+}
+
+SecureComm::SessionHandle SecureServer::resume_from_ticket(int client_socket,
+                                                           const SecureComm::HandshakeView& client_handshake,
+                                                           const SecureComm::Capabilities& capabilities,
+                                                           SecureComm::ByteView ticket_data,
+                                                           SecureComm::ByteView early_data) {
+    // The ticket carries the session state, so no table lookup is needed to trust it
+    SecureComm::SessionTicket ticket;
+    if (!ticket_manager_->open(ticket_data, ticket) ||
+        ticket.session_id != client_handshake.session_id() || ticket.client_id != client_handshake.client_id()) {
+        SC_LOG_WARN("Rejected resumption ticket for session {}", client_handshake.session_id());
+        send_error(client_socket, SecureComm::ErrorCode::SESSION_EXPIRED);
+        return nullptr;
+    }
+
+    std::vector<uint8_t> secret(ticket.resumption_secret.begin(), ticket.resumption_secret.end());
+    OPENSSL_cleanse(ticket.resumption_secret.data(), ticket.resumption_secret.size());
+
+    // The binder proves the client holds the secret sealed in the ticket
+    SecureComm::ByteView client_nonce = client_handshake.nonce();
+    if (!SecureComm::constant_time_compare(client_handshake.public_key(),
+            crypto_manager_->resume_binder(secret, ticket.session_id, client_nonce))) {
+        OPENSSL_cleanse(secret.data(), secret.size());
+        SC_LOG_WARN("Invalid ticket binder for session {}", ticket.session_id);
+        send_error(client_socket, SecureComm::ErrorCode::AUTHENTICATION_FAILED);
+        return nullptr;
+    }
+
+    // Single use: a replayed first flight (and its early data) is refused here
+    if (!ticket_manager_->redeem(ticket_data)) {
+        OPENSSL_cleanse(secret.data(), secret.size());
+        SC_LOG_WARN("Replayed resumption ticket for session {}", ticket.session_id);
+        send_error(client_socket, SecureComm::ErrorCode::SESSION_EXPIRED);
+        return nullptr;
+    }
+
+    std::string early_message;
+    if (!early_data.empty() && !open_early_data(early_data, secret, client_nonce, ticket_data, early_message)) {
+        OPENSSL_cleanse(secret.data(), secret.size());
+        SC_LOG_WARN("Invalid early data for session {}", ticket.session_id);
+        send_error(client_socket, SecureComm::ErrorCode::DECRYPTION_FAILED);
+        return nullptr;
+    }
+
+    std::vector<uint8_t> server_nonce = crypto_manager_->generate_random_bytes(SecureComm::IV_SIZE);
+    std::vector<uint8_t> resumed_key = crypto_manager_->derive_resumed_key(secret, client_nonce, server_nonce);
+    OPENSSL_cleanse(secret.data(), secret.size());
+
+    // As with resumption by id, the key stays with the connection until the
+    // client's HANDSHAKE_COMPLETE proves it holds it too
+    bool sent = send_resume_response(client_socket, client_handshake, capabilities, resumed_key,
+                                     server_nonce, SecureComm::FLAG_TICKET);
+    // The reply to early data goes out before HANDSHAKE_COMPLETE arrives,
+    // so the client has it one round trip after connecting; it needs only
+    // the ticket, not the session table
+    if (sent && !early_data.empty()) {
+        sent = send_early_response(client_socket, resumed_key, process_message(ticket.client_id, early_message));
+    }
+    std::vector<uint8_t> client_finished = crypto_manager_->resume_client_finished(resumed_key);
+    SecureComm::PersistedSession state;
+    std::copy(resumed_key.begin(), resumed_key.end(), state.key.begin());
+    OPENSSL_cleanse(resumed_key.data(), resumed_key.size());
+    if (!sent || !await_handshake_complete(client_socket, client_finished)) {
+        OPENSSL_cleanse(state.key.data(), state.key.size());
+        return nullptr;
+    }
+
+    // Recreates the session if this node dropped it (restart, expiry of idle
+    // state). The epoch moves past both the ticket's and this node's, so the
+    // other nodes, which may still hold the session, accept the new key
+    state.session_id = ticket.session_id;
+    state.client_id = ticket.client_id;
+    state.created_at = ticket.created_at;
+    state.key_epoch = ticket.key_epoch + 1;
+    if (SecureComm::SessionHandle existing = session_manager_->find_session(ticket.session_id)) {
+        state.key_epoch = std::max(state.key_epoch, existing->key_epoch() + 1);
+    }
+    SecureComm::SessionHandle session = session_manager_->adopt_session(state);
+    OPENSSL_cleanse(state.key.data(), state.key.size());
+    if (!session) {
+        send_error(client_socket, SecureComm::ErrorCode::SESSION_EXPIRED);
+        return nullptr;
+    }
+    session->set_capabilities(capabilities);
+    session_manager_->persist_session(*session);
+    if (!send_session_ticket(client_socket, *session)) {
+        return nullptr;
+    }
+
+    session->touch();
+    SC_LOG_INFO("Resumed session {} from ticket", ticket.session_id);
+    return session;
+}
+
+bool SecureServer::send_resume_response(int client_socket,
+                                        const SecureComm::HandshakeView& client_handshake,
+                                        const SecureComm::Capabilities& capabilities,
+                                        const std::vector<uint8_t>& resumed_key,
+                                        const std::vector<uint8_t>& server_nonce, uint16_t flags) {
+    SecureComm::HandshakeMessage server_handshake;
+    server_handshake.client_id = client_handshake.client_id();
+    server_handshake.session_id = client_handshake.session_id();
+    server_handshake.fs_type = client_handshake.fs_type();
+    std::vector<uint8_t> finished = crypto_manager_->resume_finished(resumed_key);
+    std::copy(finished.begin(), finished.end(), server_handshake.public_key);
+    std::copy(server_nonce.begin(), server_nonce.end(), server_handshake.nonce);
+
+    SecureComm::MessageHeader response_header;
+    response_header.version = SecureComm::ProtocolVersion::V1_0;
+    response_header.type = SecureComm::MessageType::HANDSHAKE_RESPONSE;
+    response_header.sequence_number = 1;
+    response_header.timestamp = SecureComm::get_current_timestamp_seconds();
+    response_header.payload_size = SecureComm::HANDSHAKE_WIRE_SIZE + SecureComm::CAPABILITIES_WIRE_SIZE;
+    response_header.flags = flags | SecureComm::FLAG_CAPABILITIES;
+
+    std::vector<uint8_t> response_data = SecureComm::serialize_header(response_header);
+    std::vector<uint8_t> handshake_payload = SecureComm::serialize_handshake(server_handshake);
+    response_data.insert(response_data.end(), handshake_payload.begin(), handshake_payload.end());
+    std::vector<uint8_t> selected = SecureComm::serialize_capabilities(capabilities);
+    response_data.insert(response_data.end(), selected.begin(), selected.end());
+    return send_data(client_socket, response_data);
+}
+
+bool SecureServer::open_early_data(SecureComm::ByteView frame, SecureComm::ByteView secret,
+                                   SecureComm::ByteView client_nonce, SecureComm::ByteView ticket,
+                                   std::string& message) {
+    // Frame: IV | sealed message; bound to the ticket it arrived with
+    if (frame.size() < SecureComm::IV_SIZE + SecureComm::GCM_TAG_SIZE ||
+        frame.size() > SecureComm::IV_SIZE + SecureComm::MAX_EARLY_DATA_SIZE + SecureComm::GCM_TAG_SIZE) {
+        return false;
+    }
+
+    std::vector<uint8_t> key = crypto_manager_->derive_early_data_key(secret, client_nonce);
+    try {
+        std::vector<uint8_t> plaintext = crypto_manager_->open_aes_gcm(
+            frame.subview(SecureComm::IV_SIZE), key, frame.subview(0, SecureComm::IV_SIZE), ticket);
+        message.assign(plaintext.begin(), plaintext.end());
+    } catch (const SecureComm::CryptoException&) {
+        OPENSSL_cleanse(key.data(), key.size());
+        return false;
+    }
+    OPENSSL_cleanse(key.data(), key.size());
+    return true;
+}
+
+bool SecureServer::send_early_response(int client_socket, const std::vector<uint8_t>& resumed_key,
+                                       const std::string& response) {
+    std::vector<uint8_t> key = crypto_manager_->derive_early_response_key(resumed_key);
+    std::vector<uint8_t> iv = crypto_manager_->generate_random_bytes(SecureComm::IV_SIZE);
+    std::vector<uint8_t> sealed = crypto_manager_->seal_aes_gcm(
+        std::vector<uint8_t>(response.begin(), response.end()), key, iv);
+    OPENSSL_cleanse(key.data(), key.size());
+
+    SecureComm::MessageHeader header;
+    header.version = SecureComm::ProtocolVersion::V1_0;
+    header.type = SecureComm::MessageType::EARLY_DATA;
+    header.sequence_number = 1;
+    header.timestamp = SecureComm::get_current_timestamp_seconds();
+    header.payload_size = static_cast<uint16_t>(iv.size() + sealed.size());
+    header.flags = 0;
+
+    std::vector<uint8_t> response_data = SecureComm::serialize_header(header);
+    response_data.insert(response_data.end(), iv.begin(), iv.end());
+    response_data.insert(response_data.end(), sealed.begin(), sealed.end());
+    return send_data(client_socket, response_data);
+}
+
+bool SecureServer::send_session_ticket(int client_socket, const SecureComm::Session& session) {
+    SecureComm::SessionKey session_key = session.current_key();
+    std::vector<uint8_t> secret = crypto_manager_->derive_resumption_secret(session_key);
+    OPENSSL_cleanse(session_key.data(), session_key.size());
+
+    SecureComm::SessionTicket ticket;
+    ticket.session_id = session.session_id();
+    ticket.client_id = session.client_id();
+    ticket.created_at = session.created_at();
+    ticket.issued_at = std::chrono::system_clock::now();
+    ticket.key_epoch = session.key_epoch();
+    std::copy(secret.begin(), secret.end(), ticket.resumption_secret.begin());
+    OPENSSL_cleanse(secret.data(), secret.size());
+    std::vector<uint8_t> sealed = ticket_manager_->issue(ticket);
+    OPENSSL_cleanse(ticket.resumption_secret.data(), ticket.resumption_secret.size());
+
+    // Payload: lifetime in seconds (LE) followed by the opaque ticket
+    uint32_t lifetime = static_cast<uint32_t>(ticket_manager_->ticket_lifetime().count());
+    std::vector<uint8_t> payload(sizeof(lifetime));
+    SecureComm::store_le(payload.data(), lifetime);
+    payload.insert(payload.end(), sealed.begin(), sealed.end());
+
+    SecureComm::MessageHeader header;
+    header.version = SecureComm::ProtocolVersion::V1_0;
+    header.type = SecureComm::MessageType::SESSION_TICKET;
+    header.sequence_number = 2;
+    header.timestamp = SecureComm::get_current_timestamp_seconds();
+    header.payload_size = static_cast<uint16_t>(payload.size());
+    header.flags = 0;
+
+    std::vector<uint8_t> ticket_data = SecureComm::serialize_header(header);
+    ticket_data.insert(ticket_data.end(), payload.begin(), payload.end());
+    return send_data(client_socket, ticket_data);
+}
+
+bool SecureServer::await_handshake_complete(int client_socket, SecureComm::ByteView client_finished) {
+    SecureComm::StageSpan span(SecureComm::TraceStage::HANDSHAKE_COMPLETE, 0);
+    std::vector<uint8_t> complete_data = receive_data(client_socket);
+    SecureComm::MessageView complete(complete_data);
+
+    if (complete.type() != SecureComm::MessageType::HANDSHAKE_COMPLETE) {
+        SC_LOG_WARN("Expected HANDSHAKE_COMPLETE, got {}", SecureComm::message_type_to_string(complete.type()));
+        return false;
+    }
+    if (!client_finished.empty() && !SecureComm::constant_time_compare(complete.body(), client_finished)) {
+        SC_LOG_WARN("HANDSHAKE_COMPLETE does not prove the resumed key");
+        return false;
+    }
+    return true;
+}
+
+void SecureServer::handle_encrypted_messages(int client_socket, SecureComm::Session& session) {
+    // Per-direction hash ratchets give every message its own key
+    SecureComm::SessionKey current_key = session.current_key();
+    SecureComm::ChainKeyRatchet recv_chain(current_key, SecureComm::RATCHET_LABEL_CLIENT_TO_SERVER);
+    SecureComm::ChainKeyRatchet send_chain(current_key, SecureComm::RATCHET_LABEL_SERVER_TO_CLIENT);
+    OPENSSL_cleanse(current_key.data(), current_key.size());
+    // Cipher, framing and signing resolved once for this connection
+    const SecureComm::SessionProfile profile = SecureComm::make_session_profile(session.capabilities());
+    // Compression streams for this connection; they allocate nothing unless used
+    SecureComm::MessageCompressor compressor;
+    SecureComm::MessageDecompressor decompressor(message_buffers_);
+    SecureComm::Metrics& metrics = SecureComm::Metrics::instance();
+
+    while (running_) {
+        try {
+            // RECV runs from the header's arrival, so idle time is not counted
+            uint64_t header_ticks = 0;
+            std::vector<uint8_t> encrypted_data = receive_data(client_socket, &header_ticks);
+            if (encrypted_data.empty()) {
+                break; // Client disconnected
+            }
+            uint64_t received_ticks = SecureComm::read_ticks();
+            metrics.add(SecureComm::MetricCounter::MESSAGES_RECEIVED);
+            metrics.add(SecureComm::MetricCounter::BYTES_RECEIVED, encrypted_data.size());
+
+            SecureComm::MessageView message(encrypted_data);
+
+            if (message.type() == SecureComm::MessageType::ENCRYPTED_MESSAGE) {
+                // Read the encrypted message in place
+                SecureComm::EncryptedMessageView encrypted_msg(message.body(),
+                                                               (message.flags() & SecureComm::FLAG_COMPACT) != 0);
+                const uint32_t message_id = encrypted_msg.message_id();
+                SecureComm::record_stage(SecureComm::TraceStage::RECV, session.session_id(), message_id,
+                                         header_ticks, received_ticks);
+                SecureComm::record_stage(SecureComm::TraceStage::PARSE, session.session_id(), message_id,
+                                         received_ticks, SecureComm::read_ticks());
+
+                // Verify session
+                SecureComm::AuthResult auth_result;
+                {
+                    SecureComm::StageSpan span(SecureComm::TraceStage::AUTH, session.session_id(), message_id);
+                    auth_result = session.verify_auth();
+                }
+                if (auth_result != SecureComm::AuthResult::SUCCESS) {
+                    SC_LOG_WARN("Authentication failed: {}", static_cast<int>(auth_result));
+                    metrics.add(SecureComm::MetricCounter::MESSAGE_ERRORS);
+                    send_error(client_socket, SecureComm::ErrorCode::AUTHENTICATION_FAILED);
+                    break;
+                }
+
+                if (message.payload_size() > profile.max_frame_size) {
+                    metrics.add(SecureComm::MetricCounter::MESSAGE_ERRORS);
+                    send_error(client_socket, SecureComm::ErrorCode::INVALID_MESSAGE);
+                    continue;
+                }
+
+                // Decrypt message with the key for its ratchet counter; the
+                // chain only moves once the message has authenticated
+                std::vector<uint8_t> decrypted_data;
+                try {
+                    SecureComm::StageSpan span(SecureComm::TraceStage::DECRYPT, session.session_id(), message_id);
+                    SecureComm::ChainKeyRatchet::PendingKey pending = recv_chain.pending_key_for(message_id);
+                    decrypted_data = crypto_manager_->open_aead(
+                        profile.cipher, encrypted_msg.ciphertext(message.payload_size()), pending.key(),
+                        encrypted_msg.iv(),
+                        SecureComm::encrypted_message_aad(message.header(), session.session_id(), message_id));
+                    recv_chain.commit(pending);
+                } catch (const SecureComm::CryptoException& e) {
+                    // Deriving the key for a forged counter costs chain steps
+                    // before the tag is checked, so a frame that does not
+                    // authenticate ends the connection instead of letting the
+                    // peer repeat that work on it
+                    SC_LOG_WARN("Rejected message {} for session {}: {}", message_id, session.session_id(), e.what());
+                    metrics.add(SecureComm::MetricCounter::MESSAGE_ERRORS);
+                    send_error(client_socket, SecureComm::ErrorCode::DECRYPTION_FAILED);
+                    break;
+                }
+
+                std::string text;
+                if (message.flags() & SecureComm::FLAG_COMPRESSED) {
+                    // A message that fails to inflate leaves the stream unusable
+                    SecureComm::StageSpan span(SecureComm::TraceStage::DECOMPRESS, session.session_id(), message_id);
+                    SecureComm::BufferPool::Buffer plaintext;
+                    if (!profile.compress ||
+                        !decompressor.decompress(decrypted_data, profile.max_frame_size, plaintext)) {
+                        metrics.add(SecureComm::MetricCounter::MESSAGE_ERRORS);
+                        send_error(client_socket, SecureComm::ErrorCode::INVALID_MESSAGE);
+                        break;
+                    }
+                    text.assign(plaintext.data(), plaintext.data() + plaintext.size());
+                } else {
+                    text.assign(decrypted_data.begin(), decrypted_data.end());
+                }
+
+                // Process message and send response
+                std::string response;
+                {
+                    SecureComm::StageSpan span(SecureComm::TraceStage::HANDLER, session.session_id(), message_id);
+                    session.touch();
+                    response = process_message(session.client_id(), text);
+                }
+                send_encrypted_message(client_socket, session, profile, compressor, send_chain, response);
+
+            } else if (message.type() == SecureComm::MessageType::KEY_ROTATION) {
+                SecureComm::record_stage(SecureComm::TraceStage::RECV, session.session_id(), 0,
+                                         header_ticks, received_ticks);
+                // Handle key rotation request and re-seed both chains
+                SecureComm::StageSpan span(SecureComm::TraceStage::ROTATE, session.session_id());
+                current_key = session.rotate_key(*crypto_manager_);
+                session_manager_->persist_session(session);
+                recv_chain.reset(current_key, SecureComm::RATCHET_LABEL_CLIENT_TO_SERVER);
+                send_chain.reset(current_key, SecureComm::RATCHET_LABEL_SERVER_TO_CLIENT);
+                OPENSSL_cleanse(current_key.data(), current_key.size());
+                metrics.add(SecureComm::MetricCounter::KEY_ROTATIONS);
+                SC_LOG_INFO("Key rotation completed for session {}", session.session_id());
+
+                // Send key rotation confirmation
+                send_key_rotation_response(client_socket, session);
+
+            } else if (message.type() == SecureComm::MessageType::ERROR_MESSAGE) {
+                SC_LOG_WARN("Received error message from client");
+                break;
+
+            } else {
+                SC_LOG_WARN("Unknown message type: {}", static_cast<int>(message.type()));
+                metrics.add(SecureComm::MetricCounter::MESSAGE_ERRORS);
+                send_error(client_socket, SecureComm::ErrorCode::INVALID_MESSAGE);
+            }
+
+        } catch (const std::exception& e) {
+            SC_LOG_ERROR("Error handling encrypted message: {}", e.what());
+            metrics.add(SecureComm::MetricCounter::MESSAGE_ERRORS);
+            send_error(client_socket, SecureComm::ErrorCode::INTERNAL_ERROR);
+            break;
+        }
+    }
+}
+
+std::string SecureServer::process_message(uint32_t client_id, const std::string& message) {
+    SC_LOG_DEBUG("Received encrypted message from client {}: {}", client_id, message);
+    return "Server received: " + message;
+}
+
+void SecureServer::send_encrypted_message(int client_socket, const SecureComm::Session& session,
+                                          const SecureComm::SessionProfile& profile,
+                                          SecureComm::MessageCompressor& compressor,
+                                          SecureComm::ChainKeyRatchet& send_chain, const std::string& message) {
+    try {
+        const uint32_t session_id = session.session_id();
+        std::vector<uint8_t> message_data(message.begin(), message.end());
+        // Compress only what fits the frame even if it does not shrink: once
+        // compressed, a message the client never receives desyncs the stream
+        uint16_t extra_flags = 0;
+        uint64_t compress_ticks = 0;
+        if (profile.compress && message_data.size() >= SecureComm::COMPRESSION_THRESHOLD &&
+            message_data.size() + SecureComm::COMPRESSION_OVERHEAD + SecureComm::GCM_TAG_SIZE <= profile.max_frame_size) {
+            compress_ticks = SecureComm::read_ticks();
+            message_data = compressor.compress(message_data);
+            extra_flags = SecureComm::FLAG_COMPRESSED;
+        }
+        // The message id comes from the ratchet, so compression is recorded afterwards
+        uint64_t encrypt_ticks = SecureComm::read_ticks();
+        uint32_t message_id = 0;
+        std::vector<uint8_t> key = send_chain.next_message_key(&message_id);
+        if (compress_ticks != 0) {
+            SecureComm::record_stage(SecureComm::TraceStage::COMPRESS, session_id, message_id,
+                                     compress_ticks, encrypt_ticks);
+        }
+
+        std::vector<uint8_t> iv = crypto_manager_->generate_random_bytes(SecureComm::IV_SIZE);
+
+        // Ciphertext || tag must fit the negotiated frame size; the header is
+        // sealed with it as associated data
+        const SecureComm::MessageHeader header = SecureComm::encrypted_message_header(
+            profile, message_id, extra_flags, message_data.size() + SecureComm::GCM_TAG_SIZE);
+        std::vector<uint8_t> encrypted_data;
+        {
+            SecureComm::StageSpan span(SecureComm::TraceStage::ENCRYPT, session_id, message_id);
+            encrypted_data = crypto_manager_->seal_aead(profile.cipher, message_data, key, iv,
+                                                        SecureComm::encrypted_message_aad(header, session_id, message_id));
+        }
+
+        // Sign the encrypted data unless the peer accepts AEAD-only messages
+        std::vector<uint8_t> signature;
+        if (profile.sign_messages) {
+            SecureComm::StageSpan span(SecureComm::TraceStage::SIGN, session_id, message_id);
+            signature = crypto_manager_->sign_data(encrypted_data, server_keypair_.private_key);
+        }
+
+        SecureComm::StageSpan span(SecureComm::TraceStage::SEND, session_id, message_id);
+        std::vector<uint8_t> frame = SecureComm::encode_encrypted_message(profile, header, session_id, message_id,
+                                                                          iv, encrypted_data, signature);
+        if (send_data(client_socket, frame)) {
+            SecureComm::Metrics& metrics = SecureComm::Metrics::instance();
+            metrics.add(SecureComm::MetricCounter::MESSAGES_SENT);
+            metrics.add(SecureComm::MetricCounter::BYTES_SENT, frame.size());
+        }
+
+    } catch (const std::exception& e) {
+        SC_LOG_ERROR("Failed to send encrypted message: {}", e.what());
+        SecureComm::Metrics::instance().add(SecureComm::MetricCounter::MESSAGE_ERRORS);
+    }
+}
+
+void SecureServer::send_key_rotation_response(int client_socket, const SecureComm::Session& session) {
+    SecureComm::MessageHeader header;
+    header.version = SecureComm::ProtocolVersion::V1_0;
+    header.type = SecureComm::MessageType::KEY_ROTATION;
+    header.sequence_number = session.message_counter();
+    header.timestamp = SecureComm::get_current_timestamp_seconds();
+    header.payload_size = 0;
+    header.flags = 0;
+
+    std::vector<uint8_t> response_data = SecureComm::serialize_header(header);
+    send_data(client_socket, response_data);
+}
+
+void SecureServer::send_error(int client_socket, SecureComm::ErrorCode error_code) {
+    SecureComm::MessageHeader header;
+    header.version = SecureComm::ProtocolVersion::V1_0;
+    header.type = SecureComm::MessageType::ERROR_MESSAGE;
+    header.sequence_number = 0;
+    header.timestamp = SecureComm::get_current_timestamp_seconds();
+    std::vector<uint8_t> error_data = SecureComm::serialize_error_code(error_code);
+    header.payload_size = static_cast<uint16_t>(error_data.size());
+    header.flags = 0;
+
+    std::vector<uint8_t> response_data = SecureComm::serialize_header(header);
+    response_data.insert(response_data.end(), error_data.begin(), error_data.end());
+
+    send_data(client_socket, response_data);
+}
+
+std::vector<uint8_t> SecureServer::receive_data(int client_socket, uint64_t* header_ticks) {
+    // One message per call: the header, then the body it announces
+    std::vector<uint8_t> buffer(SecureComm::HEADER_WIRE_SIZE);
+    if (!receive_exact(client_socket, buffer.data(), buffer.size())) {
+        return std::vector<uint8_t>();
+    }
+    if (header_ticks) {
+        *header_ticks = SecureComm::read_ticks();
+    }
+
+    size_t body_size = SecureComm::message_body_size(SecureComm::MessageView(buffer).header());
+    buffer.resize(SecureComm::HEADER_WIRE_SIZE + body_size);
+    if (!receive_exact(client_socket, buffer.data() + SecureComm::HEADER_WIRE_SIZE, body_size)) {
+        return std::vector<uint8_t>();
+    }
+    return buffer;
+}
+
+bool SecureServer::receive_exact(int client_socket, uint8_t* data, size_t size) {
+    size_t received = 0;
+    while (received < size) {
+        int bytes_received = recv(client_socket, reinterpret_cast<char*>(data + received),
+                                  static_cast<int>(size - received), 0);
+        if (bytes_received <= 0) {
+            return false;
+        }
+        received += static_cast<size_t>(bytes_received);
+    }
+    return true;
+}
+
+bool SecureServer::send_data(int client_socket, const std::vector<uint8_t>& data) {
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL; // a client that hangs up before the reply must not SIGPIPE the server
+#else
+    const int flags = 0;
+#endif
+    int bytes_sent = send(client_socket, reinterpret_cast<const char*>(data.data()), static_cast<int>(data.size()), flags);
+    return bytes_sent == static_cast<int>(data.size());
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "common.h"
+#include "../crypto/crypto_utils.h"
+#include "../crypto/compression.h"
+#include "../crypto/handshake_cookie.h"
+#include "../crypto/handshake_pool.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Secure server: accepts clients, runs the handshake (full, resumed by
+// session id or resumed from a ticket) and serves encrypted messages. Used
+// by the server executable, the local cluster harness and the benchmarks.
+class SecureServer {
+public:
+    SecureServer();
+    ~SecureServer();
+
+    // Keep sessions in a memory-mapped log at store_path so they survive restarts
+    bool enable_session_store(const std::string& store_path);
+    // Replicate sessions to the peers in config so clients can resume on any node
+    bool enable_replication(const SecureComm::ReplicationConfig& config);
+    // Run full-handshake key exchange on a bounded worker pool; call before start()
+    bool enable_handshake_pool(const SecureComm::HandshakePoolConfig& config);
+    // Answer full-handshake inits with a stateless cookie challenge while at
+    // least threshold key exchanges are in progress (0 = always); call before start()
+    bool enable_handshake_cookies(size_t threshold);
+    // Drop sessions with no activity on this node for this long; call before start()
+    void set_session_idle_timeout(std::chrono::seconds idle_timeout);
+
+    bool start(uint16_t port = SecureComm::DEFAULT_PORT);
+    void run();
+    void stop();
+
+private:
+    // peer_address is the client's IPv4 address in network byte order
+    void handle_client(int client_socket, uint32_t peer_address, uint64_t accepted_ticks);
+    // Join the connection threads that have finished since the last call
+    void reap_client_threads();
+    // Returns the authenticated session, or nullptr if the handshake failed
+    // or the client was sent a cookie challenge (challenged, if given, tells which)
+    SecureComm::SessionHandle perform_handshake(int client_socket, uint32_t peer_address,
+                                                bool* challenged = nullptr);
+    // Full handshakes only: true if the key exchange may go ahead. Otherwise
+    // the init was answered with a cookie challenge (challenged set) or
+    // carried a bad cookie, and the connection is done
+    bool admit_key_exchange(int client_socket, uint32_t peer_address, uint16_t flags,
+                            const SecureComm::HandshakeView& client_handshake, SecureComm::ByteView trailer,
+                            bool& challenged);
+    // The handshake views point into the received buffer; capabilities is
+    // the negotiated set, sent back in the response and kept on the session
+    SecureComm::SessionHandle perform_key_exchange(int client_socket,
+                                                   const SecureComm::HandshakeView& client_handshake,
+                                                   const SecureComm::Capabilities& capabilities);
+    SecureComm::SessionHandle resume_session(int client_socket,
+                                             const SecureComm::HandshakeView& client_handshake,
+                                             const SecureComm::Capabilities& capabilities);
+    SecureComm::SessionHandle resume_from_ticket(int client_socket,
+                                                 const SecureComm::HandshakeView& client_handshake,
+                                                 const SecureComm::Capabilities& capabilities,
+                                                 SecureComm::ByteView ticket,
+                                                 SecureComm::ByteView early_data);
+    // Finished MAC and server nonce for a resumed handshake
+    bool send_resume_response(int client_socket, const SecureComm::HandshakeView& client_handshake,
+                              const SecureComm::Capabilities& capabilities,
+                              const std::vector<uint8_t>& resumed_key,
+                              const std::vector<uint8_t>& server_nonce, uint16_t flags);
+    // 0-RTT: decrypt the early-data frame sent with a ticket, reply to it
+    bool open_early_data(SecureComm::ByteView frame, SecureComm::ByteView secret,
+                         SecureComm::ByteView client_nonce, SecureComm::ByteView ticket,
+                         std::string& message);
+    bool send_early_response(int client_socket, const std::vector<uint8_t>& resumed_key,
+                             const std::string& response);
+    // Sent once HANDSHAKE_COMPLETE has arrived
+    bool send_session_ticket(int client_socket, const SecureComm::Session& session);
+    // A resumed handshake's COMPLETE must carry the client's finished MAC
+    bool await_handshake_complete(int client_socket, SecureComm::ByteView client_finished = {});
+    void handle_encrypted_messages(int client_socket, SecureComm::Session& session);
+    // Application handling of one decrypted message; returns the reply
+    std::string process_message(uint32_t client_id, const std::string& message);
+    void send_encrypted_message(int client_socket, const SecureComm::Session& session,
+                                const SecureComm::SessionProfile& profile,
+                                SecureComm::MessageCompressor& compressor,
+                                SecureComm::ChainKeyRatchet& send_chain, const std::string& message);
+    void send_key_rotation_response(int client_socket, const SecureComm::Session& session);
+    void send_error(int client_socket, SecureComm::ErrorCode error_code);
+    // Reads exactly one message; empty on disconnect
+    // header_ticks, if given, receives the tick count once the header has arrived
+    std::vector<uint8_t> receive_data(int client_socket, uint64_t* header_ticks = nullptr);
+    bool receive_exact(int client_socket, uint8_t* data, size_t size);
+    bool send_data(int client_socket, const std::vector<uint8_t>& data);
+
+    int server_socket_;
+    std::atomic<bool> running_;
+    std::unique_ptr<SecureComm::CryptoManager> crypto_manager_;
+    // Declared before everything that schedules on it, so it is destroyed last
+    std::unique_ptr<SecureComm::TimerWheel> expiry_wheel_;
+    std::unique_ptr<SecureComm::SessionManager> session_manager_;
+    std::unique_ptr<SecureComm::KeyManager> key_manager_;
+    std::unique_ptr<SecureComm::SessionTicketManager> ticket_manager_;
+    std::shared_ptr<SecureComm::PersistentSessionStore> session_store_;
+    std::shared_ptr<SecureComm::SessionReplicator> replicator_;
+    std::unique_ptr<SecureComm::HandshakePool> handshake_pool_;
+    std::unique_ptr<SecureComm::HandshakeCookies> handshake_cookies_;
+    size_t cookie_threshold_;
+    // Full handshakes between admission and their end
+    std::atomic<size_t> key_exchanges_in_progress_;
+    // Decompressed plaintext, shared by all connections
+    SecureComm::BufferPool message_buffers_;
+    std::vector<std::thread> client_threads_;
+    // Connection threads that have returned and wait to be joined
+    std::mutex finished_threads_mutex_;
+    std::vector<std::thread::id> finished_threads_;
+    std::thread expiry_thread_;
+    SecureComm::KeyPair server_keypair_;
+};
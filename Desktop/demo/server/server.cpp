@@ -1,466 +1,17 @@
 #include "common.h"
-#include "../crypto/crypto_utils.h"
+#include "secure_server.h"
+#include "logger.h"
+#include "metrics_endpoint.h"
+#include <chrono>
 #include <iostream>
-#include <thread>
-#include <vector>
 #include <memory>
 #include <atomic>
-#include <algorithm>
-#include <chrono>
-
-#ifdef _WIN32
-    #include <winsock2.h>
-    #include <ws2tcpip.h>
-    #pragma comment(lib, "ws2_32.lib")
-#else
-    #include <sys/socket.h>
-    #include <netinet/in.h>
-    #include <arpa/inet.h>
-    #include <unistd.h>
-#endif
-
-#include <cstring>
+#include <string>
+#include <vector>
 #include <signal.h>
 
 // using namespace SecureComm; // Removed to avoid namespace conflicts
 
-class SecureServer {
-private:
-    int server_socket_;
-    std::atomic<bool> running_;
-    std::unique_ptr<SecureComm::CryptoManager> crypto_manager_;
-    std::unique_ptr<SecureComm::SessionManager> session_manager_;
-    std::unique_ptr<SecureComm::KeyManager> key_manager_;
-    std::vector<std::thread> client_threads_;
-    SecureComm::KeyPair server_keypair_;
-
-public:
-    SecureServer() : server_socket_(-1), running_(false) {
-#ifdef _WIN32
-        // Initialize Winsock
-        WSADATA wsaData;
-        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-            throw std::runtime_error("WSAStartup failed");
-        }
-#endif
-
-        crypto_manager_ = std::make_unique<SecureComm::CryptoManager>();
-        session_manager_ = std::make_unique<SecureComm::SessionManager>();
-        key_manager_ = std::make_unique<SecureComm::KeyManager>();
-        
-        // Generate server's RSA key pair
-        server_keypair_ = crypto_manager_->generate_rsa_keypair(2048);
-        std::cout << "Server RSA key pair generated successfully" << std::endl;
-    }
-
-    ~SecureServer() {
-        stop();
-#ifdef _WIN32
-        WSACleanup();
-#endif
-    }
-
-    bool start(uint16_t port = SecureComm::DEFAULT_PORT) {
-        server_socket_ = static_cast<int>(socket(AF_INET, SOCK_STREAM, 0));
-        if (server_socket_ < 0) {
-            std::cerr << "Failed to create socket" << std::endl;
-            return false;
-        }
-
-        int opt = 1;
-        if (setsockopt(server_socket_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&opt), sizeof(opt)) < 0) {
-            std::cerr << "Failed to set socket options" << std::endl;
-#ifdef _WIN32
-            closesocket(server_socket_);
-#else
-            close(server_socket_);
-#endif
-            return false;
-        }
-
-        struct sockaddr_in server_addr;
-        server_addr.sin_family = AF_INET;
-        server_addr.sin_addr.s_addr = INADDR_ANY;
-        server_addr.sin_port = htons(port);
-
-        if (bind(server_socket_, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-            std::cerr << "Failed to bind socket" << std::endl;
-#ifdef _WIN32
-            closesocket(server_socket_);
-#else
-            close(server_socket_);
-#endif
-            return false;
-        }
-
-        if (listen(server_socket_, 10) < 0) {
-            std::cerr << "Failed to listen on socket" << std::endl;
-#ifdef _WIN32
-            closesocket(server_socket_);
-#else
-            close(server_socket_);
-#endif
-            return false;
-        }
-
-        running_ = true;
-        std::cout << "Secure server started on port " << port << std::endl;
-        std::cout << "Server public key: " << SecureComm::bytes_to_hex(server_keypair_.public_key).substr(0, 64) << "..." << std::endl;
-
-        // Start cleanup thread
-        std::thread cleanup_thread([this]() {
-            while (running_) {
-                std::this_thread::sleep_for(std::chrono::minutes(5));
-                session_manager_->cleanup_expired_sessions();
-            }
-        });
-        cleanup_thread.detach();
-
-        return true;
-    }
-
-    void run() {
-        while (running_) {
-            struct sockaddr_in client_addr;
-            socklen_t client_len = sizeof(client_addr);
-            
-            int client_socket = static_cast<int>(accept(server_socket_, (struct sockaddr*)&client_addr, &client_len));
-            if (client_socket < 0) {
-                if (running_) {
-                    std::cerr << "Failed to accept client connection" << std::endl;
-                }
-                continue;
-            }
-
-            std::cout << "New client connected from " << inet_ntoa(client_addr.sin_addr) 
-                      << ":" << ntohs(client_addr.sin_port) << std::endl;
-
-            // Handle client in separate thread
-            client_threads_.emplace_back(&SecureServer::handle_client, this, client_socket);
-        }
-    }
-
-    void stop() {
-        running_ = false;
-        
-        if (server_socket_ >= 0) {
-#ifdef _WIN32
-            closesocket(server_socket_);
-#else
-            close(server_socket_);
-#endif
-            server_socket_ = -1;
-        }
-
-        // Wait for all client threads to finish
-        for (auto& thread : client_threads_) {
-            if (thread.joinable()) {
-                thread.join();
-            }
-        }
-        client_threads_.clear();
-    }
-
-private:
-    void handle_client(int client_socket) {
-        try {
-            uint32_t client_id = SecureComm::generate_client_id();
-            SecureComm::SessionInfo session = session_manager_->create_session(client_id);
-            
-            std::cout << "Created session " << session.session_id << " for client " << client_id << std::endl;
-
-            // Perform secure handshake
-            if (!perform_handshake(client_socket, session)) {
-                std::cerr << "Handshake failed for client " << client_id << std::endl;
-#ifdef _WIN32
-                closesocket(client_socket);
-#else
-                close(client_socket);
-#endif
-                return;
-            }
-
-            std::cout << "Handshake completed successfully for client " << client_id << std::endl;
-
-            // Handle encrypted messages
-            handle_encrypted_messages(client_socket, session);
-
-        } catch (const std::exception& e) {
-            std::cerr << "Error handling client: " << e.what() << std::endl;
-        }
-
-#ifdef _WIN32
-        closesocket(client_socket);
-#else
-        close(client_socket);
-#endif
-        std::cout << "Client disconnected" << std::endl;
-    }
-
-    bool perform_handshake(int client_socket, SecureComm::SessionInfo& session) {
-        try {
-            // Step 1: Receive handshake init
-            std::vector<uint8_t> handshake_data = receive_data(client_socket);
-            SecureComm::MessageHeader header = SecureComm::deserialize_header(handshake_data);
-            
-            if (header.type != SecureComm::MessageType::HANDSHAKE_INIT) {
-                std::cerr << "Expected HANDSHAKE_INIT, got " << SecureComm::message_type_to_string(header.type) << std::endl;
-                return false;
-            }
-
-            // Extract handshake message
-            std::vector<uint8_t> payload(handshake_data.begin() + sizeof(SecureComm::MessageHeader), handshake_data.end());
-            SecureComm::HandshakeMessage client_handshake = SecureComm::deserialize_handshake(payload);
-
-            std::cout << "Received handshake init from client " << client_handshake.client_id << std::endl;
-
-            // Step 2: Generate DH key pair for forward secrecy
-            std::cout << "Generating DH key pair..." << std::endl;
-            SecureComm::KeyPair dh_keypair = crypto_manager_->generate_dh_keypair();
-            std::cout << "DH key pair generated successfully" << std::endl;
-            
-            // Step 3: Perform key exchange
-            std::cout << "Performing DH key exchange..." << std::endl;
-            std::vector<uint8_t> client_public_key_vec(client_handshake.public_key, client_handshake.public_key + SecureComm::KEY_SIZE);
-            std::vector<uint8_t> shared_secret = crypto_manager_->perform_dh_key_exchange(
-                dh_keypair.private_key, client_public_key_vec);
-            std::cout << "DH key exchange completed successfully" << std::endl;
-            
-            // Derive session key
-            std::vector<uint8_t> client_nonce_vec(client_handshake.nonce, client_handshake.nonce + SecureComm::IV_SIZE);
-            std::vector<uint8_t> session_key = crypto_manager_->derive_shared_secret(
-                shared_secret, client_nonce_vec);
-
-            // Store session key
-            session_manager_->set_session_key(session.session_id, session_key);
-            session.shared_secret = shared_secret;
-            session.current_key = session_key;
-
-            // Step 4: Send handshake response
-            std::cout << "Sending handshake response..." << std::endl;
-            SecureComm::HandshakeMessage server_handshake;
-            server_handshake.client_id = session.client_id;
-            server_handshake.session_id = session.session_id;
-            server_handshake.fs_type = SecureComm::ForwardSecrecyType::PERFECT_FORWARD_SECRECY;
-            
-            // Copy DH public key
-            size_t key_copy_size = std::min<size_t>(dh_keypair.public_key.size(), SecureComm::KEY_SIZE);
-            std::copy(dh_keypair.public_key.begin(), dh_keypair.public_key.begin() + key_copy_size, server_handshake.public_key);
-            
-            // Copy nonce
-            std::copy(client_handshake.nonce, client_handshake.nonce + SecureComm::IV_SIZE, server_handshake.nonce);
-
-            SecureComm::MessageHeader response_header;
-            response_header.version = SecureComm::ProtocolVersion::V1_0;
-            response_header.type = SecureComm::MessageType::HANDSHAKE_RESPONSE;
-            response_header.sequence_number = 1;
-            response_header.timestamp = SecureComm::get_current_timestamp_seconds();
-            response_header.payload_size = sizeof(SecureComm::HandshakeMessage);
-            response_header.flags = 0;
-
-            std::vector<uint8_t> response_data = SecureComm::serialize_header(response_header);
-            std::vector<uint8_t> handshake_payload = SecureComm::serialize_handshake(server_handshake);
-            response_data.insert(response_data.end(), handshake_payload.begin(), handshake_payload.end());
-
-            if (!send_data(client_socket, response_data)) {
-                std::cerr << "Failed to send handshake response" << std::endl;
-                return false;
-            }
-            std::cout << "Handshake response sent successfully" << std::endl;
-
-            // Step 5: Receive handshake complete
-            std::cout << "Waiting for handshake complete..." << std::endl;
-            std::vector<uint8_t> complete_data = receive_data(client_socket);
-            SecureComm::MessageHeader complete_header = SecureComm::deserialize_header(complete_data);
-            
-            if (complete_header.type != SecureComm::MessageType::HANDSHAKE_COMPLETE) {
-                std::cerr << "Expected HANDSHAKE_COMPLETE, got " << SecureComm::message_type_to_string(complete_header.type) << std::endl;
-                return false;
-            }
-
-            // Authenticate session
-            session_manager_->authenticate_session(session.session_id, std::vector<uint8_t>());
-            session.authenticated = true;
-
-            std::cout << "Handshake completed successfully for session " << session.session_id << std::endl;
-            return true;
-
-        } catch (const std::exception& e) {
-            std::cerr << "Handshake error: " << e.what() << std::endl;
-            return false;
-        }
-    }
-
-    void handle_encrypted_messages(int client_socket, SecureComm::SessionInfo& session) {
-        uint32_t message_counter = 0;
-        
-        while (running_) {
-            try {
-                std::vector<uint8_t> encrypted_data = receive_data(client_socket);
-                if (encrypted_data.empty()) {
-                    break; // Client disconnected
-                }
-
-                SecureComm::MessageHeader header = SecureComm::deserialize_header(encrypted_data);
-                
-                if (header.type == SecureComm::MessageType::ENCRYPTED_MESSAGE) {
-                    // Extract encrypted message
-                    std::vector<uint8_t> payload(encrypted_data.begin() + sizeof(SecureComm::MessageHeader), encrypted_data.end());
-                    SecureComm::EncryptedMessage encrypted_msg = SecureComm::deserialize_encrypted_message(payload);
-
-                    // Verify session
-                    SecureComm::AuthResult auth_result = session_manager_->verify_session_auth(session.session_id, 
-                                                                                  std::vector<uint8_t>(encrypted_msg.signature, 
-                                                                                                      encrypted_msg.signature + SecureComm::SIGNATURE_SIZE));
-                    if (auth_result != SecureComm::AuthResult::SUCCESS) {
-                        std::cerr << "Authentication failed: " << static_cast<int>(auth_result) << std::endl;
-                        send_error(client_socket, SecureComm::ErrorCode::AUTHENTICATION_FAILED);
-                        break;
-                    }
-
-                    // Decrypt message
-                    std::vector<uint8_t> key = session_manager_->get_session_key(session.session_id);
-                    std::vector<uint8_t> iv(encrypted_msg.iv, encrypted_msg.iv + SecureComm::IV_SIZE);
-                    
-                    std::vector<uint8_t> decrypted_data = crypto_manager_->decrypt_aes_gcm(
-                        std::vector<uint8_t>(encrypted_msg.encrypted_data, 
-                                           encrypted_msg.encrypted_data + header.payload_size),
-                        key, iv);
-
-                    // Process message
-                    std::string message(decrypted_data.begin(), decrypted_data.end());
-                    std::cout << "Received encrypted message from client " << session.client_id 
-                              << ": " << message << std::endl;
-
-                    // Send response
-                    std::string response = "Server received: " + message;
-                    send_encrypted_message(client_socket, session, response);
-
-                    message_counter++;
-                    
-                    // Rotate key every 10 messages for forward secrecy
-                    if (message_counter % 10 == 0) {
-                        session_manager_->rotate_session_key(session.session_id);
-                        std::cout << "Key rotated for session " << session.session_id << std::endl;
-                    }
-
-                } else if (header.type == SecureComm::MessageType::KEY_ROTATION) {
-                    // Handle key rotation request
-                    session_manager_->rotate_session_key(session.session_id);
-                    std::cout << "Key rotation completed for session " << session.session_id << std::endl;
-                    
-                    // Send key rotation confirmation
-                    send_key_rotation_response(client_socket, session);
-
-                } else if (header.type == SecureComm::MessageType::ERROR_MESSAGE) {
-                    std::cerr << "Received error message from client" << std::endl;
-                    break;
-
-                } else {
-                    std::cerr << "Unknown message type: " << static_cast<int>(header.type) << std::endl;
-                    send_error(client_socket, SecureComm::ErrorCode::INVALID_MESSAGE);
-                }
-
-            } catch (const std::exception& e) {
-                std::cerr << "Error handling encrypted message: " << e.what() << std::endl;
-                send_error(client_socket, SecureComm::ErrorCode::INTERNAL_ERROR);
-                break;
-            }
-        }
-    }
-
-    void send_encrypted_message(int client_socket, const SecureComm::SessionInfo& session, const std::string& message) {
-        try {
-            std::vector<uint8_t> message_data(message.begin(), message.end());
-            std::vector<uint8_t> key = session_manager_->get_session_key(session.session_id);
-            std::vector<uint8_t> iv = crypto_manager_->generate_random_bytes(SecureComm::IV_SIZE);
-            
-            std::vector<uint8_t> encrypted_data = crypto_manager_->encrypt_aes_gcm(message_data, key, iv);
-            
-            SecureComm::EncryptedMessage encrypted_msg;
-            encrypted_msg.session_id = session.session_id;
-            encrypted_msg.message_id = session.message_counter;
-            
-            // Copy IV
-            size_t iv_copy_size = std::min<size_t>(iv.size(), SecureComm::IV_SIZE);
-            std::copy(iv.begin(), iv.begin() + iv_copy_size, encrypted_msg.iv);
-            
-            // Copy encrypted data
-            size_t data_copy_size = std::min<size_t>(encrypted_data.size(), SecureComm::MAX_MESSAGE_SIZE);
-            std::copy(encrypted_data.begin(), encrypted_data.begin() + data_copy_size, encrypted_msg.encrypted_data);
-            
-            // Sign the encrypted data
-            std::vector<uint8_t> signature = crypto_manager_->sign_data(encrypted_data, server_keypair_.private_key);
-            size_t sig_copy_size = std::min<size_t>(signature.size(), SecureComm::SIGNATURE_SIZE);
-            std::copy(signature.begin(), signature.begin() + sig_copy_size, encrypted_msg.signature);
-
-            SecureComm::MessageHeader header;
-            header.version = SecureComm::ProtocolVersion::V1_0;
-            header.type = SecureComm::MessageType::ENCRYPTED_MESSAGE;
-            header.sequence_number = session.message_counter;
-            header.timestamp = SecureComm::get_current_timestamp_seconds();
-            header.payload_size = static_cast<uint16_t>(encrypted_data.size());
-            header.flags = 0;
-
-            std::vector<uint8_t> response_data = SecureComm::serialize_header(header);
-            std::vector<uint8_t> msg_payload = SecureComm::serialize_encrypted_message(encrypted_msg);
-            response_data.insert(response_data.end(), msg_payload.begin(), msg_payload.end());
-
-            send_data(client_socket, response_data);
-
-        } catch (const std::exception& e) {
-            std::cerr << "Failed to send encrypted message: " << e.what() << std::endl;
-        }
-    }
-
-    void send_key_rotation_response(int client_socket, const SecureComm::SessionInfo& session) {
-        SecureComm::MessageHeader header;
-        header.version = SecureComm::ProtocolVersion::V1_0;
-        header.type = SecureComm::MessageType::KEY_ROTATION;
-        header.sequence_number = session.message_counter;
-        header.timestamp = SecureComm::get_current_timestamp_seconds();
-        header.payload_size = 0;
-        header.flags = 0;
-
-        std::vector<uint8_t> response_data = SecureComm::serialize_header(header);
-        send_data(client_socket, response_data);
-    }
-
-    void send_error(int client_socket, SecureComm::ErrorCode error_code) {
-        SecureComm::MessageHeader header;
-        header.version = SecureComm::ProtocolVersion::V1_0;
-        header.type = SecureComm::MessageType::ERROR_MESSAGE;
-        header.sequence_number = 0;
-        header.timestamp = SecureComm::get_current_timestamp_seconds();
-        header.payload_size = sizeof(SecureComm::ErrorCode);
-        header.flags = 0;
-
-        std::vector<uint8_t> response_data = SecureComm::serialize_header(header);
-        std::vector<uint8_t> error_data(reinterpret_cast<const uint8_t*>(&error_code), 
-                                       reinterpret_cast<const uint8_t*>(&error_code) + sizeof(SecureComm::ErrorCode));
-        response_data.insert(response_data.end(), error_data.begin(), error_data.end());
-
-        send_data(client_socket, response_data);
-    }
-
-    std::vector<uint8_t> receive_data(int client_socket) {
-        std::vector<uint8_t> buffer(4096);
-        int bytes_received = recv(client_socket, reinterpret_cast<char*>(buffer.data()), static_cast<int>(buffer.size()), 0);
-        
-        if (bytes_received <= 0) {
-            return std::vector<uint8_t>();
-        }
-        
-        buffer.resize(bytes_received);
-        return buffer;
-    }
-
-    bool send_data(int client_socket, const std::vector<uint8_t>& data) {
-        int bytes_sent = send(client_socket, reinterpret_cast<const char*>(data.data()), static_cast<int>(data.size()), 0);
-        return bytes_sent == static_cast<int>(data.size());
-    }
-};
-
 std::atomic<bool> g_running(true);
 
 void signal_handler(int signal) {
@@ -476,18 +27,138 @@ int main(int argc, char* argv[]) {
 
     // Parse command line arguments
     uint16_t port = SecureComm::DEFAULT_PORT;
-    if (argc > 1) {
+    std::string session_store_path;
+    std::string cluster_key_path;
+    SecureComm::ReplicationConfig replication;
+    bool metrics_log = false;
+    SecureComm::MetricsEndpointConfig metrics_endpoint_config;
+    bool handshake_pool = false;
+    SecureComm::HandshakePoolConfig handshake_pool_config;
+    bool handshake_cookies = false;
+    size_t cookie_threshold = 0;
+    std::chrono::seconds idle_timeout = SecureComm::SESSION_IDLE_TIMEOUT;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
         try {
-            port = static_cast<uint16_t>(std::stoi(argv[1]));
+            if (arg == "--session-store" && i + 1 < argc) {
+                session_store_path = argv[++i];
+            } else if (arg == "--node-id" && i + 1 < argc) {
+                replication.node_id = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (arg == "--replication-port" && i + 1 < argc) {
+                replication.listen_port = static_cast<uint16_t>(std::stoi(argv[++i]));
+            } else if (arg == "--replication-bind" && i + 1 < argc) {
+                // Address peers reach this node on; defaults to 127.0.0.1
+                replication.listen_address = argv[++i];
+            } else if (arg == "--peer" && i + 1 < argc) {
+                // host:port of another node's replication listener
+                std::string peer = argv[++i];
+                size_t colon = peer.rfind(':');
+                if (colon == std::string::npos) {
+                    throw std::invalid_argument(peer);
+                }
+                replication.peers.push_back({peer.substr(0, colon),
+                                             static_cast<uint16_t>(std::stoi(peer.substr(colon + 1)))});
+            } else if (arg == "--cluster-key" && i + 1 < argc) {
+                cluster_key_path = argv[++i];
+            } else if (arg == "--log-level" && i + 1 < argc) {
+                // Runtime filter; levels below SECURECOMM_LOG_LEVEL are compiled out
+                std::string level = argv[++i];
+                if (level == "debug") {
+                    SecureComm::Logger::instance().set_level(SecureComm::LogLevel::DEBUG);
+                } else if (level == "info") {
+                    SecureComm::Logger::instance().set_level(SecureComm::LogLevel::INFO);
+                } else if (level == "warn") {
+                    SecureComm::Logger::instance().set_level(SecureComm::LogLevel::WARN);
+                } else if (level == "error") {
+                    SecureComm::Logger::instance().set_level(SecureComm::LogLevel::ERR);
+                } else {
+                    throw std::invalid_argument(level);
+                }
+            } else if (arg == "--trace-dump" && i + 1 < argc) {
+                // kill -USR1 <pid> writes <prefix>.<n>.trace
+                SecureComm::Tracer::instance().dump_on_signal(argv[++i]);
+            } else if (arg == "--metrics-log") {
+                // Per-stage percentiles at INFO every second
+                metrics_log = true;
+            } else if (arg == "--metrics-port" && i + 1 < argc) {
+                // Prometheus scrapes on 127.0.0.1:<port>
+                metrics_endpoint_config.port = static_cast<uint16_t>(std::stoi(argv[++i]));
+            } else if (arg == "--metrics-socket" && i + 1 < argc) {
+                metrics_endpoint_config.unix_path = argv[++i];
+            } else if (arg == "--handshake-workers" && i + 1 < argc) {
+                // 0 = half the hardware threads
+                handshake_pool = true;
+                handshake_pool_config.workers = std::stoul(argv[++i]);
+            } else if (arg == "--handshake-queue" && i + 1 < argc) {
+                handshake_pool = true;
+                handshake_pool_config.max_queue = std::stoul(argv[++i]);
+            } else if (arg == "--cookie-threshold" && i + 1 < argc) {
+                // Key exchanges in progress before inits get a cookie challenge; 0 = always
+                handshake_cookies = true;
+                cookie_threshold = std::stoul(argv[++i]);
+            } else if (arg == "--idle-timeout" && i + 1 < argc) {
+                // Seconds without activity before a session is dropped
+                idle_timeout = std::chrono::seconds(std::stoul(argv[++i]));
+            } else {
+                port = static_cast<uint16_t>(std::stoi(arg));
+            }
         } catch (const std::exception& e) {
-            std::cerr << "Invalid port number: " << argv[1] << std::endl;
-            std::cerr << "Usage: " << argv[0] << " [port]" << std::endl;
+            std::cerr << "Invalid argument: " << arg << std::endl;
+            std::cerr << "Usage: " << argv[0] << " [port] [--session-store <path>] [--log-level debug|info|warn|error]"
+                      << " [--trace-dump <prefix>] [--metrics-log]"
+                      << " [--metrics-port <port> | --metrics-socket <path>]"
+                      << " [--handshake-workers <n>] [--handshake-queue <n>] [--cookie-threshold <n>]"
+                      << " [--idle-timeout <seconds>]"
+                      << " [--node-id <id> --cluster-key <path> [--replication-port <port>] [--replication-bind <addr>] [--peer <host:port>]...]"
+                      << std::endl;
+            return 1;
+        }
+    }
+    bool replicate = replication.listen_port != 0 || !replication.peers.empty();
+    if (replicate && cluster_key_path.empty()) {
+        std::cerr << "Replication requires --cluster-key" << std::endl;
+        return 1;
+    }
+    if (replicate) {
+        // Every node must use the same key file. Never created here: a
+        // mistyped path would give this node a key no peer shares
+        try {
+            replication.cluster_key = SecureComm::PersistentSessionStore::load_key(cluster_key_path);
+        } catch (const SecureComm::CryptoException& e) {
+            std::cerr << "Cannot load --cluster-key: " << e.what() << std::endl;
             return 1;
         }
     }
 
+    // Merged counters and stage histograms, published once a second
+    SecureComm::Metrics::instance().start(std::chrono::milliseconds(1000), metrics_log);
+
     try {
+        std::unique_ptr<SecureComm::MetricsEndpoint> metrics_endpoint;
+        if (metrics_endpoint_config.port != 0 || !metrics_endpoint_config.unix_path.empty()) {
+            metrics_endpoint = std::make_unique<SecureComm::MetricsEndpoint>(metrics_endpoint_config);
+            metrics_endpoint->start();
+        }
+
         SecureServer server;
+        server.set_session_idle_timeout(idle_timeout);
+
+        if (!session_store_path.empty() && !server.enable_session_store(session_store_path)) {
+            return 1;
+        }
+
+        if (handshake_pool && !server.enable_handshake_pool(handshake_pool_config)) {
+            return 1;
+        }
+        if (handshake_cookies && !server.enable_handshake_cookies(cookie_threshold)) {
+            return 1;
+        }
+
+        if (replicate) {
+            if (!server.enable_replication(replication)) {
+                return 1;
+            }
+        }
         
         if (!server.start(port)) {
             std::cerr << "Failed to start server" << std::endl;
@@ -498,9 +169,9 @@ int main(int argc, char* argv[]) {
         std::cout << "Features:" << std::endl;
         std::cout << "- RSA-2048 key exchange" << std::endl;
         std::cout << "- AES-256-GCM encryption" << std::endl;
-        std::cout << "- Perfect Forward Secrecy with DH key exchange" << std::endl;
-        std::cout << "- Session authentication" << std::endl;
-        std::cout << "- Automatic key rotation" << std::endl;
+        std::cout << "- Perfect Forward Secrecy with X25519 key exchange" << std::endl;
+        std::cout << "- Session authentication and resumption" << std::endl;
+        std::cout << "- Per-message keys via symmetric hash ratchet" << std::endl;
         std::cout << "- Digital signatures" << std::endl;
         std::cout << "Press Ctrl+C to stop" << std::endl;
 
@@ -0,0 +1,141 @@
+#include "trace.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Converts a trace dump written by the server (Tracer::dump, or SIGUSR1 with
+// --trace-dump) into Chrome trace JSON for chrome://tracing or Perfetto, or
+// prints per-stage latency percentiles.
+//
+//   trace_convert chrome <dump> <out.json>
+//   trace_convert report <dump>
+
+namespace {
+
+double to_us(const SecureComm::TraceDump& dump, uint64_t ticks) {
+    return static_cast<double>(ticks) * dump.ns_per_tick / 1000.0;
+}
+
+// Wall-clock nanoseconds of a tick count
+int64_t wall_ns(const SecureComm::TraceDump& dump, uint64_t ticks) {
+    int64_t elapsed = static_cast<int64_t>(ticks - dump.base_ticks);
+    return dump.base_wall_ns + static_cast<int64_t>(static_cast<double>(elapsed) * dump.ns_per_tick);
+}
+
+int write_chrome(const SecureComm::TraceDump& dump, const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Cannot write " << path << std::endl;
+        return 1;
+    }
+    // Timestamps count from the earliest event; microseconds since the epoch
+    // would not keep sub-microsecond precision in a double
+    uint64_t origin = UINT64_MAX;
+    for (const SecureComm::TraceDump::Thread& thread : dump.threads) {
+        for (const SecureComm::TraceEvent& event : thread.events) {
+            origin = std::min(origin, event.start_ticks);
+        }
+    }
+    if (origin == UINT64_MAX) {
+        origin = dump.base_ticks;
+    }
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"origin_wall_ns\":" << wall_ns(dump, origin)
+        << "},\"traceEvents\":[\n";
+    bool first = true;
+    size_t events = 0;
+    for (const SecureComm::TraceDump::Thread& thread : dump.threads) {
+        for (const SecureComm::TraceEvent& event : thread.events) {
+            out << (first ? "" : ",\n") << "{\"name\":\"" << SecureComm::trace_stage_name(event.stage)
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread.thread_index
+                << ",\"ts\":" << to_us(dump, event.start_ticks - origin)
+                << ",\"dur\":" << to_us(dump, event.duration_ticks)
+                << ",\"args\":{\"session\":" << event.session_id << ",\"message\":" << event.message_id << "}}";
+            first = false;
+            events++;
+        }
+    }
+    out << "\n]}\n";
+    if (!out) {
+        std::cerr << "Cannot write " << path << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << events << " events from " << dump.threads.size() << " threads to " << path
+              << std::endl;
+    return 0;
+}
+
+double percentile(const std::vector<double>& sorted, double fraction) {
+    size_t index = static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+int print_report(const SecureComm::TraceDump& dump) {
+    const size_t stages = static_cast<size_t>(SecureComm::TraceStage::STAGE_COUNT);
+    std::vector<std::vector<double>> durations(stages);
+    for (const SecureComm::TraceDump::Thread& thread : dump.threads) {
+        for (const SecureComm::TraceEvent& event : thread.events) {
+            size_t stage = static_cast<size_t>(event.stage);
+            if (stage < stages) {
+                durations[stage].push_back(to_us(dump, event.duration_ticks));
+            }
+        }
+    }
+
+    std::cout << "Per-stage latency, microseconds (" << dump.threads.size() << " threads)" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::left << std::setw(20) << "stage" << std::right << std::setw(10) << "count"
+              << std::setw(10) << "mean" << std::setw(10) << "p50" << std::setw(10) << "p90"
+              << std::setw(10) << "p99" << std::setw(10) << "max" << std::endl;
+    for (size_t stage = 0; stage < stages; ++stage) {
+        std::vector<double>& values = durations[stage];
+        if (values.empty()) {
+            continue;
+        }
+        std::sort(values.begin(), values.end());
+        double sum = 0;
+        for (double value : values) {
+            sum += value;
+        }
+        std::cout << std::left << std::setw(20) << SecureComm::trace_stage_name(static_cast<SecureComm::TraceStage>(stage))
+                  << std::right << std::setw(10) << values.size()
+                  << std::setw(10) << sum / static_cast<double>(values.size())
+                  << std::setw(10) << percentile(values, 0.50) << std::setw(10) << percentile(values, 0.90)
+                  << std::setw(10) << percentile(values, 0.99) << std::setw(10) << values.back() << std::endl;
+    }
+    return 0;
+}
+
+void usage(const char* program) {
+    std::cerr << "Usage: " << program << " chrome <dump> <out.json>" << std::endl;
+    std::cerr << "       " << program << " report <dump>" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+    std::string command = argv[1];
+    try {
+        SecureComm::TraceDump dump = SecureComm::Tracer::read_dump(argv[2]);
+        if (command == "chrome" && argc > 3) {
+            return write_chrome(dump, argv[3]);
+        }
+        if (command == "report") {
+            return print_report(dump);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    usage(argv[0]);
+    return 1;
+}